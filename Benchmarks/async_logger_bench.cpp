@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../amf/async_logger.h"
+#include "bench.h"
+
+using namespace amf;
+
+static const char* kLogPath = "async_logger_bench.log";
+static const char kLine[] =
+    "[INFO][20261017 10:00:00.000000][1234](amf_encoder.cpp:571): Frame 1, P, QP: 27, "
+    "size: 5123 B, Target:1000 kbps, 4166 B, 30 FPS\n";
+
+// What amf::log did before the logger, for every line
+static void writeOpenPerLine(const char* line, size_t size) {
+    std::FILE* file = std::fopen(kLogPath, "a");
+    if (file) {
+        std::fwrite(line, 1, size, file);
+        std::fclose(file);
+    }
+}
+
+// Mean cost of a call over bursts of 200 lines per thread, with a pause after each burst the
+// flusher keeps up with, as an encoder logging its frames
+template <typename Write> static double perLine(Write write, int threads, int bursts) {
+    static constexpr int kBurstLines = 200;
+    std::vector<double> seconds(threads);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; t++) {
+        writers.emplace_back([&, t]() {
+            for (int burst = 0; burst < bursts; burst++) {
+                const auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < kBurstLines; i++) {
+                    write(kLine, sizeof(kLine) - 1);
+                }
+                seconds[t] += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                            start)
+                                  .count();
+                std::this_thread::sleep_for(std::chrono::milliseconds(60));
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    double sum = 0;
+    for (double value : seconds) {
+        sum += value;
+    }
+    return sum / threads / bursts / kBurstLines;
+}
+
+BENCH(async_logger) {
+    for (int threads : {1, 4}) {
+        std::remove(kLogPath);
+        const double open = perLine(writeOpenPerLine, threads, 5);
+        std::remove(kLogPath);
+        AsyncLogger::Options options;
+        options.path = kLogPath;
+        AsyncLogger logger(options);
+        const double async = perLine(
+            [&](const char* line, size_t size) { logger.write(line, size); }, threads, 5);
+        logger.stop();
+        std::printf("  %d thread(s): fopen per line %7.0f ns, async %4.0f ns per line\n", threads,
+                    open * 1e9, async * 1e9);
+    }
+    // Overload, 8 threads as fast as they can into small rings, the excess is dropped
+    std::remove(kLogPath);
+    AsyncLogger::Options options;
+    options.path = kLogPath;
+    options.ring_bytes = 16 * 1024;
+    AsyncLogger logger(options);
+    static constexpr int kLines = 200 * 1000;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 8; t++) {
+        writers.emplace_back([&]() {
+            for (int i = 0; i < kLines; i++) {
+                logger.write(kLine, sizeof(kLine) - 1);
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    logger.stop();
+    std::printf("  overload, 8 threads: %4.0f ns per line, %llu of %d dropped\n",
+                seconds * 1e9 / kLines / 8, static_cast<unsigned long long>(logger.dropped()),
+                kLines * 8);
+    std::remove(kLogPath);
+    std::remove((std::string(kLogPath) + ".1").c_str());
+}
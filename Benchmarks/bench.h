@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Benchmarks of the parts of amf/ that do not need a GPU or the AMF runtime.
+// A BENCH registers itself with main.cpp and prints its own results.
+namespace bench {
+
+using BenchFunc = void (*)();
+
+struct Registrar {
+    Registrar(const char* name, BenchFunc func);
+};
+
+// Seconds per call of `func`, the best of `repeats` runs of `iterations` calls
+template <typename Func> double measure(Func&& func, int iterations, int repeats = 3) {
+    double best = 0;
+    for (int r = 0; r < repeats; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            func();
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const double seconds = elapsed.count() / iterations;
+        if (r == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+// Keeps the compiler from dropping a result nobody reads
+void consume(const void* data);
+
+} // namespace bench
+
+#define BENCH(name)                                                                                \
+    static void name();                                                                            \
+    static bench::Registrar name##_registrar(#name, name);                                         \
+    static void name()
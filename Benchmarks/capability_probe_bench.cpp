@@ -0,0 +1,107 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../amf/capability_probe.h"
+#include "bench.h"
+
+using namespace amf;
+using Kind = CapabilityProbe::Kind;
+
+// Stand-in for the AMF factory with the timings of a discrete gpu: one device and context, then
+// a component per codec whose caps are read
+class FakeFactory {
+public:
+    bool query(Kind kind, amf_codec_type type, const std::atomic<bool>& cancelled,
+               AmfCodecCapbility* capbility) {
+        std::call_once(context_, []() { sleepMs(60); });
+        if (cancelled) {
+            return false;
+        }
+        int ms = 80;
+        if (kind == Kind::ENCODER) {
+            ms = type == amf_codec_type::AVC ? 150 : type == amf_codec_type::HEVC ? 170 : 200;
+        }
+        sleepMs(ms);
+        capbility->max_width = 4096;
+        capbility->max_height = 2176;
+        capbility->vertical_align = 16;
+        return type != amf_codec_type::AV1;
+    }
+
+private:
+    static void sleepMs(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+    std::once_flag context_;
+};
+
+static const std::vector<CapabilityProbe::Codec> kCodecs = {
+    {Kind::ENCODER, amf_codec_type::AVC},  {Kind::ENCODER, amf_codec_type::HEVC},
+    {Kind::ENCODER, amf_codec_type::AV1},  {Kind::DECODER, amf_codec_type::AVC},
+    {Kind::DECODER, amf_codec_type::HEVC}, {Kind::DECODER, amf_codec_type::AV1}};
+
+static double elapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since)
+        .count();
+}
+
+// Time until the AVC encoder caps are known, with every codec probed one after the other as
+// AmfModule::doInit did, and with CapabilityProbe
+BENCH(capability_probe_startup) {
+    AmfCodecCapbility capbility;
+    double serial = 0;
+    double parallel = 0;
+    double parallel_all = 0;
+    double cancel = 0;
+    const double serial_all = bench::measure(
+        [&] {
+            FakeFactory factory;
+            std::atomic<bool> cancelled{false};
+            const auto start = std::chrono::steady_clock::now();
+            for (const auto& codec : kCodecs) {
+                factory.query(codec.first, codec.second, cancelled, &capbility);
+                if (codec.first == Kind::ENCODER && codec.second == amf_codec_type::AVC) {
+                    serial = elapsedMs(start);
+                }
+            }
+        },
+        1);
+    bench::measure(
+        [&] {
+            FakeFactory factory;
+            const auto start = std::chrono::steady_clock::now();
+            CapabilityProbe probe([&](Kind kind, amf_codec_type type,
+                                      const std::atomic<bool>& cancelled,
+                                      AmfCodecCapbility* out) {
+                return factory.query(kind, type, cancelled, out);
+            });
+            probe.start(kCodecs);
+            probe.capbility(Kind::ENCODER, amf_codec_type::AVC, &capbility);
+            parallel = elapsedMs(start);
+            probe.wait();
+            parallel_all = elapsedMs(start);
+        },
+        1);
+    // Shut down while the device is still being created
+    bench::measure(
+        [&] {
+            FakeFactory factory;
+            auto probe = std::make_unique<CapabilityProbe>(
+                [&](Kind kind, amf_codec_type type, const std::atomic<bool>& cancelled,
+                    AmfCodecCapbility* out) {
+                    return factory.query(kind, type, cancelled, out);
+                });
+            probe->start(kCodecs);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            const auto start = std::chrono::steady_clock::now();
+            probe = nullptr;
+            cancel = elapsedMs(start);
+        },
+        1);
+    std::printf("  serial    avc caps %4.0f ms, all %4.0f ms\n", serial, serial_all * 1e3);
+    std::printf("  parallel  avc caps %4.0f ms, all %4.0f ms\n", parallel, parallel_all);
+    std::printf("  cancelled during device creation, shut down in %.0f ms\n", cancel);
+}
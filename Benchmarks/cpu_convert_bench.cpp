@@ -0,0 +1,54 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../amf/cpu_convert.h"
+#include "../amf/plane_copy.h"
+#include "bench.h"
+
+using namespace amf;
+
+static constexpr uint32_t kWidth = 1920;
+static constexpr uint32_t kHeight = 1080;
+
+// BGRA -> NV12 of a 1080p frame at every simd level this cpu has
+BENCH(cpu_convert) {
+    std::mt19937 rng(1);
+    std::vector<uint8_t> bgra(kWidth * kHeight * 4);
+    for (uint8_t& b : bgra) {
+        b = static_cast<uint8_t>(rng());
+    }
+    std::vector<uint8_t> y(kWidth * kHeight);
+    std::vector<uint8_t> uv(kWidth * kHeight / 2);
+    const SimdLevel levels[] = {SimdLevel::SCALAR, SimdLevel::SSE41, SimdLevel::AVX2,
+                                SimdLevel::AVX512, SimdLevel::NEON};
+    SimdLevel done = SimdLevel::AUTO;
+    for (SimdLevel level : levels) {
+        const BgraToNv12Converter converter(level);
+        // Unsupported levels clamp down to one already measured
+        if (converter.level() != level || converter.level() == done) {
+            continue;
+        }
+        done = converter.level();
+        const double seconds = bench::measure(
+            [&] {
+                converter.convert(bgra.data(), kWidth * 4, kWidth, kHeight, y.data(), kWidth,
+                                  uv.data(), kWidth);
+            },
+            30);
+        bench::consume(y.data());
+        std::printf("  %-7s %7.3f ms  %5.2f GB/s of bgra\n", simdLevelStr(level), seconds * 1e3,
+                    bgra.size() / seconds / 1e9);
+    }
+}
+
+// Edge replication of a 1918x1078 picture into a 1920x1088 surface
+BENCH(pad_nv12) {
+    const uint32_t pitch = 2048;
+    std::vector<uint8_t> y(pitch * 1088, 16);
+    std::vector<uint8_t> uv(pitch * 544, 128);
+    const double seconds = bench::measure(
+        [&] { padNv12(y.data(), pitch, uv.data(), pitch, 1918, 1078, 1920, 1088); }, 1000);
+    bench::consume(y.data());
+    std::printf("  %7.2f us\n", seconds * 1e6);
+}
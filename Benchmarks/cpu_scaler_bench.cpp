@@ -0,0 +1,62 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../amf/cpu_scaler.h"
+#include "bench.h"
+
+using namespace amf;
+
+static const char* modeStr(CpuScaler::Mode mode) {
+    switch (mode) {
+    case CpuScaler::Mode::AREA:
+        return "area";
+    case CpuScaler::Mode::BICUBIC:
+        return "bicubic";
+    case CpuScaler::Mode::LANCZOS:
+        return "lanczos";
+    default:
+        return "bilinear";
+    }
+}
+
+// NV12 frames through every filter, scalar against the best simd level of this cpu
+BENCH(cpu_scaler_nv12) {
+    const uint32_t sizes[][4] = {{1920, 1080, 1280, 720}, {1280, 720, 1920, 1080},
+                                 {3840, 2160, 1920, 1080}};
+    const CpuScaler::Mode modes[] = {CpuScaler::Mode::BILINEAR, CpuScaler::Mode::AREA,
+                                     CpuScaler::Mode::BICUBIC, CpuScaler::Mode::LANCZOS};
+    std::mt19937 rng(6);
+    for (const auto& size : sizes) {
+        const uint32_t src_width = size[0];
+        const uint32_t src_height = size[1];
+        const uint32_t dst_width = size[2];
+        const uint32_t dst_height = size[3];
+        std::vector<uint8_t> src(static_cast<size_t>(src_width) * src_height * 3 / 2);
+        for (uint8_t& b : src) {
+            b = static_cast<uint8_t>(rng());
+        }
+        std::vector<uint8_t> dst(static_cast<size_t>(dst_width) * dst_height * 3 / 2);
+        for (CpuScaler::Mode mode : modes) {
+            double ms[2] = {0, 0};
+            const SimdLevel levels[] = {SimdLevel::SCALAR, SimdLevel::AUTO};
+            for (int i = 0; i < 2; i++) {
+                CpuScaler scaler(mode, levels[i], ChromaSiting::LEFT);
+                ms[i] = bench::measure(
+                            [&] {
+                                scaler.scaleNv12(src.data(), src_width,
+                                                 src.data() + src_width * src_height, src_width,
+                                                 src_width, src_height, dst.data(), dst_width,
+                                                 dst.data() + dst_width * dst_height, dst_width,
+                                                 dst_width, dst_height);
+                            },
+                            10) *
+                        1e3;
+                bench::consume(dst.data());
+            }
+            std::printf("  %ux%u -> %ux%u %-8s scalar %7.2f ms, %s %6.2f ms\n", src_width,
+                        src_height, dst_width, dst_height, modeStr(mode), ms[0],
+                        simdLevelStr(bestSimdLevel()), ms[1]);
+        }
+    }
+}
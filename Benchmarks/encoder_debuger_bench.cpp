@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../amf/amf_helper.h"
+#include "bench.h"
+
+using namespace amf;
+
+static constexpr int kSessions = 100;
+static constexpr int kSeconds = 20;
+
+// As AmfEncoder::PrintRecording, asked on every frame and printing every 5 seconds
+static size_t printRecording(AmfEncoderDebuger* recorder, int64_t now) {
+    std::vector<AmfEncoderDebuger::Statistics> outputs;
+    if (!recorder->stat(outputs, now, 1000 * 5)) {
+        return 0;
+    }
+    std::string logs = "[";
+    for (auto& output : outputs) {
+        logs += output.to_str();
+    }
+    logs += "]";
+    return logs.size();
+}
+
+// One frame in and one packet out per session, a jittered capture clock and a target that
+// steps down every 7 seconds
+BENCH(encoder_debuger) {
+    for (uint32_t fps : {60u, 120u, 240u}) {
+        const int frames = static_cast<int>(fps) * kSeconds;
+        size_t printed = 0;
+        const double seconds = bench::measure(
+            [&] {
+                std::vector<AmfEncoderDebuger> recorders(kSessions);
+                std::vector<int64_t> capture(kSessions, 1000 * 1000);
+                std::vector<int64_t> output(kSessions, 0);
+                std::mt19937 rng(7);
+                for (int frame = 0; frame < frames; frame++) {
+                    const uint32_t target_fps = fps - (frame / (fps * 7)) % 3 * (fps / 6);
+                    const uint32_t bitrate = 1000 * 1000 - (frame / fps % 3) * 100 * 1000;
+                    for (int session = 0; session < kSessions; session++) {
+                        const int64_t jitter = static_cast<int64_t>(rng() % 2001) - 1000;
+                        capture[session] += 1000 * 1000 / fps + jitter;
+                        // Packets leave in order, stamped by the output thread
+                        output[session] = std::max<int64_t>(output[session] + 1,
+                                                            capture[session] + 3000 + rng() % 4000);
+                        AmfEncoderDebuger& recorder = recorders[session];
+                        recorder.addInput(target_fps, capture[session]);
+                        printed += printRecording(&recorder, capture[session]);
+                        recorder.addOuput(2000 + rng() % 30000, 20 + rng() % 20, bitrate,
+                                          output[session], true, 500 + rng() % 1000,
+                                          3000 + rng() % 4000);
+                    }
+                }
+            },
+            1);
+        bench::consume(&printed);
+        std::printf("  %3u fps x %d sessions: %6.1f ns per frame\n", fps, kSessions,
+                    seconds * 1e9 / frames / kSessions);
+    }
+}
@@ -0,0 +1,132 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../amf/amf_helper.h"
+#include "../amf/encode_pipeline.h"
+#include "../amf/software_backend.h"
+#include "bench.h"
+
+using namespace amf;
+
+// The steps of AmfEncoder::Resize on the software backend: drain the pipeline, ReInit or
+// re-create the component, restart the pipeline, then the first frame at the new size
+class ResizeSession {
+public:
+    explicit ResizeSession(bool reinit) {
+        SoftwareBackend::Options options;
+        options.latency_us = 2000;
+        options.reinit = reinit;
+        backend_ = std::make_unique<SoftwareBackend>(options);
+        backend_->init(0);
+    }
+
+    ~ResizeSession() {
+        pipeline_ = nullptr;
+        if (encoder_) {
+            encoder_->Terminate();
+        }
+    }
+
+    bool start(uint32_t width, uint32_t height) {
+        if (!create(width, height)) {
+            return false;
+        }
+        startPipeline();
+        return encodeOne(width, height);
+    }
+
+    // Until the packet of the first frame at the new size is out
+    bool resize(uint32_t width, uint32_t height) {
+        pipeline_->stop();
+        pipeline_ = nullptr;
+        if (encoder_->ReInit(width, height) != AMF_OK) {
+            // As AmfEncoder does, the backend and its surfaces go with the component
+            encoder_->Terminate();
+            encoder_ = nullptr;
+            backend_->uninit();
+            if (!backend_->init(0) || !create(width, height)) {
+                return false;
+            }
+        }
+        startPipeline();
+        return encodeOne(width, height);
+    }
+
+    uint64_t surfacesAllocated() const { return backend_->stats().surfaces_allocated; }
+
+private:
+    bool create(uint32_t width, uint32_t height) {
+        if (backend_->createEncoder(AMFVideoEncoderVCE_AVC, &encoder_) != AMF_OK) {
+            return false;
+        }
+        encoder_->SetProperty(AMF_VIDEO_ENCODER_TARGET_BITRATE, 4000 * 1000);
+        encoder_->SetProperty(AMF_VIDEO_ENCODER_QUERY_TIMEOUT, 200);
+        return encoder_->Init(AMF_SURFACE_NV12, width, height) == AMF_OK;
+    }
+
+    void startPipeline() {
+        pipeline_ = std::make_unique<EncodePipeline>(
+            encoder_, [this](AMFDataPtr&, const EncodedFrameInfo&) {
+                std::lock_guard<std::mutex> lock(mtx_);
+                received_++;
+                cv_.notify_one();
+            });
+    }
+
+    bool encodeOne(uint32_t width, uint32_t height) {
+        frame_.resize(static_cast<size_t>(width) * height * 3 / 2);
+        AMFSurfacePtr surface =
+            backend_->upload(VideoFrameView::nv12(frame_.data(), width, height));
+        uint64_t expected = 0;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            expected = received_ + 1;
+        }
+        EncodedFrameInfo info;
+        info.frame_id = expected;
+        if (!surface || !pipeline_->submit(surface, info)) {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(mtx_);
+        return cv_.wait_for(lock, std::chrono::seconds(1),
+                            [&]() { return received_ >= expected; });
+    }
+
+private:
+    std::unique_ptr<SoftwareBackend> backend_;
+    AMFComponentPtr encoder_;
+    std::unique_ptr<EncodePipeline> pipeline_;
+    std::vector<uint8_t> frame_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    uint64_t received_ = 0;
+};
+
+// 1080p, 720p and 900p in turns, as a window dragged between sizes
+BENCH(encoder_resize) {
+    const uint32_t sizes[][2] = {{1920, 1080}, {1280, 720}, {1600, 900}};
+    for (bool reinit : {true, false}) {
+        ResizeSession session(reinit);
+        if (!session.start(sizes[0][0], sizes[0][1])) {
+            std::printf("  failed to start\n");
+            return;
+        }
+        int round = 0;
+        bool ok = true;
+        const double seconds = bench::measure(
+            [&] {
+                round++;
+                ok &= session.resize(sizes[round % 3][0], sizes[round % 3][1]);
+            },
+            20, 1);
+        std::printf("  %-9s %6.2f ms to the first frame, %llu surfaces allocated%s\n",
+                    reinit ? "ReInit" : "re-create", seconds * 1e3,
+                    static_cast<unsigned long long>(session.surfacesAllocated()),
+                    ok ? "" : ", some frames lost");
+    }
+}
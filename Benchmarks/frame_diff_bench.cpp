@@ -0,0 +1,36 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../amf/frame_diff.h"
+#include "bench.h"
+
+using namespace amf;
+
+// Hashing a mostly static luma plane, one byte changes per frame, with and without crc32c
+BENCH(dirty_region_detector) {
+    std::mt19937 rng(8);
+    const uint32_t sizes[][2] = {{1920, 1080}, {3840, 2160}};
+    for (const auto& size : sizes) {
+        const uint32_t width = size[0];
+        const uint32_t height = size[1];
+        std::vector<uint8_t> luma(static_cast<size_t>(width) * height);
+        for (uint8_t& b : luma) {
+            b = static_cast<uint8_t>(rng());
+        }
+        for (bool crc32 : {false, true}) {
+            DirtyRegionDetector detector(DirtyRegionDetector::kDefaultTileSize, crc32);
+            detector.update(luma.data(), width, width, height);
+            size_t frame = 0;
+            const double seconds = bench::measure(
+                [&] {
+                    luma[(frame++ * 7919) % luma.size()] ^= 1;
+                    detector.update(luma.data(), width, width, height);
+                },
+                50);
+            std::printf("  %ux%u %-8s %6.3f ms, %5.2f GB/s\n", width, height,
+                        detector.hardwareHash() ? "crc32c" : "software", seconds * 1e3,
+                        luma.size() / seconds / 1e9);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+// Runs every benchmark, or those whose name contains the argument. Build it in Release.
+//   Benchmarks [filter]
+// Outside Visual Studio, with the amf sources of Benchmarks.vcxproj:
+//   SOURCES=$(grep -o 'amf\\[a-z0-9_]*\.cpp' Benchmarks/Benchmarks.vcxproj | tr '\\' /)
+//   g++ -std=c++17 -O2 -o benchmarks Benchmarks/*.cpp $SOURCES -lpthread
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "bench.h"
+
+namespace amf {
+
+// The amf sources log through this, benchmarks only print their own lines
+void log(int, const char*, int, const char*, ...) {}
+
+} // namespace amf
+
+namespace bench {
+
+struct Bench {
+    const char* name;
+    BenchFunc func;
+};
+
+static std::vector<Bench>& benches() {
+    static std::vector<Bench> registered;
+    return registered;
+}
+
+Registrar::Registrar(const char* name, BenchFunc func) {
+    benches().push_back({name, func});
+}
+
+static const volatile void* sink = nullptr;
+
+void consume(const void* data) {
+    sink = data;
+}
+
+} // namespace bench
+
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : "";
+    int run = 0;
+    for (const bench::Bench& b : bench::benches()) {
+        if (!std::strstr(b.name, filter)) {
+            continue;
+        }
+        std::printf("%s\n", b.name);
+        b.func();
+        run++;
+    }
+    return run > 0 ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "../amf/plane_copy.h"
+#include "../amf/thread_pool.h"
+#include "bench.h"
+
+using namespace amf;
+
+// A NV12 frame between pitched buffers, the old memcpy loop against every CopyMode
+BENCH(copy_nv12) {
+    const uint32_t sizes[][2] = {{1920, 1080}, {3840, 2160}};
+    for (const auto& size : sizes) {
+        const uint32_t width = size[0];
+        const uint32_t height = size[1];
+        for (uint32_t pad : {0u, 256u}) {
+            const uint32_t src_pitch = width + pad;
+            const uint32_t dst_pitch = width + 64;
+            const uint32_t rows = height * 3 / 2;
+            std::vector<uint8_t> src(static_cast<size_t>(src_pitch) * rows, 1);
+            std::vector<uint8_t> dst(static_cast<size_t>(dst_pitch) * rows, 0);
+            const double loop = bench::measure(
+                [&] {
+                    for (uint32_t i = 0; i < rows; i++) {
+                        std::memcpy(&dst[i * dst_pitch], &src[i * src_pitch], width);
+                    }
+                },
+                50);
+            auto copy = [&](CopyMode mode) {
+                return bench::measure(
+                    [&] {
+                        copyNv12(src.data(), src_pitch, src.data() + src_pitch * height,
+                                 src_pitch, dst.data(), dst_pitch, dst.data() + dst_pitch * height,
+                                 dst_pitch, width, height, mode);
+                    },
+                    50);
+            };
+            const double temporal = copy(CopyMode::TEMPORAL);
+            const double streaming = copy(CopyMode::STREAMING);
+            const double automatic = copy(CopyMode::AUTO);
+            bench::consume(dst.data());
+            const double gb = static_cast<double>(width) * rows / 1e9;
+            std::printf("  %ux%u pad %3u: loop %5.2f GB/s, temporal %5.2f, streaming %5.2f, "
+                        "auto %5.2f\n",
+                        width, height, pad, gb / loop, gb / temporal, gb / streaming,
+                        gb / automatic);
+        }
+    }
+}
+
+// Cost of handing an empty job to the shared pool, what a row band has to beat
+BENCH(thread_pool_dispatch) {
+    ThreadPool* pool = ThreadPool::instance();
+    const uint32_t bands = pool->concurrency();
+    const double seconds = bench::measure(
+        [&] { pool->parallelFor(bands, [](uint32_t index) { bench::consume(&index); }); },
+        20000);
+    std::printf("  %u bands: %.2f us per job\n", bands, seconds * 1e6);
+}
@@ -0,0 +1,80 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../amf/yuv_convert.h"
+#include "bench.h"
+
+using namespace amf;
+
+static std::vector<uint8_t> randomPlane(size_t size, std::mt19937& rng) {
+    std::vector<uint8_t> plane(size);
+    for (uint8_t& b : plane) {
+        b = static_cast<uint8_t>(rng());
+    }
+    return plane;
+}
+
+// One 4K chroma row at every simd level this cpu has
+BENCH(interleave_uv_row) {
+    std::mt19937 rng(5);
+    const uint32_t width = 1920;
+    const std::vector<uint8_t> u = randomPlane(width, rng);
+    const std::vector<uint8_t> v = randomPlane(width, rng);
+    std::vector<uint8_t> uv(width * 2);
+    const SimdLevel levels[] = {SimdLevel::SCALAR, SimdLevel::SSE41, SimdLevel::AVX2,
+                                SimdLevel::NEON};
+    for (SimdLevel level : levels) {
+        if (level != SimdLevel::SCALAR && resolveSimdLevel(level) != level) {
+            continue;
+        }
+        const double interleave = bench::measure(
+            [&] { interleaveUVRow(u.data(), v.data(), uv.data(), width, level); }, 100000);
+        std::vector<uint8_t> u2(width);
+        std::vector<uint8_t> v2(width);
+        const double deinterleave = bench::measure(
+            [&] { deinterleaveUVRow(uv.data(), u2.data(), v2.data(), width, level); }, 100000);
+        bench::consume(uv.data());
+        bench::consume(u2.data());
+        std::printf("  %-7s interleave %6.1f ns, deinterleave %6.1f ns\n", simdLevelStr(level),
+                    interleave * 1e9, deinterleave * 1e9);
+    }
+}
+
+// Whole frames both ways, what the I420 upload path costs
+BENCH(i420_nv12_frame) {
+    std::mt19937 rng(5);
+    const uint32_t sizes[][2] = {{1920, 1080}, {1921, 1081}, {3840, 2160}};
+    for (const auto& size : sizes) {
+        const uint32_t width = size[0];
+        const uint32_t height = size[1];
+        const uint32_t chroma_width = (width + 1) / 2;
+        const uint32_t chroma_height = (height + 1) / 2;
+        const std::vector<uint8_t> y = randomPlane(width * height, rng);
+        const std::vector<uint8_t> u = randomPlane(chroma_width * chroma_height, rng);
+        const std::vector<uint8_t> v = randomPlane(chroma_width * chroma_height, rng);
+        std::vector<uint8_t> nv12_y(width * height);
+        std::vector<uint8_t> nv12_uv(chroma_width * 2 * chroma_height);
+        const double to_nv12 = bench::measure(
+            [&] {
+                copyI420ToNv12(y.data(), width, u.data(), chroma_width, v.data(), chroma_width,
+                               nv12_y.data(), width, nv12_uv.data(), chroma_width * 2, width,
+                               height);
+            },
+            50);
+        std::vector<uint8_t> y2(width * height);
+        std::vector<uint8_t> u2(chroma_width * chroma_height);
+        std::vector<uint8_t> v2(chroma_width * chroma_height);
+        const double to_i420 = bench::measure(
+            [&] {
+                copyNv12ToI420(nv12_y.data(), width, nv12_uv.data(), chroma_width * 2, y2.data(),
+                               width, u2.data(), chroma_width, v2.data(), chroma_width, width,
+                               height);
+            },
+            50);
+        bench::consume(y2.data());
+        const double gb = (y.size() + u.size() * 2) / 1e9;
+        std::printf("  %ux%u: i420->nv12 %5.2f GB/s, nv12->i420 %5.2f GB/s\n", width, height,
+                    gb / to_nv12, gb / to_i420);
+    }
+}
@@ -0,0 +1,63 @@
+// Summary of a frame trace written by the encoder, or all of its frames as csv.
+//   FrameTraceTool amf-frames.trace
+//   FrameTraceTool amf-frames.trace --csv > frames.csv
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "../amf/frame_trace_reader.h"
+
+static int usage() {
+    std::fprintf(stderr, "usage: FrameTraceTool <trace> [--csv]\n");
+    return 2;
+}
+
+static bool printCsv(amf::FrameTraceReader& reader) {
+    std::printf("output_time,frame_id,upload_us,encode_us,size,target_bitrate,fps,width,height,"
+                "codec,frame_type,qp,qp_min,qp_max,pix_num_intra,pix_num_inter,pix_num_skip,"
+                "bitcount_residual,bitcount_motion,bitcount_inter,bitcount_intra\n");
+    for (uint64_t block = 0; block < reader.blocks(); block++) {
+        if (!reader.readBlock(block)) {
+            return false;
+        }
+        for (uint32_t row = 0; row < reader.frames(); row++) {
+            const amf::FrameRecord r = reader.record(row);
+            std::printf("%lld,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+                        static_cast<long long>(r.output_time), r.frame_id, r.upload_us,
+                        r.encode_us, r.size, r.target_bitrate, r.fps, r.width, r.height, r.codec,
+                        r.frame_type, r.qp, r.qp_min, r.qp_max, r.pix_num_intra, r.pix_num_inter,
+                        r.pix_num_skip, r.bitcount_residual, r.bitcount_motion, r.bitcount_inter,
+                        r.bitcount_intra);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        return usage();
+    }
+    const bool csv = argc == 3;
+    if (csv && std::strcmp(argv[2], "--csv") != 0) {
+        return usage();
+    }
+    amf::FrameTraceReader reader;
+    if (!reader.open(argv[1])) {
+        std::fprintf(stderr, "%s\n", reader.error().c_str());
+        return 1;
+    }
+    if (csv) {
+        if (!printCsv(reader)) {
+            std::fprintf(stderr, "%s\n", reader.error().c_str());
+            return 1;
+        }
+        return 0;
+    }
+    amf::FrameTraceSummary summary;
+    if (!amf::summarize(reader, &summary)) {
+        std::fprintf(stderr, "%s\n", reader.error().c_str());
+        return 1;
+    }
+    std::printf("%s\n", summary.to_str().c_str());
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../amf/amf_encoder.h"
+#include "../amf/software_backend.h"
+#include "test.h"
+
+using namespace amf;
+
+static constexpr uint32_t kWidth = 64;
+static constexpr uint32_t kHeight = 64;
+static constexpr int64_t kStart = 10 * 1000 * 1000;
+
+// AmfEncoder on the software backend and a virtual clock. The packets are sized from the
+// TARGET_BITRATE and FRAMERATE of the component, they show what the encoder was last set to.
+class EncoderSession {
+public:
+    explicit EncoderSession(const Config& config) {
+        SoftwareBackend::Options options;
+        options.latency_us = 0;
+        encoder_ = std::make_unique<AmfEncoder>(std::make_unique<SoftwareBackend>(options));
+        encoder_->SetClock([this]() { return clock_.load(); });
+        encoder_->RegisterEncodedImageCallback(
+            [this](const uint8_t* /*data*/, size_t size, const EncodedFrameInfo& info) {
+                std::lock_guard<std::mutex> lock(mtx_);
+                // Key frames are key_frame_scale times larger
+                size_ = info.key_frame ? size / 4 : size;
+                packets_++;
+                cv_.notify_all();
+            });
+        initialized_ = encoder_->Initialize(config);
+    }
+
+    bool initialized() const { return initialized_; }
+    AmfEncoder& encoder() { return *encoder_; }
+
+    void setTime(int64_t ms) { clock_ = kStart + ms * 1000; }
+
+    // Size of the packet of a frame encoded `ms` after the start, 0 when it does not come out
+    size_t encodeAt(int64_t ms) {
+        setTime(ms);
+        std::unique_lock<std::mutex> lock(mtx_);
+        const uint64_t packets = packets_;
+        lock.unlock();
+        if (encoder_->EncodeFrame(frame_, kWidth, kHeight, false) != 0) {
+            return 0;
+        }
+        lock.lock();
+        if (!cv_.wait_for(lock, std::chrono::seconds(2), [&]() { return packets_ > packets; })) {
+            return 0;
+        }
+        return size_;
+    }
+
+private:
+    std::unique_ptr<AmfEncoder> encoder_;
+    std::atomic<int64_t> clock_{kStart};
+    std::vector<uint8_t> frame_ = std::vector<uint8_t>(kWidth * kHeight * 3 / 2, 128);
+    bool initialized_ = false;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    uint64_t packets_ = 0;
+    size_t size_ = 0;
+};
+
+// What the software backend makes of a P frame at `bitrate`
+static size_t packetSize(uint32_t bitrate, uint32_t fps = 30) {
+    return static_cast<size_t>(bitrate / 8 / static_cast<double>(fps));
+}
+
+static Config config() {
+    Config config;
+    config.width = kWidth;
+    config.height = kHeight;
+    config.framerate = 30;
+    config.bitrate_kbps = 1000;
+    return config;
+}
+
+TEST(amf_encoder_keeps_the_bitrate_for_requests_within_the_dead_band) {
+    EncoderSession session(config());
+    CHECK(session.initialized());
+    CHECK(session.encodeAt(0) == packetSize(1000 * 1000));
+    session.setTime(100);
+    session.encoder().RequestEncodingParametersChange(950 * 1000, 30);
+    for (int64_t ms = 200; ms <= 5000; ms += 200) {
+        CHECK(session.encodeAt(ms) == packetSize(1000 * 1000));
+    }
+    session.encoder().RequestEncodingParametersChange(1060 * 1000, 30);
+    for (int64_t ms = 5200; ms <= 10000; ms += 200) {
+        CHECK(session.encodeAt(ms) == packetSize(1000 * 1000));
+    }
+}
+
+TEST(amf_encoder_lowers_after_200ms_and_raises_after_1s) {
+    EncoderSession session(config());
+    CHECK(session.initialized());
+    CHECK(session.encodeAt(0) == packetSize(1000 * 1000));
+    // A drop bypasses the average, a step is at most half the bitrate
+    session.encoder().RequestEncodingParametersChange(400 * 1000, 30);
+    CHECK(session.encodeAt(0) == packetSize(500 * 1000));
+    CHECK(session.encodeAt(199) == packetSize(500 * 1000));
+    CHECK(session.encodeAt(200) == packetSize(400 * 1000));
+    // The average of the request is over the band after ~0.1 s, the bitrate waits for 1 s
+    session.encoder().RequestEncodingParametersChange(1000 * 1000, 30);
+    for (int64_t ms = 300; ms < 1200; ms += 100) {
+        CHECK(session.encodeAt(ms) == packetSize(400 * 1000));
+    }
+    CHECK(session.encodeAt(1199) == packetSize(400 * 1000));
+    // At most 15 % up per step
+    CHECK(session.encodeAt(1200) == packetSize(460 * 1000));
+    CHECK(session.encodeAt(2199) == packetSize(460 * 1000));
+    CHECK(session.encodeAt(2200) == packetSize(529 * 1000));
+}
+
+TEST(amf_encoder_changes_the_frame_rate_without_the_bitrate) {
+    Config governed = config();
+    governed.adaptive_framerate = true;
+    EncoderSession session(governed);
+    CHECK(session.initialized());
+    CHECK(session.encodeAt(0) == packetSize(1000 * 1000));
+    // Typing, the governor lowers the frame rate after its hold
+    for (int64_t ms = 0; ms < 1000; ms += 100) {
+        session.setTime(ms);
+        CHECK(session.encoder().UpdateFrameChange(0.01f) == 30);
+        if (ms == 800) {
+            session.encoder().RequestEncodingParametersChange(600 * 1000, 30);
+        }
+        else if (ms == 900) {
+            session.encoder().RequestEncodingParametersChange(2000 * 1000, 30);
+        }
+    }
+    CHECK(session.encodeAt(900) == packetSize(600 * 1000));
+    session.setTime(1000);
+    CHECK(session.encoder().UpdateFrameChange(0.01f) == 5);
+    // The raise of the bitrate still waits 1 s after the drop
+    CHECK(session.encodeAt(1000) == packetSize(600 * 1000, 5));
+    CHECK(session.encodeAt(1799) == packetSize(600 * 1000, 5));
+    CHECK(session.encodeAt(1800) == packetSize(690 * 1000, 5));
+}
@@ -0,0 +1,59 @@
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../amf/async_logger.h"
+#include "test.h"
+
+using namespace amf;
+
+static const char* kLogPath = "async_logger_test.log";
+
+// The notes of dropped lines are not counted
+static uint64_t countLines(const char* path, const std::string& prefix) {
+    uint64_t lines = 0;
+    std::FILE* file = std::fopen(path, "r");
+    if (!file) {
+        return 0;
+    }
+    char line[256];
+    while (std::fgets(line, sizeof(line), file)) {
+        lines += std::string(line).compare(0, prefix.size(), prefix) == 0;
+    }
+    std::fclose(file);
+    return lines;
+}
+
+TEST(async_logger_keeps_the_lines_written_across_stop) {
+    for (int round = 0; round < 20; round++) {
+        std::remove(kLogPath);
+        AsyncLogger::Options options;
+        options.path = kLogPath;
+        options.max_file_bytes = 0;
+        AsyncLogger logger(options);
+        std::atomic<bool> started{false};
+        std::atomic<uint64_t> written{0};
+        std::vector<std::thread> writers;
+        for (int i = 0; i < 4; i++) {
+            writers.emplace_back([&]() {
+                const char line[] = "[INFO] Frame 1, P, QP: 27, size: 5123 B\n";
+                for (int n = 0; n < 2000; n++) {
+                    written += logger.write(line, sizeof(line) - 1) ? 1 : 0;
+                    started = true;
+                }
+            });
+        }
+        while (!started) {
+            std::this_thread::yield();
+        }
+        // Some lines land before the final drain, some race it and some take the synchronous path
+        logger.stop();
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        CHECK(countLines(kLogPath, "[INFO]") == written);
+    }
+    std::remove(kLogPath);
+}
@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "../amf/capability_cache.h"
+#include "test.h"
+
+using namespace amf;
+
+static const char* kCachePath = "capability_cache_test.bin";
+// Offset of the entry count, after the magic, the format version, the key and the time written
+static constexpr size_t kCountOffset = 48;
+
+static CapabilityCache::Contents contents() {
+    CapabilityCache::Contents contents;
+    contents.key.amf_version = 0x0001000400230000ull;
+    contents.key.vendor_id = 0x1002;
+    contents.key.device_id = 0x73bf;
+    contents.key.subsys_id = 0x0e3a1002;
+    contents.key.revision = 0xc1;
+    contents.key.driver_version = 0x001f000e00150007ull;
+    contents.written_at = 1760000000;
+    CapabilityCache::Entry avc;
+    avc.supported = true;
+    avc.capbility.max_width = 4096;
+    avc.capbility.max_height = 2176;
+    avc.capbility.max_profile = 100;
+    avc.capbility.instances = 2;
+    avc.capbility.b_frame_support = true;
+    avc.capbility.vertical_align = 16;
+    avc.capbility.input_formats = {AMF_SURFACE_NV12, AMF_SURFACE_BGRA};
+    CapabilityCache::Entry av1;
+    av1.kind = CapabilityProbe::Kind::DECODER;
+    av1.type = amf_codec_type::AV1;
+    av1.capbility.max_width = 8192;
+    av1.capbility.input_formats = {AMF_SURFACE_P010};
+    contents.entries = {avc, av1};
+    return contents;
+}
+
+// The checksum of the file, for buffers changed on purpose
+static void resign(std::vector<uint8_t>* data) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i + sizeof(hash) < data->size(); i++) {
+        hash = (hash ^ (*data)[i]) * 16777619u;
+    }
+    std::memcpy(data->data() + data->size() - sizeof(hash), &hash, sizeof(hash));
+}
+
+TEST(capability_cache_round_trip) {
+    const CapabilityCache::Contents written = contents();
+    const std::vector<uint8_t> data = CapabilityCache::serialize(written);
+    // Changes with the layout, which has to bump kCacheFormatVersion then
+    CHECK(data.size() == 156);
+    CapabilityCache::Contents read;
+    CHECK(CapabilityCache::parse(data.data(), data.size(), &read));
+    CHECK(read.key == written.key && read.written_at == written.written_at);
+    CHECK(read.entries == written.entries);
+    // Through the file as well
+    CHECK(CapabilityCache::save(kCachePath, written));
+    read = CapabilityCache::Contents();
+    CHECK(CapabilityCache::load(kCachePath, written.key, &read));
+    CHECK(read.entries == written.entries);
+    std::remove(kCachePath);
+}
+
+TEST(capability_cache_rejects_truncated_and_corrupt_files) {
+    const std::vector<uint8_t> data = CapabilityCache::serialize(contents());
+    CapabilityCache::Contents read;
+    for (size_t size : {size_t(0), size_t(3), kCountOffset, data.size() - 1}) {
+        CHECK(!CapabilityCache::parse(data.data(), size, &read));
+    }
+    // Every byte is covered by the checksum, the checksum itself included
+    for (size_t i : {size_t(0), size_t(20), kCountOffset + 10, data.size() - 1}) {
+        std::vector<uint8_t> flipped = data;
+        flipped[i] ^= 0x01;
+        CHECK(!CapabilityCache::parse(flipped.data(), flipped.size(), &read));
+    }
+    // A truncated buffer with a valid checksum
+    std::vector<uint8_t> short_entries(data.begin(), data.begin() + 100);
+    short_entries.resize(104);
+    resign(&short_entries);
+    CHECK(!CapabilityCache::parse(short_entries.data(), short_entries.size(), &read));
+}
+
+TEST(capability_cache_rejects_too_many_entries) {
+    std::vector<uint8_t> data = CapabilityCache::serialize(contents());
+    CapabilityCache::Contents read;
+    resign(&data);
+    CHECK(CapabilityCache::parse(data.data(), data.size(), &read));
+    const uint32_t count = 65;
+    std::memcpy(data.data() + kCountOffset, &count, sizeof(count));
+    resign(&data);
+    CHECK(!CapabilityCache::parse(data.data(), data.size(), &read));
+}
+
+TEST(capability_cache_misses_on_another_key) {
+    const CapabilityCache::Contents written = contents();
+    CHECK(CapabilityCache::save(kCachePath, written));
+    CapabilityCache::Key updated = written.key;
+    updated.driver_version++;
+    CapabilityCache::Contents read;
+    CHECK(!CapabilityCache::load(kCachePath, updated, &read));
+    CHECK(CapabilityCache::load(kCachePath, written.key, &read));
+    std::remove(kCachePath);
+    CHECK(!CapabilityCache::load(kCachePath, written.key, &read));
+}
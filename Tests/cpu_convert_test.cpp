@@ -0,0 +1,186 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../amf/cpu_convert.h"
+#include "../amf/plane_copy.h"
+#include "test.h"
+
+using namespace amf;
+
+static std::vector<uint8_t> randomBytes(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t& b : bytes) {
+        b = static_cast<uint8_t>(rng());
+    }
+    return bytes;
+}
+
+struct Nv12 {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t pitch = 0;
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> uv;
+
+    // The uv plane has the pitch of the luma plane, as in a D3D11 NV12 texture
+    Nv12(uint32_t w, uint32_t h, uint32_t p)
+        : width(w)
+        , height(h)
+        , pitch(p)
+        , y(static_cast<size_t>(p) * h, 0xEE)
+        , uv(static_cast<size_t>(p) * ((h + 1) / 2), 0xEE) {}
+
+    uint8_t yAt(uint32_t x, uint32_t row) const { return y[row * pitch + x]; }
+    uint8_t uAt(uint32_t pair, uint32_t row) const { return uv[row * pitch + pair * 2]; }
+    uint8_t vAt(uint32_t pair, uint32_t row) const { return uv[row * pitch + pair * 2 + 1]; }
+};
+
+static Nv12 convert(const BgraToNv12Converter& converter, const std::vector<uint8_t>& bgra,
+                    uint32_t bgra_pitch, uint32_t width, uint32_t height) {
+    // Odd sizes write one more chroma pair than width / 2
+    Nv12 out(width, height, (width + 1) / 2 * 2 + 32);
+    converter.convert(bgra.data(), bgra_pitch, width, height, out.y.data(), out.pitch,
+                      out.uv.data(), out.pitch);
+    return out;
+}
+
+static Nv12 solid(const ColorSpace& color, uint8_t b, uint8_t g, uint8_t r) {
+    std::vector<uint8_t> bgra(4 * 4 * 4);
+    for (size_t i = 0; i < bgra.size(); i += 4) {
+        bgra[i + 0] = b;
+        bgra[i + 1] = g;
+        bgra[i + 2] = r;
+        bgra[i + 3] = 255;
+    }
+    return convert(BgraToNv12Converter(SimdLevel::SCALAR, color), bgra, 16, 4, 4);
+}
+
+TEST(cpu_convert_simd_matches_scalar) {
+    const SimdLevel levels[] = {SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512,
+                                SimdLevel::NEON};
+    const ColorSpace colors[] = {
+        {},
+        {ColorMatrix::BT601, ColorRange::FULL, ChromaSiting::CENTER},
+        {ColorMatrix::BT2020, ColorRange::LIMITED, ChromaSiting::LEFT},
+    };
+    for (const ColorSpace& color : colors) {
+        for (PixelOrder order : {PixelOrder::BGRA, PixelOrder::RGBA}) {
+            const BgraToNv12Converter scalar(SimdLevel::SCALAR, color, order);
+            for (uint32_t width : {1u, 2u, 3u, 15u, 16u, 17u, 33u, 64u, 65u, 1279u}) {
+                for (uint32_t height : {1u, 2u, 3u, 8u}) {
+                    const uint32_t pitch = width * 4 + 12;
+                    const std::vector<uint8_t> bgra = randomBytes(pitch * height, width * height);
+                    const Nv12 expected = convert(scalar, bgra, pitch, width, height);
+                    for (SimdLevel level : levels) {
+                        const BgraToNv12Converter simd(level, color, order);
+                        const Nv12 actual = convert(simd, bgra, pitch, width, height);
+                        CHECK(actual.y == expected.y);
+                        CHECK(actual.uv == expected.uv);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// What D3D11VideoProcessorConvert produces for BT.709 limited range
+TEST(cpu_convert_bt709_golden) {
+    const ColorSpace bt709;
+    const Nv12 white = solid(bt709, 255, 255, 255);
+    CHECK(white.yAt(0, 0) == 235 && white.uAt(0, 0) == 128 && white.vAt(0, 0) == 128);
+    const Nv12 black = solid(bt709, 0, 0, 0);
+    CHECK(black.yAt(3, 3) == 16 && black.uAt(1, 1) == 128 && black.vAt(1, 1) == 128);
+    const Nv12 red = solid(bt709, 0, 0, 255);
+    CHECK(red.yAt(1, 0) == 63 && red.uAt(0, 0) == 102 && red.vAt(0, 0) == 240);
+    const Nv12 blue = solid(bt709, 255, 0, 0);
+    CHECK(blue.yAt(2, 1) == 32 && blue.uAt(1, 0) == 240 && blue.vAt(1, 0) == 118);
+}
+
+TEST(cpu_convert_full_range_golden) {
+    const ColorSpace full = {ColorMatrix::BT709, ColorRange::FULL, ChromaSiting::CENTER};
+    const Nv12 white = solid(full, 255, 255, 255);
+    CHECK(white.yAt(0, 0) == 255 && white.uAt(0, 0) == 128 && white.vAt(0, 0) == 128);
+    const Nv12 black = solid(full, 0, 0, 0);
+    CHECK(black.yAt(0, 0) == 0 && black.uAt(0, 0) == 128 && black.vAt(0, 0) == 128);
+}
+
+TEST(cpu_convert_odd_size_replicates_edge) {
+    // A 3x3 frame: the last chroma pair averages the last column with itself
+    std::vector<uint8_t> bgra(3 * 4 * 3, 0);
+    for (uint32_t row = 0; row < 3; row++) {
+        for (uint32_t x = 0; x < 3; x++) {
+            uint8_t* p = &bgra[row * 12 + x * 4];
+            p[0] = p[1] = p[2] = x == 2 || row == 2 ? 255 : 0;
+        }
+    }
+    const Nv12 out = convert(BgraToNv12Converter(SimdLevel::SCALAR), bgra, 12, 3, 3);
+    CHECK(out.yAt(2, 0) == 235 && out.yAt(0, 2) == 235 && out.yAt(0, 0) == 16);
+    CHECK(out.uAt(1, 1) == 128 && out.vAt(1, 1) == 128);
+    // Nothing past the picture is touched
+    CHECK(out.yAt(3, 0) == 0xEE && out.uv[4] == 0xEE);
+}
+
+TEST(pad_nv12_replicates_last_column_and_row) {
+    Nv12 frame(8, 6, 16);
+    const uint32_t width = 5;
+    const uint32_t height = 3;
+    for (uint32_t row = 0; row < height; row++) {
+        for (uint32_t x = 0; x < width; x++) {
+            frame.y[row * frame.pitch + x] = static_cast<uint8_t>(row * 10 + x);
+        }
+    }
+    for (uint32_t row = 0; row < 2; row++) {
+        for (uint32_t pair = 0; pair < 3; pair++) {
+            frame.uv[row * frame.pitch + pair * 2] = static_cast<uint8_t>(100 + row * 10 + pair);
+            frame.uv[row * frame.pitch + pair * 2 + 1] = static_cast<uint8_t>(200 + row);
+        }
+    }
+    padNv12(frame.y.data(), frame.pitch, frame.uv.data(), frame.pitch, width, height, 8, 6);
+    for (uint32_t row = 0; row < 6; row++) {
+        for (uint32_t x = 0; x < 8; x++) {
+            const uint32_t src_row = row < height ? row : height - 1;
+            const uint32_t src_x = x < width ? x : width - 1;
+            CHECK(frame.yAt(x, row) == src_row * 10 + src_x);
+        }
+        // Past the padded width the row is left alone
+        CHECK(frame.yAt(8, row) == 0xEE);
+    }
+    for (uint32_t row = 0; row < 3; row++) {
+        for (uint32_t pair = 0; pair < 4; pair++) {
+            const uint32_t src_row = row < 2 ? row : 1;
+            const uint32_t src_pair = pair < 3 ? pair : 2;
+            CHECK(frame.uAt(pair, row) == 100 + src_row * 10 + src_pair);
+            CHECK(frame.vAt(pair, row) == 200 + src_row);
+        }
+    }
+}
+
+TEST(pad_nv12_p010_samples) {
+    // 16-bit samples, 3x1 padded to 4x2
+    const uint32_t pitch = 16;
+    std::vector<uint16_t> y(pitch / 2 * 2, 0);
+    std::vector<uint16_t> uv(pitch / 2, 0);
+    y[0] = 0x0100;
+    y[1] = 0x0200;
+    y[2] = 0x0300;
+    uv[0] = 0x1000;
+    uv[1] = 0x2000;
+    uv[2] = 0x3000;
+    uv[3] = 0x4000;
+    padNv12(reinterpret_cast<uint8_t*>(y.data()), pitch, reinterpret_cast<uint8_t*>(uv.data()),
+            pitch, 3, 1, 4, 2, 2);
+    CHECK(y[3] == 0x0300);
+    CHECK(y[8] == 0x0100 && y[10] == 0x0300 && y[11] == 0x0300);
+    // Two pairs already cover 3 columns
+    CHECK(uv[2] == 0x3000 && uv[3] == 0x4000 && uv[4] == 0);
+}
+
+TEST(pad_nv12_same_size_is_a_no_op) {
+    Nv12 frame(4, 4, 8);
+    const std::vector<uint8_t> y = frame.y;
+    const std::vector<uint8_t> uv = frame.uv;
+    padNv12(frame.y.data(), frame.pitch, frame.uv.data(), frame.pitch, 4, 4, 4, 4);
+    CHECK(frame.y == y && frame.uv == uv);
+}
@@ -0,0 +1,88 @@
+#include <random>
+#include <vector>
+
+#include "../amf/cpu_scaler.h"
+#include "test.h"
+
+using namespace amf;
+
+static const CpuScaler::Mode kModes[] = {CpuScaler::Mode::BILINEAR, CpuScaler::Mode::AREA,
+                                         CpuScaler::Mode::BICUBIC, CpuScaler::Mode::LANCZOS};
+
+static std::vector<uint8_t> scale(CpuScaler& scaler, const std::vector<uint8_t>& src,
+                                  uint32_t src_width, uint32_t src_height, uint32_t dst_width,
+                                  uint32_t dst_height, uint32_t channels, bool chroma) {
+    const uint32_t dst_pitch = dst_width * channels + 16;
+    std::vector<uint8_t> dst(static_cast<size_t>(dst_pitch) * dst_height, 0xEE);
+    scaler.scalePlane(src.data(), src_width * channels, src_width, src_height, dst.data(),
+                      dst_pitch, dst_width, dst_height, channels, chroma);
+    return dst;
+}
+
+TEST(cpu_scaler_simd_matches_scalar) {
+    std::mt19937 rng(6);
+    const uint32_t sizes[][4] = {{64, 32, 40, 20},    {640, 360, 1280, 720}, {1280, 720, 640, 360},
+                                 {333, 101, 100, 99}, {7, 5, 31, 3},         {1920, 8, 1278, 4},
+                                 {50, 4, 49, 4}};
+    const SimdLevel levels[] = {SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::NEON};
+    for (CpuScaler::Mode mode : kModes) {
+        for (const auto& size : sizes) {
+            for (uint32_t channels : {1u, 2u}) {
+                std::vector<uint8_t> src(static_cast<size_t>(size[0]) * channels * size[1]);
+                for (uint8_t& b : src) {
+                    b = static_cast<uint8_t>(rng());
+                }
+                for (bool chroma : {false, true}) {
+                    CpuScaler scalar(mode, SimdLevel::SCALAR, ChromaSiting::LEFT);
+                    const std::vector<uint8_t> expected =
+                        scale(scalar, src, size[0], size[1], size[2], size[3], channels, chroma);
+                    for (SimdLevel level : levels) {
+                        CpuScaler simd(mode, level, ChromaSiting::LEFT);
+                        CHECK(scale(simd, src, size[0], size[1], size[2], size[3], channels,
+                                    chroma) == expected);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(cpu_scaler_keeps_flat_planes_flat) {
+    for (CpuScaler::Mode mode : kModes) {
+        CpuScaler scaler(mode);
+        const std::vector<uint8_t> src(1280 * 720, 77);
+        for (const auto& size : {std::make_pair(640u, 360u), std::make_pair(1920u, 1080u)}) {
+            const std::vector<uint8_t> dst =
+                scale(scaler, src, 1280, 720, size.first, size.second, 1, false);
+            bool flat = true;
+            for (uint32_t row = 0; row < size.second; row++) {
+                for (uint32_t x = 0; x < size.first; x++) {
+                    flat &= dst[row * (size.first + 16) + x] == 77;
+                }
+            }
+            CHECK(flat);
+        }
+    }
+}
+
+// 2:1 of a ramp of 8 per pixel: a centered sample lands between two source pixels, a co-sited one
+// a quarter pixel further left
+TEST(cpu_scaler_chroma_siting) {
+    std::vector<uint8_t> ramp(32 * 2);
+    for (uint32_t x = 0; x < 32; x++) {
+        ramp[x] = ramp[32 + x] = static_cast<uint8_t>(x * 8);
+    }
+    for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::AUTO}) {
+        CpuScaler center(CpuScaler::Mode::BILINEAR, level, ChromaSiting::CENTER);
+        CpuScaler left(CpuScaler::Mode::BILINEAR, level, ChromaSiting::LEFT);
+        const std::vector<uint8_t> centered = scale(center, ramp, 32, 2, 16, 1, 1, true);
+        const std::vector<uint8_t> cosited = scale(left, ramp, 32, 2, 16, 1, 1, true);
+        // Luma is never shifted
+        const std::vector<uint8_t> luma = scale(left, ramp, 32, 2, 16, 1, 1, false);
+        for (uint32_t i = 0; i < 15; i++) {
+            CHECK(centered[i] == i * 16 + 4);
+            CHECK(cosited[i] == i * 16 + 2);
+            CHECK(luma[i] == i * 16 + 4);
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "../amf/encode_pipeline.h"
+#include "fake_amf.h"
+#include "test.h"
+
+using namespace amf;
+using namespace std::chrono_literals;
+
+// What the sink got, the pipeline calls it on its output thread
+struct Delivered {
+    std::mutex mtx;
+    std::vector<EncodedFrameInfo> frames;
+
+    EncodePipeline::Sink sink() {
+        return [this](AMFDataPtr&, const EncodedFrameInfo& info) {
+            std::lock_guard<std::mutex> lock(mtx);
+            frames.push_back(info);
+        };
+    }
+};
+
+static AMFComponentPtr component(test::FakeEncoder* encoder) {
+    return AMFComponentPtr(static_cast<AMFComponent*>(encoder));
+}
+
+static EncodedFrameInfo frameInfo(uint64_t frame_id, bool force_key = false) {
+    EncodedFrameInfo info;
+    info.frame_id = frame_id;
+    info.capture_time = 1000 + static_cast<int64_t>(frame_id) * 33333;
+    info.force_key = force_key;
+    return info;
+}
+
+TEST(encode_pipeline_delivers_every_frame_in_order) {
+    // Without the pts carried through the packets are matched in submission order
+    for (bool keep_pts : {true, false}) {
+        test::FakeEncoder* encoder = new test::FakeEncoder(3, 500us, keep_pts);
+        Delivered delivered;
+        EncodePipeline pipeline(component(encoder), delivered.sink(), 64);
+        for (uint64_t i = 0; i < 50; i++) {
+            CHECK(pipeline.submit(test::FakeData::make(), frameInfo(i)));
+        }
+        CHECK(pipeline.stop());
+        const EncodePipeline::Stats stats = pipeline.stats();
+        CHECK(stats.submitted == 50 && stats.encoded == 50 && stats.dropped == 0);
+        CHECK(encoder->inputFull() > 0);
+        CHECK(delivered.frames.size() == 50);
+        for (size_t i = 0; i < delivered.frames.size(); i++) {
+            const EncodedFrameInfo& info = delivered.frames[i];
+            CHECK(info.frame_id == i && info.capture_time == frameInfo(i).capture_time);
+            CHECK(info.submit_time > 0 && info.output_time >= info.submit_time);
+        }
+        CHECK(pipeline.inFlight() == 0);
+    }
+}
+
+TEST(encode_pipeline_keeps_force_key_when_parking_is_full) {
+    test::FakeEncoder* encoder = new test::FakeEncoder(1, 0us);
+    encoder->hold(true);
+    Delivered delivered;
+    EncodePipeline pipeline(component(encoder), delivered.sink(), 1);
+    // 0 fills the encoder, the key frame is parked and the frames behind it do not replace it
+    CHECK(pipeline.submit(test::FakeData::make(), frameInfo(0)));
+    CHECK(pipeline.submit(test::FakeData::make(), frameInfo(1, true)));
+    CHECK(pipeline.submit(test::FakeData::make(), frameInfo(2)));
+    CHECK(pipeline.submit(test::FakeData::make(), frameInfo(3)));
+    CHECK(pipeline.stats().dropped == 2);
+    // A newer key frame does
+    CHECK(pipeline.submit(test::FakeData::make(), frameInfo(4, true)));
+    CHECK(pipeline.stats().dropped == 3);
+    encoder->hold(false);
+    CHECK(pipeline.stop());
+    CHECK(delivered.frames.size() == 2);
+    if (delivered.frames.size() == 2) {
+        CHECK(delivered.frames[0].frame_id == 0);
+        CHECK(delivered.frames[1].frame_id == 4 && delivered.frames[1].force_key);
+    }
+}
+
+TEST(encode_pipeline_stop_gives_up_on_a_stalled_encoder) {
+    test::FakeEncoder* encoder = new test::FakeEncoder(2, 0us);
+    encoder->hold(true);
+    Delivered delivered;
+    EncodePipeline pipeline(component(encoder), delivered.sink(), 1);
+    for (uint64_t i = 0; i < 3; i++) {
+        CHECK(pipeline.submit(test::FakeData::make(), frameInfo(i)));
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    CHECK(!pipeline.stop(50));
+    CHECK(std::chrono::steady_clock::now() - begin < 1s);
+    CHECK(delivered.frames.empty());
+    const EncodePipeline::Stats stats = pipeline.stats();
+    CHECK(stats.submitted == 2 && stats.dropped == 3);
+    // Nothing is accepted once stopped
+    CHECK(!pipeline.submit(test::FakeData::make(), frameInfo(3)));
+}
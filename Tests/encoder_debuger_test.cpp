@@ -0,0 +1,31 @@
+#include <string>
+#include <vector>
+
+#include "../amf/amf_helper.h"
+#include "test.h"
+
+using namespace amf;
+
+TEST(encoder_debuger_skips_the_latencies_of_untimed_packets) {
+    AmfEncoderDebuger recorder;
+    const int64_t start = 1000 * 1000;
+    for (int64_t i = 0; i < 30; i++) {
+        const int64_t at_time = start + i * 33333;
+        recorder.addInput(30, at_time);
+        // Every third packet did not find its frame
+        const bool timed = i % 3 != 0;
+        recorder.addOuput(4000, 30, 1000 * 1000, at_time + 5000, timed, timed ? 800 : 0,
+                          timed ? 4000 : 0);
+    }
+    std::vector<AmfEncoderDebuger::Statistics> outputs;
+    CHECK(recorder.stat(outputs, start + 5 * 1000 * 1000, 1000 * 5));
+    CHECK(!outputs.empty());
+    for (auto& output : outputs) {
+        if (output.input_fps == 0) {
+            continue;
+        }
+        CHECK(output.upload_latency.min == 800 && output.upload_latency.medium == 800);
+        CHECK(output.encode_latency.min == 4000 && output.encode_latency.medium == 4000);
+        CHECK(output.to_str().find("4000Byte, 30|30}") != std::string::npos);
+    }
+}
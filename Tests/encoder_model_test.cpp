@@ -0,0 +1,41 @@
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include "../amf/encoder_model.h"
+#include "test.h"
+
+using namespace amf;
+
+static const char* kLogPath = "encoder_model_test.log";
+
+// P frames of ln(size / pixels) = -2 - 0.1 * qp, as AmfEncoder logs them
+static void writeFrames(FILE* file, uint32_t width, uint32_t height, uint32_t first) {
+    for (uint32_t i = 0; i < 12; i++) {
+        const uint32_t qp = 20 + (i * 7) % 20;
+        const double size = width * height * std::exp(-2.0 - 0.1 * qp);
+        std::fprintf(file, "[INFO] Frame %u, P, QP: %u, size: %u B, Target:900 kbps\n", first + i,
+                     qp, static_cast<uint32_t>(std::lround(size)));
+    }
+}
+
+TEST(encoder_model_calibrate_follows_resizes) {
+    FILE* file = std::fopen(kLogPath, "w");
+    CHECK(file);
+    if (!file) {
+        return;
+    }
+    std::fprintf(file, "[INFO] AMF encoder initialized, settings: 1280 X 720, 30FPS, H264\n");
+    writeFrames(file, 1280, 720, 0);
+    std::fprintf(file, "[INFO] Encoder resized to 640x360 in 3.2 ms\n");
+    writeFrames(file, 640, 360, 12);
+    std::fclose(file);
+    EncoderModel::Params params;
+    const bool fitted = EncoderModel::calibrate(kLogPath, &params);
+    std::remove(kLogPath);
+    CHECK(fitted);
+    // The frames after the resize are normalized by their own size, the fit stays exact
+    CHECK(std::fabs(params.delta.scale + 2.0) < 0.01);
+    CHECK(std::fabs(params.delta.slope - 0.1) < 0.001);
+    CHECK(params.delta.sigma < 0.01);
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "../amf/components/Component.h"
+
+// In-process stand-ins for the AMF objects EncodePipeline drives, no runtime or GPU involved.
+namespace test {
+
+// Property storage and reference counting shared by the fakes
+template <typename Interface>
+class FakeObject : public Interface {
+public:
+    amf_long AMF_STD_CALL Acquire() override { return ++refs_; }
+    amf_long AMF_STD_CALL Release() override {
+        const long refs = --refs_;
+        if (refs == 0) {
+            delete this;
+        }
+        return refs;
+    }
+    AMF_RESULT AMF_STD_CALL QueryInterface(const amf::AMFGuid&, void**) override {
+        return AMF_NO_INTERFACE;
+    }
+
+    AMF_RESULT AMF_STD_CALL SetProperty(const wchar_t* name, amf::AMFVariantStruct value) override {
+        std::lock_guard<std::mutex> lock(props_mtx_);
+        props_[name] = amf::AMFVariant(value);
+        return AMF_OK;
+    }
+    AMF_RESULT AMF_STD_CALL GetProperty(const wchar_t* name,
+                                        amf::AMFVariantStruct* value) const override {
+        std::lock_guard<std::mutex> lock(props_mtx_);
+        auto it = props_.find(name);
+        if (it == props_.end()) {
+            return AMF_NOT_FOUND;
+        }
+        amf::AMFVariantInit(value);
+        return amf::AMFVariantCopy(value, const_cast<amf::AMFVariant*>(&it->second));
+    }
+    amf_bool AMF_STD_CALL HasProperty(const wchar_t* name) const override {
+        std::lock_guard<std::mutex> lock(props_mtx_);
+        return props_.count(name) > 0;
+    }
+    amf_size AMF_STD_CALL GetPropertyCount() const override {
+        std::lock_guard<std::mutex> lock(props_mtx_);
+        return props_.size();
+    }
+    AMF_RESULT AMF_STD_CALL GetPropertyAt(amf_size, wchar_t*, amf_size,
+                                          amf::AMFVariantStruct*) const override {
+        return AMF_NOT_SUPPORTED;
+    }
+    AMF_RESULT AMF_STD_CALL Clear() override {
+        std::lock_guard<std::mutex> lock(props_mtx_);
+        props_.clear();
+        return AMF_OK;
+    }
+    AMF_RESULT AMF_STD_CALL AddTo(amf::AMFPropertyStorage*, amf_bool, amf_bool) const override {
+        return AMF_NOT_SUPPORTED;
+    }
+    AMF_RESULT AMF_STD_CALL CopyTo(amf::AMFPropertyStorage*, amf_bool) const override {
+        return AMF_NOT_SUPPORTED;
+    }
+    void AMF_STD_CALL AddObserver(amf::AMFPropertyStorageObserver*) override {}
+    void AMF_STD_CALL RemoveObserver(amf::AMFPropertyStorageObserver*) override {}
+
+protected:
+    virtual ~FakeObject() = default;
+
+private:
+    std::atomic<long> refs_{0};
+    std::map<std::wstring, amf::AMFVariant> props_;
+    mutable std::mutex props_mtx_;
+};
+
+class FakeData : public FakeObject<amf::AMFData> {
+public:
+    static amf::AMFDataPtr make() {
+        return amf::AMFDataPtr(static_cast<amf::AMFData*>(new FakeData()));
+    }
+
+    amf::AMF_MEMORY_TYPE AMF_STD_CALL GetMemoryType() override { return amf::AMF_MEMORY_HOST; }
+    AMF_RESULT AMF_STD_CALL Duplicate(amf::AMF_MEMORY_TYPE, amf::AMFData**) override {
+        return AMF_NOT_SUPPORTED;
+    }
+    AMF_RESULT AMF_STD_CALL Convert(amf::AMF_MEMORY_TYPE) override { return AMF_NOT_SUPPORTED; }
+    AMF_RESULT AMF_STD_CALL Interop(amf::AMF_MEMORY_TYPE) override { return AMF_NOT_SUPPORTED; }
+    amf::AMF_DATA_TYPE AMF_STD_CALL GetDataType() override { return amf::AMF_DATA_BUFFER; }
+    amf_bool AMF_STD_CALL IsReusable() override { return false; }
+    void AMF_STD_CALL SetPts(amf_pts pts) override { pts_ = pts; }
+    amf_pts AMF_STD_CALL GetPts() override { return pts_; }
+    void AMF_STD_CALL SetDuration(amf_pts) override {}
+    amf_pts AMF_STD_CALL GetDuration() override { return 0; }
+
+private:
+    amf_pts pts_ = 0;
+};
+
+// An encoder with an input queue of `depth` frames that encodes one at a time, each frame takes
+// `latency`. While held nothing comes out, as a stalled GPU.
+class FakeEncoder : public FakeObject<amf::AMFComponent> {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    FakeEncoder(size_t depth, std::chrono::microseconds latency, bool keep_pts = true)
+        : depth_(depth)
+        , latency_(latency)
+        , keep_pts_(keep_pts) {}
+
+    void hold(bool held) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        held_ = held;
+        cv_.notify_all();
+    }
+
+    int submits() const { return submits_; }
+    int inputFull() const { return input_full_; }
+
+    amf_size AMF_STD_CALL GetPropertiesInfoCount() const override { return 0; }
+    AMF_RESULT AMF_STD_CALL GetPropertyInfo(amf_size, const amf::AMFPropertyInfo**) const override {
+        return AMF_NOT_SUPPORTED;
+    }
+    AMF_RESULT AMF_STD_CALL GetPropertyInfo(const wchar_t*,
+                                            const amf::AMFPropertyInfo**) const override {
+        return AMF_NOT_SUPPORTED;
+    }
+    AMF_RESULT AMF_STD_CALL ValidateProperty(const wchar_t*, amf::AMFVariantStruct,
+                                             amf::AMFVariantStruct*) const override {
+        return AMF_NOT_SUPPORTED;
+    }
+
+    AMF_RESULT AMF_STD_CALL Init(amf::AMF_SURFACE_FORMAT, amf_int32, amf_int32) override {
+        return AMF_OK;
+    }
+    AMF_RESULT AMF_STD_CALL ReInit(amf_int32, amf_int32) override { return AMF_OK; }
+    AMF_RESULT AMF_STD_CALL Terminate() override { return AMF_OK; }
+    AMF_RESULT AMF_STD_CALL Drain() override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        draining_ = true;
+        cv_.notify_all();
+        return AMF_OK;
+    }
+    AMF_RESULT AMF_STD_CALL Flush() override { return AMF_OK; }
+
+    AMF_RESULT AMF_STD_CALL SubmitInput(amf::AMFData* data) override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (draining_) {
+            return AMF_EOF;
+        }
+        if (queue_.size() >= depth_) {
+            input_full_++;
+            return AMF_INPUT_FULL;
+        }
+        busy_until_ = std::max(Clock::now(), busy_until_) + latency_;
+        queue_.emplace_back(busy_until_, data->GetPts());
+        submits_++;
+        cv_.notify_all();
+        return AMF_OK;
+    }
+
+    // Waits 20 ms at most, as QUERY_TIMEOUT does
+    AMF_RESULT AMF_STD_CALL QueryOutput(amf::AMFData** output) override {
+        std::unique_lock<std::mutex> lock(mtx_);
+        const auto deadline = Clock::now() + std::chrono::milliseconds(20);
+        while (true) {
+            const auto now = Clock::now();
+            if (!held_ && !queue_.empty() && queue_.front().first <= now) {
+                FakeData* packet = new FakeData();
+                packet->SetPts(keep_pts_ ? queue_.front().second : 0);
+                packet->Acquire();
+                queue_.pop_front();
+                *output = packet;
+                return AMF_OK;
+            }
+            if (!held_ && queue_.empty() && draining_) {
+                return AMF_EOF;
+            }
+            if (now >= deadline) {
+                return AMF_REPEAT;
+            }
+            cv_.wait_until(lock, held_ || queue_.empty()
+                                     ? deadline
+                                     : std::min(deadline, queue_.front().first));
+        }
+    }
+
+    amf::AMFContext* AMF_STD_CALL GetContext() override { return nullptr; }
+    AMF_RESULT AMF_STD_CALL SetOutputDataAllocatorCB(amf::AMFDataAllocatorCB*) override {
+        return AMF_NOT_SUPPORTED;
+    }
+    AMF_RESULT AMF_STD_CALL GetCaps(amf::AMFCaps**) override { return AMF_NOT_SUPPORTED; }
+    AMF_RESULT AMF_STD_CALL Optimize(amf::AMFComponentOptimizationCallback*) override {
+        return AMF_NOT_SUPPORTED;
+    }
+
+private:
+    const size_t depth_;
+    const std::chrono::microseconds latency_;
+    const bool keep_pts_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    // Time each frame is encoded at, and its pts
+    std::deque<std::pair<Clock::time_point, amf_pts>> queue_;
+    Clock::time_point busy_until_;
+    bool held_ = false;
+    bool draining_ = false;
+    std::atomic<int> submits_{0};
+    std::atomic<int> input_full_{0};
+};
+
+} // namespace test
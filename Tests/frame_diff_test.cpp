@@ -0,0 +1,50 @@
+#include <random>
+#include <vector>
+
+#include "../amf/frame_diff.h"
+#include "test.h"
+
+using namespace amf;
+
+TEST(dirty_region_detector_finds_changed_tiles) {
+    const uint32_t width = 1921;
+    const uint32_t height = 1081;
+    std::mt19937 rng(8);
+    std::vector<uint8_t> luma(width * height);
+    for (uint8_t& b : luma) {
+        b = static_cast<uint8_t>(rng());
+    }
+    for (bool crc32 : {false, true}) {
+        DirtyRegionDetector detector(64, crc32);
+        // Everything is dirty at first, as one rectangle
+        CHECK(detector.update(luma.data(), width, width, height));
+        CHECK(detector.dirtyTileCount() == detector.tilesX() * detector.tilesY());
+        CHECK(detector.dirtyRects().size() == 1);
+        CHECK(!detector.update(luma.data(), width, width, height));
+        // The last, partial column, and two tiles on top of each other
+        luma[100 * width + 1920] ^= 1;
+        luma[700 * width + 5] ^= 1;
+        luma[764 * width + 5] ^= 1;
+        CHECK(detector.update(luma.data(), width, width, height));
+        CHECK(detector.dirtyTileCount() == 3);
+        const std::vector<DirtyRegionDetector::Rect>& rects = detector.dirtyRects();
+        CHECK(rects.size() == 2);
+        if (rects.size() == 2) {
+            CHECK(rects[0].x == 1920 && rects[0].y == 64 && rects[0].width == 1 &&
+                  rects[0].height == 64);
+            CHECK(rects[1].x == 0 && rects[1].y == 640 && rects[1].width == 64 &&
+                  rects[1].height == 128);
+        }
+        detector.reset();
+        CHECK(detector.update(luma.data(), width, width, height));
+    }
+}
+
+TEST(dirty_region_detector_size_change_is_dirty) {
+    std::vector<uint8_t> luma(1280 * 720, 16);
+    DirtyRegionDetector detector;
+    detector.update(luma.data(), 1280, 1280, 720);
+    CHECK(!detector.update(luma.data(), 1280, 1280, 720));
+    CHECK(detector.update(luma.data(), 1280, 1280, 704));
+    CHECK(detector.dirtyTileCount() == detector.tilesX() * detector.tilesY());
+}
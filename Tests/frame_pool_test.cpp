@@ -0,0 +1,65 @@
+#include <thread>
+#include <vector>
+
+#include "../amf/frame_pool.h"
+#include "test.h"
+
+using namespace amf;
+
+static constexpr size_t kFrame1080p = 1920 * 1080 * 3 / 2;
+static constexpr size_t kFrame720p = 1280 * 720 * 3 / 2;
+
+TEST(frame_pool_steady_state_does_not_allocate) {
+    FramePool pool;
+    // Capture holds a few frames in flight, as the encoder input queue does
+    std::vector<FrameBufferPtr> in_flight;
+    for (uint32_t frame = 0; frame < 1000; frame++) {
+        in_flight.push_back(pool.acquire(kFrame1080p));
+        if (in_flight.size() > 3) {
+            in_flight.erase(in_flight.begin());
+        }
+    }
+    const FramePool::Stats stats = pool.stats();
+    CHECK(stats.misses == 4);
+    CHECK(stats.hits == 996);
+    CHECK(stats.in_use == 3 && stats.high_water == 4);
+}
+
+TEST(frame_pool_buffers_are_aligned_and_sized) {
+    FramePool pool;
+    FrameBufferPtr buffer = pool.acquire(kFrame720p);
+    CHECK(buffer->size() == kFrame720p);
+    CHECK(buffer->capacity() >= kFrame720p && buffer->capacity() % 4096 == 0);
+    CHECK(reinterpret_cast<uintptr_t>(buffer->data()) % FrameBuffer::kAlignment == 0);
+    // A close size shares the bucket
+    FrameBuffer* first = buffer.get();
+    buffer.reset();
+    buffer = pool.acquire(kFrame720p - 100);
+    CHECK(buffer.get() == first && buffer->size() == kFrame720p - 100);
+}
+
+TEST(frame_pool_keeps_at_most_max_idle) {
+    FramePool pool(2);
+    {
+        std::vector<FrameBufferPtr> held;
+        for (uint32_t i = 0; i < 5; i++) {
+            held.push_back(pool.acquire(kFrame720p));
+        }
+    }
+    FramePool::Stats stats = pool.stats();
+    CHECK(stats.idle == 2 && stats.in_use == 0);
+    pool.trim();
+    stats = pool.stats();
+    CHECK(stats.idle == 0 && stats.idle_bytes == 0);
+}
+
+TEST(frame_pool_release_on_another_thread) {
+    FramePool pool;
+    for (uint32_t round = 0; round < 200; round++) {
+        FrameBufferPtr buffer = pool.acquire(kFrame720p);
+        std::thread consumer([held = std::move(buffer)]() mutable { held.reset(); });
+        consumer.join();
+    }
+    const FramePool::Stats stats = pool.stats();
+    CHECK(stats.misses == 1 && stats.in_use == 0);
+}
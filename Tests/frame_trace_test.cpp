@@ -0,0 +1,113 @@
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "../amf/frame_trace_reader.h"
+#include "../amf/frame_trace_writer.h"
+#include "test.h"
+
+using namespace amf;
+
+static const char* kTracePath = "frame_trace_test.bin";
+static const std::string kRotatedPath = std::string(kTracePath) + ".1";
+
+// 30 fps, frame 12 after a 20 s pause, every fourth packet without the times of its frame
+static FrameRecord frameRecord(uint32_t i) {
+    FrameRecord record;
+    record.output_time = 1000 * 1000 + i * 33333ll + (i >= 12 ? 20 * 1000 * 1000 : 0);
+    record.frame_id = i;
+    record.upload_us = i % 4 == 0 ? 0 : 500;
+    record.encode_us = i % 4 == 0 ? 0 : 3000;
+    record.size = 1000 + i;
+    record.target_bitrate = 1000 * 1000;
+    record.fps = 30;
+    record.width = 1280;
+    record.height = 720;
+    // IDR, then P frames
+    record.frame_type = i == 0 ? 0 : 2;
+    record.qp = 30;
+    return record;
+}
+
+static FrameTraceWriter::Options options(uint32_t block_frames) {
+    FrameTraceWriter::Options options;
+    options.path = kTracePath;
+    options.block_frames = block_frames;
+    options.grow_blocks = 4;
+    return options;
+}
+
+static bool writeFrames(uint32_t block_frames, uint32_t first, uint32_t count) {
+    FrameTraceWriter writer(options(block_frames));
+    bool written = writer.open();
+    for (uint32_t i = first; i < first + count; i++) {
+        written &= writer.append(frameRecord(i));
+    }
+    return written;
+}
+
+TEST(frame_trace_round_trip) {
+    std::remove(kTracePath);
+    CHECK(writeFrames(8, 0, 20));
+    FrameTraceReader reader;
+    CHECK(reader.open(kTracePath));
+    CHECK(reader.blocks() == 3);
+    CHECK(reader.readBlock(1) && reader.frames() == 8);
+    const FrameRecord record = reader.record(3);
+    CHECK(record.frame_id == 11 && record.output_time == frameRecord(11).output_time);
+    CHECK(record.size == 1011 && record.encode_us == 3000 && record.width == 1280);
+    CHECK(reader.readBlock(2) && reader.frames() == 4);
+    CHECK(!reader.readBlock(3));
+    std::remove(kTracePath);
+}
+
+TEST(frame_trace_keeps_the_whole_blocks_of_a_cut_trace) {
+    std::remove(kTracePath);
+    CHECK(writeFrames(8, 0, 20));
+    uint64_t block_bytes = 0;
+    {
+        FrameTraceReader reader;
+        CHECK(reader.open(kTracePath));
+        block_bytes = reader.header().block_bytes;
+    }
+    // As a crash in the middle of the third block leaves it
+    std::filesystem::resize_file(kTracePath, kFrameTraceHeaderBytes + block_bytes * 5 / 2);
+    FrameTraceReader reader;
+    CHECK(reader.open(kTracePath));
+    CHECK(reader.blocks() == 2);
+    FrameTraceSummary summary;
+    CHECK(summarize(reader, &summary));
+    CHECK(summary.frames == 16 && summary.key_frames == 1);
+    // The pause splits the frames in two sessions, it does not count towards the duration
+    CHECK(summary.sessions == 2);
+    CHECK(summary.duration_us == 14 * 33333);
+    // The untimed packets are left out of the latencies
+    CHECK(summary.encode_us.count() == 12 && summary.upload_us.count() == 12);
+    CHECK(summary.encode_us.p50() == 3000);
+    reader.close();
+    // The writer continues after the whole blocks
+    CHECK(writeFrames(8, 16, 4));
+    CHECK(reader.open(kTracePath));
+    CHECK(reader.blocks() == 3);
+    CHECK(reader.readBlock(2) && reader.frames() == 4 && reader.record(0).frame_id == 16);
+    reader.close();
+    std::remove(kTracePath);
+}
+
+TEST(frame_trace_moves_a_trace_of_another_layout) {
+    std::remove(kTracePath);
+    std::remove(kRotatedPath.c_str());
+    CHECK(writeFrames(16, 0, 20));
+    CHECK(writeFrames(8, 0, 4));
+    FrameTraceReader reader;
+    CHECK(reader.open(kRotatedPath));
+    CHECK(reader.header().block_frames == 16 && reader.blocks() == 2);
+    FrameTraceSummary summary;
+    CHECK(summarize(reader, &summary) && summary.frames == 20);
+    reader.close();
+    CHECK(reader.open(kTracePath));
+    CHECK(reader.header().block_frames == 8 && reader.blocks() == 1);
+    reader.close();
+    std::remove(kTracePath);
+    std::remove(kRotatedPath.c_str());
+}
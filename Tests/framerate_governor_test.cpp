@@ -0,0 +1,41 @@
+#include "../amf/framerate_governor.h"
+#include "test.h"
+
+using namespace amf;
+
+static constexpr int64_t kStart = 100 * 1000 * 1000;
+
+// Captures every 100 ms from `from_ms` to `to_ms` after the start, false when fps() changed
+static bool updateEvery100ms(FramerateGovernor* governor, float changed, int64_t from_ms,
+                             int64_t to_ms) {
+    bool stable = true;
+    for (int64_t ms = from_ms; ms <= to_ms; ms += 100) {
+        stable &= !governor->update(changed, kStart + ms * 1000);
+    }
+    return stable;
+}
+
+TEST(framerate_governor_lowers_after_its_hold) {
+    FramerateGovernor governor;
+    CHECK(governor.fps() == 30);
+    // Typing, the document rate is wanted from the first capture on
+    CHECK(updateEvery100ms(&governor, 0.01f, 0, 900));
+    CHECK(governor.fps() == 30);
+    CHECK(governor.update(0.01f, kStart + 1000 * 1000) && governor.fps() == 5);
+    // Motion raises it at once
+    CHECK(governor.update(0.5f, kStart + 1100 * 1000) && governor.fps() > 5);
+    // Calm again, the motion average decays and the hold starts over
+    CHECK(!governor.update(0.01f, kStart + 1200 * 1000));
+    CHECK(updateEvery100ms(&governor, 0.01f, 1300, 2100));
+    CHECK(governor.fps() > 5);
+}
+
+TEST(framerate_governor_times_the_static_screen_from_the_first_capture) {
+    FramerateGovernor governor;
+    // Nothing changes, not for long enough to be static yet
+    CHECK(updateEvery100ms(&governor, 0.f, 0, 900));
+    CHECK(governor.update(0.f, kStart + 1000 * 1000) && governor.fps() == 5);
+    // Static after 2 s, lowered to the refresh rate 1 s later
+    CHECK(updateEvery100ms(&governor, 0.f, 1100, 2900));
+    CHECK(governor.update(0.f, kStart + 3000 * 1000) && governor.fps() == 1);
+}
@@ -0,0 +1,130 @@
+// Runs every test, or those whose name contains the argument.
+//   Tests [filter]
+// Outside Visual Studio, with the amf sources of Tests.vcxproj:
+//   SOURCES=$(grep -o 'amf\\[a-z0-9_]*\.cpp' Tests/Tests.vcxproj | tr '\\' /)
+//   g++ -std=c++17 -O2 -o tests Tests/*.cpp $SOURCES -lpthread
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "../amf/amf_helper.h"
+#include "../amf/capability_probe.h"
+#include "../amf/trace_bridge.h"
+#include "test.h"
+
+namespace test {
+
+static std::mutex capture_mtx;
+static bool capturing = false;
+static std::vector<LogLine> captured;
+
+LogCapture::LogCapture() {
+    std::lock_guard<std::mutex> lock(capture_mtx);
+    captured.clear();
+    capturing = true;
+}
+
+LogCapture::~LogCapture() {
+    std::lock_guard<std::mutex> lock(capture_mtx);
+    capturing = false;
+}
+
+std::vector<LogLine> LogCapture::lines() const {
+    std::lock_guard<std::mutex> lock(capture_mtx);
+    return captured;
+}
+
+} // namespace test
+
+namespace amf {
+
+// The amf sources log through this, errors are worth seeing when a test fails unless the test
+// captures them
+void log(int level, const char* file, int line, const char* format, ...) {
+    {
+        std::lock_guard<std::mutex> lock(test::capture_mtx);
+        if (test::capturing) {
+            char text[1024];
+            va_list args;
+            va_start(args, format);
+            std::vsnprintf(text, sizeof(text), format, args);
+            va_end(args);
+            test::captured.push_back({level, text});
+            return;
+        }
+    }
+    if (level < 3) {
+        return;
+    }
+    std::fprintf(stderr, "    log %s:%d ", file, line);
+    va_list args;
+    va_start(args, format);
+    std::vfprintf(stderr, format, args);
+    va_end(args);
+    std::fprintf(stderr, "\n");
+}
+
+void log_flush() {}
+
+// The runtime is not loaded, AmfModuleWrapper::instance() is null as on a machine without it
+AmfModule::AmfModule() {}
+
+AmfModule::~AmfModule() {}
+
+bool AmfModule::init() {
+    return false;
+}
+
+void AmfModule::uninit() {}
+
+bool AmfModule::encoderCapbility(amf_codec_type /*type*/, AmfCodecCapbility* /*capbility*/) const {
+    return false;
+}
+
+} // namespace amf
+
+namespace test {
+
+struct Test {
+    const char* name;
+    TestFunc func;
+};
+
+static std::vector<Test>& tests() {
+    static std::vector<Test> registered;
+    return registered;
+}
+
+static int failures = 0;
+
+Registrar::Registrar(const char* name, TestFunc func) {
+    tests().push_back({name, func});
+}
+
+void fail(const char* file, int line, const char* expression) {
+    std::fprintf(stderr, "    %s:%d CHECK(%s) failed\n", file, line, expression);
+    failures++;
+}
+
+} // namespace test
+
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : "";
+    int run = 0;
+    int failed = 0;
+    for (const test::Test& t : test::tests()) {
+        if (!std::strstr(t.name, filter)) {
+            continue;
+        }
+        const int before = test::failures;
+        t.func();
+        run++;
+        const bool ok = test::failures == before;
+        failed += !ok;
+        std::printf("%s %s\n", ok ? "ok  " : "FAIL", t.name);
+    }
+    std::printf("%d tests, %d failed\n", run, failed);
+    return failed == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+#include <vector>
+
+#include "../amf/amf_helper.h"
+#include "../amf/software_backend.h"
+#include "test.h"
+
+using namespace amf;
+
+static std::vector<uint8_t> pattern(size_t size, uint8_t seed) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = static_cast<uint8_t>(i * 7 + seed);
+    }
+    return data;
+}
+
+static AMFComponentPtr createEncoder(SoftwareBackend& backend, const wchar_t* codec) {
+    AMFComponentPtr encoder;
+    if (backend.createEncoder(codec, &encoder) != AMF_OK) {
+        return nullptr;
+    }
+    return encoder;
+}
+
+static AMFDataPtr queryOutput(AMFComponentPtr& encoder) {
+    AMFDataPtr packet;
+    for (int i = 0; i < 100 && !packet; i++) {
+        if (encoder->QueryOutput(&packet) != AMF_REPEAT) {
+            break;
+        }
+    }
+    return packet;
+}
+
+TEST(software_backend_upload_nv12_and_i420) {
+    SoftwareBackend backend;
+    CHECK(backend.init(0) && backend.luid() == 0);
+    const uint32_t width = 98;
+    const uint32_t height = 34;
+    const std::vector<uint8_t> nv12 = pattern(width * height * 3 / 2, 3);
+    AMFSurfacePtr surface = backend.upload(VideoFrameView::nv12(nv12.data(), width, height));
+    CHECK(surface && surface->GetFormat() == AMF_SURFACE_NV12);
+    if (surface) {
+        AMFPlane* y = surface->GetPlane(AMF_PLANE_Y);
+        AMFPlane* uv = surface->GetPlane(AMF_PLANE_UV);
+        CHECK(y->GetWidth() == width && y->GetHeight() == height && y->GetHPitch() % 256 == 0);
+        const uint8_t* y_data = static_cast<const uint8_t*>(y->GetNative());
+        const uint8_t* uv_data = static_cast<const uint8_t*>(uv->GetNative());
+        bool equal = true;
+        for (uint32_t row = 0; row < height; row++) {
+            for (uint32_t x = 0; x < width; x++) {
+                equal &= y_data[row * y->GetHPitch() + x] == nv12[row * width + x];
+            }
+        }
+        for (uint32_t row = 0; row < height / 2; row++) {
+            for (uint32_t x = 0; x < width; x++) {
+                equal &= uv_data[row * uv->GetHPitch() + x] ==
+                         nv12[width * height + row * width + x];
+            }
+        }
+        CHECK(equal);
+    }
+    // I420 is interleaved on upload
+    const std::vector<uint8_t> u = pattern(width / 2 * height / 2, 50);
+    const std::vector<uint8_t> v = pattern(width / 2 * height / 2, 90);
+    surface = backend.upload(VideoFrameView::i420(nv12.data(), width, u.data(), width / 2,
+                                                  v.data(), width / 2, width, height));
+    CHECK(surface);
+    if (surface) {
+        const uint8_t* uv_data =
+            static_cast<const uint8_t*>(surface->GetPlane(AMF_PLANE_UV)->GetNative());
+        CHECK(uv_data[0] == u[0] && uv_data[1] == v[0] && uv_data[2] == u[1]);
+    }
+}
+
+TEST(software_backend_upload_runs_out_of_surfaces) {
+    SoftwareBackend::Options options;
+    options.max_surfaces = 2;
+    SoftwareBackend backend(options);
+    const std::vector<uint8_t> frame(64 * 64 * 3 / 2);
+    const VideoFrameView view = VideoFrameView::nv12(frame.data(), 64, 64);
+    AMFSurfacePtr first = backend.upload(view);
+    AMFSurfacePtr second = backend.upload(view);
+    CHECK(first && second);
+    CHECK(!backend.upload(view));
+    // Released surfaces are recycled, not allocated again
+    first = nullptr;
+    CHECK(backend.upload(view));
+    CHECK(backend.stats().surfaces_allocated == 2);
+}
+
+TEST(software_backend_encoder_follows_the_component_contract) {
+    SoftwareBackend::Options options;
+    options.queue_depth = 2;
+    options.latency_us = 100;
+    options.packet_size = 1000;
+    SoftwareBackend backend(options);
+    CHECK(!createEncoder(backend, L"unknown"));
+    AMFComponentPtr encoder = createEncoder(backend, AMFVideoEncoderVCE_AVC);
+    CHECK(encoder);
+    if (!encoder) {
+        return;
+    }
+    CHECK(encoder->Init(AMF_SURFACE_BGRA, 64, 64) == AMF_INVALID_FORMAT);
+    CHECK(encoder->Init(AMF_SURFACE_NV12, 64, 64) == AMF_OK);
+    encoder->SetProperty(AMF_VIDEO_ENCODER_IDR_PERIOD, 4);
+    encoder->SetProperty(AMF_VIDEO_ENCODER_QUERY_TIMEOUT, 50);
+    const std::vector<uint8_t> frame(64 * 64 * 3 / 2);
+    const VideoFrameView view = VideoFrameView::nv12(frame.data(), 64, 64);
+    auto submit = [&](int64_t pts, bool force_key) {
+        AMFSurfacePtr surface = backend.upload(view);
+        surface->SetPts(pts);
+        if (force_key) {
+            surface->SetProperty(AMF_VIDEO_ENCODER_FORCE_PICTURE_TYPE,
+                                 AMF_VIDEO_ENCODER_PICTURE_TYPE_IDR);
+        }
+        return encoder->SubmitInput(surface);
+    };
+    std::vector<bool> keys;
+    auto receive = [&](int64_t pts) {
+        AMFDataPtr packet = queryOutput(encoder);
+        CHECK(packet && packet->GetPts() == pts);
+        if (!packet) {
+            return;
+        }
+        int64_t type = -1;
+        packet->GetProperty(AMF_VIDEO_ENCODER_OUTPUT_DATA_TYPE, &type);
+        const bool key = type == AMF_VIDEO_ENCODER_OUTPUT_DATA_TYPE_IDR;
+        AMFBufferPtr buffer(packet);
+        CHECK(buffer && buffer->GetSize() == (key ? 4000u : 1000u));
+        if (buffer) {
+            CHECK(static_cast<const uint8_t*>(buffer->GetNative())[4] == (key ? 0x65 : 0x41));
+        }
+        keys.push_back(key);
+    };
+    // The input queue holds queue_depth frames
+    CHECK(submit(0, false) == AMF_OK);
+    CHECK(submit(1, false) == AMF_OK);
+    CHECK(submit(2, false) == AMF_INPUT_FULL);
+    receive(0);
+    receive(1);
+    // Key frames: the first one, a forced one and the IDR period counted from it
+    for (int64_t pts = 2; pts < 8; pts++) {
+        CHECK(submit(pts, pts == 2) == AMF_OK);
+        receive(pts);
+    }
+    CHECK(keys == std::vector<bool>({true, false, true, false, false, false, true, false}));
+    CHECK(encoder->Drain() == AMF_OK);
+    CHECK(submit(8, false) == AMF_EOF);
+    AMFDataPtr last;
+    CHECK(encoder->QueryOutput(&last) == AMF_EOF);
+    CHECK(backend.stats().encoded == 8 && backend.stats().input_full == 1);
+}
+
+TEST(software_backend_reinit_can_be_refused) {
+    SoftwareBackend::Options options;
+    options.reinit = false;
+    SoftwareBackend backend(options);
+    AMFComponentPtr encoder = createEncoder(backend, AMFVideoEncoder_HEVC);
+    CHECK(encoder && encoder->Init(AMF_SURFACE_NV12, 64, 64) == AMF_OK);
+    if (encoder) {
+        CHECK(encoder->ReInit(128, 128) == AMF_NOT_SUPPORTED);
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Tests of the parts of amf/ that do not need a GPU or the AMF runtime, they build on any platform.
+// A TEST registers itself with main.cpp, a failed CHECK is reported and the test goes on.
+namespace test {
+
+using TestFunc = void (*)();
+
+struct Registrar {
+    Registrar(const char* name, TestFunc func);
+};
+
+void fail(const char* file, int line, const char* expression);
+
+struct LogLine {
+    int level;
+    std::string text;
+};
+
+// Collects what the amf sources log while it is alive, one capture at a time
+class LogCapture {
+public:
+    LogCapture();
+    ~LogCapture();
+
+    std::vector<LogLine> lines() const;
+};
+
+} // namespace test
+
+#define TEST(name)                                                                                 \
+    static void name();                                                                            \
+    static test::Registrar name##_registrar(#name, name);                                          \
+    static void name()
+
+#define CHECK(expression)                                                                          \
+    do {                                                                                           \
+        if (!(expression)) {                                                                       \
+            test::fail(__FILE__, __LINE__, #expression);                                           \
+        }                                                                                          \
+    } while (0)
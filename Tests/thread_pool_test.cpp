@@ -0,0 +1,94 @@
+#include <atomic>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../amf/plane_copy.h"
+#include "../amf/thread_pool.h"
+#include "test.h"
+
+using namespace amf;
+
+TEST(thread_pool_runs_every_index_once) {
+    ThreadPool pool(3);
+    std::vector<std::atomic<uint32_t>> hits(64);
+    uint64_t expected = 0;
+    for (uint32_t round = 0; round < 2000; round++) {
+        const uint32_t count = 1 + round % 64;
+        pool.parallelFor(count, [&](uint32_t index) { hits[index]++; });
+        expected += count;
+    }
+    uint64_t total = 0;
+    for (const std::atomic<uint32_t>& h : hits) {
+        total += h;
+    }
+    CHECK(total == expected);
+    CHECK(hits[0] == 2000 && hits[63] == 2000 / 64);
+}
+
+TEST(thread_pool_concurrent_callers) {
+    ThreadPool pool(3);
+    std::atomic<uint64_t> sum{0};
+    std::vector<std::thread> callers;
+    for (uint32_t c = 0; c < 4; c++) {
+        callers.emplace_back([&]() {
+            for (uint32_t round = 0; round < 1000; round++) {
+                pool.parallelFor(7, [&](uint32_t index) { sum += index; });
+            }
+        });
+    }
+    for (std::thread& caller : callers) {
+        caller.join();
+    }
+    CHECK(sum == 4ull * 1000 * 21);
+}
+
+TEST(thread_pool_nested_runs_inline) {
+    ThreadPool pool(3);
+    std::atomic<uint32_t> inner{0};
+    pool.parallelFor(8, [&](uint32_t) {
+        const std::thread::id outer = std::this_thread::get_id();
+        pool.parallelFor(4, [&](uint32_t) {
+            CHECK(std::this_thread::get_id() == outer);
+            inner++;
+        });
+    });
+    CHECK(inner == 32);
+}
+
+TEST(copy_nv12_every_mode) {
+    std::mt19937 rng(2);
+    for (uint32_t width : {1u, 3u, 17u, 100u, 1920u}) {
+        for (uint32_t height : {1u, 3u, 64u, 1080u}) {
+            for (CopyMode mode : {CopyMode::AUTO, CopyMode::TEMPORAL, CopyMode::STREAMING}) {
+                const uint32_t uv_width = (width + 1) / 2 * 2;
+                const uint32_t uv_height = (height + 1) / 2;
+                const uint32_t src_pitch = uv_width + 7;
+                const uint32_t dst_pitch = (uv_width + 63) / 64 * 64;
+                std::vector<uint8_t> src_y(src_pitch * height);
+                std::vector<uint8_t> src_uv(src_pitch * uv_height);
+                for (uint8_t& b : src_y) {
+                    b = static_cast<uint8_t>(rng());
+                }
+                for (uint8_t& b : src_uv) {
+                    b = static_cast<uint8_t>(rng());
+                }
+                std::vector<uint8_t> dst_y(dst_pitch * height);
+                std::vector<uint8_t> dst_uv(dst_pitch * uv_height);
+                copyNv12(src_y.data(), src_pitch, src_uv.data(), src_pitch, dst_y.data(),
+                         dst_pitch, dst_uv.data(), dst_pitch, width, height, mode);
+                bool same = true;
+                for (uint32_t row = 0; row < height; row++) {
+                    same &= std::memcmp(&dst_y[row * dst_pitch], &src_y[row * src_pitch],
+                                        width) == 0;
+                }
+                for (uint32_t row = 0; row < uv_height; row++) {
+                    same &= std::memcmp(&dst_uv[row * dst_pitch], &src_uv[row * src_pitch],
+                                        uv_width) == 0;
+                }
+                CHECK(same);
+            }
+        }
+    }
+}
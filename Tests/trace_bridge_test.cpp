@@ -0,0 +1,86 @@
+#include <string>
+#include <vector>
+
+#include "../amf/trace_bridge.h"
+#include "test.h"
+
+using namespace amf;
+
+static constexpr int64_t kStart = 10 * 1000 * 1000;
+
+// As the runtime formats its lines for the writers
+static const wchar_t* kErrorLine =
+    L"2026-10-17 10:00:00.000     1a2c [AMFEncoderCoreH264]   Error: SubmitInput failed\r\n";
+static const wchar_t* kWarningLine =
+    L"2026-10-17 10:00:00.000     1a2c [AMFDeviceDX11]  Warning: no debug layer\n";
+static const wchar_t* kDebugLine =
+    L"2026-10-17 10:00:00.000     1a2c [AMFContext]    Debug: surface allocated\n";
+static const wchar_t* kInfoLine =
+    L"2026-10-17 10:00:00.000     1a2c [AMFContext]     Info: device created\n";
+
+static bool endsWith(const std::string& text, const std::string& end) {
+    return text.size() >= end.size() &&
+           text.compare(text.size() - end.size(), end.size(), end) == 0;
+}
+
+TEST(trace_bridge_takes_the_level_from_the_message) {
+    TraceBridge bridge;
+    test::LogCapture capture;
+    bridge.Write(L"AMFEncoderCoreH264", kErrorLine);
+    bridge.Write(L"AMFDeviceDX11", kWarningLine);
+    bridge.Write(L"AMFContext", kDebugLine);
+    bridge.Write(L"AMFContext", kInfoLine);
+    const std::vector<test::LogLine> lines = capture.lines();
+    CHECK(lines.size() == 4);
+    if (lines.size() != 4) {
+        return;
+    }
+    CHECK(lines[0].level == 3 && lines[1].level == 2 && lines[2].level == 0);
+    CHECK(lines[3].level == 1);
+    // The line breaks of the runtime are left to the log
+    CHECK(endsWith(lines[0].text, "Error: SubmitInput failed"));
+    CHECK(endsWith(lines[1].text, "Warning: no debug layer"));
+}
+
+TEST(trace_bridge_limits_the_rate_of_each_scope) {
+    TraceBridge::Options options;
+    options.lines_per_second = 10;
+    options.burst = 3;
+    TraceBridge bridge(options);
+    int64_t clock = kStart;
+    bridge.setClock([&]() { return clock; });
+    test::LogCapture capture;
+    for (int i = 0; i < 5; i++) {
+        bridge.Write(L"AMFEncoderCoreH264", kErrorLine);
+    }
+    CHECK(capture.lines().size() == 3);
+    // Another scope has its own bucket
+    bridge.Write(L"AMFContext", kInfoLine);
+    CHECK(capture.lines().size() == 4);
+    // A line is refilled after 100 ms, the drops are reported in front of it
+    clock += 99 * 1000;
+    bridge.Write(L"AMFEncoderCoreH264", kErrorLine);
+    CHECK(capture.lines().size() == 4);
+    clock += 1000;
+    bridge.Write(L"AMFEncoderCoreH264", kErrorLine);
+    std::vector<test::LogLine> lines = capture.lines();
+    CHECK(lines.size() == 6);
+    if (lines.size() != 6) {
+        return;
+    }
+    CHECK(lines[4].level == 2 && lines[4].text == "[AMFEncoderCoreH264] 3 trace lines suppressed");
+    CHECK(lines[5].level == 3);
+    // The count starts over, the bucket never holds more than the burst
+    clock += 60 * 1000 * 1000;
+    for (int i = 0; i < 4; i++) {
+        bridge.Write(L"AMFEncoderCoreH264", kErrorLine);
+    }
+    clock += 100 * 1000;
+    bridge.Write(L"AMFEncoderCoreH264", kErrorLine);
+    lines = capture.lines();
+    CHECK(lines.size() == 11);
+    if (lines.size() != 11) {
+        return;
+    }
+    CHECK(lines[9].text == "[AMFEncoderCoreH264] 1 trace lines suppressed");
+}
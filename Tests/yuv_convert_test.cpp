@@ -0,0 +1,77 @@
+#include <random>
+#include <vector>
+
+#include "../amf/yuv_convert.h"
+#include "test.h"
+
+using namespace amf;
+
+TEST(uv_row_every_level) {
+    std::mt19937 rng(5);
+    const SimdLevel levels[] = {SimdLevel::SCALAR, SimdLevel::SSE41, SimdLevel::AVX2,
+                                SimdLevel::AVX512, SimdLevel::NEON};
+    for (SimdLevel level : levels) {
+        for (uint32_t width : {1u, 7u, 16u, 31u, 33u, 64u, 100u, 961u}) {
+            std::vector<uint8_t> u(width);
+            std::vector<uint8_t> v(width);
+            for (uint32_t i = 0; i < width; i++) {
+                u[i] = static_cast<uint8_t>(rng());
+                v[i] = static_cast<uint8_t>(rng());
+            }
+            std::vector<uint8_t> uv(width * 2 + 1, 0xEE);
+            interleaveUVRow(u.data(), v.data(), uv.data(), width, level);
+            bool interleaved = uv[width * 2] == 0xEE;
+            for (uint32_t i = 0; i < width; i++) {
+                interleaved &= uv[i * 2] == u[i] && uv[i * 2 + 1] == v[i];
+            }
+            CHECK(interleaved);
+            std::vector<uint8_t> u2(width);
+            std::vector<uint8_t> v2(width);
+            deinterleaveUVRow(uv.data(), u2.data(), v2.data(), width, level);
+            CHECK(u2 == u && v2 == v);
+        }
+    }
+}
+
+TEST(i420_nv12_round_trip) {
+    std::mt19937 rng(5);
+    for (uint32_t width : {2u, 17u, 1921u, 3840u}) {
+        for (uint32_t height : {1u, 2u, 1081u}) {
+            const uint32_t chroma_width = (width + 1) / 2;
+            const uint32_t chroma_height = (height + 1) / 2;
+            // Pitches wider than the rows, as mapped textures have
+            const uint32_t pitch = chroma_width * 2 + 64;
+            std::vector<uint8_t> y(pitch * height);
+            std::vector<uint8_t> u(pitch * chroma_height);
+            std::vector<uint8_t> v(pitch * chroma_height);
+            for (std::vector<uint8_t>* plane : {&y, &u, &v}) {
+                for (uint8_t& b : *plane) {
+                    b = static_cast<uint8_t>(rng());
+                }
+            }
+            std::vector<uint8_t> nv12_y(pitch * height);
+            std::vector<uint8_t> nv12_uv(pitch * chroma_height);
+            copyI420ToNv12(y.data(), pitch, u.data(), pitch, v.data(), pitch, nv12_y.data(),
+                           pitch, nv12_uv.data(), pitch, width, height);
+            CHECK(nv12_uv[0] == u[0] && nv12_uv[1] == v[0]);
+            std::vector<uint8_t> y2(y.size());
+            std::vector<uint8_t> u2(u.size());
+            std::vector<uint8_t> v2(v.size());
+            copyNv12ToI420(nv12_y.data(), pitch, nv12_uv.data(), pitch, y2.data(), pitch,
+                           u2.data(), pitch, v2.data(), pitch, width, height);
+            bool same = true;
+            for (uint32_t row = 0; row < height; row++) {
+                for (uint32_t x = 0; x < width; x++) {
+                    same &= y2[row * pitch + x] == y[row * pitch + x];
+                }
+            }
+            for (uint32_t row = 0; row < chroma_height; row++) {
+                for (uint32_t x = 0; x < chroma_width; x++) {
+                    same &= u2[row * pitch + x] == u[row * pitch + x];
+                    same &= v2[row * pitch + x] == v[row * pitch + x];
+                }
+            }
+            CHECK(same);
+        }
+    }
+}
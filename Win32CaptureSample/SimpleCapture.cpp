@@ -2,6 +2,7 @@
 #include "SimpleCapture.h"
 
 #include "../amf/amf_helper.h"
+#include "../amf/plane_copy.h"
 
 #define LOG_DEBUG(...) amf::log(0, __FILE__, __LINE__, __VA_ARGS__)
 #define LOG_INFO(...) amf::log(1, __FILE__, __LINE__, __VA_ARGS__)
@@ -124,7 +125,18 @@ void SimpleCapture::OnFrameArrived(winrt::Direct3D11CaptureFramePool const& send
         auto surfaceTexture = GetDXGIInterfaceFromObject<ID3D11Texture2D>(frame.Surface());
         D3D11_TEXTURE2D_DESC desc;
         surfaceTexture->GetDesc(&desc);
-        if (!texture_bk_ || desc_bk_.Width != desc.Width || desc_bk_.Height != desc.Height) {
+        auto colorSpace = m_colorSpaceUpdate.exchange(std::nullopt);
+        const bool colorSpaceChanged = colorSpace.has_value() && colorSpace.value() != m_colorSpace;
+        if (colorSpaceChanged) {
+            m_colorSpace = colorSpace.value();
+        }
+        // The video processor has no tone mapping and no BT.2020 output, those run on the cpu
+        const auto backend = desc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT ||
+                                     m_colorSpace.matrix == amf::ColorMatrix::BT2020
+                                 ? amf::NV12Convertor::Backend::CPU
+                                 : amf::NV12Convertor::Backend::VIDEO_PROCESSOR;
+        if (!texture_bk_ || desc_bk_.Width != desc.Width || desc_bk_.Height != desc.Height ||
+            desc_bk_.Format != desc.Format) {
             auto d3dDevice = GetDXGIInterfaceFromObject<ID3D11Device>(m_device);
             desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
             desc.MiscFlags = 0;
@@ -154,14 +166,24 @@ void SimpleCapture::OnFrameArrived(winrt::Direct3D11CaptureFramePool const& send
                 return;
             }
             nv12_convertor_ = std::make_unique<amf::NV12Convertor>();
-            if (!nv12_convertor_->init(d3dDevice.get(), desc.Width, desc.Height)) {
+            if (!nv12_convertor_->init(d3dDevice.get(), desc.Width, desc.Height, backend,
+                                       m_colorSpace)) {
+                nv12_convertor_ = nullptr;
+                LOG_ERROR("Failed to initialize nv12 convertor");
+                return;
+            }
+        }
+        else if (colorSpaceChanged && nv12_convertor_) {
+            auto d3dDevice = GetDXGIInterfaceFromObject<ID3D11Device>(m_device);
+            if (!nv12_convertor_->init(d3dDevice.get(), desc.Width, desc.Height, backend,
+                                       m_colorSpace)) {
                 nv12_convertor_ = nullptr;
                 LOG_ERROR("Failed to initialize nv12 convertor");
                 return;
             }
         }
         m_d3dContext->CopyResource(backBuffer.get(), surfaceTexture.get());
-        // Convert bgra to nv12
+        // Convert bgra|fp16 to nv12
         m_d3dContext->CopyResource(texture_bk_.Get(), surfaceTexture.get());
         if (nv12_convertor_) {
             nv12_convertor_->convert(texture_bk_, texture_bk_nv12_);
@@ -189,20 +211,49 @@ bool SimpleCapture::GetFrame(Nv12Frame* output) {
     //SaveNv12Stream(d3dDevice.get(), texture_bk_nv12_cpu_access_.Get(), "nv12capture.nv12");
     D3D11_TEXTURE2D_DESC desc;
     texture_bk_nv12_cpu_access_->GetDesc(&desc);
-    output->data.resize(desc.Width * desc.Height * 3 / 2);
+    // The previous buffer goes back to the pool unless a consumer still holds it
+    output->buffer = amf::FramePool::instance()->acquire(desc.Width * desc.Height * 3 / 2);
     D3D11_MAPPED_SUBRESOURCE resource;
-    auto hr = m_d3dContext->Map(texture_bk_nv12_cpu_access_.Get(), 0, D3D11_MAP_WRITE, 0, &resource);
+    auto hr = m_d3dContext->Map(texture_bk_nv12_cpu_access_.Get(), 0, D3D11_MAP_READ, 0, &resource);
     if (FAILED(hr)) {
         LOG_ERROR("Failed to map textuer, hr:%0x", hr);
         return false;
     }
-    for (int i = 0; i < desc.Height * 3 / 2; i++) {
-        memcpy((uint8_t*)output->data.data() + i * desc.Width, (uint8_t*)resource.pData + i * resource.RowPitch,
-            desc.Width);
-    }
-    m_d3dContext->Unmap(texture_bk_nv12_.Get(), 0);
+    const uint8_t* src_y = static_cast<const uint8_t*>(resource.pData);
+    const uint8_t* src_uv = src_y + static_cast<size_t>(resource.RowPitch) * desc.Height;
+    uint8_t* dst_y = output->buffer->data();
+    uint8_t* dst_uv = dst_y + static_cast<size_t>(desc.Width) * desc.Height;
+    // The encoder reads the frame back right away, keep it in cache
+    amf::copyNv12(src_y, resource.RowPitch, src_uv, resource.RowPitch, dst_y, desc.Width, dst_uv,
+        desc.Width, desc.Width, desc.Height, amf::CopyMode::TEMPORAL);
+    m_d3dContext->Unmap(texture_bk_nv12_cpu_access_.Get(), 0);
     output->width = desc.Width;
     output->height = desc.Height;
     output->stride = output->width;
     return true;
 }
+
+bool SimpleCapture::MapFrame(amf::VideoFrameView* output) {
+    if (!texture_bk_nv12_ || !nv12_convertor_) {
+        return false;
+    }
+    m_d3dContext->CopyResource(texture_bk_nv12_cpu_access_.Get(), texture_bk_nv12_.Get());
+    D3D11_TEXTURE2D_DESC desc;
+    texture_bk_nv12_cpu_access_->GetDesc(&desc);
+    D3D11_MAPPED_SUBRESOURCE resource;
+    auto hr = m_d3dContext->Map(texture_bk_nv12_cpu_access_.Get(), 0, D3D11_MAP_READ, 0, &resource);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to map textuer, hr:%0x", hr);
+        return false;
+    }
+    const uint8_t* src_y = static_cast<const uint8_t*>(resource.pData);
+    const uint8_t* src_uv = src_y + static_cast<size_t>(resource.RowPitch) * desc.Height;
+    *output = amf::VideoFrameView::nv12(src_y, resource.RowPitch, src_uv, resource.RowPitch,
+                                        desc.Width, desc.Height);
+    output->opaque = this;
+    output->release = [](void* opaque) {
+        auto self = static_cast<SimpleCapture*>(opaque);
+        self->m_d3dContext->Unmap(self->texture_bk_nv12_cpu_access_.Get(), 0);
+    };
+    return true;
+}
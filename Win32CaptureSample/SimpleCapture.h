@@ -5,12 +5,26 @@
 #include <wrl/client.h>
 
 #include "../amf/amf_helper.h"
+#include "../amf/frame_pool.h"
+#include "../amf/nv12_convert.h"
+#include "../amf/video_frame.h"
 
 struct Nv12Frame {
     uint32_t width = 0;
     uint32_t stride = 0;
     uint32_t height = 0;
-    std::vector<uint8_t> data;
+    // Packed NV12 from amf::FramePool, UV follows Y
+    amf::FrameBufferPtr buffer;
+
+    // The view keeps a reference on the buffer until its release callback runs
+    amf::VideoFrameView view() const {
+        const uint8_t* y = buffer->data();
+        const uint8_t* uv = y + static_cast<size_t>(stride) * height;
+        auto frame = amf::VideoFrameView::nv12(y, stride, uv, stride, width, height);
+        frame.opaque = amf::FrameBufferPtr(buffer).detach();
+        frame.release = [](void* opaque) { static_cast<amf::FrameBuffer*>(opaque)->release(); };
+        return frame;
+    }
 };
 
 class SimpleCapture
@@ -39,9 +53,18 @@ public:
         m_pixelFormatUpdate.exchange(newFormat);
     }
 
+    // Applied on the next frame, the nv12 output has to match what the encoder signals
+    void SetColorSpace(const amf::ColorSpace& colorSpace)
+    {
+        CheckClosed();
+        m_colorSpaceUpdate.exchange(std::optional(colorSpace));
+    }
+
     void Close();
 
     bool  GetFrame(Nv12Frame* frame);
+    // Maps the latest frame in place, it stays mapped until `frame->release` is called
+    bool  MapFrame(amf::VideoFrameView* frame);
 
 private:
     void OnFrameArrived(
@@ -72,6 +95,8 @@ private:
     winrt::Windows::Graphics::DirectX::DirectXPixelFormat m_pixelFormat;
 
     std::atomic<std::optional<winrt::Windows::Graphics::DirectX::DirectXPixelFormat>> m_pixelFormatUpdate = std::nullopt;
+    amf::ColorSpace m_colorSpace;
+    std::atomic<std::optional<amf::ColorSpace>> m_colorSpaceUpdate = std::nullopt;
 
     std::atomic<bool> m_closed = false;
     std::atomic<bool> m_captureNextImage = false;
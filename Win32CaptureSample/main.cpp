@@ -3,6 +3,8 @@
 #include "SampleWindow.h"
 
 #include "../amf/amf_encoder.h"
+#include "../amf/d3d11_backend.h"
+#include "../amf/frame_diff.h"
 
 #define LOG_DEBUG(...) amf::log(0, __FILE__, __LINE__, __VA_ARGS__)
 #define LOG_INFO(...) amf::log(1, __FILE__, __LINE__, __VA_ARGS__)
@@ -75,40 +77,75 @@ int __stdcall WinMain(HINSTANCE, HINSTANCE, PSTR, int)
 
     Config config;
     std::unique_ptr<AmfEncoder> amf_encoder;
+    amf::DirtyRegionDetector dirty_detector;
     // Message pump
     MSG msg = {};
     auto t1 = cur_time();
     auto key_frame_time = cur_time();
     auto bitrate_update_time = cur_time();
+    auto encode_time = cur_time();
     while (GetMessageW(&msg, nullptr, 0, 0))
     {
         TranslateMessage(&msg);
         DispatchMessageW(&msg);
-        const uint32_t frame_rate = 15;
+        // Captured at the cap, encoded at the rate the encoder follows the motion with
+        const uint32_t frame_rate = 30;
         const uint32_t bitrate_kbps = 1000;
         if (cur_time() - t1 < (1000 * 1000 / frame_rate)) {
             continue;
         }
         t1 = cur_time();
-        Nv12Frame frame;
+        // Encoded straight from the mapped capture texture, EncodeFrame unmaps it
+        amf::VideoFrameView frame;
         auto capturer = window.GetCapturer();
-        if (!capturer || !capturer->GetFrame(&frame)) {
+        if (!capturer) {
             continue;
         }
-        if (!amf_encoder || config.width != frame.width || config.height != frame.height) {
-            amf_encoder = std::make_unique<AmfEncoder>();
+        capturer->SetColorSpace(config.color_space);
+        if (!capturer->MapFrame(&frame)) {
+            continue;
+        }
+        // With the fixed canvas the encoder follows the size by itself, debounced
+        if (amf_encoder && !config.fixed_canvas &&
+            (config.width != frame.width || config.height != frame.height)) {
+            // Same device and context, the encoder is only re-created when it has to be
+            if (amf_encoder->Resize(frame.width, frame.height)) {
+                config.width = frame.width;
+                config.height = frame.height;
+            }
+            else {
+                amf_encoder = nullptr;
+            }
+        }
+        if (!amf_encoder) {
+            amf_encoder = std::make_unique<AmfEncoder>(std::make_unique<amf::D3D11Backend>());
+            amf_encoder->RegisterEncodedImageCallback(
+                [](const uint8_t* data, size_t size, const amf::EncodedFrameInfo& info) {
+                    if (!info.timed()) {
+                        return;
+                    }
+                    LOG_DEBUG("Frame %llu encoded in %.1f ms, %zu B",
+                              static_cast<unsigned long long>(info.frame_id),
+                              (info.output_time - info.capture_time) / 1000.0, size);
+                });
             config.bitrate_kbps = bitrate_kbps;
             config.width = frame.width;
             config.height = frame.height;
             config.qp_min = 20;
             config.qp_max = 40;
             config.framerate = frame_rate;
+            config.adaptive_framerate = true;
+            config.fixed_canvas = true;
+            config.frame_trace_path = amf::module_directory() + "amf-frames.trace";
             if (!amf_encoder->Initialize(config)) {
+                frame.release(frame.opaque);
                 amf_encoder = nullptr;
                 config.width = 0;
                 LOG_ERROR("Failed to initialize amf-encoder");
                 continue;
             }
+            // The capturer converts into what the stream signals from the next frame on
+            config.color_space = amf_encoder->OutputColorSpace();
         }
         assert(amf_encoder);
         bool key_frame = false;
@@ -125,7 +162,21 @@ int __stdcall WinMain(HINSTANCE, HINSTANCE, PSTR, int)
             const uint32_t new_bitrate = bitrate_kbps * 1000 - (round++ % 3) * 100 * 1000;
             amf_encoder->RequestEncodingParametersChange(new_bitrate, frame_rate);
         }
-        amf_encoder->EncodeFrame(frame.data, frame.width, frame.height, key_frame);
+        // Static screen content: skip unchanged frames, refresh at least once a second
+        const bool changed =
+            dirty_detector.update(frame.data[0], frame.pitch[0], frame.width, frame.height);
+        const uint32_t tiles = dirty_detector.tilesX() * dirty_detector.tilesY();
+        const uint32_t encode_fps = amf_encoder->UpdateFrameChange(
+            tiles ? dirty_detector.dirtyTileCount() / static_cast<float>(tiles) : 1.f);
+        const int64_t encode_interval = 1000 * 1000 / std::max(encode_fps, 1u);
+        const bool due = cur_time() - encode_time >= encode_interval;
+        if (!key_frame && (!due || (!changed && cur_time() - encode_time < 1000 * 1000))) {
+            frame.release(frame.opaque);
+            continue;
+        }
+        // Late frames leave credit for the next one, 20fps out of a 30fps capture is 2 of 3
+        encode_time = std::max(encode_time + encode_interval, cur_time() - encode_interval / 2);
+        amf_encoder->EncodeFrame(frame, key_frame);
     }
     return util::ShutdownDispatcherQueueControllerAndWait(controller, static_cast<int>(msg.wParam));
 }
\ No newline at end of file
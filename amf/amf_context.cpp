@@ -0,0 +1,159 @@
+#include <cinttypes>
+#include <cstdio>
+
+#include "amf_helper.h"
+
+namespace amf {
+
+std::string codecstr(amf_codec_type type) {
+    switch (type) {
+    case amf_codec_type::AV1:
+        return "AV1";
+    case amf_codec_type::AVC:
+        return "H264";
+    case amf_codec_type::HEVC:
+        return "H265";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+std::string rcstr(AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_ENUM rc) {
+    switch (rc) {
+    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_CONSTANT_QP:
+        return "CQP";
+    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_CBR:
+        return "CBR";
+    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_HIGH_QUALITY_CBR:
+        return "HighQualityCBR";
+    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_PEAK_CONSTRAINED_VBR:
+        return "PeakConstrainedVBR";
+    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_LATENCY_CONSTRAINED_VBR:
+        return "LatencyConstrainedVBR";
+    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_QUALITY_VBR:
+        return "QualityVBR";
+    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_HIGH_QUALITY_VBR:
+        return "HighQualityVBR";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+std::string rcstr_hevc(AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_ENUM rc) {
+    switch (rc) {
+    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_CONSTANT_QP:
+        return "CQP";
+    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_CBR:
+        return "CBR";
+    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_HIGH_QUALITY_CBR:
+        return "HighQualityCBR";
+    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_PEAK_CONSTRAINED_VBR:
+        return "PeakConstrainedVBR";
+    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_LATENCY_CONSTRAINED_VBR:
+        return "LatencyConstrainedVBR";
+    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_QUALITY_VBR:
+        return "QualityVBR";
+    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_HIGH_QUALITY_VBR:
+        return "HighQualityVBR";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+std::string rcstr_av1(AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_ENUM rc) {
+    switch (rc) {
+    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_CONSTANT_QP:
+        return "CQP";
+    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_CBR:
+        return "CBR";
+    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_HIGH_QUALITY_CBR:
+        return "HighQualityCBR";
+    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_PEAK_CONSTRAINED_VBR:
+        return "PeakConstrainedVBR";
+    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_LATENCY_CONSTRAINED_VBR:
+        return "LatencyConstrainedVBR";
+    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_QUALITY_VBR:
+        return "QualityVBR";
+    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_HIGH_QUALITY_VBR:
+        return "HighQualityVBR";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+std::string formatstr(amf::AMF_SURFACE_FORMAT format) {
+    switch (format) {
+    case AMF_SURFACE_FORMAT::AMF_SURFACE_RGBA:
+        return "RGBA";
+    case AMF_SURFACE_FORMAT::AMF_SURFACE_ARGB:
+        return "ARGB";
+    case AMF_SURFACE_FORMAT::AMF_SURFACE_BGRA:
+        return "BGRA";
+    case AMF_SURFACE_FORMAT::AMF_SURFACE_NV12:
+        return "NV12";
+    case AMF_SURFACE_FORMAT::AMF_SURFACE_P010:
+        return "P010";
+    case AMF_SURFACE_FORMAT::AMF_SURFACE_YUV420P:
+        return "YUV420P";
+    case AMF_SURFACE_FORMAT::AMF_SURFACE_UNKNOWN:
+        return "UNKNOWN";
+    default:
+        return std::to_string((uint16_t)format);
+    }
+}
+
+void AmfContext::reset() {
+    width = 0;
+    height = 0;
+    frame_rate = 0;
+    throughput = 0;
+    max_throughput = 0;
+    requested_throughput = 0;
+    codec = amf_codec_type::AVC;
+    format = AMF_SURFACE_FORMAT::AMF_SURFACE_UNKNOWN;
+    rc = AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_ENUM::AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_CBR;
+    target_bitrate = 0;
+    smoothed_bitrate = 0;
+    last_bitrate_smoothed_time = 0;
+    encoded_count = 0;
+}
+
+const char* AmfContext::scenarioStr(Scenario scenario) {
+    switch (scenario) {
+    case Scenario::SCREEN_SHARED_DOCUMENT:
+        return "Doc";
+    case Scenario::SCREEN_SHARED_MIXED:
+        return "Mixed";
+    default:
+        return "Normal";
+    }
+}
+
+std::string AmfContext::to_str() {
+    char buffer[1024] = {0};
+    std::string rc_str;
+    switch (codec) {
+    case amf_codec_type::AVC:
+        rc_str = rcstr(static_cast<AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_ENUM>(rc));
+        break;
+    case amf_codec_type::HEVC:
+        rc_str = rcstr_hevc(static_cast<AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_ENUM>(rc));
+        break;
+    case amf_codec_type::AV1:
+        rc_str = rcstr_av1(static_cast<AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_ENUM>(rc));
+        break;
+    default:
+        rc_str = "UNKNOWN";
+        break;
+    }
+    std::string scenario_str = scenarioStr(scenario);
+    snprintf(buffer, sizeof(buffer) - 1,
+             "%u X %u, %" AMFPRId64 "FPS,%" AMFPRId64 " %" AMFPRId64 " %" AMFPRId64
+             ", %s, %s, %s, %s, qp:%u,%u",
+             width, height, frame_rate, throughput, max_throughput, requested_throughput,
+             codecstr(codec).c_str(), rc_str.c_str(), formatstr(format).c_str(),
+             scenario_str.c_str(), min_qp, max_qp);
+    return buffer;
+}
+
+} // namespace amf
@@ -2,9 +2,9 @@
 
 #include "amf_encoder.h"
 
-#include <Windows.h>
-
 #include <cinttypes>
+#include <cmath>
+#include <thread>
 
 #include "components/ComponentCaps.h"
 #include "components/VideoEncoderAV1.h"
@@ -17,16 +17,10 @@ using namespace std::chrono_literals;
 #define LOG_WARN(...) amf::log(2, __FILE__, __LINE__, __VA_ARGS__)
 #define LOG_ERROR(...) amf::log(3, __FILE__, __LINE__, __VA_ARGS__)
 
+#ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable : 4244)
-
-static HMODULE get_lib(const char* lib) {
-    HMODULE mod = GetModuleHandleA(lib);
-    if (mod) {
-        return mod;
-    }
-    return LoadLibraryA(lib);
-}
+#endif
 
 static int64_t cur_time() {
     return std::chrono::duration_cast<std::chrono::microseconds>(
@@ -34,39 +28,37 @@ static int64_t cur_time() {
         .count();
 }
 
-static Microsoft::WRL::ComPtr<IDXGIAdapter>
-findAdapter(Microsoft::WRL::ComPtr<IDXGIFactory2> factory, uint64_t target_luid) {
-    DXGI_ADAPTER_DESC desc;
-    Microsoft::WRL::ComPtr<IDXGIAdapter1> target_adapter;
-    for (uint32_t i = 0;; i++) {
-        Microsoft::WRL::ComPtr<IDXGIAdapter1> adapter;
-        auto hr = factory->EnumAdapters1(i, &adapter);
-        if (hr == DXGI_ERROR_NOT_FOUND) {
-            break;
-        }
-        hr = adapter->GetDesc(&desc);
-        uint64_t luid =
-            (static_cast<uint64_t>(desc.AdapterLuid.HighPart) << 32) + desc.AdapterLuid.LowPart;
-        LOG_INFO("Enum Adapter[%u,%" PRIu64 "]: %S", i, luid, desc.Description);
-        if (target_luid == 0 || (luid > 0 && luid == target_luid)) {
-            if (desc.VendorId == AMD_VENDOR_ID) {
-                LOG_INFO("Find AMD adapter on %u", i);
-                if (target_adapter == nullptr) {
-                    target_adapter = adapter;
-                    LOG_INFO("Choose adapter %" PRIu64 "", luid);
-                }
-            }
-        }
-    }
-    return target_adapter;
-}
+AmfEncoder::AmfEncoder(std::unique_ptr<amf::EncoderBackend> backend)
+    : backend_(std::move(backend)) {}
 
 AmfEncoder ::~AmfEncoder() {
     uninit();
 }
 
+void AmfEncoder::RegisterEncodedImageCallback(EncodedImageCallback callback) {
+    encoded_callback_ = std::move(callback);
+}
+
+void AmfEncoder::SetClock(Clock clock) {
+    clock_ = std::move(clock);
+}
+
+int64_t AmfEncoder::now() const {
+    return clock_ ? clock_() : cur_time();
+}
+
 void AmfEncoder::uninit() {
-    if (amf_encoder_) {
+    if (pipeline_) {
+        // Drains the encoder, the remaining packets still reach the callback
+        pipeline_->stop();
+        auto stats = pipeline_->stats();
+        LOG_INFO("Encode pipeline stopped, submitted:%llu encoded:%llu dropped:%llu",
+                 static_cast<unsigned long long>(stats.submitted),
+                 static_cast<unsigned long long>(stats.encoded),
+                 static_cast<unsigned long long>(stats.dropped));
+        pipeline_ = nullptr;
+    }
+    else if (amf_encoder_) {
         size_t try_times = 0;
         while (try_times++ < 1000) {
             auto res = amf_encoder_->Drain();
@@ -76,102 +68,32 @@ void AmfEncoder::uninit() {
             std::this_thread::sleep_for(1ms);
             LOG_INFO("Drain input queue");
         }
+    }
+    if (amf_encoder_) {
         amf_encoder_->Terminate();
         amf_encoder_ = nullptr;
     }
-    if (amf_context_) {
-        amf_context_->Terminate();
-        amf_context_ = nullptr;
+    sync_in_flight_.clear();
+    if (backend_) {
+        backend_->uninit();
     }
-    active_textures_.clear();
-    available_textures_.clear();
-
-    temp_texture_ = nullptr;
-    ZeroMemory(&temp_texture_desc_, sizeof(temp_texture_desc_));
-
-    nv12_convertor_ = nullptr;
-    d3d11_dev_ = nullptr;
-    d3d11_ctx_ = nullptr;
     help_ctx_.reset();
-    luid_ = 0;
-    input_format_ = InputFormat::UNKNOWN;
     LOG_INFO("%s", __FUNCTION__);
 }
 
-bool AmfEncoder::initD3d11(uint64_t lluid) {
-    typedef HRESULT(WINAPI * CREATEDXGIFACTORY1PROC)(REFIID, void**);
-    HMODULE dxgi = get_lib("DXGI.dll");
-    HMODULE d3d11 = get_lib("D3D11.dll");
-    if (!dxgi || !d3d11) {
-        LOG_ERROR("Failed to load d3d11|dxgi related library");
-        return false;
-    }
-    CREATEDXGIFACTORY1PROC create_dxgi =
-        (CREATEDXGIFACTORY1PROC)GetProcAddress(dxgi, "CreateDXGIFactory1");
-    PFN_D3D11_CREATE_DEVICE create_device =
-        (PFN_D3D11_CREATE_DEVICE)GetProcAddress(d3d11, "D3D11CreateDevice");
-    if (!create_dxgi || !create_device) {
-        LOG_ERROR("Failed to load CreateDXGIFactory1|D3D11CreateDevice");
-        return false;
-    }
-    Microsoft::WRL::ComPtr<IDXGIFactory2> factory;
-    auto hr = create_dxgi(__uuidof(IDXGIFactory2), (void**)&factory);
-    if (FAILED(hr)) {
-        LOG_ERROR("Failed to create dxgi factory, hr:%u", hr);
-        return false;
-    }
-    auto adapter = findAdapter(factory, lluid);
-    if (!adapter) {
-        LOG_ERROR("Failed to find AMD video card on adapter %" PRIu64 "", lluid);
-        return false;
-    }
-    UINT flag = 0;
-#ifdef _DEBUG
-    flag |= D3D11_CREATE_DEVICE_DEBUG;
-#endif
-    hr = create_device(adapter.Get(), D3D_DRIVER_TYPE_UNKNOWN, nullptr, flag, nullptr, 0,
-                       D3D11_SDK_VERSION, &d3d11_dev_, nullptr, &d3d11_ctx_);
-    if (FAILED(hr)) {
-        LOG_ERROR("Failed to call D3D11CreateDevicem, hr:%u", hr);
-        return false;
-    }
-    Microsoft::WRL::ComPtr<ID3D10Multithread> multi_thread = NULL;
-    d3d11_dev_->QueryInterface(__uuidof(ID3D10Multithread), (void**)&multi_thread);
-    if (multi_thread) {
-        multi_thread->SetMultithreadProtected(true);
-        multi_thread = nullptr;
-    }
-
-    DXGI_ADAPTER_DESC desc;
-    hr = adapter->GetDesc(&desc);
-    luid_ = (static_cast<uint64_t>(desc.AdapterLuid.HighPart) << 32) + desc.AdapterLuid.LowPart;
-    LOG_INFO("D3d11 initialized on adapter %" PRIu64 "", luid_);
-    ZeroMemory(&temp_texture_desc_, sizeof(temp_texture_desc_));
-    return true;
-}
-
 bool AmfEncoder::initCodec(const Config& config) {
-    auto res = amf::AmfModuleWrapper::instance()->factory->CreateContext(&amf_context_);
-    if (res != AMF_OK || !amf_context_) {
-        LOG_ERROR("Failed to call CreateContext, res:%d", res);
-        return false;
-    }
-    assert(d3d11_dev_);
-    res = amf_context_->InitDX11(d3d11_dev_.Get(), amf::AMF_DX11_1);
-    if (res != AMF_OK) {
-        LOG_ERROR("Failed to call InitDX11, res:%d", res);
-        return false;
-    }
     const wchar_t* codec = AMFVideoEncoderVCE_AVC;
-    LOG_INFO("Try to create amf encoder with %S", codec);
-    res = amf::AmfModuleWrapper::instance()->factory->CreateComponent(amf_context_, codec,
-                                                                      &amf_encoder_);
+    LOG_INFO("Try to create amf encoder with %S on %s", codec, backend_->name());
+    auto res = backend_->createEncoder(codec, &amf_encoder_);
     if (res != AMF_OK) {
         LOG_ERROR("Failed to call CreateComponent, codec:%S, res:%d", codec, res);
         return false;
     }
 
+    // Until the classifier has seen some frames
     help_ctx_.scenario = amf::AmfContext::Scenario::SCREEN_SHARED_DOCUMENT;
+    content_classifier_.reset();
+    frames_to_classify_ = 0;
     if (std::wstring(codec) == std::wstring(AMFVideoEncoderVCE_AVC)) {
         if (!applyH264Parameters(config)) {
             LOG_ERROR("Failed to apply avc paraeters");
@@ -198,36 +120,70 @@ bool AmfEncoder::initCodec(const Config& config) {
             return false;
         }
         set_hevc_property(amf_encoder_, FRAMERATE, AMFConstructRate(help_ctx_.frame_rate, 1));
-        if (help_ctx_.scenario == amf::AmfContext::Scenario::SCREEN_SHARED_DOCUMENT) {
-            const uint32_t min_qp_i = config.qp_min;
-            const uint32_t max_qp_i = (config.qp_min + config.qp_max) / 2;
-            set_hevc_property(amf_encoder_, MIN_QP_I, min_qp_i);
-            set_hevc_property(amf_encoder_, MAX_QP_I, max_qp_i);
-            LOG_INFO("Limit hevc QP_I to [%u,%u] for screen share document scenario", min_qp_i,
-                     max_qp_i);
-        }
+        applyHevcQPI();
     }
     else {
         LOG_ERROR("Can not support %S", codec);
         return false;
     }
+    startPipeline();
+    if (config.adaptive_framerate) {
+        amf::FramerateGovernor::Options options;
+        options.max_fps = config.framerate;
+        framerate_governor_ = amf::FramerateGovernor(options);
+    }
     config_ = config;
     LOG_INFO("AMF encoder initialized, settings: %s", help_ctx_.to_str().c_str());
     return true;
 }
 
+void AmfEncoder::startPipeline() {
+    if (encoded_callback_) {
+        pipeline_ = std::make_unique<amf::EncodePipeline>(
+            amf_encoder_, [this](amf::AMFDataPtr& pkt, const amf::EncodedFrameInfo& info) {
+                onImageEncoded(pkt, info);
+            });
+        LOG_INFO("Encoder output is delivered on its own thread");
+    }
+}
+
 // VideoEncodeAccelerator implementation.
 bool AmfEncoder::Initialize(const Config& config) {
     LOG_INFO("%s", __FUNCTION__);
-    if (!amf::AmfModuleWrapper::instance()) {
-        LOG_ERROR("Failed to get amf module");
+    if (!backend_ || !backend_->init(backend_->luid())) {
+        LOG_ERROR("Failed to initialize the encoder backend");
         return false;
     }
-    if (!initD3d11(luid_)) {
-        LOG_ERROR("Failed to initialize d3d11");
-        return false;
+    if (!config.frame_trace_path.empty() && !frame_trace_) {
+        amf::FrameTraceWriter::Options options;
+        options.path = config.frame_trace_path;
+        frame_trace_ = std::make_unique<amf::FrameTraceWriter>(options);
+        if (!frame_trace_->open()) {
+            frame_trace_ = nullptr;
+        }
+    }
+    Config codec_config = config;
+    // AMF has no property for chroma_loc_info, decoders take the H.264|HEVC default: left
+    if (codec_config.color_space.siting != amf::ChromaSiting::LEFT) {
+        LOG_WARN("Chroma siting can't be signalled, encoding co-sited (left) chroma");
+        codec_config.color_space.siting = amf::ChromaSiting::LEFT;
+    }
+    if (config.fixed_canvas) {
+        amf::FrameCanvas::Options options;
+        options.debounce_ms = config.canvas_debounce_ms;
+        options.full_range = codec_config.color_space.range == amf::ColorRange::FULL;
+        options.siting = codec_config.color_space.siting;
+        amf::AmfCodecCapbility capbility;
+        auto module = amf::AmfModuleWrapper::instance();
+        if (module && module->encoderCapbility(amf::amf_codec_type::AVC, &capbility) &&
+            capbility.vertical_align > 0) {
+            options.vertical_align = capbility.vertical_align;
+        }
+        canvas_ = std::make_unique<amf::FrameCanvas>(options);
+        canvas_->alignSize(&codec_config.width, &codec_config.height);
+        canvas_->reset(codec_config.width, codec_config.height);
     }
-    if (!initCodec(config)) {
+    if (!initCodec(codec_config)) {
         LOG_ERROR("Failed to initialize Codec");
         return false;
     }
@@ -236,8 +192,8 @@ bool AmfEncoder::Initialize(const Config& config) {
 
 bool AmfEncoder::resetDevice(uint64_t luid) {
     uninit();
-    if (!initD3d11(luid)) {
-        LOG_ERROR("Failed to initialize d3d11");
+    if (!backend_->init(luid)) {
+        LOG_ERROR("Failed to initialize the encoder backend");
         return false;
     }
     if (!initCodec(config_)) {
@@ -248,6 +204,88 @@ bool AmfEncoder::resetDevice(uint64_t luid) {
     return true;
 }
 
+bool AmfEncoder::Resize(uint32_t width, uint32_t height) {
+    if (!amf_encoder_) {
+        return false;
+    }
+    if (width == config_.width && height == config_.height) {
+        return true;
+    }
+    const int64_t ts_start = cur_time();
+    Config config = config_;
+    config.width = width;
+    config.height = height;
+    drainOutput();
+    auto res = amf_encoder_->ReInit(width, height);
+    if (res != AMF_OK) {
+        LOG_WARN("ReInit to %ux%u failed, res:%d, re-create the encoder", width, height, res);
+        uninit();
+        if (!backend_->init(backend_->luid()) || !initCodec(config)) {
+            LOG_ERROR("Failed to re-create the encoder for %ux%u", width, height);
+            return false;
+        }
+        LOG_INFO("Encoder re-created for %ux%u in %.1f ms", width, height,
+                 (cur_time() - ts_start) / 1000.0);
+        return true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(ctx_mtx_);
+        help_ctx_.width = width;
+        help_ctx_.height = height;
+        content_classifier_.reset();
+        frames_to_classify_ = 0;
+        config_ = config;
+    }
+    startPipeline();
+    LOG_INFO("Encoder resized to %ux%u in %.1f ms", width, height,
+             (cur_time() - ts_start) / 1000.0);
+    return true;
+}
+
+void AmfEncoder::drainOutput() {
+    if (pipeline_) {
+        pipeline_->stop();
+        pipeline_ = nullptr;
+        return;
+    }
+    size_t try_times = 0;
+    while (try_times++ < 1000 && amf_encoder_->Drain() == AMF_INPUT_FULL) {
+        std::this_thread::sleep_for(1ms);
+    }
+    // QUERY_TIMEOUT bounds every call, the loop ends on AMF_EOF
+    for (try_times = 0; try_times < 1000; try_times++) {
+        amf::AMFDataPtr pkt;
+        auto res = amf_encoder_->QueryOutput(&pkt);
+        if (pkt) {
+            amf::EncodedFrameInfo info = takeSyncInfo();
+            info.output_time = cur_time();
+            onImageEncoded(pkt, info);
+            continue;
+        }
+        if (res != AMF_REPEAT && res != AMF_OK) {
+            break;
+        }
+    }
+    sync_in_flight_.clear();
+}
+
+amf::EncodedFrameInfo AmfEncoder::takeSyncInfo() {
+    // Without B frames packets come out in submission order
+    amf::EncodedFrameInfo info;
+    if (!sync_in_flight_.empty()) {
+        info = sync_in_flight_.front();
+        sync_in_flight_.pop_front();
+    }
+    return info;
+}
+
+// Frames between two IDRs at `fps`: one second, the 1 fps refresh of a still screen is not all
+// key frames though
+static int64_t idrPeriod(int64_t fps) {
+    constexpr int64_t kMinIdrPeriod = 5;
+    return std::max(fps, kMinIdrPeriod);
+}
+
 bool AmfEncoder::applyH264Parameters(const Config& config) {
     assert(amf_encoder_);
     uint32_t width = config.width;
@@ -262,13 +300,16 @@ bool AmfEncoder::applyH264Parameters(const Config& config) {
     set_avc_property(amf_encoder_, MIN_QP, config.qp_min);
     set_avc_property(amf_encoder_, MAX_QP, config.qp_max);
     set_avc_property(amf_encoder_, ENFORCE_HRD, true);
-    set_avc_property(amf_encoder_, IDR_PERIOD, config.framerate);
+    set_avc_property(amf_encoder_, IDR_PERIOD, idrPeriod(config.framerate));
     set_avc_property(amf_encoder_, QUERY_TIMEOUT, 200);
-    set_avc_property(amf_encoder_, OUTPUT_COLOR_PROFILE, AMF_VIDEO_CONVERTER_COLOR_PROFILE_709);
+    // The desktop is sRGB whatever the matrix, primaries and transfer stay BT.709
+    set_avc_property(amf_encoder_, OUTPUT_COLOR_PROFILE,
+                     amf::get_amf_color_profile(config.color_space));
     set_avc_property(amf_encoder_, OUTPUT_TRANSFER_CHARACTERISTIC,
                      AMF_COLOR_TRANSFER_CHARACTERISTIC_BT709);
     set_avc_property(amf_encoder_, OUTPUT_COLOR_PRIMARIES, AMF_COLOR_PRIMARIES_BT709);
-    set_avc_property(amf_encoder_, FULL_RANGE_COLOR, false);
+    set_avc_property(amf_encoder_, FULL_RANGE_COLOR,
+                     config.color_space.range == amf::ColorRange::FULL);
     set_avc_property(amf_encoder_, CABAC_ENABLE, AMF_VIDEO_ENCODER_UNDEFINED);
     if (rc != AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_CONSTANT_QP) {
         set_avc_property(amf_encoder_, ENABLE_VBAQ, true);
@@ -287,6 +328,7 @@ bool AmfEncoder::applyH264Parameters(const Config& config) {
     help_ctx_.codec = amf::amf_codec_type::AVC;
     help_ctx_.current_bitrate = bitrate;
     help_ctx_.target_bitrate = bitrate;
+    help_ctx_.smoothed_bitrate = bitrate;
     help_ctx_.min_qp = config.qp_min;
     help_ctx_.max_qp = config.qp_max;
     return true;
@@ -308,11 +350,15 @@ bool AmfEncoder::applyH265Parameters(const Config& config) {
     set_hevc_property(amf_encoder_, PROFILE, AMF_VIDEO_ENCODER_HEVC_PROFILE_MAIN);
 
     set_hevc_property(amf_encoder_, COLOR_BIT_DEPTH, AMF_COLOR_BIT_DEPTH_8);
-    set_hevc_property(amf_encoder_, OUTPUT_COLOR_PROFILE, AMF_VIDEO_CONVERTER_COLOR_PROFILE_709);
+    set_hevc_property(amf_encoder_, OUTPUT_COLOR_PROFILE,
+                      amf::get_amf_color_profile(config.color_space));
     set_hevc_property(amf_encoder_, OUTPUT_TRANSFER_CHARACTERISTIC,
                       AMF_COLOR_TRANSFER_CHARACTERISTIC_BT709);
     set_hevc_property(amf_encoder_, OUTPUT_COLOR_PRIMARIES, AMF_COLOR_PRIMARIES_BT709);
-    set_hevc_property(amf_encoder_, NOMINAL_RANGE, false);
+    set_hevc_property(amf_encoder_, NOMINAL_RANGE,
+                      config.color_space.range == amf::ColorRange::FULL
+                          ? AMF_VIDEO_ENCODER_HEVC_NOMINAL_RANGE_FULL
+                          : AMF_VIDEO_ENCODER_HEVC_NOMINAL_RANGE_STUDIO);
     if (rc != AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_CONSTANT_QP) {
         set_hevc_property(amf_encoder_, ENABLE_VBAQ, true);
     }
@@ -332,6 +378,7 @@ bool AmfEncoder::applyH265Parameters(const Config& config) {
     help_ctx_.codec = amf::amf_codec_type::HEVC;
     help_ctx_.current_bitrate = bitrate;
     help_ctx_.target_bitrate = bitrate;
+    help_ctx_.smoothed_bitrate = bitrate;
     help_ctx_.min_qp = config.qp_min;
     help_ctx_.max_qp = config.qp_max;
     return true;
@@ -341,133 +388,69 @@ bool AmfEncoder::applyAV1Parameters(const Config& config) {
     return false;
 }
 
-void AMF_STD_CALL AmfEncoder::OnSurfaceDataRelease(amf::AMFSurface* pSurface) {
-    std::lock_guard<std::mutex> lock(texture_mtx_);
-    auto it = active_textures_.find(pSurface);
-    if (it != active_textures_.end()) {
-        available_textures_.push_back(it->second);
-        active_textures_.erase(it);
-    }
-}
-
-Microsoft::WRL::ComPtr<ID3D11Texture2D>
-AmfEncoder::getAvailableTexture(const D3D11_TEXTURE2D_DESC& desc_src) {
-    std::lock_guard<std::mutex> lock(texture_mtx_);
-    while (!available_textures_.empty()) {
-        auto item = available_textures_.back();
-        D3D11_TEXTURE2D_DESC desc;
-        item->GetDesc(&desc);
-        if (desc.Format == desc_src.Format && desc.Width == desc_src.Width &&
-            desc.Height == desc_src.Height) {
-            break;
-        }
-        available_textures_.pop_back();
-        continue;
-    }
-    if (available_textures_.empty()) {
-        D3D11_TEXTURE2D_DESC desc = desc_src;
-        desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-        desc.MiscFlags = 0;
-        desc.CPUAccessFlags = 0;
-        desc.Usage = D3D11_USAGE_DEFAULT;
-        Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
-        auto hr = d3d11_dev_->CreateTexture2D(&desc, nullptr, &texture);
-        if (hr != S_OK) {
-            LOG_ERROR("Failed to create texture, hr:%u", hr);
-            return nullptr;
-        }
-        available_textures_.push_back(texture);
-    }
-    assert(!available_textures_.empty());
-    auto output = available_textures_.back();
-    available_textures_.pop_back();
-    return output;
-}
-
-static void PrintRecording(amf::AmfEncoderDebuger* recorder) {
-    auto now = cur_time();
+static void PrintRecording(amf::AmfEncoderDebuger* recorder, int64_t now) {
     std::vector<amf::AmfEncoderDebuger::Statistics> outputs;
     if (!recorder->stat(outputs, now, 1000 * 5)) {
         return;
     }
     std::string logs = "[";
+    std::string percentiles = "[";
     for (auto& output : outputs) {
         logs += output.to_str();
+        percentiles += output.percentiles_str();
     }
     logs += "]";
+    percentiles += "]";
     LOG_INFO("%s", logs.c_str());
+    LOG_INFO("~p50|~p90|~p99|max %s", percentiles.c_str());
 }
 
-Microsoft::WRL::ComPtr<ID3D11Texture2D>
-AmfEncoder::copyFrameToTexture(const std::vector<uint8_t>& data, uint32_t width, uint32_t height) {
-    if (!temp_texture_ || temp_texture_desc_.Width != width ||
-        temp_texture_desc_.Height != height ||
-        temp_texture_desc_.CPUAccessFlags != D3D11_CPU_ACCESS_WRITE) {
-        D3D11_TEXTURE2D_DESC desc;
-        desc.Width = width;
-        desc.Height = height;
-        desc.Format = DXGI_FORMAT_NV12;
-        desc.ArraySize = 1;
-        desc.BindFlags = 0;
-        desc.MiscFlags = 0;
-        desc.SampleDesc.Count = 1;
-        desc.SampleDesc.Quality = 0;
-        desc.MipLevels = 1;
-        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-        desc.Usage = D3D11_USAGE_STAGING;
-        auto hr = d3d11_dev_->CreateTexture2D(&desc, NULL, &temp_texture_);
-        if (FAILED(hr)) {
-            return nullptr;
-        }
-        temp_texture_->GetDesc(&temp_texture_desc_);
-    }
-    if (input_format_ != InputFormat::I420) {
-        LOG_INFO("Input format is I420 Pixel");
-        input_format_ = InputFormat::I420;
-    }
-    auto gpu_texture = getAvailableTexture(temp_texture_desc_);
-    if (!gpu_texture) {
-        LOG_WARN("All textures in busy, drop frame");
-        return nullptr;
-    }
-    D3D11_MAPPED_SUBRESOURCE resource;
-    auto hr = d3d11_ctx_->Map(temp_texture_.Get(), 0, D3D11_MAP_WRITE, 0, &resource);
-    if (FAILED(hr)) {
-        LOG_ERROR("Failed to map nv12 texture, hr:%u", hr);
-        return nullptr;
-    }
-    for (uint32_t i = 0; i < height * 3 / 2; i++) {
-        memcpy((uint8_t*)resource.pData + i * resource.RowPitch, (uint8_t*)data.data() + i * width,
-               width);
+int32_t AmfEncoder::EncodeFrame(const std::vector<uint8_t>& data, uint32_t width, uint32_t height,
+                                bool force_key) {
+    if (data.size() < static_cast<size_t>(width) * height * 3 / 2) {
+        LOG_ERROR("Frame buffer too small, size:%zu, %ux%u", data.size(), width, height);
+        return -1;
     }
-    d3d11_ctx_->Unmap(temp_texture_.Get(), 0);
-    d3d11_ctx_->CopyResource(gpu_texture.Get(), temp_texture_.Get());
-    return gpu_texture;
+    return EncodeFrame(amf::VideoFrameView::nv12(data.data(), width, height), force_key);
 }
 
-int32_t AmfEncoder::EncodeFrame(const std::vector<uint8_t>& data, uint32_t width, uint32_t height,
-                                bool force_key) {
-    auto texture = copyFrameToTexture(data, width, height);
-    if (!texture) {
+int32_t AmfEncoder::EncodeFrame(const amf::VideoFrameView& frame, bool force_key) {
+    amf::ScopedFrameRelease frame_release(frame);
+    if (!frame.valid()) {
+        LOG_ERROR("Invalid frame, format:%u, %ux%u", static_cast<uint32_t>(frame.format),
+                  frame.width, frame.height);
         return -1;
     }
-    amf::AMFSurfacePtr amf_surf;
-    auto res = amf_context_->CreateSurfaceFromDX11Native(texture.Get(), &amf_surf, this);
-    if (res != AMF_OK) {
-        LOG_ERROR("CreateSurfaceFromDX11Native failed, res:%d", res);
+    amf::VideoFrameView input = frame;
+    if (canvas_ && !fitToCanvas(frame, &input)) {
         return -1;
     }
+    amf::EncodedFrameInfo info;
+    info.frame_id = frame_id_++;
+    info.capture_time = cur_time();
+    info.width = input.width;
+    info.height = input.height;
+    info.force_key = force_key;
+    {
+        std::lock_guard<std::mutex> lock(ctx_mtx_);
+        applyFrameRateAndBitrate();
+        classifyContent(input);
+    }
+    auto amf_surf = backend_->upload(input);
+    // The frame lives in the surface from here on
+    frame_release.release();
+    if (!amf_surf) {
+        return -1;
+    }
+    AMF_RESULT res = AMF_OK;
     if (force_key) {
         LOG_INFO("Request key frame");
+        std::lock_guard<std::mutex> lock(ctx_mtx_);
         if (!triggleKeyFrame(amf_surf)) {
             LOG_INFO("Requeset IDR failed, res:%u", res);
             return -1;
         }
     }
-    {
-        std::lock_guard<std::mutex> lock(texture_mtx_);
-        active_textures_[amf_surf.GetPtr()] = texture;
-    }
     if (help_ctx_.codec == amf::amf_codec_type::AVC) {
         amf_surf->SetProperty(AMF_VIDEO_ENCODER_STATISTICS_FEEDBACK, true);
         amf_surf->SetProperty(AMF_VIDEO_ENCODER_INSERT_AUD, false);
@@ -476,6 +459,15 @@ int32_t AmfEncoder::EncodeFrame(const std::vector<uint8_t>& data, uint32_t width
         amf_surf->SetProperty(AMF_VIDEO_ENCODER_HEVC_STATISTICS_FEEDBACK, true);
         amf_surf->SetProperty(AMF_VIDEO_ENCODER_HEVC_INSERT_AUD, false);
     }
+    if (pipeline_) {
+        if (!pipeline_->submit(amf_surf, info)) {
+            return -1;
+        }
+        std::lock_guard<std::mutex> lock(ctx_mtx_);
+        input_output_recorder_.addInput(help_ctx_.frame_rate, now());
+        PrintRecording(&input_output_recorder_, now());
+        return 0;
+    }
     auto ts_start = cur_time();
     while (true) {
         res = amf_encoder_->SubmitInput(amf_surf);
@@ -494,7 +486,13 @@ int32_t AmfEncoder::EncodeFrame(const std::vector<uint8_t>& data, uint32_t width
         LOG_ERROR("Failed to call SubmitInputm, res:%d", res);
         return -1;
     }
-    input_output_recorder_.addInput(help_ctx_.frame_rate, cur_time());
+    {
+        std::lock_guard<std::mutex> lock(ctx_mtx_);
+        input_output_recorder_.addInput(help_ctx_.frame_rate, now());
+    }
+    info.submit_time = cur_time();
+    // A packet that is not out yet comes with a later call, it keeps the times of its frame
+    sync_in_flight_.push_back(info);
     encoded_pkt_ = nullptr;
     res = amf_encoder_->QueryOutput(&encoded_pkt_);
     if (res != AMF_REPEAT && res != AMF_OK) {
@@ -512,14 +510,30 @@ int32_t AmfEncoder::EncodeFrame(const std::vector<uint8_t>& data, uint32_t width
             return -1;
         }
     }
-    if (encoded_pkt_ && !onImageEncoded(encoded_pkt_)) {
-        return -1;
+    if (encoded_pkt_) {
+        info = takeSyncInfo();
+        info.output_time = cur_time();
+        if (!onImageEncoded(encoded_pkt_, info)) {
+            return -1;
+        }
     }
     // Print Statistics
-    PrintRecording(&input_output_recorder_);
+    std::lock_guard<std::mutex> lock(ctx_mtx_);
+    PrintRecording(&input_output_recorder_, now());
     return 0;
 }
 
+bool AmfEncoder::fitToCanvas(const amf::VideoFrameView& frame, amf::VideoFrameView* input) {
+    if (canvas_->update(frame.width, frame.height, now())) {
+        LOG_INFO("Content kept %ux%u for %u ms, canvas follows", frame.width, frame.height,
+                 config_.canvas_debounce_ms);
+        if (!Resize(canvas_->width(), canvas_->height())) {
+            return false;
+        }
+    }
+    return canvas_->draw(frame, input);
+}
+
 bool AmfEncoder::triggleKeyFrame(amf::AMFSurfacePtr& amf_surf) {
     AMF_RESULT res = AMF_FAIL;
     if (help_ctx_.codec == amf::amf_codec_type::AVC) {
@@ -561,10 +575,96 @@ bool isKeyFrame(amf::amf_codec_type codec, uint64_t type) {
     return false;
 }
 
-bool AmfEncoder::onImageEncoded(amf::AMFDataPtr& pkt) {
+// STATISTIC_* properties of the packets that go into the frame trace, beyond the average QP
+struct StatisticNames {
+    const wchar_t* min_qp;
+    const wchar_t* max_qp;
+    const wchar_t* pix_num_intra;
+    const wchar_t* pix_num_inter;
+    const wchar_t* pix_num_skip;
+    const wchar_t* bitcount_residual;
+    const wchar_t* bitcount_motion;
+    const wchar_t* bitcount_inter;
+    const wchar_t* bitcount_intra;
+};
+
+static const StatisticNames kAvcStatistics = {
+    AMF_VIDEO_ENCODER_STATISTIC_MIN_QP,
+    AMF_VIDEO_ENCODER_STATISTIC_MAX_QP,
+    AMF_VIDEO_ENCODER_STATISTIC_PIX_NUM_INTRA,
+    AMF_VIDEO_ENCODER_STATISTIC_PIX_NUM_INTER,
+    AMF_VIDEO_ENCODER_STATISTIC_PIX_NUM_SKIP,
+    AMF_VIDEO_ENCODER_STATISTIC_BITCOUNT_RESIDUAL,
+    AMF_VIDEO_ENCODER_STATISTIC_BITCOUNT_MOTION,
+    AMF_VIDEO_ENCODER_STATISTIC_BITCOUNT_INTER,
+    AMF_VIDEO_ENCODER_STATISTIC_BITCOUNT_INTRA,
+};
+
+static const StatisticNames kHevcStatistics = {
+    AMF_VIDEO_ENCODER_HEVC_STATISTIC_MIN_QP,
+    AMF_VIDEO_ENCODER_HEVC_STATISTIC_MAX_QP,
+    AMF_VIDEO_ENCODER_HEVC_STATISTIC_PIX_NUM_INTRA,
+    AMF_VIDEO_ENCODER_HEVC_STATISTIC_PIX_NUM_INTER,
+    AMF_VIDEO_ENCODER_HEVC_STATISTIC_PIX_NUM_SKIP,
+    AMF_VIDEO_ENCODER_HEVC_STATISTIC_BITCOUNT_RESIDUAL,
+    AMF_VIDEO_ENCODER_HEVC_STATISTIC_BITCOUNT_MOTION,
+    AMF_VIDEO_ENCODER_HEVC_STATISTIC_BITCOUNT_INTER,
+    AMF_VIDEO_ENCODER_HEVC_STATISTIC_BITCOUNT_INTRA,
+};
+
+// 0 when the encoder did not report it
+static uint32_t statistic(amf::AMFDataPtr& pkt, const wchar_t* name) {
+    amf_int64 value = 0;
+    if (pkt->GetProperty(name, &value) != AMF_OK || value < 0) {
+        return 0;
+    }
+    return static_cast<uint32_t>(std::min<amf_int64>(value, UINT32_MAX));
+}
+
+void AmfEncoder::traceFrame(amf::AMFDataPtr& pkt, const amf::EncodedFrameInfo& info,
+                            uint64_t frame_type, uint32_t qp, size_t size, int64_t output_time,
+                            uint32_t upload_us, uint32_t encode_us) {
+    amf::FrameRecord record;
+    record.output_time = output_time;
+    record.frame_id = static_cast<uint32_t>(info.frame_id);
+    if (info.timed()) {
+        record.upload_us = upload_us;
+        record.encode_us = encode_us;
+    }
+    record.size = static_cast<uint32_t>(size);
+    record.target_bitrate = help_ctx_.current_bitrate;
+    record.fps = static_cast<uint16_t>(help_ctx_.frame_rate);
+    record.width = static_cast<uint16_t>(help_ctx_.width);
+    record.height = static_cast<uint16_t>(help_ctx_.height);
+    record.codec = static_cast<uint8_t>(help_ctx_.codec);
+    record.frame_type = static_cast<uint8_t>(frame_type);
+    record.qp = static_cast<uint8_t>(qp);
+    const StatisticNames* names = nullptr;
+    if (help_ctx_.codec == amf::amf_codec_type::AVC) {
+        names = &kAvcStatistics;
+    }
+    else if (help_ctx_.codec == amf::amf_codec_type::HEVC) {
+        names = &kHevcStatistics;
+    }
+    if (names) {
+        record.qp_min = static_cast<uint8_t>(statistic(pkt, names->min_qp));
+        record.qp_max = static_cast<uint8_t>(statistic(pkt, names->max_qp));
+        record.pix_num_intra = statistic(pkt, names->pix_num_intra);
+        record.pix_num_inter = statistic(pkt, names->pix_num_inter);
+        record.pix_num_skip = statistic(pkt, names->pix_num_skip);
+        record.bitcount_residual = statistic(pkt, names->bitcount_residual);
+        record.bitcount_motion = statistic(pkt, names->bitcount_motion);
+        record.bitcount_inter = statistic(pkt, names->bitcount_inter);
+        record.bitcount_intra = statistic(pkt, names->bitcount_intra);
+    }
+    frame_trace_->append(record);
+}
+
+bool AmfEncoder::onImageEncoded(amf::AMFDataPtr& pkt, amf::EncodedFrameInfo info) {
     if (!pkt) {
         return false;
     }
+    std::unique_lock<std::mutex> lock(ctx_mtx_);
     uint64_t frame_type = 0;
     auto res = pkt->GetProperty(get_amf_output_type(help_ctx_.codec), &frame_type);
     if (res != AMF_OK) {
@@ -585,13 +685,37 @@ bool AmfEncoder::onImageEncoded(amf::AMFDataPtr& pkt) {
     if (key_frame) {
         RecoverQPRange();
     }
-    size_t length = ((amf::AMFBufferPtr)pkt)->GetSize();
+    else if (config_.adaptive_framerate) {
+        // Key frames run with their own QP limits, see LimitQPForScc
+        framerate_governor_.onEncoded(static_cast<uint32_t>(average_qp), help_ctx_.min_qp,
+                                      help_ctx_.max_qp);
+    }
+    amf::AMFBufferPtr buffer(pkt);
+    size_t length = buffer->GetSize();
     LOG_INFO("Frame %u, %s, QP: %u, size: %u B, Target:%u kbps, %u B, %u FPS",
              help_ctx_.encoded_count++, (key_frame ? "I" : "P"), average_qp, length,
              help_ctx_.current_bitrate / 1000, help_ctx_.current_bitrate / help_ctx_.frame_rate / 8,
              help_ctx_.frame_rate);
     // record qp and actual bitrate
-    input_output_recorder_.addOuput(length, average_qp, help_ctx_.current_bitrate, cur_time());
+    const int64_t output_time = now();
+    // 0 for a packet without the times of its frame
+    const bool timed = info.timed();
+    const uint32_t upload_us =
+        timed ? static_cast<uint32_t>(info.submit_time - info.capture_time) : 0;
+    const uint32_t encode_us =
+        timed ? static_cast<uint32_t>(info.output_time - info.submit_time) : 0;
+    input_output_recorder_.addOuput(length, average_qp, help_ctx_.current_bitrate, output_time,
+                                    timed, upload_us, encode_us);
+    if (frame_trace_) {
+        traceFrame(pkt, info, frame_type, static_cast<uint32_t>(average_qp), length, output_time,
+                   upload_us, encode_us);
+    }
+    lock.unlock();
+    if (encoded_callback_) {
+        info.key_frame = key_frame;
+        info.qp = static_cast<uint32_t>(average_qp);
+        encoded_callback_(static_cast<const uint8_t*>(buffer->GetNative()), length, info);
+    }
 #if 0
     {
         static std::string dll_path;
@@ -623,30 +747,111 @@ bool AmfEncoder::onImageEncoded(amf::AMFDataPtr& pkt) {
     return true;
 }
 
+// Requests only move the targets, the encoder follows them at most this often. Bursts of
+// requests from the bandwidth estimator collapse into one property set.
+static constexpr int64_t kFramerateInterval = 1000 * 1000;
+static constexpr int64_t kBitrateUpInterval = 1000 * 1000;
+// Going down is what avoids the congestion, so it reacts sooner
+static constexpr int64_t kBitrateDownInterval = 200 * 1000;
+// Largest change of one update, relative to the current bitrate
+static constexpr double kBitrateMaxUpStep = 0.15;
+static constexpr double kBitrateMaxDownStep = 0.5;
+// Targets this close to the current bitrate are not worth a property set
+static constexpr double kBitrateDeadBand = 0.08;
+// Time constant of the request average, it irons out the jitter of the bandwidth estimate
+static constexpr double kBitrateSmoothing = 2.0 * 1000 * 1000;
+// Requests this far below the average are a real drop and bypass it
+static constexpr double kBitrateDrop = 0.25;
+// The average settles on the request once this close, it would only creep towards it
+static constexpr double kBitrateSettle = 1000;
+
 bool AmfEncoder::isTimeToChangeTargetFps(int64_t at_time) {
-    return true;
+    const uint32_t target_fps = targetFramerate();
+    if (help_ctx_.frame_rate == target_fps) {
+        return false;
+    }
+    // Motion starting on screen has to show up right away
+    if (target_fps > help_ctx_.frame_rate) {
+        return true;
+    }
+    return at_time - help_ctx_.last_target_fps_changed_time >= kFramerateInterval;
 }
 
 bool AmfEncoder::isTimeToChangeTargetBitrate(int64_t at_time) {
-    return true;
+    const double current = static_cast<double>(help_ctx_.current_bitrate);
+    const double target = targetBitrate();
+    if (std::abs(target - current) <= current * kBitrateDeadBand) {
+        return false;
+    }
+    const int64_t interval = target < current ? kBitrateDownInterval : kBitrateUpInterval;
+    return at_time - help_ctx_.last_target_bitrate_changed_time >= interval;
+}
+
+void AmfEncoder::smoothTargetBitrate(int64_t at_time) {
+    const double request = static_cast<double>(help_ctx_.target_bitrate);
+    const double smoothed = static_cast<double>(help_ctx_.smoothed_bitrate);
+    if (smoothed <= 0.0 || request < smoothed * (1.0 - kBitrateDrop)) {
+        help_ctx_.smoothed_bitrate = help_ctx_.target_bitrate;
+    }
+    else {
+        const double elapsed = at_time - help_ctx_.last_bitrate_smoothed_time;
+        const double weight = 1.0 - std::exp(-elapsed / kBitrateSmoothing);
+        const double next = smoothed + (request - smoothed) * weight;
+        help_ctx_.smoothed_bitrate = std::abs(request - next) < kBitrateSettle
+                                         ? help_ctx_.target_bitrate
+                                         : static_cast<uint64_t>(std::llround(next));
+    }
+    help_ctx_.last_bitrate_smoothed_time = at_time;
+}
+
+uint32_t AmfEncoder::targetFramerate() const {
+    if (!config_.adaptive_framerate) {
+        return help_ctx_.target_fps;
+    }
+    return std::min(framerate_governor_.fps(), help_ctx_.target_fps);
+}
+
+uint32_t AmfEncoder::targetBitrate() const {
+    // The governor lowers the frame rate to give the frames more bits, the bitrate stays
+    uint32_t target_bitrate = static_cast<uint32_t>(help_ctx_.smoothed_bitrate);
+    const uint32_t kMinBitrate = 50 * 1000;
+    return std::max<uint32_t>(kMinBitrate, target_bitrate);
 }
 
 int32_t AmfEncoder::RequestEncodingParametersChange(uint32_t bitrate, uint32_t frame_rate) {
     if (!amf_encoder_) {
         return -1;
     }
+    std::lock_guard<std::mutex> lock(ctx_mtx_);
     if (help_ctx_.target_fps == frame_rate && help_ctx_.target_bitrate == bitrate) {
         return 0;
     }
     LOG_INFO("Request encoder paramesters: %ukbps %uFPS", bitrate / 1000, frame_rate);
+    // The average followed the previous request up to now
+    smoothTargetBitrate(now());
     help_ctx_.target_bitrate = bitrate;
     help_ctx_.target_fps = frame_rate;
+    // Applied here when the encoder is due for an update, by the next EncodeFrame otherwise
     applyFrameRateAndBitrate();
     return 0;
 }
 
+uint32_t AmfEncoder::UpdateFrameChange(float changed) {
+    std::lock_guard<std::mutex> lock(ctx_mtx_);
+    if (!amf_encoder_ || !config_.adaptive_framerate) {
+        return static_cast<uint32_t>(help_ctx_.frame_rate);
+    }
+    if (framerate_governor_.update(changed, now())) {
+        LOG_INFO("Content motion %.3f%s, governed fps:%u", framerate_governor_.motion(),
+                 framerate_governor_.starved() ? " at max QP" : "", framerate_governor_.fps());
+        applyFrameRateAndBitrate();
+    }
+    return static_cast<uint32_t>(help_ctx_.frame_rate);
+}
+
 void AmfEncoder::applyFrameRateAndBitrate() {
-    auto at_time = cur_time();
+    auto at_time = now();
+    smoothTargetBitrate(at_time);
     if (isTimeToChangeTargetFps(at_time)) {
         applyFramerate(at_time);
     }
@@ -656,19 +861,89 @@ void AmfEncoder::applyFrameRateAndBitrate() {
 }
 
 void AmfEncoder::LimitQPForScc() {
-    if (help_ctx_.scenario != amf::AmfContext::Scenario::SCREEN_SHARED_DOCUMENT) {
+    uint32_t max_qp = 0;
+    if (!keyFrameMaxQP(&max_qp)) {
         return;
     }
     if (help_ctx_.codec == amf::amf_codec_type::AVC) {
         const uint32_t min_qp = help_ctx_.min_qp;
-        const uint32_t max_qp = (help_ctx_.min_qp + help_ctx_.max_qp) / 2;
         set_avc_property(amf_encoder_, MIN_QP, min_qp);
         set_avc_property(amf_encoder_, MAX_QP, max_qp);
-        LOG_INFO("Limit QP to [%u, %u] for screen share document scenario", min_qp, max_qp);
+        LOG_INFO("Limit QP to [%u, %u] for %s scenario", min_qp, max_qp,
+                 amf::AmfContext::scenarioStr(help_ctx_.scenario));
         recover_qp_range_ = true;
     }
 }
 
+bool AmfEncoder::keyFrameMaxQP(uint32_t* max_qp) const {
+    switch (help_ctx_.scenario) {
+    case amf::AmfContext::Scenario::SCREEN_SHARED_DOCUMENT:
+        // Blurry text on a key frame stays on screen until the next one
+        *max_qp = (help_ctx_.min_qp + help_ctx_.max_qp) / 2;
+        return true;
+    case amf::AmfContext::Scenario::SCREEN_SHARED_MIXED:
+        *max_qp = (help_ctx_.min_qp + help_ctx_.max_qp * 3) / 4;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void AmfEncoder::applyHevcQPI() {
+    if (help_ctx_.codec != amf::amf_codec_type::HEVC) {
+        return;
+    }
+    uint32_t max_qp_i = help_ctx_.max_qp;
+    if (keyFrameMaxQP(&max_qp_i)) {
+        LOG_INFO("Limit hevc QP_I to [%u,%u] for %s scenario", help_ctx_.min_qp, max_qp_i,
+                 amf::AmfContext::scenarioStr(help_ctx_.scenario));
+    }
+    set_hevc_property(amf_encoder_, MIN_QP_I, help_ctx_.min_qp);
+    set_hevc_property(amf_encoder_, MAX_QP_I, max_qp_i);
+}
+
+void AmfEncoder::classifyContent(const amf::VideoFrameView& frame) {
+    // ~2 samples per second at 30fps, the hysteresis in the classifier adds 1.5s on top
+    constexpr uint32_t kClassifyInterval = 15;
+    if (frames_to_classify_ > 0) {
+        frames_to_classify_--;
+        return;
+    }
+    frames_to_classify_ = kClassifyInterval - 1;
+    if (!content_classifier_.update(frame.data[0], frame.pitch[0], frame.width, frame.height)) {
+        return;
+    }
+    auto& features = content_classifier_.features();
+    LOG_INFO("Content changed to %s, screen:%.2f edge:%.3f motion:%.2f natural motion:%.2f",
+             amf::ContentClassifier::contentStr(content_classifier_.content()),
+             features.screen_ratio, features.edge_density, features.temporal_change,
+             features.natural_motion);
+    switch (content_classifier_.content()) {
+    case amf::ContentClassifier::Content::TEXT:
+        applyScenario(amf::AmfContext::Scenario::SCREEN_SHARED_DOCUMENT);
+        break;
+    case amf::ContentClassifier::Content::MIXED:
+        applyScenario(amf::AmfContext::Scenario::SCREEN_SHARED_MIXED);
+        break;
+    case amf::ContentClassifier::Content::VIDEO:
+        applyScenario(amf::AmfContext::Scenario::NORMAL);
+        break;
+    default:
+        break;
+    }
+}
+
+void AmfEncoder::applyScenario(amf::AmfContext::Scenario scenario) {
+    if (help_ctx_.scenario == scenario) {
+        return;
+    }
+    // A key frame QP limit still pending is lifted with the old scenario's range
+    RecoverQPRange();
+    help_ctx_.scenario = scenario;
+    applyHevcQPI();
+    LOG_INFO("Apply scenario, settings: %s", help_ctx_.to_str().c_str());
+}
+
 void AmfEncoder::RecoverQPRange() {
     if (!recover_qp_range_) {
         return;
@@ -677,20 +952,23 @@ void AmfEncoder::RecoverQPRange() {
     if (help_ctx_.codec == amf::amf_codec_type::AVC) {
         set_avc_property(amf_encoder_, MIN_QP, help_ctx_.min_qp);
         set_avc_property(amf_encoder_, MAX_QP, help_ctx_.max_qp);
-        LOG_INFO("Recover QP to [%u, %u] for screen share document scenario", help_ctx_.min_qp,
-                 help_ctx_.max_qp);
+        LOG_INFO("Recover QP to [%u, %u] for %s scenario", help_ctx_.min_qp, help_ctx_.max_qp,
+                 amf::AmfContext::scenarioStr(help_ctx_.scenario));
     }
 }
 
 void AmfEncoder::applyFramerate(int64_t at_time) {
-    if (help_ctx_.frame_rate == help_ctx_.target_fps) {
+    const uint32_t target_fps = targetFramerate();
+    if (help_ctx_.frame_rate == target_fps) {
         return;
     }
-    LOG_INFO("Apply target fps[%u->%u]", (uint32_t)help_ctx_.frame_rate, help_ctx_.target_fps);
-    help_ctx_.frame_rate = help_ctx_.target_fps;
+    LOG_INFO("Apply target fps[%u->%u]", (uint32_t)help_ctx_.frame_rate, target_fps);
+    help_ctx_.frame_rate = target_fps;
     help_ctx_.last_target_fps_changed_time = at_time;
     if (help_ctx_.codec == amf::amf_codec_type::AVC) {
         set_avc_property(amf_encoder_, FRAMERATE, AMFConstructRate(help_ctx_.frame_rate, 1));
+        // The period is in frames, it keeps its length in time at the governed rate
+        set_avc_property(amf_encoder_, IDR_PERIOD, idrPeriod(help_ctx_.frame_rate));
     }
     else if (help_ctx_.codec == amf::amf_codec_type::HEVC) {
         set_hevc_property(amf_encoder_, FRAMERATE, AMFConstructRate(help_ctx_.frame_rate, 1));
@@ -698,15 +976,20 @@ void AmfEncoder::applyFramerate(int64_t at_time) {
     else if (help_ctx_.codec == amf::amf_codec_type::AV1) {
         set_av1_property(amf_encoder_, FRAMERATE, AMFConstructRate(help_ctx_.frame_rate, 1));
     }
-    LimitQPForScc();
-    applyBitrate(at_time);
+    // The key frame QP limit is only set around an IDR, see triggleKeyFrame. The bitrate stays
+    // the same at every frame rate, it is only changed on its own intervals.
 }
 
 void AmfEncoder::applyBitrate(int64_t at_time) {
-    float scale = std::min(help_ctx_.frame_rate * 1.0 / help_ctx_.target_fps, 1.0);
-    uint32_t target_bitrate = static_cast<uint32_t>(help_ctx_.target_bitrate * scale);
-    const uint32_t kMinBitrate = 50 * 1000;
-    target_bitrate = std::max<uint32_t>(kMinBitrate, target_bitrate);
+    const double current = static_cast<double>(help_ctx_.current_bitrate);
+    uint32_t target_bitrate = targetBitrate();
+    if (current > 0) {
+        // Ramp towards the target, the rate control of the encoder overshoots on large steps
+        const double highest = current * (1.0 + kBitrateMaxUpStep);
+        const double lowest = current * (1.0 - kBitrateMaxDownStep);
+        target_bitrate = static_cast<uint32_t>(
+            std::min<double>(std::max<double>(target_bitrate, lowest), highest));
+    }
     if (help_ctx_.current_bitrate == target_bitrate) {
         return;
     }
@@ -735,4 +1018,6 @@ void AmfEncoder::applyBitrate(int64_t at_time) {
     }
 }
 
+#ifdef _MSC_VER
 #pragma warning(pop)
+#endif
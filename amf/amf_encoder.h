@@ -5,12 +5,19 @@
 //
 #pragma once
 
-#include <d3d11.h>
-#include <wrl/client.h>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
 
 #include "amf_helper.h"
-#include "core/Factory.h"
-#include "core/Trace.h"
+#include "content_classifier.h"
+#include "encode_pipeline.h"
+#include "encoder_backend.h"
+#include "frame_canvas.h"
+#include "frame_trace_writer.h"
+#include "framerate_governor.h"
+#include "video_frame.h"
 
 struct Config {
     uint32_t width = 0;
@@ -18,51 +25,104 @@ struct Config {
     uint32_t qp_min = 20;
     uint32_t qp_max = 40;
     int framerate = 0;
+    // The frame rate follows the motion on screen up to `framerate`, see UpdateFrameChange
+    bool adaptive_framerate = false;
+    // Frames of another size are scaled into the encoder size, which only follows them once they
+    // kept their size for `canvas_debounce_ms`, see amf::FrameCanvas
+    bool fixed_canvas = false;
+    uint32_t canvas_debounce_ms = 500;
     uint32_t bitrate_kbps = 0;
+    // Every encoded frame is appended to this file when set, see amf::FrameTraceWriter
+    std::string frame_trace_path;
+    // Has to match what the NV12 convertor produces, see NV12Convertor::init
+    amf::ColorSpace color_space;
 };
 
-class AmfEncoder : public amf::AMFSurfaceObserver {
-    enum class InputFormat : uint8_t {
-        UNKNOWN = 0,
-        I420 = 1,
-        ARGB_TEXTURE = 2,
-        NV12_TEXTURE = 3,
-    };
-
+class AmfEncoder {
 public:
+    using EncodedImageCallback =
+        std::function<void(const uint8_t* data, size_t size, const amf::EncodedFrameInfo& info)>;
+    // Microseconds, steady clock by default
+    using Clock = std::function<int64_t()>;
+
+    // amf::D3D11Backend on a gpu, amf::SoftwareBackend anywhere else
+    explicit AmfEncoder(std::unique_ptr<amf::EncoderBackend> backend);
     ~AmfEncoder();
 
+    // Has to be set before Initialize. Packets are then delivered on an output thread and
+    // EncodeFrame returns as soon as the frame is queued, it never waits for the encoder.
+    void RegisterEncodedImageCallback(EncodedImageCallback callback);
+
+    // Time base of the rate changes and the statistics. Offline simulations on
+    // amf::SoftwareBackend pass a virtual clock and run faster than real time.
+    void SetClock(Clock clock);
+
     // VideoEncodeAccelerator implementation.
     bool Initialize(const Config& config);
 
+    // Tightly packed NV12
     int32_t EncodeFrame(const std::vector<uint8_t>& data, uint32_t widht, uint32_t height,
                         bool force_key);
 
+    // The planes are only read during the call, `frame.release` runs once they are uploaded
+    int32_t EncodeFrame(const amf::VideoFrameView& frame, bool force_key);
+
     int32_t RequestEncodingParametersChange(uint32_t bitrate, uint32_t framerate);
 
+    // New input size. The frames in flight are drained, then the component is re-initialized in
+    // place on the same device, it is only re-created when it refuses AMFComponent::ReInit.
+    bool Resize(uint32_t width, uint32_t height);
+
+    // Share of the screen that changed since the previous capture, from amf::DirtyRegionDetector.
+    // Returns the frame rate the encoder runs at, frames should be delivered at that rate.
+    // Only with Config::adaptive_framerate, the configured frame rate is returned otherwise.
+    uint32_t UpdateFrameChange(float changed);
+
+    // What the stream signals, the NV12 convertor has to produce it. Differs from
+    // Config::color_space in what the encoder can't signal.
+    const amf::ColorSpace& OutputColorSpace() const { return config_.color_space; }
+
 private:
     void uninit();
 
-    bool initD3d11(uint64_t luid);
-
     bool initCodec(const Config& config);
 
     bool resetDevice(uint64_t luid);
 
-    bool onImageEncoded(amf::AMFDataPtr& pkt);
+    // Packets of everything submitted so far reach onImageEncoded
+    void drainOutput();
 
-private:
-    void AMF_STD_CALL OnSurfaceDataRelease(amf::AMFSurface* pSurface) override;
+    // Info of the oldest frame in sync_in_flight_, without times when there is none
+    amf::EncodedFrameInfo takeSyncInfo();
+
+    void startPipeline();
+
+    bool onImageEncoded(amf::AMFDataPtr& pkt, amf::EncodedFrameInfo info);
+
+    void traceFrame(amf::AMFDataPtr& pkt, const amf::EncodedFrameInfo& info, uint64_t frame_type,
+                    uint32_t qp, size_t size, int64_t output_time, uint32_t upload_us,
+                    uint32_t encode_us);
 
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> copyFrameToTexture(const std::vector<uint8_t>& data,
-                                                               uint32_t widht, uint32_t height);
+    // The view to encode for `frame`, resizes the encoder once the canvas takes a new size
+    bool fitToCanvas(const amf::VideoFrameView& frame, amf::VideoFrameView* input);
 
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> getAvailableTexture(const D3D11_TEXTURE2D_DESC& desc);
+    int64_t now() const;
 
+private:
     bool isTimeToChangeTargetFps(int64_t at_time);
 
     bool isTimeToChangeTargetBitrate(int64_t at_time);
 
+    // Moves help_ctx_.smoothed_bitrate towards the latest request by the time elapsed since the
+    // last call, on every request and every frame
+    void smoothTargetBitrate(int64_t at_time);
+
+    // Requested frame rate, lowered by the governor with Config::adaptive_framerate
+    uint32_t targetFramerate() const;
+
+    // Smoothed bitrate, the same at every frame rate the governor picks
+    uint32_t targetBitrate() const;
+
     void applyFramerate(int64_t at_time);
 
     void applyBitrate(int64_t at_time);
@@ -72,6 +132,13 @@ private:
     void LimitQPForScc();
     void RecoverQPRange();
 
+    // Samples the luma plane now and then, and follows the content with the scenario
+    void classifyContent(const amf::VideoFrameView& frame);
+    void applyScenario(amf::AmfContext::Scenario scenario);
+    // Upper QP for key frames in the current scenario, false when they are not limited
+    bool keyFrameMaxQP(uint32_t* max_qp) const;
+    void applyHevcQPI();
+
 private:
     bool applyH264Parameters(const Config& config);
 
@@ -82,31 +149,33 @@ private:
     bool triggleKeyFrame(amf::AMFSurfacePtr& surface);
 
 private:
-    uint64_t luid_ = 0;
-    Microsoft::WRL::ComPtr<ID3D11Device> d3d11_dev_;
-    Microsoft::WRL::ComPtr<ID3D11DeviceContext> d3d11_ctx_;
-
-    amf::AMFContextPtr amf_context_ = nullptr;
+    std::unique_ptr<amf::EncoderBackend> backend_;
     amf::AMFComponentPtr amf_encoder_ = nullptr;
 
-    std::mutex texture_mtx_;
-    std::vector<Microsoft::WRL::ComPtr<ID3D11Texture2D>> available_textures_;
-    std::unordered_map<amf::AMFSurface*, Microsoft::WRL::ComPtr<ID3D11Texture2D>> active_textures_;
-
-    D3D11_TEXTURE2D_DESC temp_texture_desc_;
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> temp_texture_;
-
     amf::AMFDataPtr encoded_pkt_;
+    // Without the pipeline: frames submitted whose packet has not come out, in submission order
+    std::deque<amf::EncodedFrameInfo> sync_in_flight_;
 
-    amf::AmfContext help_ctx_;
+    EncodedImageCallback encoded_callback_;
+    Clock clock_;
+    std::unique_ptr<amf::EncodePipeline> pipeline_;
+    uint64_t frame_id_ = 0;
 
-    std::unique_ptr<amf::NV12Convertor> nv12_convertor_;
+    // help_ctx_, the QP state and the recorder are shared with the output thread
+    std::mutex ctx_mtx_;
+    amf::AmfContext help_ctx_;
 
     Config config_;
 
-    InputFormat input_format_ = InputFormat::UNKNOWN;
-
     amf::AmfEncoderDebuger input_output_recorder_;
+    // Only with Config::frame_trace_path
+    std::unique_ptr<amf::FrameTraceWriter> frame_trace_;
 
     bool recover_qp_range_ = false;
+
+    amf::FramerateGovernor framerate_governor_;
+    std::unique_ptr<amf::FrameCanvas> canvas_;
+
+    amf::ContentClassifier content_classifier_;
+    uint32_t frames_to_classify_ = 0;
 };
@@ -1,8 +1,15 @@
 #include <algorithm>
 #include <cinttypes>
+#include <cstdlib>
 #include <iostream>
 
 #include "amf_helper.h"
+#include "async_logger.h"
+#include "capability_cache.h"
+#include "capability_probe.h"
+#include "nv12_convert.h"
+#include "plane_copy.h"
+#include "trace_bridge.h"
 
 #pragma warning(push)
 #pragma warning(disable : 4244)
@@ -15,6 +22,19 @@ namespace amf {
 #define LOG_ERROR(...) amf::log(3, __FILE__, __LINE__, __VA_ARGS__)
 
 #define LOG_FILE "amf-test.log"
+#define CAPABILITY_CACHE_FILE "amf-caps.bin"
+
+// The cache is trusted for a day, then revalidated in the background
+static constexpr int64_t kCapabilityCacheMaxAge = 24 * 3600;
+
+static const CapabilityProbe::Codec kProbedCodecs[] = {
+    {CapabilityProbe::Kind::ENCODER, amf_codec_type::AVC},
+    {CapabilityProbe::Kind::ENCODER, amf_codec_type::HEVC},
+    {CapabilityProbe::Kind::ENCODER, amf_codec_type::AV1},
+    {CapabilityProbe::Kind::DECODER, amf_codec_type::AVC},
+    {CapabilityProbe::Kind::DECODER, amf_codec_type::HEVC},
+    {CapabilityProbe::Kind::DECODER, amf_codec_type::AV1},
+};
 
 class Timestamp {
     static int64_t kMicroSecondsPerSecond;
@@ -82,6 +102,19 @@ std::string Timestamp::to_str(bool show_year, bool show_microseconds) const {
     return buf;
 }
 
+const std::string& module_directory() {
+    static const std::string dir = []() {
+        char buffer[1024] = {0};
+        GetModuleFileNameA(nullptr, buffer, 1024);
+        char* slash = strrchr(buffer, '\\');
+        if (slash) {
+            slash[1] = 0;
+        }
+        return std::string(slash ? buffer : "");
+    }();
+    return dir;
+}
+
 static const char* fileNameFromPath(const char* file) {
     const char* end1 = ::strrchr(file, '/');
     const char* end2 = ::strrchr(file, '\\');
@@ -91,38 +124,91 @@ static const char* fileNameFromPath(const char* file) {
         return (end1 > end2) ? end1 + 1 : end2 + 1;
 }
 
+// Never destroyed, other threads may still log while statics are torn down. The lines left in
+// the rings are written at exit, later ones go straight to the file.
+static AsyncLogger* logger() {
+    static AsyncLogger* instance = []() {
+        AsyncLogger::Options options;
+        options.path = module_directory() + LOG_FILE;
+        auto created = new AsyncLogger(options);
+        std::atexit([]() { logger()->stop(); });
+        return created;
+    }();
+    return instance;
+}
+
+// Appends `value` in decimal, zero padded to `width` digits
+static char* appendDecimal(char* out, uint64_t value, int width = 1) {
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (count < width) {
+        digits[count++] = '0';
+    }
+    while (count > 0) {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+static char* appendString(char* out, const char* str, size_t max_length) {
+    const size_t length = std::min(strlen(str), max_length);
+    memcpy(out, str, length);
+    return out + length;
+}
+
 void log(int type, const char* file, int line, const char* format, ...) {
     thread_local uint64_t thread_id = GetCurrentThreadId();
     auto cur_time = Timestamp::now(Timestamp::Type::kSinceEpoch);
     static const char* log_types[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+    // The date only changes once a second, only the microseconds are formatted for every line
+    thread_local int64_t date_second = -1;
+    thread_local char date[32] = {0};
+    const int64_t second = cur_time.microseconds() / 1000000;
+    if (second != date_second) {
+        date_second = second;
+        snprintf(date, sizeof(date), "%s", Timestamp(second * 1000000).to_str(true, false).c_str());
+    }
     va_list args;
     va_start(args, format);
     const int buffer_lenth = 1024;
     thread_local char buffer[buffer_lenth] = {0};
-    int wrote = snprintf(buffer, buffer_lenth,
-                         "[%s][%s][%" PRIu64 "](%s:%d): ", log_types[static_cast<uint8_t>(type)],
-                         cur_time.to_str().c_str(), thread_id, fileNameFromPath(file), line);
-    wrote = std::min<int>(wrote, buffer_lenth);
+    // [INFO][20220114 21:01:04.123456][1234](amf_helper.cpp:123): , well below buffer_lenth
+    char* out = buffer;
+    *out++ = '[';
+    out = appendString(out, log_types[static_cast<uint8_t>(type)], 16);
+    *out++ = ']';
+    *out++ = '[';
+    out = appendString(out, date, sizeof(date));
+    *out++ = '.';
+    out = appendDecimal(out, static_cast<uint64_t>(cur_time.microseconds() % 1000000), 6);
+    *out++ = ']';
+    *out++ = '[';
+    out = appendDecimal(out, thread_id);
+    *out++ = ']';
+    *out++ = '(';
+    out = appendString(out, fileNameFromPath(file), 256);
+    *out++ = ':';
+    out = appendDecimal(out, static_cast<uint64_t>(std::max(line, 0)));
+    *out++ = ')';
+    *out++ = ':';
+    *out++ = ' ';
+    int wrote = static_cast<int>(out - buffer);
     wrote += vsnprintf(buffer + wrote, buffer_lenth - wrote, format, args);
     wrote = std::min<int>(wrote, buffer_lenth - 2);
     buffer[wrote++] = '\n';
     buffer[wrote] = '\0';
-    static std::string dll_path;
-    if (dll_path.empty()) {
-        char buffer[1024] = {0};
-        GetModuleFileNameA(nullptr, buffer, 1024);
-        char* slash = strrchr(buffer, '\\');
-        if (slash) {
-            slash[1] = 0;
-            dll_path = std::string(buffer);
-        }
-    }
-    std::FILE* pfile = std::fopen((dll_path + LOG_FILE).c_str(), "a");
-    std::fwrite(buffer, wrote, 1, pfile);
-    std::fclose(pfile);
+    logger()->write(buffer, wrote);
     va_end(args);
 }
 
+void log_flush() {
+    logger()->flush();
+}
+
 NV12Convertor ::~NV12Convertor() {
     uninit();
 }
@@ -132,19 +218,47 @@ void NV12Convertor::uninit() {
         convert_->Cleanup();
         convert_ = nullptr;
     }
+    cpu_convert_ = nullptr;
+    hdr_convert_ = nullptr;
+    scaler_ = nullptr;
+    scale_buffer_.clear();
+    scale_buffer_.shrink_to_fit();
+    input_staging_ = nullptr;
+    nv12_staging_ = nullptr;
+    d3d11_ctx_ = nullptr;
+    d3d11_dev_ = nullptr;
 }
 
 bool NV12Convertor::init(Microsoft::WRL::ComPtr<ID3D11Device> d3d11_device, uint32_t width,
-                         uint32_t height) {
+                         uint32_t height, Backend backend, const ColorSpace& color) {
     uninit();
+    backend_ = backend;
+    color_ = color;
     Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
     d3d11_device->GetImmediateContext(&context);
+    if (backend_ == Backend::CPU) {
+        d3d11_dev_ = d3d11_device;
+        d3d11_ctx_ = context;
+        cpu_convert_ = std::make_unique<BgraToNv12Converter>(SimdLevel::AUTO, color_);
+        LOG_INFO("NV12 convertor runs on cpu, %s, %s %s", simdLevelStr(cpu_convert_->level()),
+                 colorMatrixStr(color_.matrix), colorRangeStr(color_.range));
+        return true;
+    }
+    // The video processor has no BT.2020 YCbCr output, only the cpu backend does. Falling back
+    // to BT.709 would tint every frame of a stream that signals BT.2020.
+    if (color_.matrix == ColorMatrix::BT2020) {
+        LOG_ERROR("Video processor can't output %s, use the cpu backend",
+                  colorMatrixStr(color_.matrix));
+        return false;
+    }
     convert_ = std::make_unique<D3D11VideoProcessorConvert>(d3d11_device.Get(), context.Get());
     auto hr = convert_->Init();
     if (FAILED(hr)) {
         LOG_ERROR("Failed to initialize D3D11VideoProcessorConvert, hr:%u", hr);
         return false;
     }
+    convert_->SetOutputColorSpace(color_.matrix == ColorMatrix::BT601 ? 0 : 1,
+                                  color_.range == ColorRange::FULL);
     return true;
 }
 
@@ -153,6 +267,9 @@ bool NV12Convertor::convert(Microsoft::WRL::ComPtr<ID3D11Texture2D> input,
     if (!input) {
         return false;
     }
+    if (backend_ == Backend::CPU) {
+        return convertOnCpu(input, output, nullptr);
+    }
     auto hr = convert_->Convert(input.Get(), output.Get());
     if (FAILED(hr)) {
         LOG_ERROR("Failed to call D3D11VideoProcessorConvert::Convert, hr:%u", hr);
@@ -161,6 +278,202 @@ bool NV12Convertor::convert(Microsoft::WRL::ComPtr<ID3D11Texture2D> input,
     return true;
 }
 
+bool NV12Convertor::convert(Microsoft::WRL::ComPtr<ID3D11Texture2D> input,
+                            Microsoft::WRL::ComPtr<ID3D11Texture2D>& output, const RECT& crop) {
+    if (!input) {
+        return false;
+    }
+    D3D11_TEXTURE2D_DESC desc;
+    input->GetDesc(&desc);
+    RECT rect;
+    rect.left = std::max<LONG>(crop.left, 0);
+    rect.top = std::max<LONG>(crop.top, 0);
+    rect.right = std::min<LONG>(crop.right, desc.Width);
+    rect.bottom = std::min<LONG>(crop.bottom, desc.Height);
+    if (rect.right <= rect.left || rect.bottom <= rect.top) {
+        LOG_ERROR("Crop [%ld,%ld,%ld,%ld] is outside of %ux%u", crop.left, crop.top, crop.right,
+                  crop.bottom, desc.Width, desc.Height);
+        return false;
+    }
+    if (backend_ == Backend::CPU) {
+        return convertOnCpu(input, output, &rect);
+    }
+    auto hr = convert_->ConvertAndCrop(input.Get(), output.Get(), rect.left, rect.top,
+                                       rect.right - rect.left, rect.bottom - rect.top);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to call D3D11VideoProcessorConvert::ConvertAndCrop, hr:%u", hr);
+        return false;
+    }
+    return true;
+}
+
+bool NV12Convertor::prepareStagingTextures(const D3D11_TEXTURE2D_DESC& input_desc,
+                                           const D3D11_TEXTURE2D_DESC& output_desc) {
+    D3D11_TEXTURE2D_DESC desc;
+    if (input_staging_) {
+        input_staging_->GetDesc(&desc);
+        if (desc.Width != input_desc.Width || desc.Height != input_desc.Height ||
+            desc.Format != input_desc.Format) {
+            input_staging_ = nullptr;
+        }
+    }
+    if (!input_staging_) {
+        desc = input_desc;
+        desc.MipLevels = 1;
+        desc.ArraySize = 1;
+        desc.SampleDesc.Count = 1;
+        desc.SampleDesc.Quality = 0;
+        desc.BindFlags = 0;
+        desc.MiscFlags = 0;
+        desc.Usage = D3D11_USAGE_STAGING;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        auto hr = d3d11_dev_->CreateTexture2D(&desc, nullptr, &input_staging_);
+        if (FAILED(hr)) {
+            LOG_ERROR("Failed to create input staging texture, hr:%u", hr);
+            return false;
+        }
+    }
+    if (nv12_staging_) {
+        nv12_staging_->GetDesc(&desc);
+        if (desc.Width != output_desc.Width || desc.Height != output_desc.Height ||
+            desc.Format != output_desc.Format) {
+            nv12_staging_ = nullptr;
+        }
+    }
+    if (!nv12_staging_) {
+        desc = output_desc;
+        desc.MipLevels = 1;
+        desc.ArraySize = 1;
+        desc.SampleDesc.Count = 1;
+        desc.SampleDesc.Quality = 0;
+        desc.BindFlags = 0;
+        desc.MiscFlags = 0;
+        desc.Usage = D3D11_USAGE_STAGING;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        auto hr = d3d11_dev_->CreateTexture2D(&desc, nullptr, &nv12_staging_);
+        if (FAILED(hr)) {
+            LOG_ERROR("Failed to create nv12 staging texture, hr:%u", hr);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool NV12Convertor::convertOnCpu(Microsoft::WRL::ComPtr<ID3D11Texture2D> input,
+                                 Microsoft::WRL::ComPtr<ID3D11Texture2D>& output,
+                                 const RECT* crop) {
+    D3D11_TEXTURE2D_DESC input_desc;
+    D3D11_TEXTURE2D_DESC output_desc;
+    input->GetDesc(&input_desc);
+    output->GetDesc(&output_desc);
+    const bool hdr = input_desc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT;
+    const bool nv12 = output_desc.Format == DXGI_FORMAT_NV12;
+    const bool rgba = input_desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM;
+    const bool supported = ((input_desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM || rgba) && nv12) ||
+                           (hdr && (nv12 || output_desc.Format == DXGI_FORMAT_P010));
+    if (!supported) {
+        LOG_ERROR("Unsupported cpu conversion %u -> %u", input_desc.Format, output_desc.Format);
+        return false;
+    }
+    if (hdr) {
+        const auto hdr_output = nv12 ? ScRgbConverter::Output::NV12 : ScRgbConverter::Output::P010;
+        if (!hdr_convert_ || hdr_convert_->output() != hdr_output) {
+            hdr_convert_ = std::make_unique<ScRgbConverter>(hdr_output, SimdLevel::AUTO, color_);
+            LOG_INFO("Convert fp16 scRGB to %s on cpu, %s", nv12 ? "NV12" : "P010",
+                     simdLevelStr(hdr_convert_->level()));
+        }
+    }
+    else {
+        const auto order = rgba ? PixelOrder::RGBA : PixelOrder::BGRA;
+        if (cpu_convert_->pixelOrder() != order) {
+            cpu_convert_ = std::make_unique<BgraToNv12Converter>(SimdLevel::AUTO, color_, order);
+        }
+    }
+    if (!prepareStagingTextures(input_desc, output_desc)) {
+        return false;
+    }
+    // The staging texture keeps the input size, a moving crop only copies its own region
+    uint32_t src_width = input_desc.Width;
+    uint32_t src_height = input_desc.Height;
+    if (crop) {
+        D3D11_BOX box;
+        box.left = crop->left;
+        box.top = crop->top;
+        box.right = crop->right;
+        box.bottom = crop->bottom;
+        box.front = 0;
+        box.back = 1;
+        d3d11_ctx_->CopySubresourceRegion(input_staging_.Get(), 0, 0, 0, 0, input.Get(), 0, &box);
+        src_width = crop->right - crop->left;
+        src_height = crop->bottom - crop->top;
+    }
+    else {
+        d3d11_ctx_->CopyResource(input_staging_.Get(), input.Get());
+    }
+    D3D11_MAPPED_SUBRESOURCE src;
+    auto hr = d3d11_ctx_->Map(input_staging_.Get(), 0, D3D11_MAP_READ, 0, &src);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to map input staging texture, hr:%u", hr);
+        return false;
+    }
+    D3D11_MAPPED_SUBRESOURCE dst;
+    hr = d3d11_ctx_->Map(nv12_staging_.Get(), 0, D3D11_MAP_WRITE, 0, &dst);
+    if (FAILED(hr)) {
+        d3d11_ctx_->Unmap(input_staging_.Get(), 0);
+        LOG_ERROR("Failed to map nv12 staging texture, hr:%u", hr);
+        return false;
+    }
+    uint8_t* y = static_cast<uint8_t*>(dst.pData);
+    uint8_t* uv = y + static_cast<size_t>(dst.RowPitch) * output_desc.Height;
+    const uint8_t* pixels = static_cast<const uint8_t*>(src.pData);
+    // The nv12 texture is rounded up to even size, one pixel more or less is not scaled
+    const bool scale = nv12 && (src_width > output_desc.Width || src_height > output_desc.Height ||
+                                src_width + 1 < output_desc.Width ||
+                                src_height + 1 < output_desc.Height);
+    if (scale) {
+        const auto mode = src_width > output_desc.Width || src_height > output_desc.Height
+                              ? CpuScaler::Mode::AREA
+                              : CpuScaler::Mode::BILINEAR;
+        if (!scaler_ || scaler_->mode() != mode) {
+            scaler_ = std::make_unique<CpuScaler>(mode, SimdLevel::AUTO, color_.siting);
+        }
+        const uint32_t pitch = (src_width + 1) / 2 * 2;
+        const size_t luma_bytes = static_cast<size_t>(pitch) * src_height;
+        scale_buffer_.resize(luma_bytes + static_cast<size_t>(pitch) * ((src_height + 1) / 2));
+        uint8_t* scaled_y = scale_buffer_.data();
+        uint8_t* scaled_uv = scaled_y + luma_bytes;
+        if (hdr) {
+            hdr_convert_->convert(pixels, src.RowPitch, src_width, src_height, scaled_y, pitch,
+                                  scaled_uv, pitch);
+        }
+        else {
+            cpu_convert_->convert(pixels, src.RowPitch, src_width, src_height, scaled_y, pitch,
+                                  scaled_uv, pitch);
+        }
+        scaler_->scaleNv12(scaled_y, pitch, scaled_uv, pitch, src_width, src_height, y,
+                           dst.RowPitch, uv, dst.RowPitch, output_desc.Width, output_desc.Height);
+    }
+    else {
+        const uint32_t width = std::min(src_width, output_desc.Width);
+        const uint32_t height = std::min(src_height, output_desc.Height);
+        if (hdr) {
+            hdr_convert_->convert(pixels, src.RowPitch, width, height, y, dst.RowPitch, uv,
+                                  dst.RowPitch);
+        }
+        else {
+            cpu_convert_->convert(pixels, src.RowPitch, width, height, y, dst.RowPitch, uv,
+                                  dst.RowPitch);
+        }
+        // An odd or unscaled P010 input leaves the rest to the edge pixels, not old frames
+        padNv12(y, dst.RowPitch, uv, dst.RowPitch, width, height, output_desc.Width,
+                output_desc.Height, nv12 ? 1 : 2);
+    }
+    d3d11_ctx_->Unmap(nv12_staging_.Get(), 0);
+    d3d11_ctx_->Unmap(input_staging_.Get(), 0);
+    d3d11_ctx_->CopyResource(output.Get(), nv12_staging_.Get());
+    return true;
+}
+
 static Microsoft::WRL::ComPtr<IDXGIAdapter>
 findAmdAdapter(Microsoft::WRL::ComPtr<IDXGIFactory2> factory, uint64_t target_luid) {
     DXGI_ADAPTER_DESC desc;
@@ -249,6 +562,90 @@ bool InitAmfContextWithD3d11(amf::AMFContextPtr amf_context) {
     return true;
 }
 
+// Identity of the adapter InitAmfContextWithD3d11 picks, with the version of its driver
+static bool queryAdapterKey(CapabilityCache::Key* key) {
+    typedef HRESULT(WINAPI * CREATEDXGIFACTORY1PROC)(REFIID, void**);
+    HMODULE dxgi = get_lib("DXGI.dll");
+    if (!dxgi) {
+        return false;
+    }
+    CREATEDXGIFACTORY1PROC create_dxgi =
+        (CREATEDXGIFACTORY1PROC)GetProcAddress(dxgi, "CreateDXGIFactory1");
+    Microsoft::WRL::ComPtr<IDXGIFactory2> factory;
+    if (!create_dxgi || FAILED(create_dxgi(__uuidof(IDXGIFactory2), (void**)&factory))) {
+        return false;
+    }
+    auto adapter = findAmdAdapter(factory, 0);
+    DXGI_ADAPTER_DESC desc;
+    LARGE_INTEGER umd_version = {};
+    if (!adapter || FAILED(adapter->GetDesc(&desc)) ||
+        FAILED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &umd_version))) {
+        return false;
+    }
+    key->vendor_id = desc.VendorId;
+    key->device_id = desc.DeviceId;
+    key->subsys_id = desc.SubSysId;
+    key->revision = desc.Revision;
+    key->driver_version = static_cast<uint64_t>(umd_version.QuadPart);
+    return true;
+}
+
+static int64_t unixTime() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+static bool coversProbedCodecs(const CapabilityCache::Contents& contents) {
+    for (auto& codec : kProbedCodecs) {
+        auto iter = std::find_if(contents.entries.begin(), contents.entries.end(),
+                                 [&codec](const CapabilityCache::Entry& entry) {
+                                     return entry.kind == codec.first && entry.type == codec.second;
+                                 });
+        if (iter == contents.entries.end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs on a task of its own once `probe` is done. `cached` holds the entries the process runs
+// with when it is a revalidation, they are compared with the new ones.
+static void updateCapabilityCache(CapabilityProbe* probe, CapabilityCache::Contents cached,
+                                  std::string path) {
+    probe->wait();
+    if (probe->cancelled()) {
+        return;
+    }
+    std::vector<CapabilityCache::Entry> entries;
+    bool any_supported = false;
+    for (auto& codec : kProbedCodecs) {
+        CapabilityCache::Entry entry;
+        entry.kind = codec.first;
+        entry.type = codec.second;
+        entry.supported = probe->capbility(codec.first, codec.second, &entry.capbility);
+        any_supported |= entry.supported;
+        entries.push_back(entry);
+    }
+    // Nothing at all is more likely a runtime that failed than a gpu without codecs
+    if (!any_supported) {
+        return;
+    }
+    if (!cached.entries.empty()) {
+        if (entries == cached.entries) {
+            LOG_INFO("Capability cache revalidated");
+        }
+        else {
+            LOG_WARN("Capabilities changed under the same driver, the next start uses them");
+        }
+    }
+    cached.entries = std::move(entries);
+    cached.written_at = unixTime();
+    if (CapabilityCache::save(path, cached)) {
+        LOG_INFO("Capabilities saved to %s", path.c_str());
+    }
+}
+
 bool AmfModule::doInit() {
     auto amf_module = LoadLibraryExW(AMF_DLL_NAME, nullptr, LOAD_LIBRARY_AS_DATAFILE);
     if (!amf_module) {
@@ -294,31 +691,51 @@ bool AmfModule::doInit() {
         amf_debug->AssertsEnable(false);
     }
 
-#ifndef _NDEBUG
-    amf_int32 traceLevel = AMF_TRACE_TRACE;
-    amf_trace->SetGlobalLevel(traceLevel);
-
-    amf_trace->EnableWriter(AMF_TRACE_WRITER_CONSOLE, false);
-
-    amf_trace->EnableWriter(AMF_TRACE_WRITER_DEBUG_OUTPUT, true);
-    amf_trace->SetWriterLevel(AMF_TRACE_WRITER_DEBUG_OUTPUT, traceLevel);
-
-    amf_trace->EnableWriter(AMF_TRACE_WRITER_FILE, true);
-    amf_trace->SetWriterLevel(AMF_TRACE_WRITER_FILE, traceLevel);
-#endif
-    amf::AMFContextPtr amf_context;
-    if (factory->CreateContext(&amf_context) != AMF_OK || !InitAmfContextWithD3d11(amf_context)) {
-        LOG_ERROR("Failed to initialize amf context");
-        return false;
+    // Warnings only in release builds, all but the encoder cores in debug builds, see
+    // TraceBridge::Options
+    trace_bridge_ = std::make_unique<TraceBridge>();
+    trace_bridge_->attach(amf_trace);
+    const std::vector<CapabilityProbe::Codec> codecs(std::begin(kProbedCodecs),
+                                                     std::end(kProbedCodecs));
+    probe_ = std::make_unique<CapabilityProbe>(
+        [this](CapabilityProbe::Kind kind, amf_codec_type type, const std::atomic<bool>& cancelled,
+               AmfCodecCapbility* capbility) {
+            return probeCodec(kind == CapabilityProbe::Kind::ENCODER, type, cancelled, capbility);
+        });
+    CapabilityCache::Contents cached;
+    cached.key.amf_version = amf_version;
+    const std::string cache_path = module_directory() + CAPABILITY_CACHE_FILE;
+    const bool has_key = queryAdapterKey(&cached.key);
+    if (has_key && CapabilityCache::load(cache_path, cached.key, &cached) &&
+        coversProbedCodecs(cached)) {
+        for (auto& entry : cached.entries) {
+            probe_->resolve(entry.kind, entry.type, entry.supported, entry.capbility);
+        }
+        probe_->start(codecs);
+        const int64_t age = unixTime() - cached.written_at;
+        LOG_INFO("Capabilities loaded from %s, written %" PRId64 " s ago", cache_path.c_str(),
+                 age);
+        if (age < 0 || age > kCapabilityCacheMaxAge) {
+            probes_left_ = static_cast<uint32_t>(codecs.size());
+            revalidation_ = std::make_unique<CapabilityProbe>(
+                [this](CapabilityProbe::Kind kind, amf_codec_type type,
+                       const std::atomic<bool>& cancelled, AmfCodecCapbility* capbility) {
+                    return probeCodec(kind == CapabilityProbe::Kind::ENCODER, type, cancelled,
+                                      capbility);
+                });
+            revalidation_->start(codecs);
+            cache_task_ = std::async(std::launch::async, updateCapabilityCache,
+                                     revalidation_.get(), cached, cache_path);
+        }
+        return true;
+    }
+    probes_left_ = static_cast<uint32_t>(codecs.size());
+    probe_->start(codecs);
+    if (has_key) {
+        cached.entries.clear();
+        cache_task_ = std::async(std::launch::async, updateCapabilityCache, probe_.get(), cached,
+                                 cache_path);
     }
-
-    QueryEncoderForCodecAVC(amf_context);
-    QueryEncoderForCodecHEVC(amf_context);
-    QueryEncoderForCodecAV1(amf_context);
-    QueryDecoderForCodec(amf_codec_type::AVC, amf_context);
-    QueryDecoderForCodec(amf_codec_type::HEVC, amf_context);
-    QueryDecoderForCodec(amf_codec_type::AV1, amf_context);
-    amf_context->Terminate();
     return true;
 }
 
@@ -327,23 +744,47 @@ bool AmfModule::init() {
     __try {
         ret = doInit();
     } __except (EXCEPTION_EXECUTE_HANDLER) {
-        encoder_capbilities_.clear();
-        decoder_capbilities_.clear();
         ret = false;
         LOG_ERROR("Amf exception detected");
     }
+    if (!ret) {
+        if (trace_bridge_) {
+            trace_bridge_->detach();
+        }
+        revalidation_ = nullptr;
+        probe_ = nullptr;
+    }
     return ret;
 }
 
 void AmfModule::uninit() {
+    // The probe tasks run on the runtime, they are done before it is unloaded
+    if (probe_) {
+        probe_->cancel();
+        probe_->wait();
+    }
+    if (revalidation_) {
+        revalidation_->cancel();
+        revalidation_->wait();
+    }
+    if (cache_task_.valid()) {
+        cache_task_.wait();
+    }
     __try {
-        uninit();
+        doUninit();
     } __except (EXCEPTION_EXECUTE_HANDLER) {
         LOG_ERROR("Amf exception detected, ignore");
     }
 }
 
 void AmfModule::doUninit() {
+    if (probe_context_) {
+        probe_context_->Terminate();
+        probe_context_ = nullptr;
+    }
+    if (trace_bridge_) {
+        trace_bridge_->detach();
+    }
     // no need to unload module
     if (amf_trace) {
         // amf_trace->TraceFlush();
@@ -352,11 +793,67 @@ void AmfModule::doUninit() {
     amf_debug = nullptr;
     factory = nullptr;
     if (amf_module) {
-        FreeLibrary(amf_module);
+        FreeLibrary(static_cast<HMODULE>(amf_module));
         amf_module = NULL;
     }
 }
 
+amf::AMFContextPtr AmfModule::probeContext() {
+    std::call_once(probe_context_once_, [this]() {
+        amf::AMFContextPtr context;
+        if (factory->CreateContext(&context) != AMF_OK || !InitAmfContextWithD3d11(context)) {
+            LOG_ERROR("Failed to initialize amf context");
+            return;
+        }
+        probe_context_ = context;
+    });
+    return probe_context_;
+}
+
+bool AmfModule::doProbeCodec(bool encoder, amf_codec_type type,
+                             const std::atomic<bool>& cancelled, AmfCodecCapbility* capbility) {
+    auto context = probeContext();
+    if (!context || cancelled) {
+        return false;
+    }
+    if (!encoder) {
+        return QueryDecoderForCodec(type, context, capbility);
+    }
+    switch (type) {
+    case amf_codec_type::AVC:
+        return QueryEncoderForCodecAVC(context, capbility);
+    case amf_codec_type::HEVC:
+        return QueryEncoderForCodecHEVC(context, capbility);
+    case amf_codec_type::AV1:
+        return QueryEncoderForCodecAV1(context, capbility);
+    default:
+        return false;
+    }
+}
+
+bool AmfModule::probeCodec(bool encoder, amf_codec_type type, const std::atomic<bool>& cancelled,
+                           AmfCodecCapbility* capbility) {
+    bool ret = false;
+    __try {
+        ret = doProbeCodec(encoder, type, cancelled, capbility);
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        ret = false;
+        LOG_ERROR("Amf exception detected while probing codec %d", static_cast<int>(type));
+    }
+    // The last probe releases the device, uninit does when some never ran
+    if (--probes_left_ == 0) {
+        __try {
+            if (probe_context_) {
+                probe_context_->Terminate();
+                probe_context_ = nullptr;
+            }
+        } __except (EXCEPTION_EXECUTE_HANDLER) {
+            LOG_ERROR("Amf exception detected, ignore");
+        }
+    }
+    return ret;
+}
+
 std::string AccelTypeToString(amf::AMF_ACCELERATION_TYPE accelType) {
     std::string strValue;
     switch (accelType) {
@@ -406,24 +903,26 @@ static bool QueryIOCaps(const amf::AMFIOCapsPtr& ioCaps, AmfCodecCapbility& capb
     return true;
 }
 
-void AmfModule::QueryEncoderForCodecAVC(amf::AMFContextPtr amf_context) {
+bool AmfModule::QueryEncoderForCodecAVC(amf::AMFContextPtr amf_context,
+                                          AmfCodecCapbility* result) {
     LOG_INFO("Start query codec for avc encoder...");
     amf::AMFComponentPtr pEncoder;
     factory->CreateComponent(amf_context, AMFVideoEncoderVCE_AVC, &pEncoder);
     if (pEncoder == NULL) {
         LOG_INFO("%s", AccelTypeToString(amf::AMF_ACCEL_NOT_SUPPORTED).c_str());
-        return;
+        return false;
     }
     amf::AMFCapsPtr encoderCaps;
     if (pEncoder->GetCaps(&encoderCaps) != AMF_OK) {
         LOG_INFO("%s", AccelTypeToString(amf::AMF_ACCEL_NOT_SUPPORTED).c_str());
-        return;
+        return false;
     }
     amf_uint32 NumOfHWInstances = 1;
     encoderCaps->GetProperty(AMF_VIDEO_ENCODER_CAP_NUM_OF_HW_INSTANCES, &NumOfHWInstances);
     LOG_INFO("Exists %u encoder instances", NumOfHWInstances);
     for (amf_uint32 i = 0; i < NumOfHWInstances; i++) {
         AmfCodecCapbility capbility;
+        capbility.instances = NumOfHWInstances;
         if (NumOfHWInstances > 1) {
             pEncoder->SetProperty(AMF_VIDEO_ENCODER_INSTANCE_INDEX, i);
         }
@@ -456,7 +955,7 @@ void AmfModule::QueryEncoderForCodecAVC(amf::AMFContextPtr amf_context) {
         LOG_INFO("Max Number of streams supported: %u", capbility.max_streams);
         amf::AMFIOCapsPtr inputCaps;
         if (encoderCaps->GetInputCaps(&inputCaps) != AMF_OK || !QueryIOCaps(inputCaps, capbility)) {
-            return;
+            return false;
         }
         LOG_INFO("Dimension limit: [%u X %u -> %u X %u]", capbility.min_width, capbility.min_height,
                  capbility.max_width, capbility.max_height);
@@ -467,29 +966,32 @@ void AmfModule::QueryEncoderForCodecAVC(amf::AMFContextPtr amf_context) {
         }
         LOG_INFO("Supported Formats: %S", formats_str.c_str());
         if (i == 0) {
-            encoder_capbilities_.emplace(amf_codec_type::AVC, capbility);
+            *result = capbility;
         }
     }
+    return true;
 }
 
-void AmfModule::QueryEncoderForCodecHEVC(amf::AMFContextPtr amf_context) {
+bool AmfModule::QueryEncoderForCodecHEVC(amf::AMFContextPtr amf_context,
+                                          AmfCodecCapbility* result) {
     LOG_INFO("Start query codec for hevc encoder...");
     amf::AMFComponentPtr pEncoder;
     factory->CreateComponent(amf_context, AMFVideoEncoder_HEVC, &pEncoder);
     if (pEncoder == NULL) {
         LOG_INFO("%s", AccelTypeToString(amf::AMF_ACCEL_NOT_SUPPORTED).c_str());
-        return;
+        return false;
     }
     amf::AMFCapsPtr encoderCaps;
     if (pEncoder->GetCaps(&encoderCaps) != AMF_OK) {
         LOG_INFO("%s", AccelTypeToString(amf::AMF_ACCEL_NOT_SUPPORTED).c_str());
-        return;
+        return false;
     }
     amf_uint32 NumOfHWInstances = 1;
     encoderCaps->GetProperty(AMF_VIDEO_ENCODER_HEVC_CAP_NUM_OF_HW_INSTANCES, &NumOfHWInstances);
     LOG_INFO("Exists %u encoder instances", NumOfHWInstances);
     for (amf_uint32 i = 0; i < NumOfHWInstances; i++) {
         AmfCodecCapbility capbility;
+        capbility.instances = NumOfHWInstances;
         if (NumOfHWInstances > 1) {
             pEncoder->SetProperty(AMF_VIDEO_ENCODER_HEVC_INSTANCE_INDEX, i);
         }
@@ -516,7 +1018,7 @@ void AmfModule::QueryEncoderForCodecHEVC(amf::AMFContextPtr amf_context) {
         LOG_INFO("Max Number of streams supported: %u", capbility.max_streams);
         amf::AMFIOCapsPtr inputCaps;
         if (encoderCaps->GetInputCaps(&inputCaps) != AMF_OK || !QueryIOCaps(inputCaps, capbility)) {
-            return;
+            return false;
         }
         LOG_INFO("Dimension limit [%u X %u -> %u X %u]", capbility.min_width, capbility.min_height,
                  capbility.max_width, capbility.max_height);
@@ -527,29 +1029,32 @@ void AmfModule::QueryEncoderForCodecHEVC(amf::AMFContextPtr amf_context) {
         }
         LOG_INFO("Supported Formats: %S", formats_str.c_str());
         if (i == 0) {
-            encoder_capbilities_.emplace(amf_codec_type::HEVC, capbility);
+            *result = capbility;
         }
     }
+    return true;
 }
 
-void AmfModule::QueryEncoderForCodecAV1(amf::AMFContextPtr amf_context) {
+bool AmfModule::QueryEncoderForCodecAV1(amf::AMFContextPtr amf_context,
+                                          AmfCodecCapbility* result) {
     LOG_INFO("Start query codec for av1 encoder...");
     amf::AMFComponentPtr pEncoder;
     factory->CreateComponent(amf_context, AMFVideoEncoder_AV1, &pEncoder);
     if (pEncoder == NULL) {
         LOG_INFO("%s", AccelTypeToString(amf::AMF_ACCEL_NOT_SUPPORTED).c_str());
-        return;
+        return false;
     }
     amf::AMFCapsPtr encoderCaps;
     if (pEncoder->GetCaps(&encoderCaps) != AMF_OK) {
         LOG_INFO("%s", AccelTypeToString(amf::AMF_ACCEL_NOT_SUPPORTED).c_str());
-        return;
+        return false;
     }
     amf_uint32 NumOfHWInstances = 1;
     encoderCaps->GetProperty(AMF_VIDEO_ENCODER_AV1_CAP_NUM_OF_HW_INSTANCES, &NumOfHWInstances);
     LOG_INFO("Exists %u encoder instances", NumOfHWInstances);
     for (amf_uint32 i = 0; i < NumOfHWInstances; i++) {
         AmfCodecCapbility capbility;
+        capbility.instances = NumOfHWInstances;
         if (NumOfHWInstances > 1) {
             pEncoder->SetProperty(AMF_VIDEO_ENCODER_AV1_ENCODER_INSTANCE_INDEX, i);
         }
@@ -568,7 +1073,7 @@ void AmfModule::QueryEncoderForCodecAV1(amf::AMFContextPtr amf_context) {
 
         amf::AMFIOCapsPtr inputCaps;
         if (encoderCaps->GetInputCaps(&inputCaps) != AMF_OK || !QueryIOCaps(inputCaps, capbility)) {
-            return;
+            return false;
         }
         LOG_INFO("Dimension limit [%u X %u -> %u X %u]", capbility.min_width, capbility.min_height,
                  capbility.max_width, capbility.max_height);
@@ -579,13 +1084,15 @@ void AmfModule::QueryEncoderForCodecAV1(amf::AMFContextPtr amf_context) {
         }
         LOG_INFO("Supported Formats: %S", formats_str.c_str());
         if (i == 0) {
-            encoder_capbilities_.emplace(amf_codec_type::AV1, capbility);
+            *result = capbility;
         }
     }
+    return true;
 }
 
 // TDOO(tao.chen): 10bit hevc
-void AmfModule::QueryDecoderForCodec(amf_codec_type codec, amf::AMFContextPtr context) {
+bool AmfModule::QueryDecoderForCodec(amf_codec_type codec, amf::AMFContextPtr context,
+                                     AmfCodecCapbility* result) {
     const wchar_t* codec_name = nullptr;
     switch (codec) {
     case amf_codec_type::AVC:
@@ -606,19 +1113,19 @@ void AmfModule::QueryDecoderForCodec(amf_codec_type codec, amf::AMFContextPtr co
     factory->CreateComponent(context, codec_name, &pDecoder);
     if (pDecoder == NULL) {
         LOG_INFO("%s", AccelTypeToString(amf::AMF_ACCEL_NOT_SUPPORTED).c_str());
-        return;
+        return false;
     }
     amf::AMFCapsPtr decoderCaps;
     if (pDecoder->GetCaps(&decoderCaps) != AMF_OK) {
         LOG_INFO("%s", AccelTypeToString(amf::AMF_ACCEL_NOT_SUPPORTED).c_str());
-        return;
+        return false;
     }
     amf::AMF_ACCELERATION_TYPE accelType = decoderCaps->GetAccelerationType();
     LOG_INFO("Acceleration Type: %s", AccelTypeToString(accelType).c_str());
     amf::AMFIOCapsPtr inputCaps;
     AmfCodecCapbility capbility;
     if (decoderCaps->GetInputCaps(&inputCaps) != AMF_OK || !QueryIOCaps(inputCaps, capbility)) {
-        return;
+        return false;
     }
     LOG_INFO("Dimension limit: [%u X %u -> %u X %u]", capbility.min_width, capbility.min_height,
              capbility.max_width, capbility.max_height);
@@ -627,252 +1134,93 @@ void AmfModule::QueryDecoderForCodec(amf_codec_type codec, amf::AMFContextPtr co
         formats_str += std::wstring(L" ") + std::wstring(amf_trace->SurfaceGetFormatName(format));
     }
     LOG_INFO("Supported Formats: %S", formats_str.c_str());
-    decoder_capbilities_.emplace(codec, capbility);
+    *result = capbility;
+    return true;
 }
 
-bool AmfModule::isSupportAVCEncode(uint32_t width, uint32_t height) const {
-    auto iter = encoder_capbilities_.find(amf_codec_type::AVC);
-    if (iter == encoder_capbilities_.end()) {
-        return false;
-    }
-    if (iter->second.max_height < height || iter->second.max_width < width) {
-        return false;
-    }
-    if (iter->second.min_height > height || iter->second.min_width > width) {
+AmfModule::AmfModule() = default;
+
+AmfModule::~AmfModule() = default;
+
+bool AmfModule::capbility(bool encoder, amf_codec_type type, AmfCodecCapbility* capbility) const {
+    if (!probe_) {
         return false;
     }
-    return true;
+    return probe_->capbility(encoder ? CapabilityProbe::Kind::ENCODER
+                                     : CapabilityProbe::Kind::DECODER,
+                             type, capbility);
 }
 
-bool AmfModule::isSupportHEVCEncode(uint32_t width, uint32_t height) const {
-    auto iter = encoder_capbilities_.find(amf_codec_type::HEVC);
-    if (iter == encoder_capbilities_.end()) {
+bool AmfModule::isSupport(bool encoder, amf_codec_type type, uint32_t width,
+                          uint32_t height) const {
+    AmfCodecCapbility caps;
+    if (!capbility(encoder, type, &caps)) {
         return false;
     }
-    if (iter->second.max_height < height || iter->second.max_width < width) {
+    if (caps.max_height < height || caps.max_width < width) {
         return false;
     }
-    if (iter->second.min_height > height || iter->second.min_width > width) {
+    if (caps.min_height > height || caps.min_width > width) {
         return false;
     }
     return true;
 }
 
+bool AmfModule::isSupportAVCEncode(uint32_t width, uint32_t height) const {
+    return isSupport(true, amf_codec_type::AVC, width, height);
+}
+
+bool AmfModule::isSupportHEVCEncode(uint32_t width, uint32_t height) const {
+    return isSupport(true, amf_codec_type::HEVC, width, height);
+}
+
 bool AmfModule::isSupportAV1Encode(uint32_t width, uint32_t height) const {
-    auto iter = encoder_capbilities_.find(amf_codec_type::AV1);
-    if (iter == encoder_capbilities_.end()) {
-        return false;
-    }
-    if (iter->second.max_height < height || iter->second.max_width < width) {
-        return false;
-    }
-    if (iter->second.min_height > height || iter->second.min_width > width) {
-        return false;
-    }
-    return true;
+    return isSupport(true, amf_codec_type::AV1, width, height);
 }
 
 bool AmfModule::isSupportAVCDecoder(uint32_t width, uint32_t height) const {
-    auto iter = decoder_capbilities_.find(amf_codec_type::AVC);
-    if (iter == decoder_capbilities_.end()) {
-        return false;
-    }
-    if (iter->second.max_height < height || iter->second.max_width < width) {
-        return false;
-    }
-    if (iter->second.min_height > height || iter->second.min_width > width) {
-        return false;
-    }
-    return true;
+    return isSupport(false, amf_codec_type::AVC, width, height);
 }
 
 bool AmfModule::isSupportHEVCDecoder(uint32_t width, uint32_t height) const {
-    auto iter = decoder_capbilities_.find(amf_codec_type::HEVC);
-    if (iter == decoder_capbilities_.end()) {
-        return false;
-    }
-    if (iter->second.max_height < height || iter->second.max_width < width) {
-        return false;
-    }
-    if (iter->second.min_height > height || iter->second.min_width > width) {
-        return false;
-    }
-    return true;
+    return isSupport(false, amf_codec_type::HEVC, width, height);
 }
 
 bool AmfModule::isSupportAV1Decoder(uint32_t width, uint32_t height) const {
-    auto iter = decoder_capbilities_.find(amf_codec_type::AV1);
-    if (iter == decoder_capbilities_.end()) {
-        return false;
-    }
-    if (iter->second.max_height < height || iter->second.max_width < width) {
-        return false;
-    }
-    if (iter->second.min_height > height || iter->second.min_width > width) {
-        return false;
-    }
-    return true;
+    return isSupport(false, amf_codec_type::AV1, width, height);
 }
 
 bool AmfModule::isEncoderFormatSupport(amf_codec_type type, amf::AMF_SURFACE_FORMAT format) const {
-    auto iter = encoder_capbilities_.find(type);
-    if (iter == encoder_capbilities_.end()) {
+    AmfCodecCapbility capbility;
+    if (!this->capbility(true, type, &capbility)) {
         return false;
     }
-    auto& capbility = iter->second;
     if (capbility.input_formats.find(format) == capbility.input_formats.end()) {
         return false;
     }
     return true;
 }
 
-std::string codecstr(amf_codec_type type) {
-    switch (type) {
-    case amf_codec_type::AV1:
-        return "AV1";
-    case amf_codec_type::AVC:
-        return "H264";
-    case amf_codec_type::HEVC:
-        return "H265";
-    default:
-        return "UNKNOWN";
-    }
+bool AmfModule::encoderCapbility(amf_codec_type type, AmfCodecCapbility* capbility) const {
+    return this->capbility(true, type, capbility);
 }
 
-std::string rcstr(AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_ENUM rc) {
-    switch (rc) {
-    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_CONSTANT_QP:
-        return "CQP";
-    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_CBR:
-        return "CBR";
-    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_HIGH_QUALITY_CBR:
-        return "HighQualityCBR";
-    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_PEAK_CONSTRAINED_VBR:
-        return "PeakConstrainedVBR";
-    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_LATENCY_CONSTRAINED_VBR:
-        return "LatencyConstrainedVBR";
-    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_QUALITY_VBR:
-        return "QualityVBR";
-    case AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_HIGH_QUALITY_VBR:
-        return "HighQualityVBR";
-    default:
-        return "UNKNOWN";
-    }
-}
-
-std::string rcstr_hevc(AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_ENUM rc) {
-    switch (rc) {
-    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_CONSTANT_QP:
-        return "CQP";
-    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_CBR:
-        return "CBR";
-    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_HIGH_QUALITY_CBR:
-        return "HighQualityCBR";
-    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_PEAK_CONSTRAINED_VBR:
-        return "PeakConstrainedVBR";
-    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_LATENCY_CONSTRAINED_VBR:
-        return "LatencyConstrainedVBR";
-    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_QUALITY_VBR:
-        return "QualityVBR";
-    case AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_HIGH_QUALITY_VBR:
-        return "HighQualityVBR";
-    default:
-        return "UNKNOWN";
-    }
-}
-
-std::string rcstr_av1(AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_ENUM rc) {
-    switch (rc) {
-    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_CONSTANT_QP:
-        return "CQP";
-    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_CBR:
-        return "CBR";
-    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_HIGH_QUALITY_CBR:
-        return "HighQualityCBR";
-    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_PEAK_CONSTRAINED_VBR:
-        return "PeakConstrainedVBR";
-    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_LATENCY_CONSTRAINED_VBR:
-        return "LatencyConstrainedVBR";
-    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_QUALITY_VBR:
-        return "QualityVBR";
-    case AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_HIGH_QUALITY_VBR:
-        return "HighQualityVBR";
-    default:
-        return "UNKNOWN";
+std::shared_future<bool> AmfModule::encoderProbed(amf_codec_type type) const {
+    if (!probe_) {
+        std::promise<bool> unsupported;
+        unsupported.set_value(false);
+        return unsupported.get_future().share();
     }
+    return probe_->probed(CapabilityProbe::Kind::ENCODER, type);
 }
 
-std::string formatstr(amf::AMF_SURFACE_FORMAT format) {
-    switch (format) {
-    case AMF_SURFACE_FORMAT::AMF_SURFACE_RGBA:
-        return "RGBA";
-    case AMF_SURFACE_FORMAT::AMF_SURFACE_ARGB:
-        return "ARGB";
-    case AMF_SURFACE_FORMAT::AMF_SURFACE_BGRA:
-        return "BGRA";
-    case AMF_SURFACE_FORMAT::AMF_SURFACE_NV12:
-        return "NV12";
-    case AMF_SURFACE_FORMAT::AMF_SURFACE_P010:
-        return "P010";
-    case AMF_SURFACE_FORMAT::AMF_SURFACE_YUV420P:
-        return "YUV420P";
-    case AMF_SURFACE_FORMAT::AMF_SURFACE_UNKNOWN:
-        return "UNKNOWN";
-    default:
-        return std::to_string((uint16_t)format);
+std::shared_future<bool> AmfModule::decoderProbed(amf_codec_type type) const {
+    if (!probe_) {
+        std::promise<bool> unsupported;
+        unsupported.set_value(false);
+        return unsupported.get_future().share();
     }
-}
-
-void AmfContext::reset() {
-    width = 0;
-    height = 0;
-    frame_rate = 0;
-    throughput = 0;
-    max_throughput = 0;
-    requested_throughput = 0;
-    codec = amf_codec_type::AVC;
-    format = AMF_SURFACE_FORMAT::AMF_SURFACE_UNKNOWN;
-    rc = AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_ENUM::AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_CBR;
-    target_bitrate = 0;
-    encoded_count = 0;
-}
-
-std::string AmfContext::to_str() {
-    char buffer[1024] = {0};
-    std::string rc_str;
-    switch (codec) {
-    case amf_codec_type::AVC:
-        rc_str = rcstr(static_cast<AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_ENUM>(rc));
-        break;
-    case amf_codec_type::HEVC:
-        rc_str = rcstr_hevc(static_cast<AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_ENUM>(rc));
-        break;
-    case amf_codec_type::AV1:
-        rc_str = rcstr_av1(static_cast<AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_ENUM>(rc));
-        break;
-    default:
-        rc_str = "UNKNOWN";
-        break;
-    }
-    std::string scenario_str;
-    switch (scenario) {
-    case Scenario::NORMAL:
-        scenario_str = "Normal";
-        break;
-    case Scenario::SCREEN_SHARED_DOCUMENT:
-        scenario_str = "Doc";
-        break;
-    default:
-        scenario_str = "Normal";
-        break;
-    }
-    snprintf(buffer, sizeof(buffer) - 1,
-             "%u X %u, %" AMFPRId64 "FPS,%" AMFPRId64 " %" AMFPRId64 " %" AMFPRId64
-             ", %s, %s, %s, %s, qp:%u,%u",
-             width, height, frame_rate, throughput, max_throughput, requested_throughput,
-             codecstr(codec).c_str(), rc_str.c_str(), formatstr(format).c_str(),
-             scenario_str.c_str(), min_qp, max_qp);
-    return buffer;
+    return probe_->probed(CapabilityProbe::Kind::DECODER, type);
 }
 
 inline char getLowByte(amf_uint16 data) {
@@ -1039,115 +1387,6 @@ bool H265ExtraDataBuilder::GetExtradata(AMFByteArray& extradata) {
     data += m_PPSs.GetSize();
     return true;
 }
-
-void AmfEncoderDebuger::addInput(uint32_t target_fps, int64_t at_time) {
-    target_fps_.emplace(at_time, target_fps);
-    input_fps_.emplace(at_time, 1);
-    if (at_time - target_fps_.begin()->first >= window_length_ms_ * 1000) {
-        auto iter = target_fps_.lower_bound(at_time - window_length_ms_ * 1000 / 2);
-        target_fps_.erase(target_fps_.begin(), iter);
-    }
-    if (at_time - input_fps_.begin()->first >= window_length_ms_ * 1000) {
-        auto iter = input_fps_.lower_bound(at_time - window_length_ms_ * 1000 / 2);
-        input_fps_.erase(input_fps_.begin(), iter);
-    }
-}
-
-void AmfEncoderDebuger::addOuput(size_t size, uint32_t qp, uint32_t target_bitrate,
-                                 int64_t at_time) {
-    OutputFrame frame;
-    frame.size = size;
-    frame.qp = qp;
-    output_frames_.emplace(at_time, frame);
-    if (at_time - output_frames_.begin()->first >= window_length_ms_ * 1000) {
-        auto iter = output_frames_.lower_bound(at_time - window_length_ms_ * 1000 / 2);
-        output_frames_.erase(output_frames_.begin(), iter);
-    }
-    target_bitrate_.emplace(at_time, target_bitrate);
-    if (at_time - target_bitrate_.begin()->first >= window_length_ms_ * 1000) {
-        auto iter = target_bitrate_.lower_bound(at_time - window_length_ms_ * 1000 / 2);
-        target_bitrate_.erase(target_bitrate_.begin(), iter);
-    }
-}
-
-bool AmfEncoderDebuger::stat(std::vector<Statistics>& outputs, int64_t at_time,
-                             int64_t interval_ms) {
-    if (output_frames_.empty() || at_time - last_stat_time_ <= interval_ms * 1000) {
-        return false;
-    }
-    last_stat_time_ = at_time - interval_ms * 1000;
-
-    while (last_stat_time_ < at_time) {
-        Statistics output;
-        auto start_time = last_stat_time_;
-        auto end_time = start_time + 1000 * 1000;
-
-        auto iter1 = target_fps_.lower_bound(start_time);
-        auto iter2 = target_fps_.upper_bound(end_time);
-        size_t count = std::distance(iter1, iter2);
-        if (count == 0) {
-            last_stat_time_ = end_time;
-            continue;
-        }
-        std::for_each(iter1, iter2, [&output](const std::pair<int64_t, int>& iter) {
-            output.target_fps += iter.second;
-        });
-        output.target_fps = static_cast<uint32_t>(output.target_fps * 1.0f / count + 0.5);
-
-        iter1 = input_fps_.lower_bound(start_time);
-        iter2 = input_fps_.upper_bound(end_time);
-        std::for_each(iter1, iter2, [&output](const std::pair<int64_t, int>& iter) {
-            output.input_fps += iter.second;
-        });
-
-        iter1 = target_bitrate_.lower_bound(start_time);
-        iter2 = target_bitrate_.upper_bound(end_time);
-        count = std::distance(iter1, iter2);
-        if (count > 0) {
-            std::for_each(iter1, iter2, [&output](const std::pair<int64_t, int>& iter) {
-                output.target_bitrate += iter.second;
-            });
-            output.target_bitrate =
-                static_cast<uint32_t>(output.target_bitrate * 1.0f / count + 0.5);
-        }
-        {
-            auto iter1 = output_frames_.lower_bound(start_time);
-            auto iter2 = output_frames_.upper_bound(end_time);
-            std::for_each(iter1, iter2, [&output](const std::pair<int64_t, OutputFrame>& iter) {
-                output.frame_size.add(iter.second.size);
-                output.qp.add(iter.second.qp);
-            });
-            size_t count = std::distance(iter1, iter2);
-            if (count > 0) {
-                output.output_bitrate =
-                    static_cast<uint32_t>(output.frame_size.average * 8.0f + 0.5);
-            }
-            output.frame_size.update();
-            output.qp.update();
-        }
-        last_stat_time_ = end_time;
-        outputs.push_back(output);
-    }
-    last_stat_time_ = std::min(at_time, last_stat_time_);
-    return true;
-}
-
-std::string AmfEncoderDebuger::Statistics::to_str() {
-    /*
-      uint32_t target_fps = 0;
-      uint32_t input_fps = 0;
-      uint32_t target_bitrate = 0;
-      uint32_t output_bitrate = 0;
-      DebugValue<size_t> frame_size;
-      DebugValue<uint32_t> qp;
-    */
-    char buffer[1024] = {0};
-    snprintf(buffer, sizeof(buffer), "{%u|%u, %u|%ukbps, %uByte, %u|%u}", target_fps, input_fps,
-             static_cast<uint32_t>(target_bitrate / 1000.f + 0.5),
-             static_cast<uint32_t>(output_bitrate / 1000.f + 0.5), (uint32_t)frame_size.medium,
-             qp.medium, qp.max);
-    return buffer;
-}
 } // namespace amf
 
 #pragma warning(pop)
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <future>
 #include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
@@ -15,7 +19,9 @@
 #include "components/VideoEncoderVCE.h"
 #include "core/Factory.h"
 
-#include "nv12_convert.h"
+#include "color_space.h"
+#include "p2_quantile.h"
+#include "sample_ring.h"
 
 #define AMD_VENDOR_ID 0x1002
 
@@ -52,38 +58,36 @@ struct AmfCodecCapbility {
     uint32_t max_profile = 0;
     uint32_t max_temporal_layers = 0;
     uint32_t max_streams = 1;
+    // Hardware instances, they all report the same caps
+    uint32_t instances = 1;
     bool b_frame_support = false;
     int32_t vertical_align = 0;
     std::set<amf::AMF_SURFACE_FORMAT> input_formats;
 };
 
-class NV12Convertor {
-public:
-    ~NV12Convertor();
-
-    bool init(Microsoft::WRL::ComPtr<ID3D11Device> d3d11_device, uint32_t width, uint32_t height);
-
-    bool convert(Microsoft::WRL::ComPtr<ID3D11Texture2D> input,
-                 Microsoft::WRL::ComPtr<ID3D11Texture2D>& output);
-
-private:
-    void uninit();
-
-private:
-    std::unique_ptr<D3D11VideoProcessorConvert> convert_;
-};
-
 void log(int level, const char* file, int line, const char* format, ...);
+// Blocks until the lines logged so far are in the file
+void log_flush();
+// Directory of the executable, with a trailing separator
+const std::string& module_directory();
 
 class AmfModuleWrapper;
+class CapabilityProbe;
+class TraceBridge;
+// The runtime is loaded synchronously, the codec caps are probed in the background afterwards.
+// Every capability query only waits for the codec it asks about. The caps come from
+// CapabilityCache instead when it holds them for this driver and runtime.
 class AmfModule {
     friend class AmfModuleWrapper;
 
 public:
+    AmfModule();
+    ~AmfModule();
+
     amf::AMFFactory* factory = nullptr;
     amf::AMFTrace* amf_trace = nullptr;
     amf::AMFDebug* amf_debug = nullptr;
-    HMODULE amf_module = nullptr;
+    amf_handle amf_module = nullptr;
     uint64_t amf_version = 0;
 
 public:
@@ -97,21 +101,48 @@ public:
 
     bool isEncoderFormatSupport(amf_codec_type type, amf::AMF_SURFACE_FORMAT format) const;
 
+    // False when the encoder of `type` was not found
+    bool encoderCapbility(amf_codec_type type, AmfCodecCapbility* capbility) const;
+
+    // Ready once the codec is probed, true when it is supported. Never blocks.
+    std::shared_future<bool> encoderProbed(amf_codec_type type) const;
+    std::shared_future<bool> decoderProbed(amf_codec_type type) const;
+
 private:
     bool init();
     bool doInit();
     void uninit();
     void doUninit();
 
-    void QueryEncoderForCodecAVC(amf::AMFContextPtr context);
-    void QueryEncoderForCodecHEVC(amf::AMFContextPtr context);
-    void QueryEncoderForCodecAV1(amf::AMFContextPtr context);
+    // Runs on a probe task, structured exceptions of the runtime count as not supported
+    bool probeCodec(bool encoder, amf_codec_type type, const std::atomic<bool>& cancelled,
+                    AmfCodecCapbility* capbility);
+    bool doProbeCodec(bool encoder, amf_codec_type type, const std::atomic<bool>& cancelled,
+                      AmfCodecCapbility* capbility);
+    // Shared by the probe tasks, created by the first one
+    amf::AMFContextPtr probeContext();
+
+    bool QueryEncoderForCodecAVC(amf::AMFContextPtr context, AmfCodecCapbility* capbility);
+    bool QueryEncoderForCodecHEVC(amf::AMFContextPtr context, AmfCodecCapbility* capbility);
+    bool QueryEncoderForCodecAV1(amf::AMFContextPtr context, AmfCodecCapbility* capbility);
 
-    void QueryDecoderForCodec(amf_codec_type codec, amf::AMFContextPtr context);
+    bool QueryDecoderForCodec(amf_codec_type codec, amf::AMFContextPtr context,
+                              AmfCodecCapbility* capbility);
+
+    bool capbility(bool encoder, amf_codec_type type, AmfCodecCapbility* capbility) const;
+    bool isSupport(bool encoder, amf_codec_type type, uint32_t width, uint32_t height) const;
 
 private:
-    std::map<amf_codec_type, AmfCodecCapbility> encoder_capbilities_;
-    std::map<amf_codec_type, AmfCodecCapbility> decoder_capbilities_;
+    // Runtime trace into amf::log, registered with amf_trace
+    std::unique_ptr<TraceBridge> trace_bridge_;
+    std::unique_ptr<CapabilityProbe> probe_;
+    // Probes again in the background when the cache is old, only the file is updated
+    std::unique_ptr<CapabilityProbe> revalidation_;
+    // Writes the cache once probe_ or revalidation_ is done
+    std::future<void> cache_task_;
+    std::atomic<uint32_t> probes_left_{0};
+    std::once_flag probe_context_once_;
+    amf::AMFContextPtr probe_context_;
 };
 
 class AmfModuleWrapper {
@@ -143,8 +174,10 @@ template <typename T>
 inline bool set_amf_property(amf::AMFComponentPtr enc, const wchar_t* name, const T& value) {
     AMF_RESULT res = enc->SetProperty(name, value);
     if (res != AMF_OK) {
+        // The software backend runs without the runtime
+        auto module = AmfModuleWrapper::instance();
         log(3, __FUNCTION__, __LINE__, "Failed to set property '%ls': %ls", name,
-            AmfModuleWrapper::instance()->amf_trace->GetResultText(res));
+            module && module->amf_trace ? module->amf_trace->GetResultText(res) : L"");
         return false;
     }
     return true;
@@ -171,6 +204,22 @@ static AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_ENUM get_amf_av1_rc(uint32_t va
     return static_cast<AMF_VIDEO_ENCODER_AV1_RATE_CONTROL_METHOD_ENUM>(value);
 }
 
+// Matrix and range signalled in the VUI, the converters produce the same from `color`
+inline AMF_VIDEO_CONVERTER_COLOR_PROFILE_ENUM get_amf_color_profile(const ColorSpace& color) {
+    const bool full = color.range == ColorRange::FULL;
+    switch (color.matrix) {
+    case ColorMatrix::BT601:
+        return full ? AMF_VIDEO_CONVERTER_COLOR_PROFILE_FULL_601
+                    : AMF_VIDEO_CONVERTER_COLOR_PROFILE_601;
+    case ColorMatrix::BT2020:
+        return full ? AMF_VIDEO_CONVERTER_COLOR_PROFILE_FULL_2020
+                    : AMF_VIDEO_CONVERTER_COLOR_PROFILE_2020;
+    default:
+        return full ? AMF_VIDEO_CONVERTER_COLOR_PROFILE_FULL_709
+                    : AMF_VIDEO_CONVERTER_COLOR_PROFILE_709;
+    }
+}
+
 inline const wchar_t* get_amf_output_type(amf_codec_type type) {
     switch (type) {
     case amf::amf_codec_type::AVC:
@@ -190,9 +239,12 @@ struct AmfContext {
     enum class Scenario : uint8_t {
         NORMAL = 0,
         SCREEN_SHARED_DOCUMENT = 1,
+        // Video playing inside a shared desktop
+        SCREEN_SHARED_MIXED = 2,
     };
     void reset();
     std::string to_str();
+    static const char* scenarioStr(Scenario scenario);
 
     uint32_t width = 0;
     uint32_t height = 0;
@@ -208,6 +260,9 @@ struct AmfContext {
     uint32_t target_fps = 0;
     uint64_t current_bitrate = 0;
     uint64_t target_bitrate = 0;
+    // Requests averaged over time, what the encoder actually follows. Advanced on every frame.
+    uint64_t smoothed_bitrate = 0;
+    int64_t last_bitrate_smoothed_time = 0;
     uint64_t encoded_count = 0;
     int64_t last_target_fps_changed_time = 0;
     int64_t last_target_bitrate_changed_time = 0;
@@ -386,41 +441,48 @@ private:
 
 class AmfEncoderDebuger {
     struct OutputFrame {
-        size_t size = 0;
-        int qp = 0;
+        uint32_t size = 0;
+        uint32_t qp = 0;
+        uint32_t target_bitrate = 0;
+        uint32_t upload_us = 0;
+        uint32_t encode_us = 0;
+        bool timed = false;
     };
 
 public:
     AmfEncoderDebuger(uint32_t window_length_second = 30)
-        : window_length_ms_(window_length_second * 1000) {
+        : window_length_ms_(window_length_second * 1000)
+        , inputs_(window_length_ms_ * 1000)
+        , outputs_(window_length_ms_ * 1000) {
         ;
     }
-#pragma warning(push)
-#pragma warning(disable : 4267)
+    // Percentiles are streamed through amf::QuantileSketch, exact up to five samples
     template <typename T> struct DebugValue {
         void add(T v) {
-            values_.push_back(v);
+            sketch_.add(static_cast<double>(v));
             average += v;
             min = std::min<T>(min, v);
             max = std::max<T>(max, v);
         }
         void update() {
-            if (values_.size() > 0) {
-                average = average / values_.size();
-                std::sort(values_.begin(), values_.end());
-                medium = values_[values_.size() / 2];
+            if (sketch_.count() > 0) {
+                average = static_cast<T>(average / sketch_.count());
+                medium = static_cast<T>(sketch_.p50() + 0.5);
+                p90 = static_cast<T>(sketch_.p90() + 0.5);
+                p99 = static_cast<T>(sketch_.p99() + 0.5);
             }
         }
 
         T min = std::numeric_limits<T>::max();
         T medium = 0;
+        T p90 = 0;
+        T p99 = 0;
         T average = 0;
         T max = std::numeric_limits<T>::min();
 
     private:
-        std::vector<T> values_;
+        QuantileSketch sketch_;
     };
-#pragma warning(pop)
     struct Statistics {
         uint32_t target_fps = 0;
         uint32_t input_fps = 0;
@@ -428,22 +490,27 @@ public:
         uint32_t output_bitrate = 0;
         DebugValue<size_t> frame_size;
         DebugValue<uint32_t> qp;
+        // Microseconds from capture to submit, and from submit to the packet
+        DebugValue<uint32_t> upload_latency;
+        DebugValue<uint32_t> encode_latency;
 
         std::string to_str();
+        // p50/p90/p99/max of the frame size, QP and latencies, p50 to p99 are estimates
+        std::string percentiles_str();
     };
 
     void addInput(uint32_t target_fps, int64_t at_time);
-    void addOuput(size_t size, uint32_t qp, uint32_t target_bitrate, int64_t at_time);
+    // The latencies of a packet without the times of its frame are not sampled
+    void addOuput(size_t size, uint32_t qp, uint32_t target_bitrate, int64_t at_time, bool timed,
+                  uint32_t upload_us, uint32_t encode_us);
     bool stat(std::vector<Statistics>& output, int64_t at_time, int64_t interval_ms);
 
 private:
     int64_t window_length_ms_ = 0;
     int64_t last_stat_time_ = 0;
 
-    std::map<int64_t /*at_time*/, int> target_fps_;
-    std::map<int64_t /*at_time*/, int> input_fps_;
-
-    std::map<int64_t /*at_time*/, int> target_bitrate_;
-    std::map<int64_t /*at_time*/, OutputFrame> output_frames_;
+    // Target frame rate at every input frame, the input frame rate is their count
+    SampleRing<uint32_t> inputs_;
+    SampleRing<OutputFrame> outputs_;
 };
 } // namespace amf
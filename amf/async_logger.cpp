@@ -0,0 +1,229 @@
+#include "async_logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace amf {
+
+static std::atomic<uint64_t> next_logger_id{1};
+
+struct AsyncLogger::Ring {
+    explicit Ring(size_t bytes)
+        : data(bytes) {}
+
+    // Power of two
+    std::vector<char> data;
+    // Bytes ever read and written, only the flusher moves head and only the owner moves tail
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+    // The owning thread exited, the flusher removes the ring once it is drained
+    std::atomic<bool> retired{false};
+
+    void copyIn(uint64_t position, const void* src, size_t size) {
+        const size_t offset = static_cast<size_t>(position & (data.size() - 1));
+        const size_t first = std::min(size, data.size() - offset);
+        std::memcpy(data.data() + offset, src, first);
+        std::memcpy(data.data(), static_cast<const char*>(src) + first, size - first);
+    }
+
+    void copyOut(uint64_t position, void* dst, size_t size) const {
+        const size_t offset = static_cast<size_t>(position & (data.size() - 1));
+        const size_t first = std::min(size, data.size() - offset);
+        std::memcpy(dst, data.data() + offset, first);
+        std::memcpy(static_cast<char*>(dst) + first, data.data(), size - first);
+    }
+};
+
+struct AsyncLogger::ThreadRing {
+    uint64_t owner = 0;
+    std::shared_ptr<Ring> ring;
+
+    ~ThreadRing() {
+        if (ring) {
+            ring->retired = true;
+        }
+    }
+};
+
+AsyncLogger::AsyncLogger(const Options& options)
+    : options_(options)
+    , id_(next_logger_id++) {
+    out_.reserve(options_.ring_bytes);
+    flusher_ = std::thread(&AsyncLogger::flushLoop, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+    stop();
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+AsyncLogger::Ring* AsyncLogger::threadRing() {
+    thread_local ThreadRing local;
+    if (local.owner != id_) {
+        if (local.ring) {
+            local.ring->retired = true;
+        }
+        size_t capacity = 1024;
+        while (capacity < options_.ring_bytes) {
+            capacity <<= 1;
+        }
+        local.ring = std::make_shared<Ring>(capacity);
+        local.owner = id_;
+        std::lock_guard<std::mutex> lock(rings_mtx_);
+        rings_.push_back(local.ring);
+    }
+    return local.ring.get();
+}
+
+bool AsyncLogger::write(const char* line, size_t size) {
+    if (stopped_) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        writeFile(line, size);
+        if (file_) {
+            std::fflush(file_);
+        }
+        return true;
+    }
+    Ring* ring = threadRing();
+    const uint32_t length = static_cast<uint32_t>(size);
+    const uint64_t capacity = ring->data.size();
+    const uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    const uint64_t used = tail - ring->head.load(std::memory_order_acquire);
+    if (sizeof(length) + size > capacity - used) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    ring->copyIn(tail, &length, sizeof(length));
+    ring->copyIn(tail + sizeof(length), line, size);
+    ring->tail.store(tail + sizeof(length) + size, std::memory_order_release);
+    // stop() may have drained the rings between the check above and the store, the line would
+    // be left behind. Paired with the fence in stop()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (stopped_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        drain();
+        return true;
+    }
+    if (used + sizeof(length) + size > capacity / 2 && !wake_.exchange(true)) {
+        cv_.notify_one();
+    }
+    return true;
+}
+
+void AsyncLogger::flush() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (stop_) {
+        return;
+    }
+    const uint64_t target = ++flush_requests_;
+    cv_.notify_one();
+    flushed_cv_.wait(lock, [this, target]() { return flushed_ >= target || stop_; });
+}
+
+void AsyncLogger::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (stop_) {
+            return;
+        }
+        stop_ = true;
+    }
+    cv_.notify_one();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    // Later lines take the synchronous path, which waits for this drain on mtx_
+    stopped_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    drain();
+    flushed_cv_.notify_all();
+}
+
+void AsyncLogger::flushLoop() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (!stop_) {
+        cv_.wait_for(lock, std::chrono::milliseconds(options_.flush_interval_ms),
+                     [this]() { return stop_ || wake_ || flush_requests_ > flushed_; });
+        wake_ = false;
+        const uint64_t requests = flush_requests_;
+        lock.unlock();
+        drain();
+        lock.lock();
+        flushed_ = requests;
+        flushed_cv_.notify_all();
+    }
+}
+
+void AsyncLogger::drain() {
+    out_.clear();
+    {
+        std::lock_guard<std::mutex> lock(rings_mtx_);
+        for (auto iter = rings_.begin(); iter != rings_.end();) {
+            Ring* ring = iter->get();
+            // Read before the tail, the last lines of an exiting thread are not left behind
+            const bool retired = ring->retired;
+            uint64_t head = ring->head.load(std::memory_order_relaxed);
+            const uint64_t tail = ring->tail.load(std::memory_order_acquire);
+            while (head != tail) {
+                uint32_t length = 0;
+                ring->copyOut(head, &length, sizeof(length));
+                const size_t offset = out_.size();
+                out_.resize(offset + length);
+                ring->copyOut(head + sizeof(length), out_.data() + offset, length);
+                head += sizeof(length) + length;
+            }
+            ring->head.store(head, std::memory_order_release);
+            const uint64_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped > 0) {
+                dropped_total_ += dropped;
+                char note[64] = {0};
+                const int size = snprintf(note, sizeof(note), "[WARNING] %llu log lines dropped\n",
+                                          static_cast<unsigned long long>(dropped));
+                out_.insert(out_.end(), note, note + std::min<int>(size, sizeof(note) - 1));
+            }
+            iter = retired ? rings_.erase(iter) : iter + 1;
+        }
+    }
+    if (!out_.empty()) {
+        writeFile(out_.data(), out_.size());
+        if (file_) {
+            std::fflush(file_);
+        }
+    }
+}
+
+void AsyncLogger::openFile() {
+    // Text mode like the synchronous logger was, lines end with \n
+    file_ = std::fopen(options_.path.c_str(), "a");
+    if (file_) {
+        std::fseek(file_, 0, SEEK_END);
+        file_bytes_ = static_cast<uint64_t>(std::max<long>(std::ftell(file_), 0));
+    }
+}
+
+void AsyncLogger::writeFile(const char* data, size_t size) {
+    if (!file_) {
+        openFile();
+    }
+    if (!file_) {
+        return;
+    }
+    std::fwrite(data, 1, size, file_);
+    file_bytes_ += size;
+    if (options_.max_file_bytes > 0 && file_bytes_ >= options_.max_file_bytes) {
+        std::fclose(file_);
+        file_ = nullptr;
+        const std::string rotated = options_.path + ".1";
+        std::remove(rotated.c_str());
+        std::rename(options_.path.c_str(), rotated.c_str());
+        openFile();
+    }
+}
+
+} // namespace amf
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace amf {
+
+// Log file written by a background thread.
+// Every writing thread has its own single producer ring, write() copies the line into it without
+// taking a lock or making a system call. The flusher drains the rings every `flush_interval_ms`,
+// or earlier once a ring is half full, and appends them to the file in one buffered write. A line
+// that does not fit in the ring of its thread is dropped rather than waited for, the number of
+// dropped lines is written to the file in its place.
+class AsyncLogger {
+public:
+    struct Options {
+        std::string path;
+        // Per writing thread
+        uint32_t ring_bytes = 64 * 1024;
+        // The file moves to <path>.1 beyond this size, 0 never rotates
+        uint64_t max_file_bytes = 16 * 1024 * 1024;
+        uint32_t flush_interval_ms = 50;
+    };
+
+    explicit AsyncLogger(const Options& options);
+    // stop()
+    ~AsyncLogger();
+
+    // Never blocks, false when the line was dropped
+    bool write(const char* line, size_t size);
+
+    // Blocks until the lines written so far are in the file
+    void flush();
+
+    // Writes what is left and joins the flusher, later lines are written synchronously
+    void stop();
+
+    // Dropped lines the flusher came across so far
+    uint64_t dropped() const { return dropped_total_; }
+
+private:
+    struct Ring;
+    struct ThreadRing;
+
+    Ring* threadRing();
+    void flushLoop();
+    // Appends every ring to the file, only called on the flusher or under mtx_ after it stopped
+    void drain();
+    void writeFile(const char* data, size_t size);
+    void openFile();
+
+private:
+    const Options options_;
+    // Identifies the logger to the rings cached by the threads, addresses can be reused
+    const uint64_t id_;
+
+    std::mutex rings_mtx_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::condition_variable flushed_cv_;
+    uint64_t flush_requests_ = 0;
+    uint64_t flushed_ = 0;
+    bool stop_ = false;
+    std::atomic<bool> wake_{false};
+    std::atomic<bool> stopped_{false};
+    std::atomic<uint64_t> dropped_total_{0};
+
+    // Flusher thread only, or under mtx_ once stopped
+    std::FILE* file_ = nullptr;
+    uint64_t file_bytes_ = 0;
+    std::vector<char> out_;
+
+    std::thread flusher_;
+};
+
+} // namespace amf
@@ -0,0 +1,249 @@
+#include "capability_cache.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+namespace amf {
+
+#define LOG_DEBUG(...) amf::log(0, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_INFO(...) amf::log(1, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_WARN(...) amf::log(2, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_ERROR(...) amf::log(3, __FILE__, __LINE__, __VA_ARGS__)
+
+// "AMFC"
+static constexpr uint32_t kCacheMagic = 0x43464d41;
+// Bumped with every change of the layout below
+static constexpr uint32_t kCacheFormatVersion = 1;
+// Far more than the codecs there are, a larger count is a corrupt file
+static constexpr uint32_t kMaxEntries = 64;
+static constexpr uint32_t kMaxFormats = 256;
+
+static uint32_t fnv1a(const uint8_t* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+class CacheWriter {
+public:
+    explicit CacheWriter(std::vector<uint8_t>* out)
+        : out_(out) {}
+
+    template <typename T> void put(T value) {
+        const size_t offset = out_->size();
+        out_->resize(offset + sizeof(T));
+        std::memcpy(out_->data() + offset, &value, sizeof(T));
+    }
+
+private:
+    std::vector<uint8_t>* out_;
+};
+
+class CacheReader {
+public:
+    CacheReader(const uint8_t* data, size_t size)
+        : data_(data)
+        , size_(size) {}
+
+    template <typename T> bool get(T* value) {
+        if (size_ - offset_ < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(value, data_ + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return true;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t offset_ = 0;
+};
+
+bool CapabilityCache::Key::operator==(const Key& other) const {
+    return amf_version == other.amf_version && vendor_id == other.vendor_id &&
+           device_id == other.device_id && subsys_id == other.subsys_id &&
+           revision == other.revision && driver_version == other.driver_version;
+}
+
+bool CapabilityCache::Entry::operator==(const Entry& other) const {
+    const auto& a = capbility;
+    const auto& b = other.capbility;
+    return kind == other.kind && type == other.type && supported == other.supported &&
+           a.min_width == b.min_width && a.max_width == b.max_width &&
+           a.min_height == b.min_height && a.max_height == b.max_height &&
+           a.max_profile == b.max_profile && a.max_temporal_layers == b.max_temporal_layers &&
+           a.max_streams == b.max_streams && a.instances == b.instances &&
+           a.b_frame_support == b.b_frame_support && a.vertical_align == b.vertical_align &&
+           a.input_formats == b.input_formats;
+}
+
+std::vector<uint8_t> CapabilityCache::serialize(const Contents& contents) {
+    std::vector<uint8_t> out;
+    CacheWriter writer(&out);
+    writer.put(kCacheMagic);
+    writer.put(kCacheFormatVersion);
+    writer.put(contents.key.amf_version);
+    writer.put(contents.key.vendor_id);
+    writer.put(contents.key.device_id);
+    writer.put(contents.key.subsys_id);
+    writer.put(contents.key.revision);
+    writer.put(contents.key.driver_version);
+    writer.put(contents.written_at);
+    writer.put(static_cast<uint32_t>(contents.entries.size()));
+    for (auto& entry : contents.entries) {
+        const auto& caps = entry.capbility;
+        writer.put(static_cast<uint8_t>(entry.kind));
+        writer.put(static_cast<uint8_t>(entry.type));
+        writer.put(static_cast<uint8_t>(entry.supported));
+        writer.put(static_cast<uint8_t>(caps.b_frame_support));
+        writer.put(caps.min_width);
+        writer.put(caps.max_width);
+        writer.put(caps.min_height);
+        writer.put(caps.max_height);
+        writer.put(caps.max_profile);
+        writer.put(caps.max_temporal_layers);
+        writer.put(caps.max_streams);
+        writer.put(caps.instances);
+        writer.put(caps.vertical_align);
+        writer.put(static_cast<uint32_t>(caps.input_formats.size()));
+        for (auto format : caps.input_formats) {
+            writer.put(static_cast<int32_t>(format));
+        }
+    }
+    writer.put(fnv1a(out.data(), out.size()));
+    return out;
+}
+
+bool CapabilityCache::parse(const uint8_t* data, size_t size, Contents* contents) {
+    uint32_t checksum = 0;
+    if (size < sizeof(checksum)) {
+        return false;
+    }
+    std::memcpy(&checksum, data + size - sizeof(checksum), sizeof(checksum));
+    size -= sizeof(checksum);
+    if (fnv1a(data, size) != checksum) {
+        return false;
+    }
+    CacheReader reader(data, size);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if (!reader.get(&magic) || magic != kCacheMagic || !reader.get(&version) ||
+        version != kCacheFormatVersion) {
+        return false;
+    }
+    Key& key = contents->key;
+    uint32_t count = 0;
+    if (!reader.get(&key.amf_version) || !reader.get(&key.vendor_id) ||
+        !reader.get(&key.device_id) || !reader.get(&key.subsys_id) ||
+        !reader.get(&key.revision) || !reader.get(&key.driver_version) ||
+        !reader.get(&contents->written_at) || !reader.get(&count) || count > kMaxEntries) {
+        return false;
+    }
+    contents->entries.resize(count);
+    for (auto& entry : contents->entries) {
+        auto& caps = entry.capbility;
+        uint8_t kind = 0;
+        uint8_t type = 0;
+        uint8_t supported = 0;
+        uint8_t b_frame_support = 0;
+        uint32_t formats = 0;
+        if (!reader.get(&kind) || !reader.get(&type) || !reader.get(&supported) ||
+            !reader.get(&b_frame_support) || !reader.get(&caps.min_width) ||
+            !reader.get(&caps.max_width) || !reader.get(&caps.min_height) ||
+            !reader.get(&caps.max_height) || !reader.get(&caps.max_profile) ||
+            !reader.get(&caps.max_temporal_layers) || !reader.get(&caps.max_streams) ||
+            !reader.get(&caps.instances) || !reader.get(&caps.vertical_align) ||
+            !reader.get(&formats) || formats > kMaxFormats) {
+            return false;
+        }
+        entry.kind = static_cast<CapabilityProbe::Kind>(kind);
+        entry.type = static_cast<amf_codec_type>(type);
+        entry.supported = supported != 0;
+        caps.b_frame_support = b_frame_support != 0;
+        caps.input_formats.clear();
+        for (uint32_t i = 0; i < formats; i++) {
+            int32_t format = 0;
+            if (!reader.get(&format)) {
+                return false;
+            }
+            caps.input_formats.insert(static_cast<AMF_SURFACE_FORMAT>(format));
+        }
+    }
+    return true;
+}
+
+bool CapabilityCache::load(const std::string& path, const Key& key, Contents* contents) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buffer[4096];
+    size_t read = 0;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + read);
+    }
+    std::fclose(file);
+    if (!parse(data.data(), data.size(), contents)) {
+        LOG_WARN("Ignore corrupt capability cache %s", path.c_str());
+        return false;
+    }
+    if (contents->key != key) {
+        LOG_INFO("Capability cache %s belongs to another driver or runtime", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Readers see the old file or the new one, never none
+static bool replaceFile(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    auto wide = [](const std::string& path) {
+        const int size = MultiByteToWideChar(CP_ACP, 0, path.c_str(), -1, nullptr, 0);
+        std::wstring result(size > 0 ? size : 1, L'\0');
+        MultiByteToWideChar(CP_ACP, 0, path.c_str(), -1, &result[0], size);
+        return result;
+    };
+    return MoveFileExW(wide(from).c_str(), wide(to).c_str(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+bool CapabilityCache::save(const std::string& path, const Contents& contents) {
+    const auto data = serialize(contents);
+    // Unique per writer, processes probing at the same time do not share the temporary file
+    const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count() ^
+                       std::hash<std::thread::id>()(std::this_thread::get_id());
+    const std::string temp_path = path + "." + std::to_string(stamp) + ".tmp";
+    std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        LOG_WARN("Failed to create %s", temp_path.c_str());
+        return false;
+    }
+    const bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    if (std::fclose(file) != 0 || !written) {
+        std::remove(temp_path.c_str());
+        LOG_WARN("Failed to write %s", temp_path.c_str());
+        return false;
+    }
+    if (!replaceFile(temp_path, path)) {
+        std::remove(temp_path.c_str());
+        LOG_WARN("Failed to replace %s", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace amf
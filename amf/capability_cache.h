@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "capability_probe.h"
+
+namespace amf {
+
+// Codec caps of one adapter and runtime, kept on disk between processes.
+// The file is a small versioned binary with a checksum, it is only used when the runtime version
+// and the adapter identity it was written for match the current ones. Anything else, a missing,
+// truncated or foreign file included, is a miss and the caps are probed again.
+class CapabilityCache {
+public:
+    struct Key {
+        uint64_t amf_version = 0;
+        uint32_t vendor_id = 0;
+        uint32_t device_id = 0;
+        uint32_t subsys_id = 0;
+        uint32_t revision = 0;
+        // User mode driver version, it changes with every driver update
+        uint64_t driver_version = 0;
+
+        bool operator==(const Key& other) const;
+        bool operator!=(const Key& other) const { return !(*this == other); }
+    };
+
+    struct Entry {
+        CapabilityProbe::Kind kind = CapabilityProbe::Kind::ENCODER;
+        amf_codec_type type = amf_codec_type::AVC;
+        bool supported = false;
+        AmfCodecCapbility capbility;
+
+        bool operator==(const Entry& other) const;
+        bool operator!=(const Entry& other) const { return !(*this == other); }
+    };
+
+    struct Contents {
+        Key key;
+        // Seconds since epoch
+        int64_t written_at = 0;
+        std::vector<Entry> entries;
+    };
+
+    static std::vector<uint8_t> serialize(const Contents& contents);
+    // False on a bad magic, format version or checksum, or a truncated buffer
+    static bool parse(const uint8_t* data, size_t size, Contents* contents);
+
+    // False on a miss, `contents` is only valid when the key matches `key`
+    static bool load(const std::string& path, const Key& key, Contents* contents);
+    // Written to a temporary file first, readers in other processes never see half a file
+    static bool save(const std::string& path, const Contents& contents);
+};
+
+} // namespace amf
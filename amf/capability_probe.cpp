@@ -0,0 +1,82 @@
+#include "capability_probe.h"
+
+namespace amf {
+
+#define LOG_DEBUG(...) amf::log(0, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_INFO(...) amf::log(1, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_WARN(...) amf::log(2, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_ERROR(...) amf::log(3, __FILE__, __LINE__, __VA_ARGS__)
+
+CapabilityProbe::CapabilityProbe(ProbeFn probe)
+    : probe_(std::move(probe)) {}
+
+CapabilityProbe::~CapabilityProbe() {
+    cancel();
+    wait();
+}
+
+void CapabilityProbe::resolve(Kind kind, amf_codec_type type, bool supported,
+                              const AmfCodecCapbility& capbility) {
+    Slot& slot = slots_[Codec(kind, type)];
+    slot.capbility = capbility;
+    std::promise<bool> probed;
+    probed.set_value(supported);
+    slot.probed = probed.get_future().share();
+}
+
+void CapabilityProbe::start(const std::vector<Codec>& codecs) {
+    // Slots are all in place before the first task runs, the map is not modified afterwards
+    size_t started = 0;
+    for (auto& codec : codecs) {
+        slots_[codec];
+    }
+    for (auto& entry : slots_) {
+        Slot* slot = &entry.second;
+        const Codec codec = entry.first;
+        if (slot->probed.valid()) {
+            continue;
+        }
+        started++;
+        slot->probed = std::async(std::launch::async, [this, slot, codec]() {
+                           if (cancelled_) {
+                               return false;
+                           }
+                           return probe_(codec.first, codec.second, cancelled_, &slot->capbility);
+                       }).share();
+    }
+    LOG_INFO("Probing %zu codecs, %zu known", started, slots_.size() - started);
+}
+
+std::shared_future<bool> CapabilityProbe::probed(Kind kind, amf_codec_type type) const {
+    auto iter = slots_.find(Codec(kind, type));
+    if (iter == slots_.end()) {
+        std::promise<bool> unsupported;
+        unsupported.set_value(false);
+        return unsupported.get_future().share();
+    }
+    return iter->second.probed;
+}
+
+bool CapabilityProbe::capbility(Kind kind, amf_codec_type type,
+                                AmfCodecCapbility* capbility) const {
+    auto iter = slots_.find(Codec(kind, type));
+    if (iter == slots_.end() || !iter->second.probed.get()) {
+        return false;
+    }
+    *capbility = iter->second.capbility;
+    return true;
+}
+
+void CapabilityProbe::cancel() {
+    cancelled_ = true;
+}
+
+void CapabilityProbe::wait() const {
+    for (auto& entry : slots_) {
+        if (entry.second.probed.valid()) {
+            entry.second.probed.wait();
+        }
+    }
+}
+
+} // namespace amf
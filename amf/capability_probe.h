@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "amf_helper.h"
+
+namespace amf {
+
+// Queries the caps of several codecs concurrently, one task per codec.
+// Every codec has its own future, a caller only waits for the codec it needs while the others are
+// still being probed. Codecs that were never started report as not supported.
+class CapabilityProbe {
+public:
+    enum class Kind : uint8_t {
+        ENCODER = 0,
+        DECODER = 1,
+    };
+    using Codec = std::pair<Kind, amf_codec_type>;
+
+    // Fills `capbility`, false when the codec is not available. `cancelled` turns true once the
+    // probe is cancelled, long queries give up between their steps.
+    using ProbeFn = std::function<bool(Kind kind, amf_codec_type type,
+                                       const std::atomic<bool>& cancelled,
+                                       AmfCodecCapbility* capbility)>;
+
+    explicit CapabilityProbe(ProbeFn probe);
+    // Cancels and waits for the tasks still running
+    ~CapabilityProbe();
+
+    // Known beforehand, from CapabilityCache. Before start(), which does not probe it again.
+    void resolve(Kind kind, amf_codec_type type, bool supported,
+                 const AmfCodecCapbility& capbility);
+
+    // Once, after resolve() and before any other call
+    void start(const std::vector<Codec>& codecs);
+
+    // Ready once the codec is probed, true when it is supported
+    std::shared_future<bool> probed(Kind kind, amf_codec_type type) const;
+
+    // Blocks until the codec is probed
+    bool capbility(Kind kind, amf_codec_type type, AmfCodecCapbility* capbility) const;
+
+    // Tasks that did not query their codec yet report it as not supported
+    void cancel();
+    bool cancelled() const { return cancelled_; }
+
+    void wait() const;
+
+private:
+    struct Slot {
+        std::shared_future<bool> probed;
+        // Written by the task before `probed` is ready
+        AmfCodecCapbility capbility;
+    };
+
+    ProbeFn probe_;
+    std::atomic<bool> cancelled_{false};
+    std::map<Codec, Slot> slots_;
+};
+
+} // namespace amf
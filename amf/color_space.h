@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+
+namespace amf {
+
+enum class ColorMatrix : uint8_t {
+    BT601 = 0,
+    BT709 = 1,
+    BT2020 = 2,
+};
+
+enum class ColorRange : uint8_t {
+    // Y:16-235, UV:16-240
+    LIMITED = 0,
+    FULL = 1,
+};
+
+enum class ChromaSiting : uint8_t {
+    // Between the 4 luma samples, a 2x2 box filter
+    CENTER = 0,
+    // Co-sited with the left luma column (H.264/HEVC default), a [1 2 1] filter horizontally.
+    // The only siting AmfEncoder can encode, see AmfEncoder::OutputColorSpace
+    LEFT = 1,
+};
+
+// Byte order of a 32-bit source pixel
+enum class PixelOrder : uint8_t {
+    BGRA = 0,
+    RGBA = 1,
+};
+
+// What the encoder signals and what the converters have to produce
+struct ColorSpace {
+    ColorMatrix matrix = ColorMatrix::BT709;
+    ColorRange range = ColorRange::LIMITED;
+    ChromaSiting siting = ChromaSiting::CENTER;
+
+    bool operator==(const ColorSpace& other) const {
+        return matrix == other.matrix && range == other.range && siting == other.siting;
+    }
+    bool operator!=(const ColorSpace& other) const { return !(*this == other); }
+};
+
+inline const char* colorMatrixStr(ColorMatrix matrix) {
+    switch (matrix) {
+    case ColorMatrix::BT601:
+        return "BT.601";
+    case ColorMatrix::BT2020:
+        return "BT.2020";
+    default:
+        return "BT.709";
+    }
+}
+
+inline const char* colorRangeStr(ColorRange range) {
+    return range == ColorRange::FULL ? "full" : "limited";
+}
+
+// RGB -> YCbCr in Q15, for 8-bit samples.
+// Y = kYR R + kYG G + kYB B + kYOffset, chroma is centered on 128. The chroma rows sum to zero so
+// that gray maps exactly to 128, the luma row sums to exactly the range so that white is 235|255.
+template <ColorMatrix kMatrix, ColorRange kRange> struct YuvCoefficients {
+    static constexpr int kShift = 15;
+
+    static constexpr double kKr = kMatrix == ColorMatrix::BT601    ? 0.299
+                                  : kMatrix == ColorMatrix::BT2020 ? 0.2627
+                                                                   : 0.2126;
+    static constexpr double kKb = kMatrix == ColorMatrix::BT601    ? 0.114
+                                  : kMatrix == ColorMatrix::BT2020 ? 0.0593
+                                                                   : 0.0722;
+    static constexpr bool kFull = kRange == ColorRange::FULL;
+    static constexpr double kYScale = kFull ? 1.0 : 219.0 / 255.0;
+    static constexpr double kUVScale = kFull ? 1.0 : 224.0 / 255.0;
+
+    static constexpr int q15(double v) {
+        return v >= 0 ? static_cast<int>(v * (1 << kShift) + 0.5)
+                      : -static_cast<int>(-v * (1 << kShift) + 0.5);
+    }
+    // Full range 0.5 would be 16384, which lets pure blue|red round up to 256
+    static constexpr int kUVMax = kFull ? (1 << (kShift - 1)) - 1 : q15(0.5 * kUVScale);
+
+    static constexpr int kYR = q15(kKr * kYScale);
+    static constexpr int kYB = q15(kKb * kYScale);
+    static constexpr int kYG = q15(kYScale) - kYR - kYB;
+    static constexpr int kUB = kUVMax;
+    static constexpr int kUR = q15(-kKr / (2.0 * (1.0 - kKb)) * kUVScale);
+    static constexpr int kUG = -kUB - kUR;
+    static constexpr int kVR = kUVMax;
+    static constexpr int kVB = q15(-kKb / (2.0 * (1.0 - kKr)) * kUVScale);
+    static constexpr int kVG = -kVR - kVB;
+    static constexpr int kYOffset = kFull ? 0 : 16;
+
+    static_assert(kUR + kUG + kUB == 0 && kVR + kVG + kVB == 0, "Gray must map to 128");
+    // Every coefficient has to fit the 16-bit multiplies of the simd kernels
+    static_assert(kYG < 32768 && kUG > -32768 && kVG > -32768, "Coefficient out of range");
+};
+
+} // namespace amf
@@ -0,0 +1,189 @@
+#include "content_classifier.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace amf {
+
+static constexpr uint32_t kTileSize = 64;
+static constexpr uint32_t kBlockSize = 16;
+// Luma step between neighbours that counts as a glyph or UI edge
+static constexpr int kEdgeThreshold = 48;
+// Anti-aliased text stays within a few dozen levels, dominated by background and foreground.
+// Without any sharp edge such a block is a flat area or a smooth gradient, which says nothing.
+static constexpr uint32_t kScreenMaxLevels = 24;
+static constexpr uint32_t kScreenTop2Share = kBlockSize * kBlockSize / 2;
+
+static constexpr float kTextScreenRatio = 0.7f;
+// A small video in a corner of the desktop already counts
+static constexpr float kTextMaxNaturalMotion = 0.05f;
+static constexpr float kVideoScreenRatio = 0.3f;
+static constexpr float kVideoNaturalMotion = 0.5f;
+static constexpr float kVideoTemporalChange = 0.3f;
+static constexpr float kVideoEdgeDensity = 0.05f;
+
+struct BlockStats {
+    uint32_t levels = 0;
+    uint32_t top2 = 0;
+    uint32_t edges = 0;
+    uint64_t hash = 0;
+};
+
+static BlockStats analyzeBlock(const uint8_t* y, uint32_t pitch) {
+    uint16_t histogram[256];
+    memset(histogram, 0, sizeof(histogram));
+    BlockStats stats;
+    uint64_t h = 0;
+    for (uint32_t row = 0; row < kBlockSize; row++) {
+        const uint8_t* p = y + static_cast<size_t>(row) * pitch;
+        for (uint32_t x = 0; x < kBlockSize; x++) {
+            histogram[p[x]]++;
+            if (x > 0 && std::abs(p[x] - p[x - 1]) >= kEdgeThreshold) {
+                stats.edges++;
+            }
+        }
+        uint64_t v0 = 0;
+        uint64_t v1 = 0;
+        memcpy(&v0, p, 8);
+        memcpy(&v1, p + 8, 8);
+        h = (h ^ v0) * 0x9e3779b97f4a7c15ull;
+        h = (h ^ v1 ^ (h >> 29)) * 0x9e3779b97f4a7c15ull;
+    }
+    uint32_t first = 0;
+    uint32_t second = 0;
+    for (uint32_t i = 0; i < 256; i++) {
+        const uint32_t count = histogram[i];
+        if (count == 0) {
+            continue;
+        }
+        stats.levels++;
+        if (count > first) {
+            second = first;
+            first = count;
+        }
+        else if (count > second) {
+            second = count;
+        }
+    }
+    stats.top2 = first + second;
+    stats.hash = h;
+    return stats;
+}
+
+ContentClassifier::ContentClassifier(uint32_t confirm_samples)
+    : confirm_samples_(std::max(confirm_samples, 1u)) {}
+
+void ContentClassifier::reset() {
+    content_ = Content::UNKNOWN;
+    raw_ = Content::UNKNOWN;
+    candidate_ = Content::UNKNOWN;
+    candidate_count_ = 0;
+    features_ = Features();
+    block_hashes_.clear();
+}
+
+ContentClassifier::Content ContentClassifier::classify(const Features& features) const {
+    // Scrolling a document changes a lot, but only synthetic blocks
+    if (features.screen_ratio >= kTextScreenRatio &&
+        features.natural_motion < kTextMaxNaturalMotion) {
+        return Content::TEXT;
+    }
+    if (features.natural_motion >= kVideoNaturalMotion) {
+        return Content::VIDEO;
+    }
+    // Few synthetic blocks and either lots of motion or soft detail everywhere
+    if (features.screen_ratio <= kVideoScreenRatio &&
+        (features.temporal_change >= kVideoTemporalChange ||
+         features.edge_density < kVideoEdgeDensity)) {
+        return Content::VIDEO;
+    }
+    return Content::MIXED;
+}
+
+bool ContentClassifier::update(const uint8_t* y, uint32_t pitch, uint32_t width,
+                               uint32_t height) {
+    if (!y || width < kBlockSize || height < kBlockSize) {
+        return false;
+    }
+    const uint32_t tiles_x = std::max(width / kTileSize, 1u);
+    const uint32_t tiles_y = std::max(height / kTileSize, 1u);
+    const bool same_size = width == width_ && height == height_ &&
+                           block_hashes_.size() == static_cast<size_t>(tiles_x) * tiles_y;
+    if (!same_size) {
+        width_ = width;
+        height_ = height;
+        block_hashes_.assign(static_cast<size_t>(tiles_x) * tiles_y, 0);
+    }
+    uint32_t flat = 0;
+    uint32_t screen = 0;
+    uint32_t changed = 0;
+    uint32_t natural_changed = 0;
+    uint64_t edges = 0;
+    // Sample the middle of each tile, away from the tile grid the encoder also aligns to
+    const uint32_t inset = (std::min(kTileSize, std::min(width, height)) - kBlockSize) / 2;
+    for (uint32_t ty = 0; ty < tiles_y; ty++) {
+        for (uint32_t tx = 0; tx < tiles_x; tx++) {
+            const uint32_t left = std::min(tx * kTileSize + inset, width - kBlockSize);
+            const uint32_t top = std::min(ty * kTileSize + inset, height - kBlockSize);
+            auto stats = analyzeBlock(y + static_cast<size_t>(top) * pitch + left, pitch);
+            auto& hash = block_hashes_[static_cast<size_t>(ty) * tiles_x + tx];
+            const bool moved = same_size && hash != stats.hash;
+            hash = stats.hash;
+            changed += moved;
+            const bool few_levels = stats.levels <= kScreenMaxLevels;
+            if (stats.edges == 0 && few_levels) {
+                flat++;
+                natural_changed += moved;
+                continue;
+            }
+            edges += stats.edges;
+            if (stats.edges > 0 && (few_levels || stats.top2 >= kScreenTop2Share)) {
+                screen++;
+            }
+            else {
+                natural_changed += moved;
+            }
+        }
+    }
+    const uint32_t blocks = tiles_x * tiles_y;
+    const uint32_t busy = blocks - flat;
+    features_.flat_ratio = static_cast<float>(flat) / blocks;
+    features_.screen_ratio = busy ? static_cast<float>(screen) / busy : 1.f;
+    features_.edge_density =
+        busy ? static_cast<float>(edges) / (busy * kBlockSize * (kBlockSize - 1)) : 0.f;
+    features_.temporal_change = static_cast<float>(changed) / blocks;
+    features_.natural_motion = static_cast<float>(natural_changed) / blocks;
+
+    raw_ = classify(features_);
+    if (raw_ == content_) {
+        candidate_count_ = 0;
+        return false;
+    }
+    if (raw_ != candidate_) {
+        candidate_ = raw_;
+        candidate_count_ = 0;
+    }
+    // The first label is taken right away, later ones need to hold for a while
+    if (++candidate_count_ < confirm_samples_ && content_ != Content::UNKNOWN) {
+        return false;
+    }
+    content_ = raw_;
+    candidate_count_ = 0;
+    return true;
+}
+
+const char* ContentClassifier::contentStr(Content content) {
+    switch (content) {
+    case Content::TEXT:
+        return "Text";
+    case Content::VIDEO:
+        return "Video";
+    case Content::MIXED:
+        return "Mixed";
+    default:
+        return "Unknown";
+    }
+}
+
+} // namespace amf
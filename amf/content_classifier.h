@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace amf {
+
+// Labels screen content from a sparse sample of the luma plane.
+// One 16x16 block per 64x64 tile is looked at: how many distinct levels it has, how much of it
+// is covered by its two most common levels (text on a background) and how many sharp edges it
+// has. Blocks are also hashed to measure how much of the screen moves between samples.
+// The reported label only switches after the same raw label was seen several samples in a row.
+class ContentClassifier {
+public:
+    enum class Content : uint8_t {
+        UNKNOWN = 0,
+        // Text, documents, UI
+        TEXT = 1,
+        // Camera, movies, games
+        VIDEO = 2,
+        // Video playing inside a desktop
+        MIXED = 3,
+    };
+
+    struct Features {
+        // Share of the non flat blocks that look synthetic
+        float screen_ratio = 0.f;
+        // Sharp horizontal transitions per sampled pixel pair, non flat blocks only
+        float edge_density = 0.f;
+        // Share of the sampled blocks that changed since the previous sample
+        float temporal_change = 0.f;
+        // Same, counting only the blocks that do not look synthetic (a video playing)
+        float natural_motion = 0.f;
+        // Share of the sampled blocks that are flat or smooth gradients
+        float flat_ratio = 0.f;
+    };
+
+    explicit ContentClassifier(uint32_t confirm_samples = 3);
+
+    // Returns true when content() changed
+    bool update(const uint8_t* y, uint32_t pitch, uint32_t width, uint32_t height);
+
+    void reset();
+
+    Content content() const { return content_; }
+    // Label of the last sample, before hysteresis
+    Content rawContent() const { return raw_; }
+    const Features& features() const { return features_; }
+
+    static const char* contentStr(Content content);
+
+private:
+    Content classify(const Features& features) const;
+
+private:
+    const uint32_t confirm_samples_;
+
+    Content content_ = Content::UNKNOWN;
+    Content raw_ = Content::UNKNOWN;
+    Content candidate_ = Content::UNKNOWN;
+    uint32_t candidate_count_ = 0;
+    Features features_;
+
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    std::vector<uint64_t> block_hashes_;
+};
+
+} // namespace amf
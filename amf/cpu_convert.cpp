@@ -0,0 +1,539 @@
+#include "cpu_convert.h"
+
+#include <algorithm>
+
+#if defined(AMF_ARCH_X86)
+#include <immintrin.h>
+#elif defined(AMF_ARCH_ARM64)
+#include <arm_neon.h>
+#endif
+
+namespace amf {
+
+static constexpr int kShift = 15;
+
+// One conversion, resolved at compile time. Coefficients are indexed by byte position in the
+// source pixel, so the pixel order costs nothing in the kernels.
+template <ColorMatrix kMatrix, ColorRange kRange, ChromaSiting kSiting, PixelOrder kOrder>
+struct Format {
+    using C = YuvCoefficients<kMatrix, kRange>;
+    static_assert(C::kShift == kShift, "Kernels assume Q15");
+
+    static constexpr bool kBgra = kOrder == PixelOrder::BGRA;
+    static constexpr int kY0 = kBgra ? C::kYB : C::kYR;
+    static constexpr int kY1 = C::kYG;
+    static constexpr int kY2 = kBgra ? C::kYR : C::kYB;
+    static constexpr int kU0 = kBgra ? C::kUB : C::kUR;
+    static constexpr int kU1 = C::kUG;
+    static constexpr int kU2 = kBgra ? C::kUR : C::kUB;
+    static constexpr int kV0 = kBgra ? C::kVB : C::kVR;
+    static constexpr int kV1 = C::kVG;
+    static constexpr int kV2 = kBgra ? C::kVR : C::kVB;
+    static constexpr int kYOffset = (C::kYOffset << kShift) + (1 << (kShift - 1));
+
+    static constexpr bool kLeft = kSiting == ChromaSiting::LEFT;
+    // Chroma is computed from the sum of 4 pixels, 8 weights with the [1 2 1] x [1 1] filter
+    static constexpr int kUVShift = kShift + (kLeft ? 3 : 2);
+    static constexpr int kUVOffset = (128 << kUVShift) + (1 << (kUVShift - 1));
+};
+
+// Every simd kernel has to produce exactly the same bytes as these two.
+template <typename F> static uint32_t rowY_C(const uint8_t* bgra, uint8_t* y, uint32_t width) {
+    for (uint32_t x = 0; x < width; x++) {
+        const uint8_t* p = bgra + x * 4;
+        y[x] = static_cast<uint8_t>((F::kY0 * p[0] + F::kY1 * p[1] + F::kY2 * p[2] + F::kYOffset) >>
+                                    kShift);
+    }
+    return width;
+}
+
+template <typename F>
+static uint32_t rowUV_C(const uint8_t* bgra0, const uint8_t* bgra1, uint8_t* uv, uint32_t begin,
+                        uint32_t width) {
+    for (uint32_t x = begin; x < width; x += 2) {
+        const uint32_t x0 = x * 4;
+        const uint32_t x1 = std::min(x + 1, width - 1) * 4;
+        int s0 = bgra0[x0 + 0] + bgra0[x1 + 0] + bgra1[x0 + 0] + bgra1[x1 + 0];
+        int s1 = bgra0[x0 + 1] + bgra0[x1 + 1] + bgra1[x0 + 1] + bgra1[x1 + 1];
+        int s2 = bgra0[x0 + 2] + bgra0[x1 + 2] + bgra1[x0 + 2] + bgra1[x1 + 2];
+        if (F::kLeft) {
+            const uint32_t xl = (x > 0 ? x - 1 : 0) * 4;
+            s0 += bgra0[xl + 0] + bgra0[x0 + 0] + bgra1[xl + 0] + bgra1[x0 + 0];
+            s1 += bgra0[xl + 1] + bgra0[x0 + 1] + bgra1[xl + 1] + bgra1[x0 + 1];
+            s2 += bgra0[xl + 2] + bgra0[x0 + 2] + bgra1[xl + 2] + bgra1[x0 + 2];
+        }
+        uv[x] = static_cast<uint8_t>(
+            (F::kU0 * s0 + F::kU1 * s1 + F::kU2 * s2 + F::kUVOffset) >> F::kUVShift);
+        uv[x + 1] = static_cast<uint8_t>(
+            (F::kV0 * s0 + F::kV1 * s1 + F::kV2 * s2 + F::kUVOffset) >> F::kUVShift);
+    }
+    return width;
+}
+
+#if defined(AMF_ARCH_X86)
+// Each 32-bit pixel is split into two 16-bit pairs, bytes (0, 2) and (1, 3), so that one pmaddwd
+// against (c0, c2) plus one against (c1, 0) yields the whole dot product.
+static inline int32_t pair16(int lo, int hi) {
+    return static_cast<int32_t>((static_cast<uint32_t>(hi) << 16) | static_cast<uint16_t>(lo));
+}
+
+template <typename F>
+AMF_TARGET_SSE41 static inline __m128i yFromPixels_SSE41(__m128i px, __m128i mask, __m128i c_br,
+                                                         __m128i c_ga, __m128i offset) {
+    __m128i br = _mm_and_si128(px, mask);
+    __m128i ga = _mm_srli_epi16(px, 8);
+    __m128i sum = _mm_add_epi32(_mm_madd_epi16(br, c_br), _mm_madd_epi16(ga, c_ga));
+    return _mm_srai_epi32(_mm_add_epi32(sum, offset), kShift);
+}
+
+template <typename F>
+AMF_TARGET_SSE41 static uint32_t rowY_SSE41(const uint8_t* bgra, uint8_t* y, uint32_t width) {
+    const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+    const __m128i c_br = _mm_set1_epi32(pair16(F::kY0, F::kY2));
+    const __m128i c_ga = _mm_set1_epi32(pair16(F::kY1, 0));
+    const __m128i offset = _mm_set1_epi32(F::kYOffset);
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i* src = reinterpret_cast<const __m128i*>(bgra + x * 4);
+        __m128i y0 = yFromPixels_SSE41<F>(_mm_loadu_si128(src + 0), mask, c_br, c_ga, offset);
+        __m128i y1 = yFromPixels_SSE41<F>(_mm_loadu_si128(src + 1), mask, c_br, c_ga, offset);
+        __m128i y2 = yFromPixels_SSE41<F>(_mm_loadu_si128(src + 2), mask, c_br, c_ga, offset);
+        __m128i y3 = yFromPixels_SSE41<F>(_mm_loadu_si128(src + 3), mask, c_br, c_ga, offset);
+        __m128i out = _mm_packus_epi16(_mm_packs_epi32(y0, y1), _mm_packs_epi32(y2, y3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(y + x), out);
+    }
+    return x;
+}
+
+// 8 pixels of two rows -> sums of the 4 horizontal pairs, (byte 0, byte 2) and (byte 1, byte 3)
+AMF_TARGET_SSE41 static inline void pairSums_SSE41(const uint8_t* row0, const uint8_t* row1,
+                                                   __m128i mask, __m128i* br, __m128i* ga) {
+    const __m128i* src0 = reinterpret_cast<const __m128i*>(row0);
+    const __m128i* src1 = reinterpret_cast<const __m128i*>(row1);
+    __m128i p0 = _mm_loadu_si128(src0), p1 = _mm_loadu_si128(src0 + 1);
+    __m128i q0 = _mm_loadu_si128(src1), q1 = _mm_loadu_si128(src1 + 1);
+    // Vertical sums, a 16-bit lane never exceeds 510
+    __m128i br0 = _mm_add_epi16(_mm_and_si128(p0, mask), _mm_and_si128(q0, mask));
+    __m128i br1 = _mm_add_epi16(_mm_and_si128(p1, mask), _mm_and_si128(q1, mask));
+    __m128i ga0 = _mm_add_epi16(_mm_srli_epi16(p0, 8), _mm_srli_epi16(q0, 8));
+    __m128i ga1 = _mm_add_epi16(_mm_srli_epi16(p1, 8), _mm_srli_epi16(q1, 8));
+    // Horizontal sums of neighbours, no carry crosses the 16-bit halves (max 1020)
+    *br = _mm_hadd_epi32(br0, br1);
+    *ga = _mm_hadd_epi32(ga0, ga1);
+}
+
+// 8 pixels of two rows -> 4 interleaved UV pairs, one per 32-bit lane
+template <typename F>
+AMF_TARGET_SSE41 static inline __m128i uvFromPixels_SSE41(const uint8_t* row0, const uint8_t* row1,
+                                                          __m128i mask, __m128i c_u_br,
+                                                          __m128i c_u_ga, __m128i c_v_br,
+                                                          __m128i c_v_ga, __m128i offset) {
+    __m128i br, ga;
+    pairSums_SSE41(row0, row1, mask, &br, &ga);
+    if (F::kLeft) {
+        // The pairs one pixel earlier complete the [1 2 1] filter, still at most 2040
+        __m128i br_left, ga_left;
+        pairSums_SSE41(row0 - 4, row1 - 4, mask, &br_left, &ga_left);
+        br = _mm_add_epi32(br, br_left);
+        ga = _mm_add_epi32(ga, ga_left);
+    }
+    __m128i u = _mm_add_epi32(_mm_madd_epi16(br, c_u_br), _mm_madd_epi16(ga, c_u_ga));
+    __m128i v = _mm_add_epi32(_mm_madd_epi16(br, c_v_br), _mm_madd_epi16(ga, c_v_ga));
+    u = _mm_srai_epi32(_mm_add_epi32(u, offset), F::kUVShift);
+    v = _mm_srai_epi32(_mm_add_epi32(v, offset), F::kUVShift);
+    return _mm_or_si128(u, _mm_slli_epi32(v, 16));
+}
+
+template <typename F>
+AMF_TARGET_SSE41 static uint32_t rowUV_SSE41(const uint8_t* bgra0, const uint8_t* bgra1,
+                                             uint8_t* uv, uint32_t begin, uint32_t width) {
+    const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+    const __m128i c_u_br = _mm_set1_epi32(pair16(F::kU0, F::kU2));
+    const __m128i c_u_ga = _mm_set1_epi32(pair16(F::kU1, 0));
+    const __m128i c_v_br = _mm_set1_epi32(pair16(F::kV0, F::kV2));
+    const __m128i c_v_ga = _mm_set1_epi32(pair16(F::kV1, 0));
+    const __m128i offset = _mm_set1_epi32(F::kUVOffset);
+    uint32_t x = begin;
+    for (; x + 16 <= width; x += 16) {
+        const uint8_t* row0 = bgra0 + x * 4;
+        const uint8_t* row1 = bgra1 + x * 4;
+        __m128i uv0 =
+            uvFromPixels_SSE41<F>(row0, row1, mask, c_u_br, c_u_ga, c_v_br, c_v_ga, offset);
+        __m128i uv1 = uvFromPixels_SSE41<F>(row0 + 32, row1 + 32, mask, c_u_br, c_u_ga, c_v_br,
+                                            c_v_ga, offset);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + x), _mm_packus_epi16(uv0, uv1));
+    }
+    return x;
+}
+
+AMF_TARGET_AVX2 static inline __m256i yFromPixels_AVX2(__m256i px, __m256i mask, __m256i c_br,
+                                                       __m256i c_ga, __m256i offset) {
+    __m256i br = _mm256_and_si256(px, mask);
+    __m256i ga = _mm256_srli_epi16(px, 8);
+    __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(br, c_br), _mm256_madd_epi16(ga, c_ga));
+    return _mm256_srai_epi32(_mm256_add_epi32(sum, offset), kShift);
+}
+
+template <typename F>
+AMF_TARGET_AVX2 static uint32_t rowY_AVX2(const uint8_t* bgra, uint8_t* y, uint32_t width) {
+    const __m256i mask = _mm256_set1_epi32(0x00FF00FF);
+    const __m256i c_br = _mm256_set1_epi32(pair16(F::kY0, F::kY2));
+    const __m256i c_ga = _mm256_set1_epi32(pair16(F::kY1, 0));
+    const __m256i offset = _mm256_set1_epi32(F::kYOffset);
+    // pack works per 128-bit lane, this puts the 4-pixel groups back in order
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    uint32_t x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const __m256i* src = reinterpret_cast<const __m256i*>(bgra + x * 4);
+        __m256i y0 = yFromPixels_AVX2(_mm256_loadu_si256(src + 0), mask, c_br, c_ga, offset);
+        __m256i y1 = yFromPixels_AVX2(_mm256_loadu_si256(src + 1), mask, c_br, c_ga, offset);
+        __m256i y2 = yFromPixels_AVX2(_mm256_loadu_si256(src + 2), mask, c_br, c_ga, offset);
+        __m256i y3 = yFromPixels_AVX2(_mm256_loadu_si256(src + 3), mask, c_br, c_ga, offset);
+        __m256i out =
+            _mm256_packus_epi16(_mm256_packs_epi32(y0, y1), _mm256_packs_epi32(y2, y3));
+        out = _mm256_permutevar8x32_epi32(out, order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(y + x), out);
+    }
+    return x;
+}
+
+AMF_TARGET_AVX2 static inline void pairSums_AVX2(const uint8_t* row0, const uint8_t* row1,
+                                                 __m256i mask, __m256i* br, __m256i* ga) {
+    const __m256i* src0 = reinterpret_cast<const __m256i*>(row0);
+    const __m256i* src1 = reinterpret_cast<const __m256i*>(row1);
+    __m256i p0 = _mm256_loadu_si256(src0), p1 = _mm256_loadu_si256(src0 + 1);
+    __m256i q0 = _mm256_loadu_si256(src1), q1 = _mm256_loadu_si256(src1 + 1);
+    __m256i br0 = _mm256_add_epi16(_mm256_and_si256(p0, mask), _mm256_and_si256(q0, mask));
+    __m256i br1 = _mm256_add_epi16(_mm256_and_si256(p1, mask), _mm256_and_si256(q1, mask));
+    __m256i ga0 = _mm256_add_epi16(_mm256_srli_epi16(p0, 8), _mm256_srli_epi16(q0, 8));
+    __m256i ga1 = _mm256_add_epi16(_mm256_srli_epi16(p1, 8), _mm256_srli_epi16(q1, 8));
+    *br = _mm256_hadd_epi32(br0, br1);
+    *ga = _mm256_hadd_epi32(ga0, ga1);
+}
+
+template <typename F>
+AMF_TARGET_AVX2 static inline __m256i uvFromPixels_AVX2(const uint8_t* row0, const uint8_t* row1,
+                                                        __m256i mask, __m256i c_u_br,
+                                                        __m256i c_u_ga, __m256i c_v_br,
+                                                        __m256i c_v_ga, __m256i offset) {
+    __m256i br, ga;
+    pairSums_AVX2(row0, row1, mask, &br, &ga);
+    if (F::kLeft) {
+        __m256i br_left, ga_left;
+        pairSums_AVX2(row0 - 4, row1 - 4, mask, &br_left, &ga_left);
+        br = _mm256_add_epi32(br, br_left);
+        ga = _mm256_add_epi32(ga, ga_left);
+    }
+    __m256i u = _mm256_add_epi32(_mm256_madd_epi16(br, c_u_br), _mm256_madd_epi16(ga, c_u_ga));
+    __m256i v = _mm256_add_epi32(_mm256_madd_epi16(br, c_v_br), _mm256_madd_epi16(ga, c_v_ga));
+    u = _mm256_srai_epi32(_mm256_add_epi32(u, offset), F::kUVShift);
+    v = _mm256_srai_epi32(_mm256_add_epi32(v, offset), F::kUVShift);
+    return _mm256_or_si256(u, _mm256_slli_epi32(v, 16));
+}
+
+template <typename F>
+AMF_TARGET_AVX2 static uint32_t rowUV_AVX2(const uint8_t* bgra0, const uint8_t* bgra1,
+                                           uint8_t* uv, uint32_t begin, uint32_t width) {
+    const __m256i mask = _mm256_set1_epi32(0x00FF00FF);
+    const __m256i c_u_br = _mm256_set1_epi32(pair16(F::kU0, F::kU2));
+    const __m256i c_u_ga = _mm256_set1_epi32(pair16(F::kU1, 0));
+    const __m256i c_v_br = _mm256_set1_epi32(pair16(F::kV0, F::kV2));
+    const __m256i c_v_ga = _mm256_set1_epi32(pair16(F::kV1, 0));
+    const __m256i offset = _mm256_set1_epi32(F::kUVOffset);
+    // hadd and pack both work per 128-bit lane, the two reorders cancel into this one
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    uint32_t x = begin;
+    for (; x + 32 <= width; x += 32) {
+        const uint8_t* row0 = bgra0 + x * 4;
+        const uint8_t* row1 = bgra1 + x * 4;
+        __m256i uv0 =
+            uvFromPixels_AVX2<F>(row0, row1, mask, c_u_br, c_u_ga, c_v_br, c_v_ga, offset);
+        __m256i uv1 = uvFromPixels_AVX2<F>(row0 + 64, row1 + 64, mask, c_u_br, c_u_ga, c_v_br,
+                                           c_v_ga, offset);
+        __m256i out = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(uv0, uv1), order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + x), out);
+    }
+    return x;
+}
+
+template <typename F>
+AMF_TARGET_AVX512 static uint32_t rowY_AVX512(const uint8_t* bgra, uint8_t* y, uint32_t width) {
+    const __m512i mask = _mm512_set1_epi32(0x00FF00FF);
+    const __m512i c_br = _mm512_set1_epi32(pair16(F::kY0, F::kY2));
+    const __m512i c_ga = _mm512_set1_epi32(pair16(F::kY1, 0));
+    const __m512i offset = _mm512_set1_epi32(F::kYOffset);
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i px = _mm512_loadu_si512(bgra + x * 4);
+        __m512i br = _mm512_and_si512(px, mask);
+        __m512i ga = _mm512_srli_epi16(px, 8);
+        __m512i sum = _mm512_add_epi32(_mm512_madd_epi16(br, c_br), _mm512_madd_epi16(ga, c_ga));
+        sum = _mm512_srai_epi32(_mm512_add_epi32(sum, offset), kShift);
+        // Y never leaves [0, 255], plain truncation is enough
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(y + x), _mm512_cvtepi32_epi8(sum));
+    }
+    return x;
+}
+
+// 16 pixels of two rows -> pair sums in the even 32-bit lanes
+AMF_TARGET_AVX512 static inline void pairSums_AVX512(const uint8_t* row0, const uint8_t* row1,
+                                                     __m512i mask, __m512i* br, __m512i* ga) {
+    __m512i p = _mm512_loadu_si512(row0);
+    __m512i q = _mm512_loadu_si512(row1);
+    __m512i sum_br = _mm512_add_epi16(_mm512_and_si512(p, mask), _mm512_and_si512(q, mask));
+    __m512i sum_ga = _mm512_add_epi16(_mm512_srli_epi16(p, 8), _mm512_srli_epi16(q, 8));
+    *br = _mm512_add_epi32(sum_br, _mm512_srli_epi64(sum_br, 32));
+    *ga = _mm512_add_epi32(sum_ga, _mm512_srli_epi64(sum_ga, 32));
+}
+
+template <typename F>
+AMF_TARGET_AVX512 static uint32_t rowUV_AVX512(const uint8_t* bgra0, const uint8_t* bgra1,
+                                               uint8_t* uv, uint32_t begin, uint32_t width) {
+    const __m512i mask = _mm512_set1_epi32(0x00FF00FF);
+    const __m512i c_u_br = _mm512_set1_epi32(pair16(F::kU0, F::kU2));
+    const __m512i c_u_ga = _mm512_set1_epi32(pair16(F::kU1, 0));
+    const __m512i c_v_br = _mm512_set1_epi32(pair16(F::kV0, F::kV2));
+    const __m512i c_v_ga = _mm512_set1_epi32(pair16(F::kV1, 0));
+    const __m512i offset = _mm512_set1_epi32(F::kUVOffset);
+    // Even 32-bit lanes of both inputs
+    const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    uint32_t x = begin;
+    for (; x + 32 <= width; x += 32) {
+        __m512i sums_br[2];
+        __m512i sums_ga[2];
+        for (int i = 0; i < 2; i++) {
+            const uint8_t* row0 = bgra0 + (x + i * 16) * 4;
+            const uint8_t* row1 = bgra1 + (x + i * 16) * 4;
+            pairSums_AVX512(row0, row1, mask, &sums_br[i], &sums_ga[i]);
+            if (F::kLeft) {
+                __m512i br_left, ga_left;
+                pairSums_AVX512(row0 - 4, row1 - 4, mask, &br_left, &ga_left);
+                sums_br[i] = _mm512_add_epi32(sums_br[i], br_left);
+                sums_ga[i] = _mm512_add_epi32(sums_ga[i], ga_left);
+            }
+        }
+        __m512i br = _mm512_permutex2var_epi32(sums_br[0], even, sums_br[1]);
+        __m512i ga = _mm512_permutex2var_epi32(sums_ga[0], even, sums_ga[1]);
+        __m512i u = _mm512_add_epi32(_mm512_madd_epi16(br, c_u_br), _mm512_madd_epi16(ga, c_u_ga));
+        __m512i v = _mm512_add_epi32(_mm512_madd_epi16(br, c_v_br), _mm512_madd_epi16(ga, c_v_ga));
+        u = _mm512_srai_epi32(_mm512_add_epi32(u, offset), F::kUVShift);
+        v = _mm512_srai_epi32(_mm512_add_epi32(v, offset), F::kUVShift);
+        __m512i packed = _mm512_or_si512(u, _mm512_slli_epi32(v, 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + x), _mm512_cvtepi32_epi16(packed));
+    }
+    return x;
+}
+#endif // AMF_ARCH_X86
+
+#if defined(AMF_ARCH_ARM64)
+template <typename F>
+static inline uint16x4_t yFromChannels_NEON(uint16x4_t c0, uint16x4_t c1, uint16x4_t c2) {
+    uint32x4_t sum = vmull_n_u16(c0, F::kY0);
+    sum = vmlal_n_u16(sum, c1, F::kY1);
+    sum = vmlal_n_u16(sum, c2, F::kY2);
+    return vshrn_n_u32(vaddq_u32(sum, vdupq_n_u32(F::kYOffset)), kShift);
+}
+
+template <typename F> static uint32_t rowY_NEON(const uint8_t* bgra, uint8_t* y, uint32_t width) {
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t px = vld4q_u8(bgra + x * 4);
+        uint16x8_t c0_lo = vmovl_u8(vget_low_u8(px.val[0]));
+        uint16x8_t c1_lo = vmovl_u8(vget_low_u8(px.val[1]));
+        uint16x8_t c2_lo = vmovl_u8(vget_low_u8(px.val[2]));
+        uint16x8_t c0_hi = vmovl_u8(vget_high_u8(px.val[0]));
+        uint16x8_t c1_hi = vmovl_u8(vget_high_u8(px.val[1]));
+        uint16x8_t c2_hi = vmovl_u8(vget_high_u8(px.val[2]));
+        uint16x8_t y_lo = vcombine_u16(
+            yFromChannels_NEON<F>(vget_low_u16(c0_lo), vget_low_u16(c1_lo), vget_low_u16(c2_lo)),
+            yFromChannels_NEON<F>(vget_high_u16(c0_lo), vget_high_u16(c1_lo),
+                                  vget_high_u16(c2_lo)));
+        uint16x8_t y_hi = vcombine_u16(
+            yFromChannels_NEON<F>(vget_low_u16(c0_hi), vget_low_u16(c1_hi), vget_low_u16(c2_hi)),
+            yFromChannels_NEON<F>(vget_high_u16(c0_hi), vget_high_u16(c1_hi),
+                                  vget_high_u16(c2_hi)));
+        vst1q_u8(y + x, vcombine_u8(vmovn_u16(y_lo), vmovn_u16(y_hi)));
+    }
+    return x;
+}
+
+template <typename F>
+static inline uint8x8_t chromaFromSums_NEON(int16x8_t s0, int16x8_t s1, int16x8_t s2, int c0,
+                                            int c1, int c2) {
+    int32x4_t lo = vmull_n_s16(vget_low_s16(s0), c0);
+    lo = vmlal_n_s16(lo, vget_low_s16(s1), c1);
+    lo = vmlal_n_s16(lo, vget_low_s16(s2), c2);
+    int32x4_t hi = vmull_n_s16(vget_high_s16(s0), c0);
+    hi = vmlal_n_s16(hi, vget_high_s16(s1), c1);
+    hi = vmlal_n_s16(hi, vget_high_s16(s2), c2);
+    const int32x4_t offset = vdupq_n_s32(F::kUVOffset);
+    lo = vshrq_n_s32(vaddq_s32(lo, offset), F::kUVShift);
+    hi = vshrq_n_s32(vaddq_s32(hi, offset), F::kUVShift);
+    return vmovn_u16(vreinterpretq_u16_s16(vcombine_s16(vmovn_s32(lo), vmovn_s32(hi))));
+}
+
+template <typename F>
+static uint32_t rowUV_NEON(const uint8_t* bgra0, const uint8_t* bgra1, uint8_t* uv,
+                           uint32_t begin, uint32_t width) {
+    uint32_t x = begin;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t p = vld4q_u8(bgra0 + x * 4);
+        uint8x16x4_t q = vld4q_u8(bgra1 + x * 4);
+        // Pairwise add neighbours, then accumulate the second row
+        uint16x8_t s0 = vpadalq_u8(vpaddlq_u8(p.val[0]), q.val[0]);
+        uint16x8_t s1 = vpadalq_u8(vpaddlq_u8(p.val[1]), q.val[1]);
+        uint16x8_t s2 = vpadalq_u8(vpaddlq_u8(p.val[2]), q.val[2]);
+        if (F::kLeft) {
+            // The pairs one pixel earlier complete the [1 2 1] filter
+            uint8x16x4_t pl = vld4q_u8(bgra0 + x * 4 - 4);
+            uint8x16x4_t ql = vld4q_u8(bgra1 + x * 4 - 4);
+            s0 = vaddq_u16(s0, vpadalq_u8(vpaddlq_u8(pl.val[0]), ql.val[0]));
+            s1 = vaddq_u16(s1, vpadalq_u8(vpaddlq_u8(pl.val[1]), ql.val[1]));
+            s2 = vaddq_u16(s2, vpadalq_u8(vpaddlq_u8(pl.val[2]), ql.val[2]));
+        }
+        int16x8_t c0 = vreinterpretq_s16_u16(s0);
+        int16x8_t c1 = vreinterpretq_s16_u16(s1);
+        int16x8_t c2 = vreinterpretq_s16_u16(s2);
+        uint8x8x2_t out;
+        out.val[0] = chromaFromSums_NEON<F>(c0, c1, c2, F::kU0, F::kU1, F::kU2);
+        out.val[1] = chromaFromSums_NEON<F>(c0, c1, c2, F::kV0, F::kV1, F::kV2);
+        vst2_u8(uv + x, out);
+    }
+    return x;
+}
+#endif // AMF_ARCH_ARM64
+
+struct RowKernels {
+    SimdLevel level = SimdLevel::SCALAR;
+    BgraToNv12Converter::RowYFunc row_y = nullptr;
+    BgraToNv12Converter::RowUVFunc row_uv = nullptr;
+    BgraToNv12Converter::RowYFunc row_y_c = nullptr;
+    BgraToNv12Converter::RowUVFunc row_uv_c = nullptr;
+};
+
+template <typename F> static void selectKernels(SimdLevel level, RowKernels* k) {
+    k->row_y_c = rowY_C<F>;
+    k->row_uv_c = rowUV_C<F>;
+    k->row_y = k->row_y_c;
+    k->row_uv = k->row_uv_c;
+    k->level = level;
+    switch (level) {
+#if defined(AMF_ARCH_X86)
+    case SimdLevel::SSE41:
+        k->row_y = rowY_SSE41<F>;
+        k->row_uv = rowUV_SSE41<F>;
+        break;
+    case SimdLevel::AVX2:
+        k->row_y = rowY_AVX2<F>;
+        k->row_uv = rowUV_AVX2<F>;
+        break;
+    case SimdLevel::AVX512:
+        k->row_y = rowY_AVX512<F>;
+        k->row_uv = rowUV_AVX512<F>;
+        break;
+#endif
+#if defined(AMF_ARCH_ARM64)
+    case SimdLevel::NEON:
+        k->row_y = rowY_NEON<F>;
+        k->row_uv = rowUV_NEON<F>;
+        break;
+#endif
+    default:
+        k->level = SimdLevel::SCALAR;
+        break;
+    }
+}
+
+// Runtime settings -> one instantiation, each level of the color space peels off one template
+// argument
+template <ColorMatrix kMatrix, ColorRange kRange, ChromaSiting kSiting>
+static void selectOrder(PixelOrder order, SimdLevel level, RowKernels* k) {
+    if (order == PixelOrder::RGBA) {
+        selectKernels<Format<kMatrix, kRange, kSiting, PixelOrder::RGBA>>(level, k);
+    }
+    else {
+        selectKernels<Format<kMatrix, kRange, kSiting, PixelOrder::BGRA>>(level, k);
+    }
+}
+
+template <ColorMatrix kMatrix, ColorRange kRange>
+static void selectSiting(const ColorSpace& color, PixelOrder order, SimdLevel level,
+                         RowKernels* k) {
+    if (color.siting == ChromaSiting::LEFT) {
+        selectOrder<kMatrix, kRange, ChromaSiting::LEFT>(order, level, k);
+    }
+    else {
+        selectOrder<kMatrix, kRange, ChromaSiting::CENTER>(order, level, k);
+    }
+}
+
+template <ColorMatrix kMatrix>
+static void selectRange(const ColorSpace& color, PixelOrder order, SimdLevel level,
+                        RowKernels* k) {
+    if (color.range == ColorRange::FULL) {
+        selectSiting<kMatrix, ColorRange::FULL>(color, order, level, k);
+    }
+    else {
+        selectSiting<kMatrix, ColorRange::LIMITED>(color, order, level, k);
+    }
+}
+
+BgraToNv12Converter::BgraToNv12Converter(SimdLevel level, const ColorSpace& color,
+                                         PixelOrder order)
+    : color_(color)
+    , order_(order) {
+    RowKernels k;
+    switch (color_.matrix) {
+    case ColorMatrix::BT601:
+        selectRange<ColorMatrix::BT601>(color_, order_, resolveSimdLevel(level), &k);
+        break;
+    case ColorMatrix::BT2020:
+        selectRange<ColorMatrix::BT2020>(color_, order_, resolveSimdLevel(level), &k);
+        break;
+    default:
+        selectRange<ColorMatrix::BT709>(color_, order_, resolveSimdLevel(level), &k);
+        break;
+    }
+    level_ = k.level;
+    row_y_ = k.row_y;
+    row_uv_ = k.row_uv;
+    row_y_c_ = k.row_y_c;
+    row_uv_c_ = k.row_uv_c;
+    // The kernels read the pixel left of their first pair, the first pair needs the edge replicated
+    uv_begin_ = color_.siting == ChromaSiting::LEFT ? 2 : 0;
+}
+
+void BgraToNv12Converter::convertRows(const uint8_t* bgra0, const uint8_t* bgra1, uint32_t width,
+                                      uint8_t* y0, uint8_t* y1, uint8_t* uv) const {
+    uint32_t done = row_y_(bgra0, y0, width);
+    row_y_c_(bgra0 + done * 4, y0 + done, width - done);
+    if (y1) {
+        done = row_y_(bgra1, y1, width);
+        row_y_c_(bgra1 + done * 4, y1 + done, width - done);
+    }
+    const uint32_t begin = std::min(uv_begin_, width);
+    if (begin > 0) {
+        row_uv_c_(bgra0, bgra1, uv, 0, begin);
+    }
+    // Kernels only consume whole pixel pairs
+    done = row_uv_(bgra0, bgra1, uv, begin, width) & ~1u;
+    if (done < width) {
+        row_uv_c_(bgra0, bgra1, uv, done, width);
+    }
+}
+
+void BgraToNv12Converter::convert(const uint8_t* bgra, uint32_t bgra_pitch, uint32_t width,
+                                  uint32_t height, uint8_t* y, uint32_t y_pitch, uint8_t* uv,
+                                  uint32_t uv_pitch) const {
+    for (uint32_t row = 0; row < height; row += 2) {
+        const uint8_t* src0 = bgra + static_cast<size_t>(row) * bgra_pitch;
+        const bool last = row + 1 >= height;
+        const uint8_t* src1 = last ? src0 : src0 + bgra_pitch;
+        uint8_t* dst_y0 = y + static_cast<size_t>(row) * y_pitch;
+        uint8_t* dst_y1 = last ? nullptr : dst_y0 + y_pitch;
+        convertRows(src0, src1, width, dst_y0, dst_y1,
+                    uv + static_cast<size_t>(row / 2) * uv_pitch);
+    }
+}
+
+} // namespace amf
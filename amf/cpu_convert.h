@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+#include "color_space.h"
+#include "cpu_features.h"
+
+namespace amf {
+
+// BGRA|RGBA -> NV12 on the cpu.
+// Matrix, range, chroma siting and pixel order are template parameters of the row kernels, the
+// constructor picks the instantiation once. The default matches what D3D11VideoProcessorConvert
+// produces with YCbCr_Matrix = 1: BT.709, limited range, chroma is the average of each 2x2 block.
+class BgraToNv12Converter {
+public:
+    using RowYFunc = uint32_t (*)(const uint8_t* bgra, uint8_t* y, uint32_t width);
+    // Writes the chroma of the pixel pairs in [begin, width), begin is even
+    using RowUVFunc = uint32_t (*)(const uint8_t* bgra0, const uint8_t* bgra1, uint8_t* uv,
+                                   uint32_t begin, uint32_t width);
+
+    explicit BgraToNv12Converter(SimdLevel level = SimdLevel::AUTO, const ColorSpace& color = {},
+                                 PixelOrder order = PixelOrder::BGRA);
+
+    SimdLevel level() const { return level_; }
+    const ColorSpace& colorSpace() const { return color_; }
+    PixelOrder pixelOrder() const { return order_; }
+
+    // Odd width|height are allowed, the last column|row is replicated for the chroma plane
+    void convert(const uint8_t* bgra, uint32_t bgra_pitch, uint32_t width, uint32_t height,
+                 uint8_t* y, uint32_t y_pitch, uint8_t* uv, uint32_t uv_pitch) const;
+
+    void convertRows(const uint8_t* bgra0, const uint8_t* bgra1, uint32_t width, uint8_t* y0,
+                     uint8_t* y1, uint8_t* uv) const;
+
+private:
+    const ColorSpace color_;
+    const PixelOrder order_;
+    SimdLevel level_ = SimdLevel::SCALAR;
+    // The simd kernels return how many pixels they handled, the scalar ones finish the row
+    RowYFunc row_y_ = nullptr;
+    RowUVFunc row_uv_ = nullptr;
+    RowYFunc row_y_c_ = nullptr;
+    RowUVFunc row_uv_c_ = nullptr;
+    // Chroma pairs left of this are done by the scalar kernel
+    uint32_t uv_begin_ = 0;
+};
+
+} // namespace amf
@@ -0,0 +1,134 @@
+#include "cpu_features.h"
+
+#if defined(AMF_ARCH_X86)
+#if defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace amf {
+
+#if defined(AMF_ARCH_X86)
+static void cpuid(int leaf, int sub_leaf, int regs[4]) {
+#if defined(_MSC_VER)
+    __cpuidex(regs, leaf, sub_leaf);
+#else
+    unsigned int a = 0, b = 0, c = 0, d = 0;
+    __cpuid_count(leaf, sub_leaf, a, b, c, d);
+    regs[0] = a;
+    regs[1] = b;
+    regs[2] = c;
+    regs[3] = d;
+#endif
+}
+
+static uint64_t xgetbv0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax = 0, edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+static CpuFeatures detect() {
+    CpuFeatures features;
+#if defined(AMF_ARCH_X86)
+    int regs[4] = {0};
+    cpuid(0, 0, regs);
+    const int max_leaf = regs[0];
+    if (max_leaf < 1) {
+        return features;
+    }
+    cpuid(1, 0, regs);
+    features.sse41 = (regs[2] & (1 << 19)) != 0;
+    features.crc32 = (regs[2] & (1 << 20)) != 0;
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+    const bool avx = (regs[2] & (1 << 28)) != 0;
+    const bool f16c = (regs[2] & (1 << 29)) != 0;
+    const bool fma = (regs[2] & (1 << 12)) != 0;
+    if (!osxsave || !avx) {
+        return features;
+    }
+    // The OS has to save the ymm/zmm state, otherwise the instructions fault
+    const uint64_t xcr0 = xgetbv0();
+    const bool ymm_state = (xcr0 & 0x6) == 0x6;
+    const bool zmm_state = (xcr0 & 0xE6) == 0xE6;
+    if (max_leaf >= 7) {
+        cpuid(7, 0, regs);
+        features.avx2 = ymm_state && (regs[1] & (1 << 5)) != 0;
+        features.avx512bw =
+            zmm_state && (regs[1] & (1 << 16)) != 0 /*F*/ && (regs[1] & (1 << 30)) != 0 /*BW*/;
+    }
+    features.f16c = features.avx2 && f16c && fma;
+#elif defined(AMF_ARCH_ARM64)
+    features.neon = true;
+    // Mandatory from ARMv8.1, and Windows on ARM requires it
+    features.crc32 = true;
+#endif
+    return features;
+}
+
+const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures features = detect();
+    return features;
+}
+
+SimdLevel bestSimdLevel() {
+    auto& features = cpuFeatures();
+    if (features.avx512bw) {
+        return SimdLevel::AVX512;
+    }
+    if (features.avx2) {
+        return SimdLevel::AVX2;
+    }
+    if (features.sse41) {
+        return SimdLevel::SSE41;
+    }
+    if (features.neon) {
+        return SimdLevel::NEON;
+    }
+    return SimdLevel::SCALAR;
+}
+
+SimdLevel resolveSimdLevel(SimdLevel level) {
+    auto& features = cpuFeatures();
+    switch (level) {
+    case SimdLevel::SCALAR:
+        return SimdLevel::SCALAR;
+    case SimdLevel::SSE41:
+        return features.sse41 ? level : bestSimdLevel();
+    case SimdLevel::AVX2:
+        return features.avx2 ? level : bestSimdLevel();
+    case SimdLevel::AVX512:
+        return features.avx512bw ? level : bestSimdLevel();
+    case SimdLevel::NEON:
+        return features.neon ? level : bestSimdLevel();
+    default:
+        return bestSimdLevel();
+    }
+}
+
+const char* simdLevelStr(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::SCALAR:
+        return "Scalar";
+    case SimdLevel::SSE41:
+        return "SSE4.1";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::AVX512:
+        return "AVX512";
+    case SimdLevel::NEON:
+        return "NEON";
+    default:
+        return "Auto";
+    }
+}
+
+} // namespace amf
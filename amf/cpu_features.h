@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AMF_ARCH_X86 1
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define AMF_ARCH_ARM64 1
+#endif
+
+// MSVC allows any intrinsic in any function, gcc/clang need the target attribute so that the
+// kernels can live next to the scalar code and still be dispatched at runtime.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define AMF_TARGET_SSE41
+#define AMF_TARGET_AVX2
+#define AMF_TARGET_AVX512
+#define AMF_TARGET_F16C
+#define AMF_TARGET_CRC32
+#else
+#define AMF_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define AMF_TARGET_AVX2 __attribute__((target("avx2")))
+#define AMF_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#define AMF_TARGET_F16C __attribute__((target("avx2,f16c,fma")))
+#if defined(AMF_ARCH_ARM64)
+#define AMF_TARGET_CRC32 __attribute__((target("+crc")))
+#else
+#define AMF_TARGET_CRC32 __attribute__((target("sse4.2")))
+#endif
+#endif
+
+namespace amf {
+
+enum class SimdLevel : uint8_t {
+    AUTO = 0,
+    SCALAR = 1,
+    SSE41 = 2,
+    AVX2 = 3,
+    AVX512 = 4,
+    NEON = 5,
+};
+
+struct CpuFeatures {
+    bool sse41 = false;
+    bool avx2 = false;
+    bool avx512bw = false;
+    bool f16c = false;
+    bool neon = false;
+    // crc32c instructions, SSE4.2 on x86
+    bool crc32 = false;
+};
+
+const CpuFeatures& cpuFeatures();
+
+// Best level supported by this cpu
+SimdLevel bestSimdLevel();
+
+// Resolve AUTO and clamp unsupported levels down to the best supported one
+SimdLevel resolveSimdLevel(SimdLevel level);
+
+const char* simdLevelStr(SimdLevel level);
+
+} // namespace amf
@@ -0,0 +1,573 @@
+#include "cpu_scaler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "thread_pool.h"
+
+#if defined(AMF_ARCH_X86)
+#include <immintrin.h>
+#elif defined(AMF_ARCH_ARM64)
+#include <arm_neon.h>
+#endif
+
+namespace amf {
+
+static constexpr int kFilterShift = 14;
+static constexpr int kFilterOne = 1 << kFilterShift;
+static constexpr int kFilterRound = 1 << (kFilterShift - 1);
+static constexpr uint32_t kMinRowsPerBand = 16;
+
+static constexpr double kPi = 3.14159265358979323846;
+
+static inline uint8_t clampPixel(int32_t value) {
+    return static_cast<uint8_t>(std::min(std::max(value >> kFilterShift, 0), 255));
+}
+
+static void verticalRange_C(const uint8_t* const* rows, const int16_t* weights, uint32_t taps,
+                            uint8_t* dst, uint32_t begin, uint32_t end) {
+    for (uint32_t x = begin; x < end; x++) {
+        int32_t sum = kFilterRound;
+        for (uint32_t k = 0; k < taps; k++) {
+            sum += weights[k] * rows[k][x];
+        }
+        dst[x] = clampPixel(sum);
+    }
+}
+
+static uint32_t vertical_C(const uint8_t* const* rows, const int16_t* weights, uint32_t taps,
+                           uint8_t* dst, uint32_t width) {
+    verticalRange_C(rows, weights, taps, dst, 0, width);
+    return width;
+}
+
+#if defined(AMF_ARCH_X86)
+AMF_TARGET_SSE41 static uint32_t vertical_SSE41(const uint8_t* const* rows,
+                                                const int16_t* weights, uint32_t taps,
+                                                uint8_t* dst, uint32_t width) {
+    const __m128i round = _mm_set1_epi32(kFilterRound);
+    uint32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i acc_lo = round;
+        __m128i acc_hi = round;
+        // Two rows per pmaddwd, an odd last row is paired with a zero weight
+        for (uint32_t k = 0; k < taps; k += 2) {
+            const bool pair = k + 1 < taps;
+            __m128i a = _mm_cvtepu8_epi16(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows[k] + x)));
+            __m128i b = pair ? _mm_cvtepu8_epi16(_mm_loadl_epi64(
+                                   reinterpret_cast<const __m128i*>(rows[k + 1] + x)))
+                             : _mm_setzero_si128();
+            __m128i w = _mm_set1_epi32(static_cast<uint16_t>(weights[k]) |
+                                       (pair ? static_cast<int32_t>(weights[k + 1]) << 16 : 0));
+            acc_lo = _mm_add_epi32(acc_lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+            acc_hi = _mm_add_epi32(acc_hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+        }
+        __m128i px = _mm_packs_epi32(_mm_srai_epi32(acc_lo, kFilterShift),
+                                     _mm_srai_epi32(acc_hi, kFilterShift));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(px, px));
+    }
+    return x;
+}
+
+AMF_TARGET_AVX2 static uint32_t vertical_AVX2(const uint8_t* const* rows, const int16_t* weights,
+                                              uint32_t taps, uint8_t* dst, uint32_t width) {
+    const __m256i round = _mm256_set1_epi32(kFilterRound);
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        // unpack splits each lane, lo holds pixels 0-3|8-11 and hi 4-7|12-15
+        __m256i acc_lo = round;
+        __m256i acc_hi = round;
+        for (uint32_t k = 0; k < taps; k += 2) {
+            const bool pair = k + 1 < taps;
+            __m256i a = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + x)));
+            __m256i b = pair ? _mm256_cvtepu8_epi16(_mm_loadu_si128(
+                                   reinterpret_cast<const __m128i*>(rows[k + 1] + x)))
+                             : _mm256_setzero_si256();
+            __m256i w = _mm256_set1_epi32(static_cast<uint16_t>(weights[k]) |
+                                          (pair ? static_cast<int32_t>(weights[k + 1]) << 16 : 0));
+            acc_lo = _mm256_add_epi32(acc_lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+            acc_hi = _mm256_add_epi32(acc_hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+        }
+        __m256i px = _mm256_packs_epi32(_mm256_srai_epi32(acc_lo, kFilterShift),
+                                        _mm256_srai_epi32(acc_hi, kFilterShift));
+        px = _mm256_permute4x64_epi64(_mm256_packus_epi16(px, px), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm256_castsi256_si128(px));
+    }
+    return x;
+}
+#endif // AMF_ARCH_X86
+
+#if defined(AMF_ARCH_ARM64)
+static uint32_t vertical_NEON(const uint8_t* const* rows, const int16_t* weights, uint32_t taps,
+                              uint8_t* dst, uint32_t width) {
+    uint32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        int32x4_t acc_lo = vdupq_n_s32(0);
+        int32x4_t acc_hi = vdupq_n_s32(0);
+        for (uint32_t k = 0; k < taps; k++) {
+            int16x8_t px = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(rows[k] + x)));
+            acc_lo = vmlal_n_s16(acc_lo, vget_low_s16(px), weights[k]);
+            acc_hi = vmlal_n_s16(acc_hi, vget_high_s16(px), weights[k]);
+        }
+        // Rounding narrow shifts, negative lobes saturate to 0
+        uint16x8_t px = vcombine_u16(vqrshrun_n_s32(acc_lo, kFilterShift),
+                                     vqrshrun_n_s32(acc_hi, kFilterShift));
+        vst1_u8(dst + x, vqmovn_u16(px));
+    }
+    return x;
+}
+#endif // AMF_ARCH_ARM64
+
+template <uint32_t kChannels, uint32_t kTaps>
+static void horizontal(const uint8_t* src, const CpuScaler::Filter& filter, uint8_t* dst,
+                       uint32_t begin, uint32_t dst_width) {
+    // kTaps == 0 is the generic loop, the fixed ones let the compiler unroll the FIR
+    const uint32_t taps = kTaps ? kTaps : filter.taps;
+    const int16_t* w = filter.weights.data() + static_cast<size_t>(begin) * taps;
+    const int32_t* offset = filter.offset.data();
+    for (uint32_t i = begin; i < dst_width; i++, w += taps) {
+        const uint8_t* s = src + static_cast<size_t>(offset[i]) * kChannels;
+        for (uint32_t c = 0; c < kChannels; c++) {
+            int32_t sum = kFilterRound;
+            for (uint32_t k = 0; k < taps; k++) {
+                sum += w[k] * s[k * kChannels + c];
+            }
+            dst[i * kChannels + c] = clampPixel(sum);
+        }
+    }
+}
+
+template <uint32_t kChannels>
+static void horizontal(const uint8_t* src, const CpuScaler::Filter& filter, uint8_t* dst,
+                       uint32_t begin, uint32_t dst_width) {
+    switch (filter.taps) {
+    case 1:
+        return horizontal<kChannels, 1>(src, filter, dst, begin, dst_width);
+    case 2:
+        return horizontal<kChannels, 2>(src, filter, dst, begin, dst_width);
+    case 3:
+        return horizontal<kChannels, 3>(src, filter, dst, begin, dst_width);
+    case 4:
+        return horizontal<kChannels, 4>(src, filter, dst, begin, dst_width);
+    case 6:
+        return horizontal<kChannels, 6>(src, filter, dst, begin, dst_width);
+    case 8:
+        return horizontal<kChannels, 8>(src, filter, dst, begin, dst_width);
+    case 12:
+        return horizontal<kChannels, 12>(src, filter, dst, begin, dst_width);
+    default:
+        return horizontal<kChannels, 0>(src, filter, dst, begin, dst_width);
+    }
+}
+
+static uint32_t horizontal_C(const uint8_t*, const CpuScaler::Filter&, uint8_t*, uint32_t,
+                             uint32_t) {
+    return 0;
+}
+
+#if defined(AMF_ARCH_X86)
+static inline int32_t load32(const uint8_t* src) {
+    int32_t value;
+    memcpy(&value, src, sizeof(value));
+    return value;
+}
+
+// Each 32-bit lane holds 4 source bytes of one output pixel: bytes (0, 2) and (1, 3) become two
+// 16-bit pairs, one pmaddwd each against the matching weight pairs.
+// One channel: 4 taps, (b0, b2) . (w0, w2) + (b1, b3) . (w1, w3).
+// Two channels: 2 taps of U and V, U = (b0, b2) . (w0, w1) and V = (b1, b3) . (w0, w1).
+AMF_TARGET_SSE41 static uint32_t horizontal_SSE41(const uint8_t* src,
+                                                  const CpuScaler::Filter& filter, uint8_t* dst,
+                                                  uint32_t dst_width, uint32_t channels) {
+    const __m128i round = _mm_set1_epi32(kFilterRound);
+    const __m128i low_bytes = _mm_set1_epi32(0x00FF00FF);
+    const int32_t* offset = filter.offset.data();
+    uint32_t i = 0;
+    if (channels == 1) {
+        const uint32_t end = std::min(filter.quad_end, dst_width);
+        for (; i + 4 <= end; i += 4) {
+            __m128i acc = round;
+            const int32_t* even = filter.quads_even.data() + i;
+            const int32_t* odd = filter.quads_odd.data() + i;
+            for (uint32_t c = 0; c < filter.quad_chunks; c++, even += dst_width, odd += dst_width) {
+                const uint8_t* s = src + c * 4;
+                __m128i px = _mm_setr_epi32(load32(s + offset[i]), load32(s + offset[i + 1]),
+                                            load32(s + offset[i + 2]), load32(s + offset[i + 3]));
+                acc = _mm_add_epi32(
+                    acc, _mm_madd_epi16(_mm_and_si128(px, low_bytes),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(even))));
+                acc = _mm_add_epi32(
+                    acc, _mm_madd_epi16(_mm_and_si128(_mm_srli_epi32(px, 8), low_bytes),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(odd))));
+            }
+            __m128i out = _mm_packs_epi32(_mm_srai_epi32(acc, kFilterShift), _mm_setzero_si128());
+            const int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(out, out));
+            memcpy(dst + i, &bytes, sizeof(bytes));
+        }
+        return i;
+    }
+    const uint32_t end = std::min(filter.pair_end, dst_width);
+    for (; i + 4 <= end; i += 4) {
+        __m128i acc_u = round;
+        __m128i acc_v = round;
+        const int32_t* pairs = filter.pairs.data() + i;
+        for (uint32_t c = 0; c < filter.pair_chunks; c++, pairs += dst_width) {
+            const uint8_t* s = src + c * 4;
+            __m128i px =
+                _mm_setr_epi32(load32(s + offset[i] * 2), load32(s + offset[i + 1] * 2),
+                               load32(s + offset[i + 2] * 2), load32(s + offset[i + 3] * 2));
+            const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pairs));
+            acc_u = _mm_add_epi32(acc_u, _mm_madd_epi16(_mm_and_si128(px, low_bytes), w));
+            acc_v = _mm_add_epi32(
+                acc_v, _mm_madd_epi16(_mm_and_si128(_mm_srli_epi32(px, 8), low_bytes), w));
+        }
+        __m128i u = _mm_packs_epi32(_mm_srai_epi32(acc_u, kFilterShift), _mm_setzero_si128());
+        __m128i v = _mm_packs_epi32(_mm_srai_epi32(acc_v, kFilterShift), _mm_setzero_si128());
+        __m128i uv = _mm_unpacklo_epi8(_mm_packus_epi16(u, u), _mm_packus_epi16(v, v));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * 2), uv);
+    }
+    return i;
+}
+
+AMF_TARGET_AVX2 static inline void storePixels_AVX2(__m256i acc, uint8_t* dst) {
+    acc = _mm256_srai_epi32(acc, kFilterShift);
+    __m128i px = _mm_packs_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(px, px));
+}
+
+AMF_TARGET_AVX2 static uint32_t horizontal_AVX2(const uint8_t* src,
+                                                const CpuScaler::Filter& filter, uint8_t* dst,
+                                                uint32_t dst_width, uint32_t channels) {
+    const __m256i round = _mm256_set1_epi32(kFilterRound);
+    const __m256i low_bytes = _mm256_set1_epi32(0x00FF00FF);
+    const int* base = reinterpret_cast<const int*>(src);
+    uint32_t i = 0;
+    if (channels == 1) {
+        const uint32_t end = std::min(filter.quad_end, dst_width);
+        for (; i + 8 <= end; i += 8) {
+            __m256i acc = round;
+            __m256i index =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(filter.offset.data() + i));
+            const int32_t* even = filter.quads_even.data() + i;
+            const int32_t* odd = filter.quads_odd.data() + i;
+            for (uint32_t c = 0; c < filter.quad_chunks; c++, even += dst_width, odd += dst_width) {
+                __m256i px = _mm256_i32gather_epi32(base, index, 1);
+                acc = _mm256_add_epi32(
+                    acc,
+                    _mm256_madd_epi16(_mm256_and_si256(px, low_bytes),
+                                      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(even))));
+                acc = _mm256_add_epi32(
+                    acc,
+                    _mm256_madd_epi16(_mm256_and_si256(_mm256_srli_epi32(px, 8), low_bytes),
+                                      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(odd))));
+                index = _mm256_add_epi32(index, _mm256_set1_epi32(4));
+            }
+            storePixels_AVX2(acc, dst + i);
+        }
+        return i;
+    }
+    const uint32_t end = std::min(filter.pair_end, dst_width);
+    for (; i + 8 <= end; i += 8) {
+        __m256i acc_u = round;
+        __m256i acc_v = round;
+        __m256i index = _mm256_slli_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(filter.offset.data() + i)), 1);
+        const int32_t* pairs = filter.pairs.data() + i;
+        for (uint32_t c = 0; c < filter.pair_chunks; c++, pairs += dst_width) {
+            __m256i px = _mm256_i32gather_epi32(base, index, 1);
+            const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairs));
+            acc_u = _mm256_add_epi32(acc_u, _mm256_madd_epi16(_mm256_and_si256(px, low_bytes), w));
+            acc_v = _mm256_add_epi32(
+                acc_v,
+                _mm256_madd_epi16(_mm256_and_si256(_mm256_srli_epi32(px, 8), low_bytes), w));
+            index = _mm256_add_epi32(index, _mm256_set1_epi32(4));
+        }
+        acc_u = _mm256_srai_epi32(acc_u, kFilterShift);
+        acc_v = _mm256_srai_epi32(acc_v, kFilterShift);
+        __m128i u =
+            _mm_packs_epi32(_mm256_castsi256_si128(acc_u), _mm256_extracti128_si256(acc_u, 1));
+        __m128i v =
+            _mm_packs_epi32(_mm256_castsi256_si128(acc_v), _mm256_extracti128_si256(acc_v, 1));
+        __m128i uv = _mm_unpacklo_epi8(_mm_packus_epi16(u, u), _mm_packus_epi16(v, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), uv);
+    }
+    return i;
+}
+#endif // AMF_ARCH_X86
+
+static double filterRadius(CpuScaler::Mode mode) {
+    switch (mode) {
+    case CpuScaler::Mode::AREA:
+        return 0.5;
+    case CpuScaler::Mode::BICUBIC:
+        return 2.0;
+    case CpuScaler::Mode::LANCZOS:
+        return 3.0;
+    default:
+        return 1.0;
+    }
+}
+
+static double filterWeight(CpuScaler::Mode mode, double x) {
+    x = std::fabs(x);
+    switch (mode) {
+    case CpuScaler::Mode::BICUBIC:
+        if (x < 1.0) {
+            return (1.5 * x - 2.5) * x * x + 1.0;
+        }
+        if (x < 2.0) {
+            return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+        }
+        return 0.0;
+    case CpuScaler::Mode::LANCZOS: {
+        if (x < 1e-8) {
+            return 1.0;
+        }
+        if (x >= 3.0) {
+            return 0.0;
+        }
+        const double px = kPi * x;
+        return 3.0 * std::sin(px) * std::sin(px / 3.0) / (px * px);
+    }
+    default:
+        return std::max(0.0, 1.0 - x);
+    }
+}
+
+// Interleaves two int16 weights for pmaddwd, zero past the taps
+static int32_t weightPair(const int16_t* w, uint32_t taps, uint32_t a, uint32_t b) {
+    const int32_t lo = a < taps ? static_cast<uint16_t>(w[a]) : 0;
+    const int32_t hi = b < taps ? w[b] : 0;
+    return static_cast<int32_t>(static_cast<uint32_t>(hi) << 16 | static_cast<uint32_t>(lo));
+}
+
+// Lays the weights out for the simd horizontal pass, see Filter
+static void packFilter(CpuScaler::Filter* filter, uint32_t src_len) {
+    const uint32_t dst_len = static_cast<uint32_t>(filter->offset.size());
+    const uint32_t taps = filter->taps;
+    filter->quad_chunks = (taps + 3) / 4;
+    filter->pair_chunks = (taps + 1) / 2;
+    filter->quads_even.assign(static_cast<size_t>(filter->quad_chunks) * dst_len, 0);
+    filter->quads_odd.assign(filter->quads_even.size(), 0);
+    filter->pairs.assign(static_cast<size_t>(filter->pair_chunks) * dst_len, 0);
+    filter->quad_end = 0;
+    filter->pair_end = 0;
+    for (uint32_t i = 0; i < dst_len; i++) {
+        const int16_t* w = filter->weights.data() + static_cast<size_t>(i) * taps;
+        for (uint32_t c = 0; c < filter->quad_chunks; c++) {
+            const size_t at = static_cast<size_t>(c) * dst_len + i;
+            filter->quads_even[at] = weightPair(w, taps, c * 4, c * 4 + 2);
+            filter->quads_odd[at] = weightPair(w, taps, c * 4 + 1, c * 4 + 3);
+        }
+        for (uint32_t c = 0; c < filter->pair_chunks; c++) {
+            filter->pairs[static_cast<size_t>(c) * dst_len + i] =
+                weightPair(w, taps, c * 2, c * 2 + 1);
+        }
+        // Offsets never decrease, the chunks of later outputs only run further right
+        const uint32_t offset = static_cast<uint32_t>(filter->offset[i]);
+        if (offset + filter->quad_chunks * 4 <= src_len) {
+            filter->quad_end = i + 1;
+        }
+        if (offset + filter->pair_chunks * 2 <= src_len) {
+            filter->pair_end = i + 1;
+        }
+    }
+}
+
+CpuScaler::Filter CpuScaler::buildFilter(Mode mode, uint32_t src_len, uint32_t dst_len,
+                                         bool cosited) {
+    const double scale = static_cast<double>(src_len) / dst_len;
+    // Position of a sample within its pixel, 1/4 for co-sited chroma: the left one of the two
+    // luma pixels it covers
+    const double phase = cosited ? 0.25 : 0.5;
+    // Downscaling widens every filter but bilinear, which keeps its 2 taps
+    const double stretch = mode == Mode::BILINEAR ? 1.0 : std::max(scale, 1.0);
+    const double radius = filterRadius(mode) * stretch;
+    const int32_t last = static_cast<int32_t>(src_len) - 1;
+
+    std::vector<std::vector<double>> weights(dst_len);
+    std::vector<int32_t> first(dst_len);
+    uint32_t taps = 1;
+    for (uint32_t i = 0; i < dst_len; i++) {
+        const double center = (i + phase) * scale - phase;
+        const int32_t lo = static_cast<int32_t>(std::floor(center - radius));
+        const int32_t hi = static_cast<int32_t>(std::ceil(center + radius));
+        // Taps outside the image fold into the edge pixel
+        const int32_t begin = std::min(std::max(lo, 0), last);
+        const int32_t end = std::min(std::max(hi, 0), last);
+        auto& w = weights[i];
+        w.assign(end - begin + 1, 0.0);
+        for (int32_t j = lo; j <= hi; j++) {
+            double value = 0.0;
+            if (mode == Mode::AREA) {
+                // Coverage of source pixel j by the destination pixel footprint
+                value = std::max(0.0, std::min(j + 0.5, center + radius) -
+                                          std::max(j - 0.5, center - radius));
+            }
+            else {
+                value = filterWeight(mode, (j - center) / stretch);
+            }
+            w[std::min(std::max(j, 0), last) - begin] += value;
+        }
+        // The window is rounded outwards, drop the empty taps on both ends
+        size_t head = 0;
+        while (head + 1 < w.size() && std::fabs(w[head]) < 1e-9) {
+            head++;
+        }
+        while (w.size() > head + 1 && std::fabs(w.back()) < 1e-9) {
+            w.pop_back();
+        }
+        w.erase(w.begin(), w.begin() + head);
+        first[i] = begin + static_cast<int32_t>(head);
+        taps = std::max<uint32_t>(taps, static_cast<uint32_t>(w.size()));
+    }
+    taps = std::min(taps, src_len);
+
+    Filter filter;
+    filter.taps = taps;
+    filter.offset.resize(dst_len);
+    filter.weights.assign(static_cast<size_t>(dst_len) * taps, 0);
+    for (uint32_t i = 0; i < dst_len; i++) {
+        const auto& w = weights[i];
+        // Same tap count for every pixel, shift windows that would run past the end
+        const int32_t offset = std::min(first[i], static_cast<int32_t>(src_len - taps));
+        filter.offset[i] = offset;
+        double sum = 0.0;
+        for (double value : w) {
+            sum += value;
+        }
+        int16_t* dst = filter.weights.data() + static_cast<size_t>(i) * taps;
+        int32_t total = 0;
+        uint32_t peak = 0;
+        for (size_t k = 0; k < w.size(); k++) {
+            const uint32_t index = static_cast<uint32_t>(first[i] - offset + k);
+            dst[index] = static_cast<int16_t>(std::lround(w[k] / sum * kFilterOne));
+            total += dst[index];
+            if (dst[index] > dst[peak]) {
+                peak = index;
+            }
+        }
+        // Rounding must not change the brightness
+        dst[peak] = static_cast<int16_t>(dst[peak] + kFilterOne - total);
+    }
+    packFilter(&filter, src_len);
+    return filter;
+}
+
+CpuScaler::CpuScaler(Mode mode, SimdLevel level, ChromaSiting siting)
+    : mode_(mode)
+    , siting_(siting) {
+    level_ = resolveSimdLevel(level);
+    vertical_ = vertical_C;
+    horizontal_ = horizontal_C;
+    switch (level_) {
+#if defined(AMF_ARCH_X86)
+    case SimdLevel::SSE41:
+        vertical_ = vertical_SSE41;
+        horizontal_ = horizontal_SSE41;
+        break;
+    case SimdLevel::AVX2:
+    case SimdLevel::AVX512:
+        vertical_ = vertical_AVX2;
+        horizontal_ = horizontal_AVX2;
+        break;
+#endif
+#if defined(AMF_ARCH_ARM64)
+    case SimdLevel::NEON:
+        vertical_ = vertical_NEON;
+        break;
+#endif
+    default:
+        level_ = SimdLevel::SCALAR;
+        break;
+    }
+}
+
+const CpuScaler::Filter* CpuScaler::filter(uint32_t src_len, uint32_t dst_len, bool cosited) {
+    std::lock_guard<std::mutex> lock(filter_mtx_);
+    auto key = std::make_tuple(src_len, dst_len, cosited);
+    auto it = filters_.find(key);
+    if (it != filters_.end()) {
+        return it->second.get();
+    }
+    auto& entry = filters_[key];
+    entry = std::make_unique<Filter>(buildFilter(mode_, src_len, dst_len, cosited));
+    return entry.get();
+}
+
+void CpuScaler::scalePlane(const uint8_t* src, uint32_t src_pitch, uint32_t src_width,
+                           uint32_t src_height, uint8_t* dst, uint32_t dst_pitch,
+                           uint32_t dst_width, uint32_t dst_height, uint32_t channels,
+                           bool chroma) {
+    if (src_width == 0 || src_height == 0 || dst_width == 0 || dst_height == 0) {
+        return;
+    }
+    // Co-sited only moves chroma horizontally, vertically it stays between the rows
+    const Filter* fx = filter(src_width, dst_width, chroma && siting_ == ChromaSiting::LEFT);
+    const Filter* fy = filter(src_height, dst_height, false);
+    const uint32_t row_bytes = src_width * channels;
+    const bool copy_rows = fy->taps == 1;
+    auto vertical = vertical_;
+    auto horizontal_simd = horizontal_;
+
+    parallelForRows(dst_height, kMinRowsPerBand, [&](uint32_t begin, uint32_t end) {
+        // Per thread scratch, only grows
+        thread_local std::vector<uint8_t> tmp;
+        thread_local std::vector<const uint8_t*> rows;
+        tmp.resize(std::max<size_t>(tmp.size(), row_bytes));
+        rows.resize(std::max<size_t>(rows.size(), fy->taps));
+        for (uint32_t y = begin; y < end; y++) {
+            const int16_t* w = fy->weights.data() + static_cast<size_t>(y) * fy->taps;
+            for (uint32_t k = 0; k < fy->taps; k++) {
+                rows[k] = src + static_cast<size_t>(fy->offset[y] + k) * src_pitch;
+            }
+            const uint8_t* line = rows[0];
+            if (!copy_rows) {
+                const uint32_t done = vertical(rows.data(), w, fy->taps, tmp.data(), row_bytes);
+                verticalRange_C(rows.data(), w, fy->taps, tmp.data(), done, row_bytes);
+                line = tmp.data();
+            }
+            uint8_t* out = dst + static_cast<size_t>(y) * dst_pitch;
+            const uint32_t done = horizontal_simd(line, *fx, out, dst_width, channels);
+            if (channels == 2) {
+                horizontal<2>(line, *fx, out, done, dst_width);
+            }
+            else {
+                horizontal<1>(line, *fx, out, done, dst_width);
+            }
+        }
+    });
+}
+
+void CpuScaler::scaleNv12(const uint8_t* src_y, uint32_t src_y_pitch, const uint8_t* src_uv,
+                          uint32_t src_uv_pitch, uint32_t src_width, uint32_t src_height,
+                          uint8_t* dst_y, uint32_t dst_y_pitch, uint8_t* dst_uv,
+                          uint32_t dst_uv_pitch, uint32_t dst_width, uint32_t dst_height) {
+    scalePlane(src_y, src_y_pitch, src_width, src_height, dst_y, dst_y_pitch, dst_width,
+               dst_height);
+    scalePlane(src_uv, src_uv_pitch, (src_width + 1) / 2, (src_height + 1) / 2, dst_uv,
+               dst_uv_pitch, (dst_width + 1) / 2, (dst_height + 1) / 2, 2, true);
+}
+
+void CpuScaler::scaleI420(const uint8_t* src_y, uint32_t src_y_pitch, const uint8_t* src_u,
+                          uint32_t src_u_pitch, const uint8_t* src_v, uint32_t src_v_pitch,
+                          uint32_t src_width, uint32_t src_height, uint8_t* dst_y,
+                          uint32_t dst_y_pitch, uint8_t* dst_u, uint32_t dst_u_pitch,
+                          uint8_t* dst_v, uint32_t dst_v_pitch, uint32_t dst_width,
+                          uint32_t dst_height) {
+    const uint32_t src_uv_width = (src_width + 1) / 2;
+    const uint32_t src_uv_height = (src_height + 1) / 2;
+    const uint32_t dst_uv_width = (dst_width + 1) / 2;
+    const uint32_t dst_uv_height = (dst_height + 1) / 2;
+    scalePlane(src_y, src_y_pitch, src_width, src_height, dst_y, dst_y_pitch, dst_width,
+               dst_height);
+    scalePlane(src_u, src_u_pitch, src_uv_width, src_uv_height, dst_u, dst_u_pitch, dst_uv_width,
+               dst_uv_height, 1, true);
+    scalePlane(src_v, src_v_pitch, src_uv_width, src_uv_height, dst_v, dst_v_pitch, dst_uv_width,
+               dst_uv_height, 1, true);
+}
+
+} // namespace amf
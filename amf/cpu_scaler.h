@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "color_space.h"
+#include "cpu_features.h"
+
+namespace amf {
+
+// Separable NV12/I420 scaler on the cpu, the cpu side counterpart of the HQScaler component.
+// Filter tables are built once per (src, dst) length and kept for the scaler's lifetime, rows
+// are split over the ThreadPool. Both passes are vectorized, the horizontal one gathers 4 source
+// bytes per output pixel and lane. Chroma is resampled at its siting, co-sited chroma keeps its
+// position on the left luma column.
+class CpuScaler {
+public:
+    enum class Mode : uint8_t {
+        // 2 taps, cheapest, aliases below 1/2
+        BILINEAR = 0,
+        // Pixel coverage, the one to use for plain downscaling
+        AREA = 1,
+        // Catmull-Rom
+        BICUBIC = 2,
+        // Lanczos, 3 lobes
+        LANCZOS = 3,
+    };
+
+    // Q14 taps of one axis, `taps` weights for each output pixel starting at `offset`
+    struct Filter {
+        uint32_t taps = 0;
+        std::vector<int32_t> offset;
+        std::vector<int16_t> weights;
+
+        // The weights again for the simd horizontal pass, each int32 holds two of them for
+        // pmaddwd, chunk major so that consecutive outputs are adjacent.
+        // One channel: 4 taps per chunk, (w0, w2) in `even` and (w1, w3) in `odd`.
+        // Two channels: 2 taps per chunk, (w0, w1) in `pairs`.
+        uint32_t quad_chunks = 0;
+        uint32_t pair_chunks = 0;
+        std::vector<int32_t> quads_even;
+        std::vector<int32_t> quads_odd;
+        std::vector<int32_t> pairs;
+        // Outputs before these read their chunks within the source row
+        uint32_t quad_end = 0;
+        uint32_t pair_end = 0;
+    };
+
+    using VerticalFunc = uint32_t (*)(const uint8_t* const* rows, const int16_t* weights,
+                                      uint32_t taps, uint8_t* dst, uint32_t width);
+    // Returns how many output pixels it did, the scalar FIR does the rest
+    using HorizontalFunc = uint32_t (*)(const uint8_t* src, const Filter& filter, uint8_t* dst,
+                                        uint32_t dst_width, uint32_t channels);
+
+    explicit CpuScaler(Mode mode = Mode::BILINEAR, SimdLevel level = SimdLevel::AUTO,
+                       ChromaSiting siting = ChromaSiting::CENTER);
+
+    Mode mode() const { return mode_; }
+    SimdLevel level() const { return level_; }
+    ChromaSiting siting() const { return siting_; }
+
+    // `channels` is 2 for an interleaved UV plane, `chroma` planes are resampled at the siting
+    void scalePlane(const uint8_t* src, uint32_t src_pitch, uint32_t src_width,
+                    uint32_t src_height, uint8_t* dst, uint32_t dst_pitch, uint32_t dst_width,
+                    uint32_t dst_height, uint32_t channels = 1, bool chroma = false);
+
+    void scaleNv12(const uint8_t* src_y, uint32_t src_y_pitch, const uint8_t* src_uv,
+                   uint32_t src_uv_pitch, uint32_t src_width, uint32_t src_height, uint8_t* dst_y,
+                   uint32_t dst_y_pitch, uint8_t* dst_uv, uint32_t dst_uv_pitch,
+                   uint32_t dst_width, uint32_t dst_height);
+
+    void scaleI420(const uint8_t* src_y, uint32_t src_y_pitch, const uint8_t* src_u,
+                   uint32_t src_u_pitch, const uint8_t* src_v, uint32_t src_v_pitch,
+                   uint32_t src_width, uint32_t src_height, uint8_t* dst_y, uint32_t dst_y_pitch,
+                   uint8_t* dst_u, uint32_t dst_u_pitch, uint8_t* dst_v, uint32_t dst_v_pitch,
+                   uint32_t dst_width, uint32_t dst_height);
+
+    // `cosited` samples sit on the left edge of the luma pixel pair they cover instead of its
+    // middle, H.264/HEVC chroma location 0 horizontally
+    static Filter buildFilter(Mode mode, uint32_t src_len, uint32_t dst_len, bool cosited = false);
+
+private:
+    const Filter* filter(uint32_t src_len, uint32_t dst_len, bool cosited);
+
+private:
+    Mode mode_ = Mode::BILINEAR;
+    SimdLevel level_ = SimdLevel::SCALAR;
+    ChromaSiting siting_ = ChromaSiting::CENTER;
+    VerticalFunc vertical_ = nullptr;
+    HorizontalFunc horizontal_ = nullptr;
+
+    std::mutex filter_mtx_;
+    std::map<std::tuple<uint32_t, uint32_t, bool>, std::unique_ptr<Filter>> filters_;
+};
+
+} // namespace amf
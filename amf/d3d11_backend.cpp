@@ -0,0 +1,280 @@
+#include "d3d11_backend.h"
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <cinttypes>
+
+#include "amf_helper.h"
+#include "plane_copy.h"
+#include "yuv_convert.h"
+
+#define LOG_DEBUG(...) amf::log(0, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_INFO(...) amf::log(1, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_WARN(...) amf::log(2, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_ERROR(...) amf::log(3, __FILE__, __LINE__, __VA_ARGS__)
+
+static HMODULE get_lib(const char* lib) {
+    HMODULE mod = GetModuleHandleA(lib);
+    if (mod) {
+        return mod;
+    }
+    return LoadLibraryA(lib);
+}
+
+static Microsoft::WRL::ComPtr<IDXGIAdapter>
+findAdapter(Microsoft::WRL::ComPtr<IDXGIFactory2> factory, uint64_t target_luid) {
+    DXGI_ADAPTER_DESC desc;
+    Microsoft::WRL::ComPtr<IDXGIAdapter1> target_adapter;
+    for (uint32_t i = 0;; i++) {
+        Microsoft::WRL::ComPtr<IDXGIAdapter1> adapter;
+        auto hr = factory->EnumAdapters1(i, &adapter);
+        if (hr == DXGI_ERROR_NOT_FOUND) {
+            break;
+        }
+        hr = adapter->GetDesc(&desc);
+        uint64_t luid =
+            (static_cast<uint64_t>(desc.AdapterLuid.HighPart) << 32) + desc.AdapterLuid.LowPart;
+        LOG_INFO("Enum Adapter[%u,%" PRIu64 "]: %S", i, luid, desc.Description);
+        if (target_luid == 0 || (luid > 0 && luid == target_luid)) {
+            if (desc.VendorId == AMD_VENDOR_ID) {
+                LOG_INFO("Find AMD adapter on %u", i);
+                if (target_adapter == nullptr) {
+                    target_adapter = adapter;
+                    LOG_INFO("Choose adapter %" PRIu64 "", luid);
+                }
+            }
+        }
+    }
+    return target_adapter;
+}
+
+namespace amf {
+
+// Free textures kept across sizes
+static constexpr size_t kMaxPooledTextures = 8;
+
+D3D11Backend::D3D11Backend() {
+    ZeroMemory(&temp_texture_desc_, sizeof(temp_texture_desc_));
+}
+
+D3D11Backend::~D3D11Backend() {
+    uninit();
+}
+
+bool D3D11Backend::init(uint64_t lluid) {
+    if (!AmfModuleWrapper::instance()) {
+        LOG_ERROR("Failed to get amf module");
+        return false;
+    }
+    typedef HRESULT(WINAPI * CREATEDXGIFACTORY1PROC)(REFIID, void**);
+    HMODULE dxgi = get_lib("DXGI.dll");
+    HMODULE d3d11 = get_lib("D3D11.dll");
+    if (!dxgi || !d3d11) {
+        LOG_ERROR("Failed to load d3d11|dxgi related library");
+        return false;
+    }
+    CREATEDXGIFACTORY1PROC create_dxgi =
+        (CREATEDXGIFACTORY1PROC)GetProcAddress(dxgi, "CreateDXGIFactory1");
+    PFN_D3D11_CREATE_DEVICE create_device =
+        (PFN_D3D11_CREATE_DEVICE)GetProcAddress(d3d11, "D3D11CreateDevice");
+    if (!create_dxgi || !create_device) {
+        LOG_ERROR("Failed to load CreateDXGIFactory1|D3D11CreateDevice");
+        return false;
+    }
+    Microsoft::WRL::ComPtr<IDXGIFactory2> factory;
+    auto hr = create_dxgi(__uuidof(IDXGIFactory2), (void**)&factory);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to create dxgi factory, hr:%u", hr);
+        return false;
+    }
+    auto adapter = findAdapter(factory, lluid);
+    if (!adapter) {
+        LOG_ERROR("Failed to find AMD video card on adapter %" PRIu64 "", lluid);
+        return false;
+    }
+    UINT flag = 0;
+#ifdef _DEBUG
+    flag |= D3D11_CREATE_DEVICE_DEBUG;
+#endif
+    hr = create_device(adapter.Get(), D3D_DRIVER_TYPE_UNKNOWN, nullptr, flag, nullptr, 0,
+                       D3D11_SDK_VERSION, &d3d11_dev_, nullptr, &d3d11_ctx_);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to call D3D11CreateDevicem, hr:%u", hr);
+        return false;
+    }
+    Microsoft::WRL::ComPtr<ID3D10Multithread> multi_thread = NULL;
+    d3d11_dev_->QueryInterface(__uuidof(ID3D10Multithread), (void**)&multi_thread);
+    if (multi_thread) {
+        multi_thread->SetMultithreadProtected(true);
+        multi_thread = nullptr;
+    }
+
+    DXGI_ADAPTER_DESC desc;
+    hr = adapter->GetDesc(&desc);
+    luid_ = (static_cast<uint64_t>(desc.AdapterLuid.HighPart) << 32) + desc.AdapterLuid.LowPart;
+    LOG_INFO("D3d11 initialized on adapter %" PRIu64 "", luid_);
+    ZeroMemory(&temp_texture_desc_, sizeof(temp_texture_desc_));
+
+    auto res = AmfModuleWrapper::instance()->factory->CreateContext(&amf_context_);
+    if (res != AMF_OK || !amf_context_) {
+        LOG_ERROR("Failed to call CreateContext, res:%d", res);
+        return false;
+    }
+    res = amf_context_->InitDX11(d3d11_dev_.Get(), AMF_DX11_1);
+    if (res != AMF_OK) {
+        LOG_ERROR("Failed to call InitDX11, res:%d", res);
+        return false;
+    }
+    return true;
+}
+
+void D3D11Backend::uninit() {
+    if (amf_context_) {
+        amf_context_->Terminate();
+        amf_context_ = nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(texture_mtx_);
+        active_textures_.clear();
+        available_textures_.clear();
+    }
+    temp_texture_ = nullptr;
+    ZeroMemory(&temp_texture_desc_, sizeof(temp_texture_desc_));
+
+    d3d11_dev_ = nullptr;
+    d3d11_ctx_ = nullptr;
+    luid_ = 0;
+    input_format_ = VideoFormat::UNKNOWN;
+}
+
+AMF_RESULT D3D11Backend::createEncoder(const wchar_t* codec, AMFComponent** encoder) {
+    if (!amf_context_) {
+        return AMF_NOT_INITIALIZED;
+    }
+    return AmfModuleWrapper::instance()->factory->CreateComponent(amf_context_, codec, encoder);
+}
+
+AMFSurfacePtr D3D11Backend::upload(const VideoFrameView& frame) {
+    auto texture = copyFrameToTexture(frame);
+    if (!texture) {
+        return nullptr;
+    }
+    AMFSurfacePtr amf_surf;
+    auto res = amf_context_->CreateSurfaceFromDX11Native(texture.Get(), &amf_surf, this);
+    if (res != AMF_OK) {
+        LOG_ERROR("CreateSurfaceFromDX11Native failed, res:%d", res);
+        std::lock_guard<std::mutex> lock(texture_mtx_);
+        available_textures_.push_back(texture);
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(texture_mtx_);
+    active_textures_[amf_surf.GetPtr()] = texture;
+    return amf_surf;
+}
+
+void AMF_STD_CALL D3D11Backend::OnSurfaceDataRelease(AMFSurface* pSurface) {
+    std::lock_guard<std::mutex> lock(texture_mtx_);
+    auto it = active_textures_.find(pSurface);
+    if (it != active_textures_.end()) {
+        available_textures_.push_back(it->second);
+        active_textures_.erase(it);
+    }
+}
+
+Microsoft::WRL::ComPtr<ID3D11Texture2D>
+D3D11Backend::getAvailableTexture(const D3D11_TEXTURE2D_DESC& desc_src) {
+    std::lock_guard<std::mutex> lock(texture_mtx_);
+    // Textures of another size stay pooled for a while, a window often goes back to its size
+    auto match = std::find_if(available_textures_.rbegin(), available_textures_.rend(),
+                              [&desc_src](const Microsoft::WRL::ComPtr<ID3D11Texture2D>& item) {
+                                  D3D11_TEXTURE2D_DESC desc;
+                                  item->GetDesc(&desc);
+                                  return desc.Format == desc_src.Format &&
+                                         desc.Width == desc_src.Width &&
+                                         desc.Height == desc_src.Height;
+                              });
+    if (match != available_textures_.rend()) {
+        std::swap(*match, available_textures_.back());
+    }
+    else {
+        if (available_textures_.size() >= kMaxPooledTextures) {
+            // Oldest first
+            available_textures_.erase(available_textures_.begin());
+        }
+        D3D11_TEXTURE2D_DESC desc = desc_src;
+        desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+        desc.MiscFlags = 0;
+        desc.CPUAccessFlags = 0;
+        desc.Usage = D3D11_USAGE_DEFAULT;
+        Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+        auto hr = d3d11_dev_->CreateTexture2D(&desc, nullptr, &texture);
+        if (hr != S_OK) {
+            LOG_ERROR("Failed to create texture, hr:%u", hr);
+            return nullptr;
+        }
+        available_textures_.push_back(texture);
+    }
+    assert(!available_textures_.empty());
+    auto output = available_textures_.back();
+    available_textures_.pop_back();
+    return output;
+}
+
+Microsoft::WRL::ComPtr<ID3D11Texture2D>
+D3D11Backend::copyFrameToTexture(const VideoFrameView& frame) {
+    const uint32_t width = frame.width;
+    const uint32_t height = frame.height;
+    if (!temp_texture_ || temp_texture_desc_.Width != width ||
+        temp_texture_desc_.Height != height ||
+        temp_texture_desc_.CPUAccessFlags != D3D11_CPU_ACCESS_WRITE) {
+        D3D11_TEXTURE2D_DESC desc;
+        desc.Width = width;
+        desc.Height = height;
+        desc.Format = DXGI_FORMAT_NV12;
+        desc.ArraySize = 1;
+        desc.BindFlags = 0;
+        desc.MiscFlags = 0;
+        desc.SampleDesc.Count = 1;
+        desc.SampleDesc.Quality = 0;
+        desc.MipLevels = 1;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        desc.Usage = D3D11_USAGE_STAGING;
+        auto hr = d3d11_dev_->CreateTexture2D(&desc, NULL, &temp_texture_);
+        if (FAILED(hr)) {
+            return nullptr;
+        }
+        temp_texture_->GetDesc(&temp_texture_desc_);
+    }
+    if (input_format_ != frame.format) {
+        LOG_INFO("Input format is %s Pixel", frame.format == VideoFormat::I420 ? "I420" : "NV12");
+        input_format_ = frame.format;
+    }
+    auto gpu_texture = getAvailableTexture(temp_texture_desc_);
+    if (!gpu_texture) {
+        LOG_WARN("All textures in busy, drop frame");
+        return nullptr;
+    }
+    D3D11_MAPPED_SUBRESOURCE resource;
+    auto hr = d3d11_ctx_->Map(temp_texture_.Get(), 0, D3D11_MAP_WRITE, 0, &resource);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to map nv12 texture, hr:%u", hr);
+        return nullptr;
+    }
+    uint8_t* dst_y = static_cast<uint8_t*>(resource.pData);
+    uint8_t* dst_uv = dst_y + static_cast<size_t>(resource.RowPitch) * temp_texture_desc_.Height;
+    if (frame.format == VideoFormat::I420) {
+        copyI420ToNv12(frame.data[0], frame.pitch[0], frame.data[1], frame.pitch[1],
+                       frame.data[2], frame.pitch[2], dst_y, resource.RowPitch, dst_uv,
+                       resource.RowPitch, width, height);
+    }
+    else {
+        copyNv12(frame.data[0], frame.pitch[0], frame.data[1], frame.pitch[1], dst_y,
+                 resource.RowPitch, dst_uv, resource.RowPitch, width, height);
+    }
+    d3d11_ctx_->Unmap(temp_texture_.Get(), 0);
+    d3d11_ctx_->CopyResource(gpu_texture.Get(), temp_texture_.Get());
+    return gpu_texture;
+}
+
+} // namespace amf
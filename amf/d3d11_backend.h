@@ -0,0 +1,56 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "core/Context.h"
+#include "encoder_backend.h"
+
+namespace amf {
+
+// AMF on a D3D11 device of an AMD adapter. Frames are uploaded through a staging texture into
+// pooled NV12 textures, a texture goes back to the pool once the encoder releases its surface.
+class D3D11Backend : public EncoderBackend, public AMFSurfaceObserver {
+public:
+    D3D11Backend();
+    ~D3D11Backend() override;
+
+    const char* name() const override { return "d3d11"; }
+
+    bool init(uint64_t luid) override;
+    void uninit() override;
+    uint64_t luid() const override { return luid_; }
+
+    AMF_RESULT createEncoder(const wchar_t* codec, AMFComponent** encoder) override;
+
+    AMFSurfacePtr upload(const VideoFrameView& frame) override;
+
+private:
+    void AMF_STD_CALL OnSurfaceDataRelease(AMFSurface* pSurface) override;
+
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> copyFrameToTexture(const VideoFrameView& frame);
+
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> getAvailableTexture(const D3D11_TEXTURE2D_DESC& desc);
+
+private:
+    uint64_t luid_ = 0;
+    Microsoft::WRL::ComPtr<ID3D11Device> d3d11_dev_;
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext> d3d11_ctx_;
+
+    AMFContextPtr amf_context_ = nullptr;
+
+    std::mutex texture_mtx_;
+    std::vector<Microsoft::WRL::ComPtr<ID3D11Texture2D>> available_textures_;
+    std::unordered_map<AMFSurface*, Microsoft::WRL::ComPtr<ID3D11Texture2D>> active_textures_;
+
+    D3D11_TEXTURE2D_DESC temp_texture_desc_;
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> temp_texture_;
+
+    VideoFormat input_format_ = VideoFormat::UNKNOWN;
+};
+
+} // namespace amf
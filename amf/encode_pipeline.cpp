@@ -0,0 +1,203 @@
+#include "encode_pipeline.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace amf {
+// Defined in amf_helper.cpp, declared here to keep this file free of d3d headers
+void log(int level, const char* file, int line, const char* format, ...);
+} // namespace amf
+
+#define LOG_DEBUG(...) amf::log(0, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_INFO(...) amf::log(1, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_WARN(...) amf::log(2, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_ERROR(...) amf::log(3, __FILE__, __LINE__, __VA_ARGS__)
+
+using namespace std::chrono_literals;
+
+static int64_t cur_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+namespace amf {
+
+EncodePipeline::EncodePipeline(AMFComponentPtr encoder, Sink sink, uint32_t max_parked)
+    : encoder_(encoder)
+    , sink_(std::move(sink))
+    , max_parked_(std::max(max_parked, 1u)) {
+    output_thread_ = std::thread([this]() { outputLoop(); });
+}
+
+EncodePipeline::~EncodePipeline() {
+    stop();
+}
+
+bool EncodePipeline::submit(AMFData* input, const EncodedFrameInfo& info) {
+    if (!input) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (stopping_) {
+        return false;
+    }
+    Pending pending;
+    pending.data = input;
+    pending.info = info;
+    pending.info.submit_time = cur_time();
+    // The output is matched by pts, in AMF units of 100ns
+    const amf_pts pts = std::max<amf_pts>(info.capture_time * 10, last_pts_ + 1);
+    last_pts_ = pts;
+    pending.data->SetPts(pts);
+    parked_.push_back(std::move(pending));
+    auto res = submitParked();
+    cv_.notify_one();
+    if (res == AMF_INPUT_FULL) {
+        stats_.input_full++;
+        dropParked();
+    }
+    // On any other error submitParked() already dropped the frame
+    return res == AMF_OK || res == AMF_INPUT_FULL;
+}
+
+AMF_RESULT EncodePipeline::submitParked() {
+    while (!parked_.empty()) {
+        auto& front = parked_.front();
+        auto res = encoder_->SubmitInput(front.data);
+        if (res == AMF_INPUT_FULL) {
+            return res;
+        }
+        if (res != AMF_OK && res != AMF_NEED_MORE_INPUT) {
+            LOG_ERROR("Failed to call SubmitInput, frame:%llu, res:%d",
+                      static_cast<unsigned long long>(front.info.frame_id), res);
+            parked_.pop_front();
+            stats_.dropped++;
+            return res;
+        }
+        in_flight_.emplace_back(front.data->GetPts(), front.info);
+        parked_.pop_front();
+        stats_.submitted++;
+    }
+    return AMF_OK;
+}
+
+void EncodePipeline::dropParked() {
+    // Latency matters more than every single frame, keep the newest ones
+    while (parked_.size() > max_parked_) {
+        auto victim = std::find_if(parked_.begin(), parked_.end(),
+                                   [](const Pending& p) { return !p.info.force_key; });
+        // Only key frames left, a newer one still resets the stream
+        if (victim == parked_.end()) {
+            victim = parked_.begin();
+        }
+        parked_.erase(victim);
+        stats_.dropped++;
+    }
+}
+
+bool EncodePipeline::takeInfo(amf_pts pts, EncodedFrameInfo* info) {
+    for (auto it = in_flight_.begin(); it != in_flight_.end(); ++it) {
+        if (it->first == pts) {
+            *info = it->second;
+            in_flight_.erase(it);
+            return true;
+        }
+    }
+    if (in_flight_.empty()) {
+        return false;
+    }
+    // Without B frames packets come out in submission order
+    *info = in_flight_.front().second;
+    in_flight_.pop_front();
+    return true;
+}
+
+void EncodePipeline::outputLoop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            // Nothing can come out until the next submit, QueryOutput would only block
+            cv_.wait(lock,
+                     [this]() { return !in_flight_.empty() || !parked_.empty() || stopping_; });
+            submitParked();
+            if (stopping_ && cur_time() >= stop_deadline_) {
+                break;
+            }
+            if (stopping_ && parked_.empty()) {
+                if (!drained_) {
+                    drained_ = encoder_->Drain() != AMF_INPUT_FULL;
+                }
+                // Not every encoder reports AMF_EOF after a drain
+                if (drained_ && in_flight_.empty()) {
+                    break;
+                }
+            }
+        }
+        AMFDataPtr packet;
+        // Blocks up to the QUERY_TIMEOUT of the encoder
+        auto res = encoder_->QueryOutput(&packet);
+        if (res == AMF_OK && packet) {
+            EncodedFrameInfo info;
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                if (!takeInfo(packet->GetPts(), &info)) {
+                    LOG_WARN("Packet without a frame, pts:%lld",
+                             static_cast<long long>(packet->GetPts()));
+                }
+                stats_.encoded++;
+                // The packet freed a slot in the input queue
+                submitParked();
+            }
+            info.output_time = cur_time();
+            sink_(packet, info);
+            continue;
+        }
+        if (res == AMF_EOF) {
+            break;
+        }
+        if (res != AMF_OK && res != AMF_REPEAT) {
+            LOG_ERROR("QueryOutput failed, res:%d", res);
+        }
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait_for(lock, 1ms);
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!in_flight_.empty() || !parked_.empty()) {
+        complete_ = false;
+        LOG_WARN("Output stopped with %zu frames in flight, %zu parked", in_flight_.size(),
+                 parked_.size());
+    }
+    stats_.dropped += in_flight_.size() + parked_.size();
+    in_flight_.clear();
+    parked_.clear();
+}
+
+bool EncodePipeline::stop(uint32_t timeout_ms) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!stopping_) {
+            stopping_ = true;
+            stop_deadline_ = cur_time() + static_cast<int64_t>(timeout_ms) * 1000;
+        }
+    }
+    cv_.notify_one();
+    // Bounded by the deadline plus one QueryOutput, which waits QUERY_TIMEOUT at most
+    if (output_thread_.joinable()) {
+        output_thread_.join();
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    return complete_;
+}
+
+uint32_t EncodePipeline::inFlight() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return static_cast<uint32_t>(in_flight_.size());
+}
+
+EncodePipeline::Stats EncodePipeline::stats() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return stats_;
+}
+
+} // namespace amf
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "components/Component.h"
+
+namespace amf {
+
+// Travels with a frame from submit() to its packet
+struct EncodedFrameInfo {
+    uint64_t frame_id = 0;
+    // Microseconds, steady clock
+    int64_t capture_time = 0;
+    int64_t submit_time = 0;
+    int64_t output_time = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool force_key = false;
+    // Filled from the packet by the owner of the sink
+    bool key_frame = false;
+    uint32_t qp = 0;
+
+    // False for a packet that could not be matched to its frame, its latencies are unknown
+    bool timed() const {
+        return capture_time > 0 && submit_time >= capture_time && output_time >= submit_time;
+    }
+};
+
+// Splits SubmitInput and QueryOutput of an encoder component across two threads.
+// submit() never waits for the encoder: when its input queue is full the frame is parked and the
+// output thread submits it again as soon as a packet has been taken out. Every packet is passed to
+// the sink on the output thread together with the info of its frame, matched by pts.
+// Only the AMFComponent interface is used, any implementation of it can drive the pipeline.
+class EncodePipeline {
+public:
+    using Sink = std::function<void(AMFDataPtr& packet, const EncodedFrameInfo& info)>;
+
+    struct Stats {
+        uint64_t submitted = 0;
+        uint64_t encoded = 0;
+        // Parked frames replaced by newer ones, or refused by the encoder
+        uint64_t dropped = 0;
+        // Times submit() had to park a frame
+        uint64_t input_full = 0;
+    };
+
+    // `max_parked` frames wait for the encoder at most, the oldest is dropped beyond that. A frame
+    // with force_key is only dropped for a newer one with force_key, the stream would go on
+    // without its key frame otherwise.
+    EncodePipeline(AMFComponentPtr encoder, Sink sink, uint32_t max_parked = 1);
+    ~EncodePipeline();
+
+    // False when the encoder refused the frame
+    bool submit(AMFData* input, const EncodedFrameInfo& info);
+
+    // Submits what is parked, drains the encoder and delivers every remaining packet. Gives up
+    // on an encoder that is still busy after `timeout_ms`, the rest is counted as dropped and
+    // false is returned.
+    bool stop(uint32_t timeout_ms = 2000);
+
+    // Frames submitted to the encoder whose packet has not arrived yet
+    uint32_t inFlight() const;
+    Stats stats() const;
+
+private:
+    struct Pending {
+        AMFDataPtr data;
+        EncodedFrameInfo info;
+    };
+
+    void outputLoop();
+    // With mtx_ held. AMF_INPUT_FULL leaves the frame parked.
+    AMF_RESULT submitParked();
+    bool takeInfo(amf_pts pts, EncodedFrameInfo* info);
+    // With mtx_ held. Drops parked frames down to max_parked_, keeping those with force_key.
+    void dropParked();
+
+private:
+    AMFComponentPtr encoder_;
+    Sink sink_;
+    const uint32_t max_parked_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Pending> parked_;
+    // In submission order, the encoder may not carry the pts through
+    std::deque<std::pair<amf_pts, EncodedFrameInfo>> in_flight_;
+    amf_pts last_pts_ = -1;
+    Stats stats_;
+    bool stopping_ = false;
+    bool drained_ = false;
+    // Steady clock, microseconds. The output thread abandons the drain past it.
+    int64_t stop_deadline_ = 0;
+    bool complete_ = true;
+
+    std::thread output_thread_;
+};
+
+} // namespace amf
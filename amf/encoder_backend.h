@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+#include "components/Component.h"
+#include "video_frame.h"
+
+namespace amf {
+
+// Device, input surfaces and encoder component underneath AmfEncoder.
+// The rate control, QP and key frame logic only talks to the AMF interfaces handed out here, so
+// it runs the same on a gpu and on an in-memory stand-in.
+class EncoderBackend {
+public:
+    virtual ~EncoderBackend() = default;
+
+    virtual const char* name() const = 0;
+
+    // `luid` picks the adapter, 0 takes the first one that fits
+    virtual bool init(uint64_t luid) = 0;
+    virtual void uninit() = 0;
+    // Adapter in use, 0 when the backend has none
+    virtual uint64_t luid() const = 0;
+
+    // The component still has to be configured and initialized, see AMFComponent::Init
+    virtual AMF_RESULT createEncoder(const wchar_t* codec, AMFComponent** encoder) = 0;
+
+    // Copies an NV12 or I420 frame into an NV12 surface the encoder takes, nullptr when no
+    // surface is free. The planes are only read during the call.
+    virtual AMFSurfacePtr upload(const VideoFrameView& frame) = 0;
+};
+
+} // namespace amf
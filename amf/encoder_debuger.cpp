@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "amf_helper.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#endif
+
+namespace amf {
+
+void AmfEncoderDebuger::addInput(uint32_t target_fps, int64_t at_time) {
+    inputs_.push(at_time, target_fps);
+}
+
+void AmfEncoderDebuger::addOuput(size_t size, uint32_t qp, uint32_t target_bitrate,
+                                 int64_t at_time, bool timed, uint32_t upload_us,
+                                 uint32_t encode_us) {
+    OutputFrame frame;
+    frame.size = static_cast<uint32_t>(size);
+    frame.qp = qp;
+    frame.target_bitrate = target_bitrate;
+    frame.upload_us = upload_us;
+    frame.encode_us = encode_us;
+    frame.timed = timed;
+    outputs_.push(at_time, frame);
+}
+
+bool AmfEncoderDebuger::stat(std::vector<Statistics>& outputs, int64_t at_time,
+                             int64_t interval_ms) {
+    if (outputs_.empty() || at_time - last_stat_time_ <= interval_ms * 1000) {
+        return false;
+    }
+    last_stat_time_ = at_time - interval_ms * 1000;
+
+    while (last_stat_time_ < at_time) {
+        Statistics output;
+        auto start_time = last_stat_time_;
+        auto end_time = start_time + 1000 * 1000;
+
+        // Samples at both ends belong to the second
+        size_t first = inputs_.lowerBound(start_time);
+        size_t count = inputs_.upperBound(end_time) - first;
+        if (count == 0) {
+            last_stat_time_ = end_time;
+            continue;
+        }
+        for (size_t i = first; i < first + count; i++) {
+            output.target_fps += inputs_.at(i);
+        }
+        output.target_fps = static_cast<uint32_t>(output.target_fps * 1.0f / count + 0.5);
+        output.input_fps = static_cast<uint32_t>(count);
+
+        first = outputs_.lowerBound(start_time);
+        count = outputs_.upperBound(end_time) - first;
+        if (count > 0) {
+            for (size_t i = first; i < first + count; i++) {
+                const OutputFrame& frame = outputs_.at(i);
+                output.target_bitrate += frame.target_bitrate;
+                output.frame_size.add(frame.size);
+                output.qp.add(frame.qp);
+                if (frame.timed) {
+                    output.upload_latency.add(frame.upload_us);
+                    output.encode_latency.add(frame.encode_us);
+                }
+            }
+            output.target_bitrate =
+                static_cast<uint32_t>(output.target_bitrate * 1.0f / count + 0.5);
+            output.output_bitrate = static_cast<uint32_t>(output.frame_size.average * 8.0f + 0.5);
+        }
+        output.frame_size.update();
+        output.qp.update();
+        output.upload_latency.update();
+        output.encode_latency.update();
+        last_stat_time_ = end_time;
+        outputs.push_back(output);
+    }
+    last_stat_time_ = std::min(at_time, last_stat_time_);
+    return true;
+}
+
+std::string AmfEncoderDebuger::Statistics::to_str() {
+    /*
+      uint32_t target_fps = 0;
+      uint32_t input_fps = 0;
+      uint32_t target_bitrate = 0;
+      uint32_t output_bitrate = 0;
+      DebugValue<size_t> frame_size;
+      DebugValue<uint32_t> qp;
+    */
+    char buffer[1024] = {0};
+    snprintf(buffer, sizeof(buffer), "{%u|%u, %u|%ukbps, %uByte, %u|%u}", target_fps, input_fps,
+             static_cast<uint32_t>(target_bitrate / 1000.f + 0.5),
+             static_cast<uint32_t>(output_bitrate / 1000.f + 0.5), (uint32_t)frame_size.medium,
+             qp.medium, qp.max);
+    return buffer;
+}
+
+std::string AmfEncoderDebuger::Statistics::percentiles_str() {
+    char buffer[1024] = {0};
+    snprintf(buffer, sizeof(buffer),
+             "{size %u|%u|%u|%uByte, qp %u|%u|%u|%u, upload %u|%u|%u|%uus, encode %u|%u|%u|%uus}",
+             (uint32_t)frame_size.medium, (uint32_t)frame_size.p90, (uint32_t)frame_size.p99,
+             (uint32_t)frame_size.max, qp.medium, qp.p90, qp.p99, qp.max, upload_latency.medium,
+             upload_latency.p90, upload_latency.p99, upload_latency.max, encode_latency.medium,
+             encode_latency.p90, encode_latency.p99, encode_latency.max);
+    return buffer;
+}
+} // namespace amf
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
@@ -0,0 +1,195 @@
+#include "encoder_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace amf {
+
+static constexpr uint32_t kRowStep = 8;
+
+// Least squares of ln(size) over qp. With too narrow a QP range (a CBR log usually is) only the
+// scale is fitted, the slope is kept.
+static bool fitFrameType(const std::vector<std::pair<double, double>>& samples,
+                         EncoderModel::FrameType* type) {
+    const size_t n = samples.size();
+    if (n < 8) {
+        return false;
+    }
+    double mean_qp = 0.0;
+    double mean_size = 0.0;
+    for (auto& sample : samples) {
+        mean_qp += sample.first;
+        mean_size += sample.second;
+    }
+    mean_qp /= n;
+    mean_size /= n;
+    double sxx = 0.0;
+    double sxy = 0.0;
+    for (auto& sample : samples) {
+        sxx += (sample.first - mean_qp) * (sample.first - mean_qp);
+        sxy += (sample.first - mean_qp) * (sample.second - mean_size);
+    }
+    double slope = sxx > 0.0 ? -sxy / sxx : 0.0;
+    if (sxx / n < 4.0 || slope < 0.03 || slope > 0.3) {
+        slope = type->slope;
+    }
+    const double scale = mean_size + slope * mean_qp;
+    double residual = 0.0;
+    for (auto& sample : samples) {
+        const double error = sample.second - (scale - slope * sample.first);
+        residual += error * error;
+    }
+    type->scale = scale;
+    type->slope = slope;
+    type->sigma = std::sqrt(residual / n);
+    return true;
+}
+
+bool EncoderModel::calibrate(const std::string& log_path, Params* params) {
+    std::ifstream file(log_path);
+    if (!file) {
+        return false;
+    }
+    std::vector<std::pair<double, double>> key;
+    std::vector<std::pair<double, double>> delta;
+    double pixels = 0.0;
+    std::string line;
+    while (std::getline(file, line)) {
+        const char* settings = std::strstr(line.c_str(), "settings: ");
+        const char* resized = std::strstr(line.c_str(), "Encoder resized to ");
+        unsigned width = 0;
+        unsigned height = 0;
+        if ((settings && std::sscanf(settings, "settings: %u X %u", &width, &height) == 2) ||
+            (resized &&
+             std::sscanf(resized, "Encoder resized to %ux%u", &width, &height) == 2)) {
+            pixels = static_cast<double>(width) * height;
+            continue;
+        }
+        const char* frame = std::strstr(line.c_str(), "Frame ");
+        unsigned long long index = 0;
+        char type = 0;
+        unsigned qp = 0;
+        unsigned long long size = 0;
+        if (!frame || pixels <= 0.0 ||
+            std::sscanf(frame, "Frame %llu, %c, QP: %u, size: %llu B", &index, &type, &qp,
+                        &size) != 4 ||
+            size == 0) {
+            continue;
+        }
+        auto sample = std::make_pair(static_cast<double>(qp), std::log(size / pixels));
+        (type == 'I' ? key : delta).push_back(sample);
+    }
+    Params fitted = *params;
+    const bool key_fitted = fitFrameType(key, &fitted.key);
+    const bool delta_fitted = fitFrameType(delta, &fitted.delta);
+    if (!delta_fitted) {
+        return false;
+    }
+    if (!key_fitted) {
+        // Keep the key to P frame ratio of the current params
+        fitted.key.scale = params->key.scale - params->delta.scale + fitted.delta.scale;
+    }
+    *params = fitted;
+    return true;
+}
+
+EncoderModel::EncoderModel()
+    : EncoderModel(Params()) {}
+
+EncoderModel::EncoderModel(const Params& params, uint32_t seed)
+    : params_(params)
+    , rng_(seed) {}
+
+void EncoderModel::reset() {
+    pixels_ = 0;
+    spatial_ = 0.0;
+    temporal_ = 0.0;
+    prev_rows_.clear();
+    fullness_ = 0.0;
+    last_qp_ = 0;
+}
+
+void EncoderModel::analyze(const uint8_t* y, uint32_t pitch, uint32_t width, uint32_t height) {
+    if (!y || width < 2 || height == 0) {
+        return;
+    }
+    const uint32_t rows = (height + kRowStep - 1) / kRowStep;
+    const bool has_prev = pixels_ == width * height && prev_rows_.size() == size_t(rows) * width;
+    prev_rows_.resize(size_t(rows) * width);
+    uint64_t gradient = 0;
+    uint64_t difference = 0;
+    for (uint32_t row = 0; row < rows; row++) {
+        const uint8_t* src = y + size_t(row) * kRowStep * pitch;
+        uint8_t* prev = prev_rows_.data() + size_t(row) * width;
+        for (uint32_t x = 0; x + 1 < width; x++) {
+            gradient += std::abs(src[x + 1] - src[x]);
+        }
+        if (has_prev) {
+            for (uint32_t x = 0; x < width; x++) {
+                difference += std::abs(src[x] - prev[x]);
+            }
+        }
+        std::memcpy(prev, src, width);
+    }
+    pixels_ = width * height;
+    spatial_ = gradient / (double(rows) * (width - 1));
+    temporal_ = has_prev ? difference / (double(rows) * width) : spatial_;
+}
+
+double EncoderModel::predict(const FrameType& type, double complexity, double qp) const {
+    return pixels_ * std::exp(type.scale - type.slope * qp) *
+           std::pow(complexity, params_.complexity_exponent);
+}
+
+EncoderModel::Frame EncoderModel::encode(bool key, const Settings& settings) {
+    const FrameType& type = key ? params_.key : params_.delta;
+    // Flat or static content still costs headers and skipped macroblocks
+    const double complexity =
+        std::max(key ? spatial_ / params_.reference_spatial
+                     : temporal_ / params_.reference_temporal,
+                 0.05);
+    const double fps = settings.fps > 0.0 ? settings.fps : 30.0;
+    const double budget = settings.bitrate / 8.0 / fps;
+    const double vbv = (settings.vbv_size ? settings.vbv_size : settings.bitrate) / 8.0;
+    const uint32_t min_qp = std::min(settings.min_qp, settings.max_qp);
+    const uint32_t max_qp = settings.max_qp;
+
+    // Steer the fullness back to half the buffer over ~8 frames
+    double target = budget + (vbv * 0.5 - fullness_) / 8.0;
+    if (key) {
+        // A key frame gets what it costs at the P frame QP, up to half the free buffer
+        const double ratio = std::exp(params_.key.scale - params_.delta.scale);
+        target = std::min(budget * ratio, std::max(vbv - fullness_, budget) * 0.5);
+    }
+    target = std::max(target, budget * 0.1);
+
+    Frame frame;
+    double qp = min_qp;
+    if (pixels_ > 0 && target > 0.0) {
+        qp = (std::log(predict(type, complexity, 0.0)) - std::log(target)) / type.slope;
+    }
+    qp = std::round(qp);
+    if (!key && last_qp_ > 0) {
+        // Hardware rate control moves P frames a few QP at a time
+        qp = std::min(std::max(qp, last_qp_ - 4.0), last_qp_ + 4.0);
+    }
+    frame.qp = static_cast<uint32_t>(std::min<double>(std::max<double>(qp, min_qp), max_qp));
+    if (!key) {
+        last_qp_ = frame.qp;
+    }
+    const double noise = std::exp(type.sigma * normal_(rng_));
+    frame.size = static_cast<size_t>(std::max(predict(type, complexity, frame.qp) * noise, 16.0));
+
+    fullness_ += frame.size;
+    frame.overflow = fullness_ > vbv;
+    frame.fullness = fullness_;
+    // The channel drains one budget per frame interval
+    fullness_ = std::max(fullness_ - budget, 0.0);
+    return frame;
+}
+
+} // namespace amf
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace amf {
+
+// Statistical stand-in for the rate control of a hardware encoder.
+// Frame sizes follow bytes = pixels * exp(scale - slope * qp) * complexity^exponent * noise, with
+// separate parameters for key and P frames. A CBR rate control picks the QP of every frame from
+// the VBV buffer fullness, within the QP range the encoder is currently configured with.
+class EncoderModel {
+public:
+    struct FrameType {
+        // ln(bytes per pixel) at QP 0 and typical complexity
+        double scale = 0.0;
+        // ln(size) lost per QP step, ln(2) / 6 in theory
+        double slope = 0.1155;
+        // Standard deviation of ln(size) around the prediction
+        double sigma = 0.15;
+    };
+
+    struct Params {
+        // H.264 on desktop content: 0.03 / 0.004 bytes per pixel at QP 30
+        FrameType key{-0.04, 0.1155, 0.10};
+        FrameType delta{-2.06, 0.1155, 0.20};
+        // Size grows with complexity^exponent, complexity 1 is the content the params came from
+        double complexity_exponent = 0.8;
+        // Mean absolute horizontal gradient and frame difference of that content, in luma levels
+        double reference_spatial = 8.0;
+        double reference_temporal = 2.0;
+    };
+
+    struct Settings {
+        uint64_t bitrate = 0;
+        double fps = 30.0;
+        // Bits, 0 holds one second
+        uint64_t vbv_size = 0;
+        uint32_t min_qp = 0;
+        uint32_t max_qp = 51;
+    };
+
+    struct Frame {
+        uint32_t qp = 0;
+        size_t size = 0;
+        // VBV fullness in bytes once the frame is in
+        double fullness = 0.0;
+        // The frame did not fit in the VBV buffer
+        bool overflow = false;
+    };
+
+    // Fits Params to the "Frame N, I|P, QP: q, size: s B" lines AmfEncoder writes to its log,
+    // frames are normalized by the resolution of the preceding "settings: W X H" or
+    // "Encoder resized to WxH" line.
+    // False when the log holds too few frames, `params` then keeps what it had.
+    static bool calibrate(const std::string& log_path, Params* params);
+
+    EncoderModel();
+    explicit EncoderModel(const Params& params, uint32_t seed = 1);
+
+    // Samples every 8th row of the luma plane, the complexity of the next frame
+    void analyze(const uint8_t* y, uint32_t pitch, uint32_t width, uint32_t height);
+
+    Frame encode(bool key, const Settings& settings);
+
+    void reset();
+
+    const Params& params() const { return params_; }
+
+private:
+    double predict(const FrameType& type, double complexity, double qp) const;
+
+private:
+    Params params_;
+    std::mt19937 rng_;
+    std::normal_distribution<double> normal_{0.0, 1.0};
+
+    uint32_t pixels_ = 0;
+    double spatial_ = 0.0;
+    double temporal_ = 0.0;
+    std::vector<uint8_t> prev_rows_;
+
+    double fullness_ = 0.0;
+    uint32_t last_qp_ = 0;
+};
+
+} // namespace amf
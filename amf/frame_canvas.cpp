@@ -0,0 +1,146 @@
+#include "frame_canvas.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "plane_copy.h"
+
+namespace amf {
+
+static uint32_t alignUp(uint32_t value, uint32_t align) {
+    return (value + align - 1) / align * align;
+}
+
+FrameCanvas::FrameCanvas()
+    : FrameCanvas(Options()) {}
+
+FrameCanvas::FrameCanvas(const Options& options)
+    : options_(options)
+    , scaler_(options.scaler, SimdLevel::AUTO, options.siting) {
+    options_.vertical_align = std::max(options_.vertical_align, 2u);
+}
+
+void FrameCanvas::alignSize(uint32_t* width, uint32_t* height) const {
+    *width = alignUp(std::max(*width, 2u), 2);
+    // Keeps the chroma rows whole too
+    *height = alignUp(alignUp(std::max(*height, 2u), 2), options_.vertical_align);
+}
+
+void FrameCanvas::reset(uint32_t width, uint32_t height) {
+    alignSize(&width, &height);
+    width_ = width;
+    height_ = height;
+    pending_width_ = 0;
+    pending_height_ = 0;
+    buffer_format_ = VideoFormat::UNKNOWN;
+}
+
+bool FrameCanvas::update(uint32_t width, uint32_t height, int64_t at_time) {
+    if (width != pending_width_ || height != pending_height_) {
+        pending_width_ = width;
+        pending_height_ = height;
+        pending_since_ = at_time;
+    }
+    uint32_t aligned_width = width;
+    uint32_t aligned_height = height;
+    alignSize(&aligned_width, &aligned_height);
+    if (aligned_width == width_ && aligned_height == height_) {
+        return false;
+    }
+    if (at_time - pending_since_ < static_cast<int64_t>(options_.debounce_ms) * 1000) {
+        return false;
+    }
+    width_ = aligned_width;
+    height_ = aligned_height;
+    buffer_format_ = VideoFormat::UNKNOWN;
+    return true;
+}
+
+void FrameCanvas::fill(VideoFormat format) {
+    const size_t luma = static_cast<size_t>(width_) * height_;
+    buffer_.resize(luma * 3 / 2);
+    std::memset(buffer_.data(), options_.full_range ? 0 : 16, luma);
+    std::memset(buffer_.data() + luma, 128, luma / 2);
+    buffer_format_ = format;
+}
+
+bool FrameCanvas::draw(const VideoFrameView& frame, VideoFrameView* out) {
+    if (!frame.valid() || width_ == 0 || height_ == 0) {
+        return false;
+    }
+    if (frame.width == width_ && frame.height == height_) {
+        *out = frame;
+        return true;
+    }
+    if (options_.fit == Fit::PAD && frame.width >= width_ && frame.height >= height_) {
+        // Cropping only drops the right and bottom, the planes are read in place
+        *out = frame;
+        out->width = width_;
+        out->height = height_;
+        return true;
+    }
+    uint32_t dst_x = 0;
+    uint32_t dst_y = 0;
+    uint32_t dst_width = std::min(frame.width, width_) & ~1u;
+    uint32_t dst_height = std::min(frame.height, height_) & ~1u;
+    if (options_.fit == Fit::SCALE) {
+        const double scale =
+            std::min(static_cast<double>(width_) / frame.width,
+                     static_cast<double>(height_) / frame.height);
+        dst_width = std::min(static_cast<uint32_t>(frame.width * scale + 0.5) & ~1u, width_);
+        dst_height = std::min(static_cast<uint32_t>(frame.height * scale + 0.5) & ~1u, height_);
+        dst_x = (width_ - dst_width) / 2 & ~1u;
+        dst_y = (height_ - dst_height) / 2 & ~1u;
+    }
+    // The bars stay black, only a new layout clears the whole canvas
+    if (buffer_format_ != frame.format || dst_x != layout_[0] || dst_y != layout_[1] ||
+        dst_width != layout_[2] || dst_height != layout_[3]) {
+        fill(frame.format);
+        layout_[0] = dst_x;
+        layout_[1] = dst_y;
+        layout_[2] = dst_width;
+        layout_[3] = dst_height;
+    }
+    uint8_t* y = buffer_.data();
+    uint8_t* chroma = y + static_cast<size_t>(width_) * height_;
+    const uint32_t chroma_offset = dst_y / 2 * width_;
+    *out = VideoFrameView();
+    if (frame.format == VideoFormat::I420) {
+        const uint32_t pitch = width_ / 2;
+        uint8_t* u = chroma;
+        uint8_t* v = chroma + static_cast<size_t>(pitch) * height_ / 2;
+        uint8_t* dst_y_plane = y + static_cast<size_t>(dst_y) * width_ + dst_x;
+        uint8_t* dst_u = u + chroma_offset / 2 + dst_x / 2;
+        uint8_t* dst_v = v + chroma_offset / 2 + dst_x / 2;
+        if (options_.fit == Fit::SCALE) {
+            scaler_.scaleI420(frame.data[0], frame.pitch[0], frame.data[1], frame.pitch[1],
+                              frame.data[2], frame.pitch[2], frame.width, frame.height,
+                              dst_y_plane, width_, dst_u, pitch, dst_v, pitch, dst_width,
+                              dst_height);
+        }
+        else {
+            copyPlane(frame.data[0], frame.pitch[0], dst_y_plane, width_, dst_width, dst_height);
+            copyPlane(frame.data[1], frame.pitch[1], dst_u, pitch, dst_width / 2, dst_height / 2);
+            copyPlane(frame.data[2], frame.pitch[2], dst_v, pitch, dst_width / 2, dst_height / 2);
+        }
+        *out = VideoFrameView::i420(y, width_, u, pitch, v, pitch, width_, height_);
+    }
+    else {
+        uint8_t* dst_y_plane = y + static_cast<size_t>(dst_y) * width_ + dst_x;
+        uint8_t* dst_uv = chroma + chroma_offset + dst_x;
+        if (options_.fit == Fit::SCALE) {
+            scaler_.scaleNv12(frame.data[0], frame.pitch[0], frame.data[1], frame.pitch[1],
+                              frame.width, frame.height, dst_y_plane, width_, dst_uv, width_,
+                              dst_width, dst_height);
+        }
+        else {
+            copyNv12(frame.data[0], frame.pitch[0], frame.data[1], frame.pitch[1], dst_y_plane,
+                     width_, dst_uv, width_, dst_width, dst_height);
+        }
+        *out = VideoFrameView::nv12(y, width_, chroma, width_, width_, height_);
+    }
+    drawn_++;
+    return true;
+}
+
+} // namespace amf
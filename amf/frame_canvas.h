@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "cpu_scaler.h"
+#include "video_frame.h"
+
+namespace amf {
+
+// Keeps the encoder resolution stable while the captured size changes.
+// Frames of another size are scaled or padded into a canvas of the current encoder size, the
+// canvas only takes the size of the content once the content kept it for `debounce_ms`. Dragging
+// a window edge then costs a cpu scale per frame and one resize of the encoder at the end.
+class FrameCanvas {
+public:
+    enum class Fit : uint8_t {
+        // Scaled to fit with its aspect ratio, black bars around it
+        SCALE = 0,
+        // 1:1 at the top left, cropped or padded with black
+        PAD = 1,
+    };
+
+    struct Options {
+        Fit fit = Fit::SCALE;
+        uint32_t debounce_ms = 500;
+        // Canvas rows are a multiple of this, AmfCodecCapbility::vertical_align
+        uint32_t vertical_align = 2;
+        // Black is 0 instead of 16
+        bool full_range = false;
+        CpuScaler::Mode scaler = CpuScaler::Mode::BILINEAR;
+        // Of the chroma the encoder signals
+        ChromaSiting siting = ChromaSiting::CENTER;
+    };
+
+    FrameCanvas();
+    explicit FrameCanvas(const Options& options);
+
+    // Size of the canvas for content of this size
+    void alignSize(uint32_t* width, uint32_t* height) const;
+
+    void reset(uint32_t width, uint32_t height);
+
+    // Size of the latest captured frame. Returns true when the canvas takes a new size.
+    bool update(uint32_t width, uint32_t height, int64_t at_time);
+
+    // `frame` itself when it has the canvas size or only needs a crop, the canvas buffer
+    // otherwise. The buffer stays valid until the next draw.
+    bool draw(const VideoFrameView& frame, VideoFrameView* out);
+
+    uint32_t width() const { return width_; }
+    uint32_t height() const { return height_; }
+    // Frames that went through the canvas buffer
+    uint64_t drawn() const { return drawn_; }
+
+private:
+    void fill(VideoFormat format);
+
+private:
+    Options options_;
+    CpuScaler scaler_;
+
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+
+    uint32_t pending_width_ = 0;
+    uint32_t pending_height_ = 0;
+    int64_t pending_since_ = 0;
+
+    std::vector<uint8_t> buffer_;
+    VideoFormat buffer_format_ = VideoFormat::UNKNOWN;
+    // x, y, width and height of the content in the buffer
+    uint32_t layout_[4] = {0, 0, 0, 0};
+    uint64_t drawn_ = 0;
+};
+
+} // namespace amf
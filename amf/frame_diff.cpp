@@ -0,0 +1,206 @@
+#include "frame_diff.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "cpu_features.h"
+#include "thread_pool.h"
+
+#if defined(AMF_ARCH_X86)
+#include <immintrin.h>
+#elif defined(AMF_ARCH_ARM64)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <arm_acle.h>
+#endif
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(AMF_ARCH_ARM64)
+#define AMF_HAS_CRC32_U64 1
+#endif
+
+namespace amf {
+
+// A 4K luma plane hashes in about a millisecond on one thread, only split bigger ones
+static constexpr size_t kParallelThreshold = 3840 * 2160 * 2;
+
+static inline uint64_t load64(const uint8_t* p) {
+    uint64_t v = 0;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t loadTail(const uint8_t* p, uint32_t len) {
+    uint64_t v = 0;
+    memcpy(&v, p, len);
+    return v;
+}
+
+// Two independent lanes per tile, even and odd 8-byte words, packed into one 64-bit state
+static void hashSpan_C(const uint8_t* p, uint32_t len, uint64_t* state) {
+    constexpr uint64_t kMul = 0x9e3779b97f4a7c15ull;
+    uint64_t h = *state;
+    uint32_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        h = (h ^ load64(p + i)) * kMul;
+        h ^= h >> 29;
+    }
+    if (i < len) {
+        h = (h ^ loadTail(p + i, len - i)) * kMul;
+        h ^= h >> 29;
+    }
+    *state = h;
+}
+
+#if defined(AMF_HAS_CRC32_U64)
+AMF_TARGET_CRC32 static inline uint32_t crc32c(uint32_t crc, uint64_t v) {
+#if defined(AMF_ARCH_X86)
+    return static_cast<uint32_t>(_mm_crc32_u64(crc, v));
+#else
+    return __crc32cd(crc, v);
+#endif
+}
+
+AMF_TARGET_CRC32 static void hashSpan_CRC32(const uint8_t* p, uint32_t len, uint64_t* state) {
+    uint32_t a = static_cast<uint32_t>(*state);
+    uint32_t b = static_cast<uint32_t>(*state >> 32);
+    uint32_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        a = crc32c(a, load64(p + i));
+        b = crc32c(b, load64(p + i + 8));
+    }
+    if (i + 8 <= len) {
+        a = crc32c(a, load64(p + i));
+        i += 8;
+    }
+    if (i < len) {
+        b = crc32c(b, loadTail(p + i, len - i));
+    }
+    *state = a | (static_cast<uint64_t>(b) << 32);
+}
+#endif
+
+DirtyRegionDetector::DirtyRegionDetector(uint32_t tile_size, bool allow_crc32)
+    : tile_size_(std::max(tile_size, 8u))
+#if defined(AMF_HAS_CRC32_U64)
+    , crc32_(allow_crc32 && cpuFeatures().crc32)
+#else
+    , crc32_(false)
+#endif
+{
+}
+
+void DirtyRegionDetector::reset() {
+    valid_ = false;
+}
+
+void DirtyRegionDetector::hashTileRow(const uint8_t* y, uint32_t pitch, uint32_t tile_row,
+                                      uint64_t* hashes) const {
+    const uint32_t top = tile_row * tile_size_;
+    const uint32_t rows = std::min(tile_size_, height_ - top);
+    for (uint32_t tx = 0; tx < tiles_x_; tx++) {
+        // Seeded with the tile position so that equal tiles still hash differently
+        hashes[tx] = (static_cast<uint64_t>(tile_row) << 32) | tx;
+    }
+    auto hash_span = hashSpan_C;
+#if defined(AMF_HAS_CRC32_U64)
+    if (crc32_) {
+        hash_span = hashSpan_CRC32;
+    }
+#endif
+    // Row by row through the frame, the tiles of one row are independent chains
+    for (uint32_t r = 0; r < rows; r++) {
+        const uint8_t* line = y + static_cast<size_t>(top + r) * pitch;
+        for (uint32_t tx = 0; tx < tiles_x_; tx++) {
+            const uint32_t left = tx * tile_size_;
+            hash_span(line + left, std::min(tile_size_, width_ - left), hashes + tx);
+        }
+    }
+}
+
+bool DirtyRegionDetector::update(const uint8_t* y, uint32_t pitch, uint32_t width,
+                                 uint32_t height) {
+    if (!y || width == 0 || height == 0) {
+        dirty_count_ = 0;
+        rects_.clear();
+        return false;
+    }
+    if (width != width_ || height != height_) {
+        width_ = width;
+        height_ = height;
+        tiles_x_ = (width + tile_size_ - 1) / tile_size_;
+        tiles_y_ = (height + tile_size_ - 1) / tile_size_;
+        valid_ = false;
+    }
+    const size_t tiles = static_cast<size_t>(tiles_x_) * tiles_y_;
+    next_hashes_.resize(tiles);
+    dirty_.resize(tiles);
+    auto hash_rows = [&](uint32_t begin, uint32_t end) {
+        for (uint32_t ty = begin; ty < end; ty++) {
+            hashTileRow(y, pitch, ty, next_hashes_.data() + static_cast<size_t>(ty) * tiles_x_);
+        }
+    };
+    if (static_cast<size_t>(width) * height < kParallelThreshold) {
+        hash_rows(0, tiles_y_);
+    }
+    else {
+        parallelForRows(tiles_y_, 1, hash_rows);
+    }
+    dirty_count_ = 0;
+    for (size_t i = 0; i < tiles; i++) {
+        dirty_[i] = !valid_ || next_hashes_[i] != hashes_[i];
+        dirty_count_ += dirty_[i];
+    }
+    hashes_.swap(next_hashes_);
+    valid_ = true;
+    buildRects();
+    return changed();
+}
+
+void DirtyRegionDetector::buildRects() {
+    rects_.clear();
+    open_rects_.clear();
+    for (uint32_t ty = 0; ty < tiles_y_; ty++) {
+        const uint8_t* row = dirty_.data() + static_cast<size_t>(ty) * tiles_x_;
+        const uint32_t top = ty * tile_size_;
+        const uint32_t bottom = std::min(top + tile_size_, height_);
+        next_open_rects_.clear();
+        size_t candidate = 0;
+        for (uint32_t tx = 0; tx < tiles_x_;) {
+            if (!row[tx]) {
+                tx++;
+                continue;
+            }
+            uint32_t end = tx;
+            while (end < tiles_x_ && row[end]) {
+                end++;
+            }
+            const uint32_t left = tx * tile_size_;
+            const uint32_t right = std::min(end * tile_size_, width_);
+            // Runs of the previous row are sorted by x, walk them along with this row
+            while (candidate < open_rects_.size() && rects_[open_rects_[candidate]].x < left) {
+                candidate++;
+            }
+            if (candidate < open_rects_.size() && rects_[open_rects_[candidate]].x == left &&
+                rects_[open_rects_[candidate]].width == right - left) {
+                auto& rect = rects_[open_rects_[candidate]];
+                rect.height = bottom - rect.y;
+                next_open_rects_.push_back(open_rects_[candidate]);
+            }
+            else {
+                Rect rect;
+                rect.x = left;
+                rect.y = top;
+                rect.width = right - left;
+                rect.height = bottom - top;
+                next_open_rects_.push_back(static_cast<uint32_t>(rects_.size()));
+                rects_.push_back(rect);
+            }
+            tx = end;
+        }
+        open_rects_.swap(next_open_rects_);
+    }
+}
+
+} // namespace amf
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace amf {
+
+// Finds which tiles of the luma plane changed since the previous frame.
+// Only a 64-bit hash per tile is kept (crc32c where the cpu has it), so no copy of the previous
+// frame is needed and a frame is read exactly once.
+class DirtyRegionDetector {
+public:
+    static constexpr uint32_t kDefaultTileSize = 64;
+
+    struct Rect {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    explicit DirtyRegionDetector(uint32_t tile_size = kDefaultTileSize, bool allow_crc32 = true);
+
+    // Returns changed(). The first frame and any size change mark every tile dirty.
+    bool update(const uint8_t* y, uint32_t pitch, uint32_t width, uint32_t height);
+
+    // Forget the previous frame, the next update() reports everything dirty
+    void reset();
+
+    bool changed() const { return dirty_count_ > 0; }
+    uint32_t tileSize() const { return tile_size_; }
+    uint32_t tilesX() const { return tiles_x_; }
+    uint32_t tilesY() const { return tiles_y_; }
+    // One byte per tile, row major, non zero when dirty
+    const std::vector<uint8_t>& dirtyTiles() const { return dirty_; }
+    uint32_t dirtyTileCount() const { return dirty_count_; }
+    // Dirty tiles merged into rectangles, in pixels and clipped to the frame
+    const std::vector<Rect>& dirtyRects() const { return rects_; }
+    bool hardwareHash() const { return crc32_; }
+
+private:
+    void hashTileRow(const uint8_t* y, uint32_t pitch, uint32_t tile_row, uint64_t* hashes) const;
+    void buildRects();
+
+private:
+    const uint32_t tile_size_;
+    const bool crc32_;
+
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    uint32_t tiles_x_ = 0;
+    uint32_t tiles_y_ = 0;
+    bool valid_ = false;
+
+    std::vector<uint64_t> hashes_;
+    std::vector<uint64_t> next_hashes_;
+    std::vector<uint8_t> dirty_;
+    uint32_t dirty_count_ = 0;
+    std::vector<Rect> rects_;
+    // Rects that end on the previous tile row, and may grow by one more row
+    std::vector<uint32_t> open_rects_;
+    std::vector<uint32_t> next_open_rects_;
+};
+
+} // namespace amf
@@ -0,0 +1,131 @@
+#include "frame_pool.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <new>
+
+namespace amf {
+
+// Sizes are rounded to pages so that close resolutions share a bucket
+static constexpr size_t kBucketGranularity = 4096;
+// FrameBuffer lives in front of its data, in the same allocation
+static constexpr size_t kHeaderSize =
+    (sizeof(FrameBuffer) + FrameBuffer::kAlignment - 1) / FrameBuffer::kAlignment *
+    FrameBuffer::kAlignment;
+
+void FrameBuffer::release() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        pool_->recycle(this);
+    }
+}
+
+std::string FramePool::Stats::to_str() const {
+    char buf[160] = {0};
+    snprintf(buf, sizeof(buf),
+             "{hit:%" PRIu64 ", miss:%" PRIu64 ", in use:%u, high water:%u, idle:%u|%zukB}", hits,
+             misses, in_use, high_water, idle, idle_bytes / 1024);
+    return buf;
+}
+
+FramePool* FramePool::instance() {
+    // Never destroyed, like the logger: frames still held by the capture or encoder threads during
+    // static destruction return to it after it would have been gone
+    static FramePool* pool = new FramePool();
+    return pool;
+}
+
+FramePool::FramePool(uint32_t max_idle_per_bucket)
+    : max_idle_per_bucket_(max_idle_per_bucket) {}
+
+FramePool::~FramePool() {
+    trim();
+}
+
+FrameBuffer* FramePool::allocate(FramePool* pool, size_t capacity) {
+    auto block = static_cast<uint8_t*>(
+        ::operator new(kHeaderSize + capacity, std::align_val_t(FrameBuffer::kAlignment)));
+    return new (block) FrameBuffer(pool, block + kHeaderSize, capacity);
+}
+
+void FramePool::free(FrameBuffer* buffer) {
+    buffer->~FrameBuffer();
+    ::operator delete(reinterpret_cast<uint8_t*>(buffer),
+                      std::align_val_t(FrameBuffer::kAlignment));
+}
+
+FrameBufferPtr FramePool::acquire(size_t size) {
+    const size_t capacity =
+        (std::max<size_t>(size, 1) + kBucketGranularity - 1) / kBucketGranularity *
+        kBucketGranularity;
+    FrameBuffer* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = buckets_.find(capacity);
+        if (it != buckets_.end() && it->second.head) {
+            buffer = it->second.head;
+            it->second.head = buffer->next_;
+            it->second.count--;
+            stats_.idle--;
+            stats_.idle_bytes -= capacity;
+            stats_.hits++;
+        }
+        else {
+            stats_.misses++;
+        }
+        stats_.in_use++;
+        stats_.high_water = std::max(stats_.high_water, stats_.in_use);
+    }
+    if (!buffer) {
+        buffer = allocate(this, capacity);
+    }
+    buffer->next_ = nullptr;
+    buffer->size_ = size;
+    return FrameBufferPtr(buffer);
+}
+
+void FramePool::recycle(FrameBuffer* buffer) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stats_.in_use--;
+        auto& bucket = buckets_[buffer->capacity_];
+        if (bucket.count < max_idle_per_bucket_) {
+            buffer->next_ = bucket.head;
+            bucket.head = buffer;
+            bucket.count++;
+            stats_.idle++;
+            stats_.idle_bytes += buffer->capacity_;
+            return;
+        }
+    }
+    free(buffer);
+}
+
+void FramePool::trim() {
+    FrameBuffer* idle = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto& it : buckets_) {
+            while (auto buffer = it.second.head) {
+                it.second.head = buffer->next_;
+                buffer->next_ = idle;
+                idle = buffer;
+            }
+            it.second.count = 0;
+        }
+        stats_.idle = 0;
+        stats_.idle_bytes = 0;
+    }
+    while (idle) {
+        auto next = idle->next_;
+        free(idle);
+        idle = next;
+    }
+}
+
+FramePool::Stats FramePool::stats() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return stats_;
+}
+
+} // namespace amf
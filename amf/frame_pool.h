@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace amf {
+
+class FramePool;
+
+// 64-byte aligned block handed out by FramePool, goes back to its pool with the last reference
+class FrameBuffer {
+    friend class FramePool;
+
+public:
+    static constexpr size_t kAlignment = 64;
+
+    uint8_t* data() { return data_; }
+    const uint8_t* data() const { return data_; }
+    // Bytes asked for in acquire()
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+
+    void addRef() { refs_.fetch_add(1, std::memory_order_relaxed); }
+    void release();
+
+private:
+    FrameBuffer(FramePool* pool, uint8_t* data, size_t capacity)
+        : pool_(pool)
+        , data_(data)
+        , capacity_(capacity) {}
+
+private:
+    std::atomic<uint32_t> refs_{0};
+    FramePool* pool_ = nullptr;
+    uint8_t* data_ = nullptr;
+    size_t capacity_ = 0;
+    size_t size_ = 0;
+    // Free list link while idle in the pool
+    FrameBuffer* next_ = nullptr;
+};
+
+// Intrusive reference to a FrameBuffer, copying it never allocates
+class FrameBufferPtr {
+public:
+    FrameBufferPtr() = default;
+    explicit FrameBufferPtr(FrameBuffer* buffer)
+        : ptr_(buffer) {
+        if (ptr_) {
+            ptr_->addRef();
+        }
+    }
+    FrameBufferPtr(const FrameBufferPtr& other)
+        : FrameBufferPtr(other.ptr_) {}
+    FrameBufferPtr(FrameBufferPtr&& other) noexcept
+        : ptr_(other.ptr_) {
+        other.ptr_ = nullptr;
+    }
+    ~FrameBufferPtr() { reset(); }
+
+    FrameBufferPtr& operator=(FrameBufferPtr other) noexcept {
+        std::swap(ptr_, other.ptr_);
+        return *this;
+    }
+
+    void reset() {
+        if (ptr_) {
+            ptr_->release();
+            ptr_ = nullptr;
+        }
+    }
+
+    // Hands the reference over to the caller, balance it with FrameBuffer::release()
+    FrameBuffer* detach() {
+        auto ptr = ptr_;
+        ptr_ = nullptr;
+        return ptr;
+    }
+
+    FrameBuffer* get() const { return ptr_; }
+    FrameBuffer* operator->() const { return ptr_; }
+    explicit operator bool() const { return ptr_ != nullptr; }
+
+private:
+    FrameBuffer* ptr_ = nullptr;
+};
+
+// Thread-safe pool of frame buffers, bucketed by rounded size.
+// Buffers of a size already seen are recycled, so a steady stream of frames does not allocate.
+class FramePool {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        // Buffers handed out and not returned yet
+        uint32_t in_use = 0;
+        uint32_t high_water = 0;
+        uint32_t idle = 0;
+        size_t idle_bytes = 0;
+
+        std::string to_str() const;
+    };
+
+    static FramePool* instance();
+
+    explicit FramePool(uint32_t max_idle_per_bucket = 4);
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    FrameBufferPtr acquire(size_t size);
+
+    // Frees every idle buffer, e.g. after a resolution change
+    void trim();
+
+    Stats stats() const;
+
+private:
+    friend class FrameBuffer;
+
+    struct Bucket {
+        FrameBuffer* head = nullptr;
+        uint32_t count = 0;
+    };
+
+    void recycle(FrameBuffer* buffer);
+
+    static FrameBuffer* allocate(FramePool* pool, size_t capacity);
+    static void free(FrameBuffer* buffer);
+
+private:
+    const uint32_t max_idle_per_bucket_;
+
+    mutable std::mutex mtx_;
+    std::unordered_map<size_t, Bucket> buckets_;
+    Stats stats_;
+};
+
+} // namespace amf
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace amf {
+
+// Binary record of every encoded frame, written by FrameTraceWriter and read by FrameTraceReader.
+// A header page is followed by blocks of `block_frames` frames. Blocks are columnar: each field
+// of their frames is stored contiguously, a scan of one field over millions of frames does not
+// touch the others. The header lists the size of every column, readers skip the columns they do
+// not know and see zeros for the ones an older writer did not have. Little endian.
+
+// Columns in the order they are stored, new ones are only ever appended
+enum class FrameColumn : uint8_t {
+    // int64, microseconds, steady clock
+    OUTPUT_TIME,
+    FRAME_ID,
+    // Capture to submit and submit to output, microseconds
+    UPLOAD_US,
+    ENCODE_US,
+    SIZE,
+    TARGET_BITRATE,
+    FPS,
+    WIDTH,
+    HEIGHT,
+    CODEC,
+    FRAME_TYPE,
+    QP,
+    QP_MIN,
+    QP_MAX,
+    PIX_NUM_INTRA,
+    PIX_NUM_INTER,
+    PIX_NUM_SKIP,
+    BITCOUNT_RESIDUAL,
+    BITCOUNT_MOTION,
+    BITCOUNT_INTER,
+    BITCOUNT_INTRA,
+    COUNT
+};
+
+static constexpr uint32_t kFrameColumnCount = static_cast<uint32_t>(FrameColumn::COUNT);
+
+// Bytes per frame of each column
+static constexpr uint8_t kFrameColumnSizes[kFrameColumnCount] = {
+    8, 4, 4, 4, 4, 4, 2, 2, 2, 1, 1, 1, 1, 1, 4, 4, 4, 4, 4, 4, 4,
+};
+
+struct FrameRecord {
+    int64_t output_time = 0;
+    uint32_t frame_id = 0;
+    // 0 when the packet came without the times of its frame
+    uint32_t upload_us = 0;
+    uint32_t encode_us = 0;
+    // Bytes
+    uint32_t size = 0;
+    // bps
+    uint32_t target_bitrate = 0;
+    uint16_t fps = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    // amf_codec_type
+    uint8_t codec = 0;
+    // AMF_VIDEO_ENCODER_OUTPUT_DATA_TYPE_*, the same values for HEVC
+    uint8_t frame_type = 0;
+    // STATISTIC_* of the encoder, 0 when it did not report them
+    uint8_t qp = 0;
+    uint8_t qp_min = 0;
+    uint8_t qp_max = 0;
+    uint32_t pix_num_intra = 0;
+    uint32_t pix_num_inter = 0;
+    uint32_t pix_num_skip = 0;
+    uint32_t bitcount_residual = 0;
+    uint32_t bitcount_motion = 0;
+    uint32_t bitcount_inter = 0;
+    uint32_t bitcount_intra = 0;
+};
+
+// "AMFT"
+static constexpr uint32_t kFrameTraceMagic = 0x54464d41;
+// "BLCK"
+static constexpr uint32_t kFrameBlockMagic = 0x4b434c42;
+// Bumped with every change that old readers cannot skip, adding a column is not one
+static constexpr uint16_t kFrameTraceVersion = 1;
+// The first block starts here
+static constexpr uint32_t kFrameTraceHeaderBytes = 4096;
+static constexpr uint32_t kMaxFrameColumns = 64;
+
+struct FrameTraceHeader {
+    uint32_t magic = kFrameTraceMagic;
+    uint16_t version = kFrameTraceVersion;
+    uint16_t column_count = 0;
+    // A multiple of 8, every column starts 8 byte aligned
+    uint32_t block_frames = 0;
+    uint32_t block_bytes = 0;
+    // Seconds since epoch
+    int64_t created_at = 0;
+    uint8_t column_sizes[kMaxFrameColumns] = {0};
+};
+static_assert(sizeof(FrameTraceHeader) == 88, "the header is written as is");
+
+struct FrameBlockHeader {
+    uint32_t magic = kFrameBlockMagic;
+    // Frames stored in the block so far, written after their columns
+    uint32_t frames = 0;
+    int64_t reserved = 0;
+};
+static_assert(sizeof(FrameBlockHeader) == 16, "the block header is written as is");
+
+// Offset of `column` from the start of a block
+inline size_t frameColumnOffset(const FrameTraceHeader& header, uint32_t column) {
+    size_t offset = sizeof(FrameBlockHeader);
+    for (uint32_t i = 0; i < column; i++) {
+        offset += static_cast<size_t>(header.column_sizes[i]) * header.block_frames;
+    }
+    return offset;
+}
+
+} // namespace amf
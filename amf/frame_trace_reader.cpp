@@ -0,0 +1,236 @@
+#include "frame_trace_reader.h"
+
+#include <cstring>
+
+namespace amf {
+
+// 64 bit offsets, traces grow beyond 2 GB
+static bool seekTo(std::FILE* file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<int64_t>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+static uint64_t fileSize(std::FILE* file) {
+#ifdef _WIN32
+    if (_fseeki64(file, 0, SEEK_END) != 0) {
+        return 0;
+    }
+    const int64_t size = _ftelli64(file);
+#else
+    if (fseeko(file, 0, SEEK_END) != 0) {
+        return 0;
+    }
+    const int64_t size = ftello(file);
+#endif
+    return size > 0 ? static_cast<uint64_t>(size) : 0;
+}
+
+// A longer gap between two frames, or a step back of the clock, starts another session of the
+// trace, the gap does not count towards the duration
+static constexpr int64_t kMaxFrameInterval = 10 * 1000 * 1000;
+
+static bool isKeyFrameType(uint8_t frame_type) {
+    // AMF_VIDEO_ENCODER_OUTPUT_DATA_TYPE_IDR and _I
+    return frame_type <= 1;
+}
+
+FrameTraceReader::~FrameTraceReader() {
+    close();
+}
+
+bool FrameTraceReader::open(const std::string& path) {
+    close();
+    file_ = std::fopen(path.c_str(), "rb");
+    if (!file_) {
+        error_ = "cannot open " + path;
+        return false;
+    }
+    const uint64_t size = fileSize(file_);
+    if (!seekTo(file_, 0) || std::fread(&header_, sizeof(header_), 1, file_) != 1 ||
+        header_.magic != kFrameTraceMagic) {
+        error_ = path + " is not a frame trace";
+        close();
+        return false;
+    }
+    if (header_.version != kFrameTraceVersion) {
+        error_ = "unsupported frame trace version " + std::to_string(header_.version);
+        close();
+        return false;
+    }
+    if (header_.column_count > kMaxFrameColumns || header_.block_frames == 0 ||
+        header_.block_frames % 8 != 0 ||
+        header_.block_bytes < frameColumnOffset(header_, header_.column_count)) {
+        error_ = "corrupt frame trace header";
+        close();
+        return false;
+    }
+    for (uint32_t i = 0; i < kFrameColumnCount && i < header_.column_count; i++) {
+        if (header_.column_sizes[i] != kFrameColumnSizes[i]) {
+            error_ = "column " + std::to_string(i) + " has " +
+                     std::to_string(header_.column_sizes[i]) + " B per frame";
+            close();
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < kFrameColumnCount; i++) {
+        column_offsets_[i] = frameColumnOffset(header_, i);
+    }
+    // A block cut short by a full disk is left out
+    blocks_ = size > kFrameTraceHeaderBytes
+                  ? (size - kFrameTraceHeaderBytes) / header_.block_bytes
+                  : 0;
+    next_block_ = blocks_;
+    block_.assign(header_.block_bytes, 0);
+    frames_ = 0;
+    error_.clear();
+    return true;
+}
+
+void FrameTraceReader::close() {
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+    blocks_ = 0;
+    frames_ = 0;
+}
+
+bool FrameTraceReader::readBlock(uint64_t index) {
+    frames_ = 0;
+    if (!file_ || index >= blocks_) {
+        return false;
+    }
+    if (index != next_block_ &&
+        !seekTo(file_, kFrameTraceHeaderBytes + index * header_.block_bytes)) {
+        next_block_ = blocks_;
+        return false;
+    }
+    if (std::fread(block_.data(), block_.size(), 1, file_) != 1) {
+        next_block_ = blocks_;
+        error_ = "failed to read block " + std::to_string(index);
+        return false;
+    }
+    next_block_ = index + 1;
+    FrameBlockHeader block_header;
+    std::memcpy(&block_header, block_.data(), sizeof(block_header));
+    if (block_header.magic != kFrameBlockMagic) {
+        // Grown ahead by the writer and never started
+        return true;
+    }
+    if (block_header.frames > header_.block_frames) {
+        error_ = "block " + std::to_string(index) + " claims " +
+                 std::to_string(block_header.frames) + " frames";
+        return false;
+    }
+    frames_ = block_header.frames;
+    return true;
+}
+
+FrameRecord FrameTraceReader::record(uint32_t row) const {
+    FrameRecord record;
+    record.output_time = value<int64_t>(FrameColumn::OUTPUT_TIME, row);
+    record.frame_id = value<uint32_t>(FrameColumn::FRAME_ID, row);
+    record.upload_us = value<uint32_t>(FrameColumn::UPLOAD_US, row);
+    record.encode_us = value<uint32_t>(FrameColumn::ENCODE_US, row);
+    record.size = value<uint32_t>(FrameColumn::SIZE, row);
+    record.target_bitrate = value<uint32_t>(FrameColumn::TARGET_BITRATE, row);
+    record.fps = value<uint16_t>(FrameColumn::FPS, row);
+    record.width = value<uint16_t>(FrameColumn::WIDTH, row);
+    record.height = value<uint16_t>(FrameColumn::HEIGHT, row);
+    record.codec = value<uint8_t>(FrameColumn::CODEC, row);
+    record.frame_type = value<uint8_t>(FrameColumn::FRAME_TYPE, row);
+    record.qp = value<uint8_t>(FrameColumn::QP, row);
+    record.qp_min = value<uint8_t>(FrameColumn::QP_MIN, row);
+    record.qp_max = value<uint8_t>(FrameColumn::QP_MAX, row);
+    record.pix_num_intra = value<uint32_t>(FrameColumn::PIX_NUM_INTRA, row);
+    record.pix_num_inter = value<uint32_t>(FrameColumn::PIX_NUM_INTER, row);
+    record.pix_num_skip = value<uint32_t>(FrameColumn::PIX_NUM_SKIP, row);
+    record.bitcount_residual = value<uint32_t>(FrameColumn::BITCOUNT_RESIDUAL, row);
+    record.bitcount_motion = value<uint32_t>(FrameColumn::BITCOUNT_MOTION, row);
+    record.bitcount_inter = value<uint32_t>(FrameColumn::BITCOUNT_INTER, row);
+    record.bitcount_intra = value<uint32_t>(FrameColumn::BITCOUNT_INTRA, row);
+    return record;
+}
+
+bool summarize(FrameTraceReader& reader, FrameTraceSummary* summary) {
+    for (uint64_t block = 0; block < reader.blocks(); block++) {
+        if (!reader.readBlock(block)) {
+            return false;
+        }
+        const uint32_t frames = reader.frames();
+        if (frames == 0) {
+            continue;
+        }
+        const int64_t* times = reader.column<int64_t>(FrameColumn::OUTPUT_TIME);
+        const uint32_t* sizes = reader.column<uint32_t>(FrameColumn::SIZE);
+        const uint32_t* targets = reader.column<uint32_t>(FrameColumn::TARGET_BITRATE);
+        const uint16_t* fps = reader.column<uint16_t>(FrameColumn::FPS);
+        const uint8_t* types = reader.column<uint8_t>(FrameColumn::FRAME_TYPE);
+        const uint8_t* qps = reader.column<uint8_t>(FrameColumn::QP);
+        const uint32_t* uploads = reader.column<uint32_t>(FrameColumn::UPLOAD_US);
+        const uint32_t* encodes = reader.column<uint32_t>(FrameColumn::ENCODE_US);
+        const uint32_t* intra = reader.column<uint32_t>(FrameColumn::PIX_NUM_INTRA);
+        const uint32_t* inter = reader.column<uint32_t>(FrameColumn::PIX_NUM_INTER);
+        const uint32_t* skip = reader.column<uint32_t>(FrameColumn::PIX_NUM_SKIP);
+        if (!times || !sizes || !targets || !fps || !types || !qps || !uploads || !encodes ||
+            !intra || !inter || !skip) {
+            return false;
+        }
+        for (uint32_t i = 0; i < frames; i++) {
+            const int64_t interval = times[i] - summary->last_time;
+            if (summary->frames == 0 || interval < 0 || interval > kMaxFrameInterval) {
+                summary->sessions++;
+            }
+            else {
+                summary->duration_us += interval;
+            }
+            summary->last_time = times[i];
+            summary->frames++;
+            summary->bytes += sizes[i];
+            summary->key_frames += isKeyFrameType(types[i]);
+            summary->size.add(sizes[i]);
+            if (fps[i] > 0 && sizes[i] * 8ull * fps[i] > 2ull * targets[i]) {
+                summary->oversized_frames++;
+            }
+            if (qps[i] > 0) {
+                summary->qp.add(qps[i]);
+            }
+            if (encodes[i] > 0) {
+                summary->upload_us.add(uploads[i]);
+                summary->encode_us.add(encodes[i]);
+            }
+            summary->pix_num_intra += intra[i];
+            summary->pix_num_inter += inter[i];
+            summary->pix_num_skip += skip[i];
+        }
+    }
+    return true;
+}
+
+std::string FrameTraceSummary::to_str() const {
+    const double seconds = duration_us / 1e6;
+    const double pixels = static_cast<double>(pix_num_intra + pix_num_inter + pix_num_skip);
+    char buffer[1024] = {0};
+    snprintf(buffer, sizeof(buffer),
+             "frames %llu in %.1f s, %u sessions, %.1f fps, %llu key, %llu oversized\n"
+             "bitrate %.0f kbps, size %.0f|%.0f|%.0f|%.0fByte\n"
+             "qp %.0f|%.0f|%.0f|%.0f, upload %.0f|%.0f|%.0f|%.0fus, "
+             "encode %.0f|%.0f|%.0f|%.0fus\n"
+             "pixels intra %.1f%%, inter %.1f%%, skip %.1f%%",
+             static_cast<unsigned long long>(frames), seconds, sessions,
+             seconds > 0 ? (frames - sessions) / seconds : 0.0,
+             static_cast<unsigned long long>(key_frames),
+             static_cast<unsigned long long>(oversized_frames),
+             seconds > 0 ? bytes * 8 / seconds / 1000 : 0.0, size.p50(), size.p90(), size.p99(),
+             size.max(), qp.p50(), qp.p90(), qp.p99(), qp.max(), upload_us.p50(), upload_us.p90(),
+             upload_us.p99(), upload_us.max(), encode_us.p50(), encode_us.p90(), encode_us.p99(),
+             encode_us.max(), pixels > 0 ? pix_num_intra * 100 / pixels : 0.0,
+             pixels > 0 ? pix_num_inter * 100 / pixels : 0.0,
+             pixels > 0 ? pix_num_skip * 100 / pixels : 0.0);
+    return buffer;
+}
+
+} // namespace amf
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "frame_trace.h"
+#include "p2_quantile.h"
+
+namespace amf {
+
+// Reads a frame trace one block at a time, with no dependency on the AMF runtime.
+// The columns of a block are handed out as arrays, aggregations over a field only ever read
+// contiguous memory. A trace that is still being written can be read, the frames appended after a
+// block was read are not seen.
+class FrameTraceReader {
+public:
+    FrameTraceReader() = default;
+    ~FrameTraceReader();
+
+    FrameTraceReader(const FrameTraceReader&) = delete;
+    FrameTraceReader& operator=(const FrameTraceReader&) = delete;
+
+    // false with error() set when `path` is not a trace this reader understands
+    bool open(const std::string& path);
+    void close();
+    const std::string& error() const { return error_; }
+
+    const FrameTraceHeader& header() const { return header_; }
+    uint64_t blocks() const { return blocks_; }
+
+    // Reads block `index`, false on a read error or a corrupt block.
+    // Blocks the writer had reserved but not started yet have no frames.
+    bool readBlock(uint64_t index);
+
+    // Of the block read last
+    uint32_t frames() const { return frames_; }
+    // nullptr when the trace was written without `column`
+    template <typename T> const T* column(FrameColumn column) const {
+        const uint32_t index = static_cast<uint32_t>(column);
+        if (index >= header_.column_count || sizeof(T) != kFrameColumnSizes[index]) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(block_.data() + column_offsets_[index]);
+    }
+    FrameRecord record(uint32_t row) const;
+
+private:
+    template <typename T> T value(FrameColumn column, uint32_t row) const {
+        const T* values = this->column<T>(column);
+        return values ? values[row] : T();
+    }
+
+private:
+    std::FILE* file_ = nullptr;
+    std::string error_;
+    FrameTraceHeader header_;
+    size_t column_offsets_[kFrameColumnCount] = {0};
+    uint64_t blocks_ = 0;
+    // Block the file is positioned at
+    uint64_t next_block_ = 0;
+
+    std::vector<uint8_t> block_;
+    uint32_t frames_ = 0;
+};
+
+struct FrameTraceSummary {
+    uint64_t frames = 0;
+    uint64_t key_frames = 0;
+    uint64_t bytes = 0;
+    // Larger than twice the share of the target bitrate of one frame
+    uint64_t oversized_frames = 0;
+    // Runs of frames without a long gap, a trace continued by another process has several
+    uint32_t sessions = 0;
+    // Of all sessions, microseconds
+    int64_t duration_us = 0;
+    // Steady clock
+    int64_t last_time = 0;
+    uint64_t pix_num_intra = 0;
+    uint64_t pix_num_inter = 0;
+    uint64_t pix_num_skip = 0;
+    QuantileSketch size;
+    // Frames the encoder reported a QP for
+    QuantileSketch qp;
+    QuantileSketch upload_us;
+    QuantileSketch encode_us;
+
+    std::string to_str() const;
+};
+
+// Reads every block of `reader` once, false on a read error
+bool summarize(FrameTraceReader& reader, FrameTraceSummary* summary);
+
+} // namespace amf
@@ -0,0 +1,327 @@
+#include "frame_trace_writer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+#include "amf_helper.h"
+
+namespace amf {
+
+#define LOG_DEBUG(...) amf::log(0, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_INFO(...) amf::log(1, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_WARN(...) amf::log(2, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_ERROR(...) amf::log(3, __FILE__, __LINE__, __VA_ARGS__)
+
+// Blocks are page aligned
+static constexpr uint32_t kBlockAlign = 4096;
+
+#ifdef _WIN32
+static unsigned long lastError() {
+    return GetLastError();
+}
+
+static FrameTraceWriter::File openFile(const std::string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    return file == INVALID_HANDLE_VALUE ? nullptr : file;
+}
+
+static void closeFile(FrameTraceWriter::File file) {
+    CloseHandle(file);
+}
+
+static uint64_t fileSize(FrameTraceWriter::File file) {
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file, &size)) {
+        return 0;
+    }
+    return static_cast<uint64_t>(size.QuadPart);
+}
+
+static bool truncateFile(FrameTraceWriter::File file, uint64_t size) {
+    LARGE_INTEGER offset = {};
+    offset.QuadPart = static_cast<LONGLONG>(size);
+    return SetFilePointerEx(file, offset, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+}
+
+static bool readAt(FrameTraceWriter::File file, uint64_t offset, void* data, uint32_t size) {
+    DWORD read = 0;
+    LARGE_INTEGER start = {};
+    start.QuadPart = static_cast<LONGLONG>(offset);
+    return SetFilePointerEx(file, start, nullptr, FILE_BEGIN) &&
+           ReadFile(file, data, size, &read, nullptr) && read == size;
+}
+
+// The file is extended when shorter than `bytes`
+static uint8_t* mapFile(FrameTraceWriter::File file, uint64_t bytes, void** mapping) {
+    *mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(bytes >> 32),
+                                  static_cast<DWORD>(bytes), nullptr);
+    if (!*mapping) {
+        return nullptr;
+    }
+    void* view = MapViewOfFile(*mapping, FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(bytes));
+    if (!view) {
+        CloseHandle(*mapping);
+        *mapping = nullptr;
+    }
+    return static_cast<uint8_t*>(view);
+}
+
+static void unmapFile(uint8_t* view, uint64_t /*bytes*/, void* mapping) {
+    UnmapViewOfFile(view);
+    CloseHandle(mapping);
+}
+
+static bool replaceFile(const std::string& from, const std::string& to) {
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+#else
+static unsigned long lastError() {
+    return static_cast<unsigned long>(errno);
+}
+
+static FrameTraceWriter::File openFile(const std::string& path) {
+    return ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+}
+
+static void closeFile(FrameTraceWriter::File file) {
+    ::close(file);
+}
+
+static uint64_t fileSize(FrameTraceWriter::File file) {
+    struct stat info = {};
+    if (fstat(file, &info) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(info.st_size);
+}
+
+static bool truncateFile(FrameTraceWriter::File file, uint64_t size) {
+    return ftruncate(file, static_cast<off_t>(size)) == 0;
+}
+
+static bool readAt(FrameTraceWriter::File file, uint64_t offset, void* data, uint32_t size) {
+    return pread(file, data, size, static_cast<off_t>(offset)) == static_cast<ssize_t>(size);
+}
+
+static uint8_t* mapFile(FrameTraceWriter::File file, uint64_t bytes, void** mapping) {
+    *mapping = nullptr;
+    if (fileSize(file) < bytes && !truncateFile(file, bytes)) {
+        return nullptr;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(bytes), PROT_READ | PROT_WRITE, MAP_SHARED,
+                      file, 0);
+    return view == MAP_FAILED ? nullptr : static_cast<uint8_t*>(view);
+}
+
+static void unmapFile(uint8_t* view, uint64_t bytes, void* /*mapping*/) {
+    munmap(view, static_cast<size_t>(bytes));
+}
+
+static bool replaceFile(const std::string& from, const std::string& to) {
+    return std::rename(from.c_str(), to.c_str()) == 0;
+}
+#endif
+
+static bool readHeader(FrameTraceWriter::File file, uint64_t size, FrameTraceHeader* header) {
+    return size >= kFrameTraceHeaderBytes && readAt(file, 0, header, sizeof(*header));
+}
+
+static bool sameLayout(const FrameTraceHeader& a, const FrameTraceHeader& b) {
+    return a.magic == b.magic && a.version == b.version && a.column_count == b.column_count &&
+           a.block_frames == b.block_frames && a.block_bytes == b.block_bytes &&
+           std::memcmp(a.column_sizes, b.column_sizes, a.column_count) == 0;
+}
+
+FrameTraceWriter::FrameTraceWriter(const Options& options)
+    : options_(options) {
+    header_.column_count = kFrameColumnCount;
+    header_.block_frames = (std::max(options_.block_frames, 8u) + 7) / 8 * 8;
+    size_t row_bytes = 0;
+    for (uint32_t i = 0; i < kFrameColumnCount; i++) {
+        header_.column_sizes[i] = kFrameColumnSizes[i];
+        row_bytes += kFrameColumnSizes[i];
+    }
+    const size_t block_bytes = sizeof(FrameBlockHeader) + row_bytes * header_.block_frames;
+    header_.block_bytes =
+        static_cast<uint32_t>((block_bytes + kBlockAlign - 1) / kBlockAlign * kBlockAlign);
+    for (uint32_t i = 0; i < kFrameColumnCount; i++) {
+        column_offsets_[i] = frameColumnOffset(header_, i);
+    }
+}
+
+FrameTraceWriter::~FrameTraceWriter() {
+    close();
+}
+
+bool FrameTraceWriter::open() {
+    if (isOpen()) {
+        return true;
+    }
+    const File file = openFile(options_.path);
+    if (file == kNoFile) {
+        LOG_ERROR("Failed to open frame trace %s, error:%lu", options_.path.c_str(), lastError());
+        return false;
+    }
+    file_ = file;
+    const uint64_t size = fileSize(file);
+    blocks_ = 0;
+    block_ = nullptr;
+    FrameTraceHeader existing;
+    const bool trace = readHeader(file, size, &existing) && existing.magic == kFrameTraceMagic;
+    if (trace && sameLayout(existing, header_)) {
+        // A crash can leave part of a block behind the started ones, it never held frames
+        blocks_ = (size - kFrameTraceHeaderBytes) / header_.block_bytes;
+        header_.created_at = existing.created_at;
+        if (size + header_.block_bytes > options_.max_bytes) {
+            return rotate();
+        }
+    }
+    else if (trace) {
+        // Written by another version or with other options, kept as it is
+        LOG_WARN("Frame trace %s has another layout, version %u, %u frames per block",
+                 options_.path.c_str(), existing.version, existing.block_frames);
+        closeFile(file);
+        file_ = kNoFile;
+        return rotate();
+    }
+    else {
+        header_.created_at = static_cast<int64_t>(std::time(nullptr));
+        if (!truncateFile(file, 0)) {
+            LOG_ERROR("Failed to truncate frame trace %s, error:%lu", options_.path.c_str(),
+                      lastError());
+            close();
+            return false;
+        }
+    }
+    if (!map(kFrameTraceHeaderBytes + blocks_ * header_.block_bytes)) {
+        close();
+        return false;
+    }
+    std::memcpy(view_, &header_, sizeof(header_));
+    LOG_INFO("Frame trace %s, %llu blocks of %u frames already in it", options_.path.c_str(),
+             static_cast<unsigned long long>(blocks_), header_.block_frames);
+    return true;
+}
+
+void FrameTraceWriter::close() {
+    if (file_ == kNoFile) {
+        return;
+    }
+    const uint64_t used = kFrameTraceHeaderBytes + blocks_ * header_.block_bytes;
+    unmap();
+    // The mapping grew the file ahead of the blocks
+    truncateFile(file_, used);
+    closeFile(file_);
+    file_ = kNoFile;
+    block_ = nullptr;
+    blocks_ = 0;
+}
+
+bool FrameTraceWriter::append(const FrameRecord& record) {
+    if (!view_) {
+        return false;
+    }
+    if (!block_ || row_ == header_.block_frames) {
+        if (!nextBlock()) {
+            return false;
+        }
+    }
+    put(FrameColumn::OUTPUT_TIME, record.output_time);
+    put(FrameColumn::FRAME_ID, record.frame_id);
+    put(FrameColumn::UPLOAD_US, record.upload_us);
+    put(FrameColumn::ENCODE_US, record.encode_us);
+    put(FrameColumn::SIZE, record.size);
+    put(FrameColumn::TARGET_BITRATE, record.target_bitrate);
+    put(FrameColumn::FPS, record.fps);
+    put(FrameColumn::WIDTH, record.width);
+    put(FrameColumn::HEIGHT, record.height);
+    put(FrameColumn::CODEC, record.codec);
+    put(FrameColumn::FRAME_TYPE, record.frame_type);
+    put(FrameColumn::QP, record.qp);
+    put(FrameColumn::QP_MIN, record.qp_min);
+    put(FrameColumn::QP_MAX, record.qp_max);
+    put(FrameColumn::PIX_NUM_INTRA, record.pix_num_intra);
+    put(FrameColumn::PIX_NUM_INTER, record.pix_num_inter);
+    put(FrameColumn::PIX_NUM_SKIP, record.pix_num_skip);
+    put(FrameColumn::BITCOUNT_RESIDUAL, record.bitcount_residual);
+    put(FrameColumn::BITCOUNT_MOTION, record.bitcount_motion);
+    put(FrameColumn::BITCOUNT_INTER, record.bitcount_inter);
+    put(FrameColumn::BITCOUNT_INTRA, record.bitcount_intra);
+    row_++;
+    // After the columns, a reader never counts a frame whose fields are not there yet
+    reinterpret_cast<FrameBlockHeader*>(block_)->frames = row_;
+    frames_++;
+    return true;
+}
+
+bool FrameTraceWriter::map(uint64_t bytes) {
+    unmap();
+    view_ = mapFile(file_, bytes, &mapping_);
+    if (!view_) {
+        LOG_ERROR("Failed to map %llu B of frame trace, error:%lu",
+                  static_cast<unsigned long long>(bytes), lastError());
+        return false;
+    }
+    mapped_bytes_ = bytes;
+    return true;
+}
+
+void FrameTraceWriter::unmap() {
+    if (view_) {
+        unmapFile(view_, mapped_bytes_, mapping_);
+        view_ = nullptr;
+        mapping_ = nullptr;
+    }
+    mapped_bytes_ = 0;
+}
+
+bool FrameTraceWriter::nextBlock() {
+    const uint64_t end = kFrameTraceHeaderBytes + (blocks_ + 1) * header_.block_bytes;
+    if (end > options_.max_bytes) {
+        if (blocks_ == 0) {
+            LOG_ERROR("Frame trace limit of %llu B is below one block of %u B",
+                      static_cast<unsigned long long>(options_.max_bytes), header_.block_bytes);
+            return false;
+        }
+        return rotate() && nextBlock();
+    }
+    if (end > mapped_bytes_) {
+        const uint64_t grown = kFrameTraceHeaderBytes +
+                               (blocks_ + std::max(options_.grow_blocks, 1u)) * header_.block_bytes;
+        if (!map(std::min(grown, options_.max_bytes))) {
+            return false;
+        }
+    }
+    block_ = view_ + kFrameTraceHeaderBytes + blocks_ * header_.block_bytes;
+    blocks_++;
+    row_ = 0;
+    FrameBlockHeader block_header;
+    std::memcpy(block_, &block_header, sizeof(block_header));
+    return true;
+}
+
+bool FrameTraceWriter::rotate() {
+    close();
+    const std::string rotated = options_.path + ".1";
+    if (!replaceFile(options_.path, rotated)) {
+        LOG_ERROR("Failed to move frame trace to %s, error:%lu", rotated.c_str(), lastError());
+        return false;
+    }
+    LOG_INFO("Frame trace moved to %s", rotated.c_str());
+    return open();
+}
+
+} // namespace amf
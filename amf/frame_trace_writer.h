@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "frame_trace.h"
+
+namespace amf {
+
+// Appends FrameRecords to a frame trace through a mapping of the file.
+// append() stores the fields straight into the mapped columns of the current block, the file is
+// only touched when it grows by `grow_blocks` blocks. What was appended survives a crash of the
+// process, the system writes the mapped pages back. An existing trace of the same layout is
+// continued, a trace of another layout moves to <path>.1 and anything else at `path` is replaced.
+// Beyond `max_bytes` the file moves to <path>.1.
+// Not thread safe, the encoder appends on its output thread only.
+class FrameTraceWriter {
+public:
+#ifdef _WIN32
+    using File = void*;
+    static constexpr File kNoFile = nullptr;
+#else
+    using File = int;
+    static constexpr File kNoFile = -1;
+#endif
+
+    struct Options {
+        std::string path;
+        // Rounded up to a multiple of 8
+        uint32_t block_frames = 4096;
+        uint32_t grow_blocks = 16;
+        uint64_t max_bytes = 1024ull * 1024 * 1024;
+    };
+
+    explicit FrameTraceWriter(const Options& options);
+    // close()
+    ~FrameTraceWriter();
+
+    bool open();
+    // Trims the file to the blocks in use
+    void close();
+    bool isOpen() const { return view_ != nullptr; }
+
+    // False when the file could not grow, the frame is lost
+    bool append(const FrameRecord& record);
+
+    uint64_t frames() const { return frames_; }
+
+private:
+    // Maps `bytes` of the file, it is extended when shorter
+    bool map(uint64_t bytes);
+    void unmap();
+    bool nextBlock();
+    bool rotate();
+
+    template <typename T> void put(FrameColumn column, T value) {
+        reinterpret_cast<T*>(block_ + column_offsets_[static_cast<uint32_t>(column)])[row_] =
+            value;
+    }
+
+private:
+    const Options options_;
+    FrameTraceHeader header_;
+    size_t column_offsets_[kFrameColumnCount] = {0};
+
+    File file_ = kNoFile;
+    // The file mapping object on Windows
+    void* mapping_ = nullptr;
+    uint8_t* view_ = nullptr;
+    uint64_t mapped_bytes_ = 0;
+    // Blocks started so far, the last one is being filled
+    uint64_t blocks_ = 0;
+    uint8_t* block_ = nullptr;
+    uint32_t row_ = 0;
+    uint64_t frames_ = 0;
+};
+
+} // namespace amf
@@ -0,0 +1,102 @@
+#include "framerate_governor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace amf {
+
+// Weight of the latest capture in the motion average
+static constexpr float kMotionWeight = 0.3f;
+// Below this much of the screen the content is a document being edited
+static constexpr float kDocumentMotion = 0.02f;
+// The cap is reached once this much of the screen keeps moving
+static constexpr float kFullMotion = 0.25f;
+static constexpr float kQPWeight = 0.1f;
+// Starved within this many QP of the top of the range, relieved below the larger margin.
+// A third fewer frames only buy ~3.5 QP, the relief has to come from calmer content.
+static constexpr float kStarvedMargin = 2.f;
+static constexpr float kRelievedMargin = 10.f;
+// Share of the frame rate kept while starved
+static constexpr float kStarvedScale = 2.f / 3.f;
+// Frame rates on motion are rounded to this step, the encoder is not updated for every wiggle
+static constexpr uint32_t kFpsStep = 5;
+
+FramerateGovernor::FramerateGovernor()
+    : FramerateGovernor(Options()) {}
+
+FramerateGovernor::FramerateGovernor(const Options& options)
+    : options_(options) {
+    options_.max_fps = std::max(options_.max_fps, 1u);
+    options_.static_fps = std::min(std::max(options_.static_fps, 1u), options_.max_fps);
+    options_.document_fps = std::min(std::max(options_.document_fps, options_.static_fps),
+                                     options_.max_fps);
+    reset();
+}
+
+void FramerateGovernor::reset() {
+    fps_ = options_.max_fps;
+    motion_ = 0.f;
+    last_change_time_ = -1;
+    lower_since_ = -1;
+    qp_ = 0.f;
+    starved_ = false;
+}
+
+bool FramerateGovernor::update(float changed, int64_t at_time) {
+    changed = std::min(std::max(changed, 0.f), 1.f);
+    motion_ += (changed - motion_) * kMotionWeight;
+    // The screen counts as static from the first capture on, not from the epoch of the clock
+    if (changed > 0.f || last_change_time_ < 0) {
+        last_change_time_ = at_time;
+    }
+    const uint32_t wanted = wantedFps(at_time);
+    if (wanted >= fps_) {
+        lower_since_ = -1;
+        if (wanted == fps_) {
+            return false;
+        }
+        fps_ = wanted;
+        return true;
+    }
+    if (lower_since_ < 0) {
+        lower_since_ = at_time;
+    }
+    if (at_time - lower_since_ < static_cast<int64_t>(options_.hold_ms) * 1000) {
+        return false;
+    }
+    lower_since_ = -1;
+    fps_ = wanted;
+    return true;
+}
+
+void FramerateGovernor::onEncoded(uint32_t qp, uint32_t min_qp, uint32_t max_qp) {
+    if (qp == 0 || max_qp <= min_qp) {
+        return;
+    }
+    qp_ = qp_ > 0.f ? qp_ + (qp - qp_) * kQPWeight : static_cast<float>(qp);
+    if (qp_ >= max_qp - kStarvedMargin) {
+        starved_ = true;
+    }
+    else if (qp_ < max_qp - kRelievedMargin) {
+        starved_ = false;
+    }
+}
+
+uint32_t FramerateGovernor::wantedFps(int64_t at_time) const {
+    if (at_time - last_change_time_ >= static_cast<int64_t>(options_.static_delay_ms) * 1000) {
+        return options_.static_fps;
+    }
+    if (motion_ < kDocumentMotion) {
+        return options_.document_fps;
+    }
+    const float ratio =
+        std::min((motion_ - kDocumentMotion) / (kFullMotion - kDocumentMotion), 1.f);
+    float fps = options_.document_fps + (options_.max_fps - options_.document_fps) * ratio;
+    if (starved_) {
+        fps *= kStarvedScale;
+    }
+    uint32_t rounded = static_cast<uint32_t>(std::lround(fps / kFpsStep)) * kFpsStep;
+    return std::min(std::max(rounded, options_.document_fps), options_.max_fps);
+}
+
+} // namespace amf
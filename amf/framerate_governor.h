@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+namespace amf {
+
+// Picks the frame rate of a screen session from how much of the screen moves.
+// Fed with the share of the screen that changed between two captures (amf::DirtyRegionDetector)
+// and with the average QP of the packets. An idle screen drops to a refresh rate, typing and small
+// edits run at a document rate and motion raises it towards the cap. When the encoder already
+// spends its QP range on motion, fewer frames get more bits each.
+// Raising the frame rate is immediate, lowering it waits for the content to stay calm.
+class FramerateGovernor {
+public:
+    struct Options {
+        uint32_t max_fps = 30;
+        // Nothing changed for `static_delay_ms`
+        uint32_t static_fps = 1;
+        uint32_t static_delay_ms = 2000;
+        // A few tiles change, a caret, typing
+        uint32_t document_fps = 5;
+        uint32_t hold_ms = 1000;
+    };
+
+    FramerateGovernor();
+    explicit FramerateGovernor(const Options& options);
+
+    // `changed` is the share of the screen that changed since the previous capture, in [0, 1].
+    // Returns true when fps() changed.
+    bool update(float changed, int64_t at_time);
+
+    // Average QP of the last packet and the QP range the encoder runs with
+    void onEncoded(uint32_t qp, uint32_t min_qp, uint32_t max_qp);
+
+    void reset();
+
+    uint32_t fps() const { return fps_; }
+    float motion() const { return motion_; }
+    bool starved() const { return starved_; }
+    const Options& options() const { return options_; }
+
+private:
+    uint32_t wantedFps(int64_t at_time) const;
+
+private:
+    Options options_;
+
+    uint32_t fps_ = 0;
+    // Moving average of `changed`
+    float motion_ = 0.f;
+    // Of the last capture with changes, -1 before the first capture
+    int64_t last_change_time_ = -1;
+    // Since when the wanted frame rate stays below fps_, -1 when it does not
+    int64_t lower_since_ = -1;
+
+    // Moving average of the QP, with its position in the QP range
+    float qp_ = 0.f;
+    bool starved_ = false;
+};
+
+} // namespace amf
@@ -0,0 +1,416 @@
+#include "hdr_convert.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include "thread_pool.h"
+
+#if defined(AMF_ARCH_X86)
+#include <immintrin.h>
+#endif
+
+namespace amf {
+
+// The tables cover [2^kMinExp, 2^(kMinExp + kOctaves)) with 2^kBinBits bins per octave, so the
+// index is just the top bits of the float. Smaller values (and zero, negatives, NaN) hit the first
+// bin, larger ones the last. 2^7 scRGB is above the 10000 nits PQ ends at.
+static constexpr int kBinBits = 7;
+static constexpr int kBins = 1 << kBinBits;
+static constexpr int kMinExp = -20;
+static constexpr int kOctaves = 27;
+static constexpr int kLutSize = kOctaves * kBins;
+static constexpr int kIndexBase = (127 + kMinExp) << kBinBits;
+
+// Windows composes SDR content at 1.0 scRGB by default
+static constexpr float kDefaultSdrWhite = 1.0f;
+// Below this share of SDR white the NV12 tone map is the identity
+static constexpr double kToneMapKnee = 0.8;
+
+// constexpr replacements for the <cmath> functions the tables need
+namespace ct {
+
+constexpr double kLn2 = 0.6931471805599453;
+
+constexpr double exp2i(int e) {
+    double v = 1.0;
+    for (; e > 0; e--) {
+        v *= 2.0;
+    }
+    for (; e < 0; e++) {
+        v *= 0.5;
+    }
+    return v;
+}
+
+constexpr double log(double x) {
+    int e = 0;
+    while (x >= 2.0) {
+        x *= 0.5;
+        e++;
+    }
+    while (x < 1.0) {
+        x *= 2.0;
+        e--;
+    }
+    // ln(x) = 2 atanh((x - 1) / (x + 1)), |z| <= 1/3 converges fast
+    const double z = (x - 1.0) / (x + 1.0);
+    const double z2 = z * z;
+    double term = z;
+    double sum = 0.0;
+    for (int k = 1; k < 40; k += 2) {
+        sum += term / k;
+        term *= z2;
+    }
+    return 2.0 * sum + e * kLn2;
+}
+
+constexpr double exp(double x) {
+    int k = static_cast<int>(x / kLn2);
+    double r = x - k * kLn2;
+    if (r < 0) {
+        r += kLn2;
+        k--;
+    }
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 24; n++) {
+        term *= r / n;
+        sum += term;
+    }
+    return sum * exp2i(k);
+}
+
+constexpr double pow(double x, double y) {
+    return x <= 0.0 ? 0.0 : exp(y * log(x));
+}
+
+} // namespace ct
+
+// scRGB -> PQ, 1.0 = 80 nits and PQ ends at 10000 nits
+struct PqCurve {
+    static constexpr double apply(double x) {
+        constexpr double m1 = 2610.0 / 16384.0;
+        constexpr double m2 = 2523.0 / 4096.0 * 128.0;
+        constexpr double c1 = 3424.0 / 4096.0;
+        constexpr double c2 = 2413.0 / 4096.0 * 32.0;
+        constexpr double c3 = 2392.0 / 4096.0 * 32.0;
+        const double y = std::min(x * 80.0 / 10000.0, 1.0);
+        const double ym1 = ct::pow(y, m1);
+        return ct::pow((c1 + c2 * ym1) / (1.0 + c3 * ym1), m2);
+    }
+};
+
+// SDR white relative -> sRGB, highlights are compressed into [knee, 1) with slope 1 at the knee
+struct SdrCurve {
+    static constexpr double apply(double x) {
+        if (x > kToneMapKnee) {
+            const double t = (x - kToneMapKnee) / (1.0 - kToneMapKnee);
+            x = kToneMapKnee + (1.0 - kToneMapKnee) * t / (1.0 + t);
+        }
+        if (x <= 0.0031308) {
+            return 12.92 * x;
+        }
+        return 1.055 * ct::pow(x, 1.0 / 2.4) - 0.055;
+    }
+};
+
+// One octave per constant evaluation keeps each one well within the compilers' step limits
+template <typename Curve, int Octave> struct OctaveTable {
+    static constexpr std::array<float, kBins> build() {
+        std::array<float, kBins> values = {};
+        const double base = ct::exp2i(kMinExp + Octave);
+        for (int i = 0; i < kBins; i++) {
+            // Middle of the bin
+            values[i] = static_cast<float>(Curve::apply(base * (1.0 + (i + 0.5) / kBins)));
+        }
+        // Everything below the table, zero included, has to stay black
+        if (Octave == 0) {
+            values[0] = static_cast<float>(Curve::apply(0.0));
+        }
+        return values;
+    }
+    static constexpr std::array<float, kBins> values = build();
+};
+
+template <typename Curve, size_t... I>
+constexpr std::array<float, sizeof...(I)> buildTable(std::index_sequence<I...>) {
+    return {{OctaveTable<Curve, static_cast<int>(I / kBins)>::values[I % kBins]...}};
+}
+
+alignas(64) static constexpr std::array<float, kLutSize> kPqTable =
+    buildTable<PqCurve>(std::make_index_sequence<kLutSize>());
+alignas(64) static constexpr std::array<float, kLutSize> kSdrTable =
+    buildTable<SdrCurve>(std::make_index_sequence<kLutSize>());
+
+static_assert(kPqTable[0] < 1e-5f && kPqTable[kLutSize - 1] == 1.0f, "PQ table out of range");
+static_assert(kSdrTable[0] < 1e-5f && kSdrTable[kLutSize - 1] < 1.0f, "SDR table out of range");
+
+static inline float halfToFloat(uint16_t h) {
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1f;
+    const uint32_t mantissa = h & 0x3ff;
+    if (exponent == 0) {
+        const float value = mantissa * (1.0f / 16777216.0f);
+        return sign ? -value : value;
+    }
+    uint32_t bits = sign | (mantissa << 13);
+    bits |= exponent == 31 ? 0x7f800000 : (exponent + 112) << 23;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline float lookup_C(float x, const float* lut) {
+    // Also sends NaN to the first bin
+    x = x > 0.0f ? x : 0.0f;
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    const int index = static_cast<int>(bits >> (23 - kBinBits)) - kIndexBase;
+    return lut[std::min(std::max(index, 0), kLutSize - 1)];
+}
+
+static inline void nonlinear_C(const ScRgbConverter::Params& p, const uint16_t* px, float rgb[3]) {
+    const float r = halfToFloat(px[0]);
+    const float g = halfToFloat(px[1]);
+    const float b = halfToFloat(px[2]);
+    const float* m = p.matrix;
+    rgb[0] = lookup_C(m[0] * r + m[1] * g + m[2] * b, p.lut);
+    rgb[1] = lookup_C(m[3] * r + m[4] * g + m[5] * b, p.lut);
+    rgb[2] = lookup_C(m[6] * r + m[7] * g + m[8] * b, p.lut);
+}
+
+template <typename Sample, int kShift> static inline Sample quantize(float code, float max_code) {
+    code = std::min(std::max(code, 0.0f), max_code);
+    return static_cast<Sample>(static_cast<int>(code) << kShift);
+}
+
+// The simd kernels round differently (fma), they may differ from this by one code
+template <bool kP010>
+static uint32_t row_C(const ScRgbConverter::Params& p, const uint16_t* rgba0, const uint16_t* rgba1,
+                      uint32_t width, void* y0, void* y1, void* uv) {
+    using Sample = typename std::conditional<kP010, uint16_t, uint8_t>::type;
+    constexpr int kShift = kP010 ? 6 : 0;
+    Sample* dst_y0 = static_cast<Sample*>(y0);
+    Sample* dst_y1 = static_cast<Sample*>(y1);
+    Sample* dst_uv = static_cast<Sample*>(uv);
+    for (uint32_t x = 0; x < width; x += 2) {
+        const uint32_t x1 = std::min(x + 1, width - 1);
+        const uint16_t* px[4] = {rgba0 + x * 4, rgba0 + x1 * 4, rgba1 + x * 4, rgba1 + x1 * 4};
+        Sample* dst[4] = {dst_y0 + x, dst_y0 + x1, dst_y1 + x, dst_y1 + x1};
+        float sum[3] = {0.0f, 0.0f, 0.0f};
+        for (int i = 0; i < 4; i++) {
+            float rgb[3];
+            nonlinear_C(p, px[i], rgb);
+            const float y = p.y_offset + p.y[0] * rgb[0] + p.y[1] * rgb[1] + p.y[2] * rgb[2];
+            *dst[i] = quantize<Sample, kShift>(y, p.max_code);
+            sum[0] += rgb[0];
+            sum[1] += rgb[1];
+            sum[2] += rgb[2];
+        }
+        const float u = p.uv_offset + p.u[0] * sum[0] + p.u[1] * sum[1] + p.u[2] * sum[2];
+        const float v = p.uv_offset + p.v[0] * sum[0] + p.v[1] * sum[1] + p.v[2] * sum[2];
+        dst_uv[x] = quantize<Sample, kShift>(u, p.max_code);
+        dst_uv[x + 1] = quantize<Sample, kShift>(v, p.max_code);
+    }
+    return width;
+}
+
+#if defined(AMF_ARCH_X86)
+AMF_TARGET_F16C static inline __m256 lookup_F16C(__m256 x, const float* lut) {
+    x = _mm256_max_ps(x, _mm256_setzero_ps());
+    __m256i index = _mm256_srli_epi32(_mm256_castps_si256(x), 23 - kBinBits);
+    index = _mm256_sub_epi32(index, _mm256_set1_epi32(kIndexBase));
+    index = _mm256_max_epi32(index, _mm256_setzero_si256());
+    index = _mm256_min_epi32(index, _mm256_set1_epi32(kLutSize - 1));
+    return _mm256_i32gather_ps(lut, index, 4);
+}
+
+AMF_TARGET_F16C static inline __m256 dot_F16C(const float* c, __m256 r, __m256 g, __m256 b,
+                                              __m256 offset) {
+    __m256 sum = _mm256_fmadd_ps(_mm256_set1_ps(c[0]), r, offset);
+    sum = _mm256_fmadd_ps(_mm256_set1_ps(c[1]), g, sum);
+    return _mm256_fmadd_ps(_mm256_set1_ps(c[2]), b, sum);
+}
+
+// 8 pixels -> non linear R, G, B in the order 0 2 4 6 | 1 3 5 7, so that adding the two halves
+// sums horizontal neighbours
+AMF_TARGET_F16C static inline void nonlinear_F16C(const ScRgbConverter::Params& p,
+                                                  const uint16_t* px, __m256* r, __m256* g,
+                                                  __m256* b) {
+    const __m128i* src = reinterpret_cast<const __m128i*>(px);
+    const __m256 p01 = _mm256_cvtph_ps(_mm_loadu_si128(src + 0));
+    const __m256 p23 = _mm256_cvtph_ps(_mm_loadu_si128(src + 1));
+    const __m256 p45 = _mm256_cvtph_ps(_mm_loadu_si128(src + 2));
+    const __m256 p67 = _mm256_cvtph_ps(_mm_loadu_si128(src + 3));
+    const __m256 rg0 = _mm256_unpacklo_ps(p01, p23);
+    const __m256 ba0 = _mm256_unpackhi_ps(p01, p23);
+    const __m256 rg1 = _mm256_unpacklo_ps(p45, p67);
+    const __m256 ba1 = _mm256_unpackhi_ps(p45, p67);
+    const __m256 lr = _mm256_shuffle_ps(rg0, rg1, 0x44);
+    const __m256 lg = _mm256_shuffle_ps(rg0, rg1, 0xEE);
+    const __m256 lb = _mm256_shuffle_ps(ba0, ba1, 0x44);
+    const __m256 zero = _mm256_setzero_ps();
+    *r = lookup_F16C(dot_F16C(p.matrix + 0, lr, lg, lb, zero), p.lut);
+    *g = lookup_F16C(dot_F16C(p.matrix + 3, lr, lg, lb, zero), p.lut);
+    *b = lookup_F16C(dot_F16C(p.matrix + 6, lr, lg, lb, zero), p.lut);
+}
+
+AMF_TARGET_F16C static inline __m128i codes_F16C(__m256 code, __m256 max_code, __m256i order) {
+    code = _mm256_min_ps(_mm256_max_ps(code, _mm256_setzero_ps()), max_code);
+    const __m256i v = _mm256_permutevar8x32_epi32(_mm256_cvttps_epi32(code), order);
+    return _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+}
+
+template <bool kP010> AMF_TARGET_F16C static inline void store_F16C(void* dst, __m128i codes) {
+    if (kP010) {
+        _mm_storeu_si128(static_cast<__m128i*>(dst), _mm_slli_epi16(codes, 6));
+    }
+    else {
+        _mm_storel_epi64(static_cast<__m128i*>(dst), _mm_packus_epi16(codes, codes));
+    }
+}
+
+template <bool kP010>
+AMF_TARGET_F16C static uint32_t row_F16C(const ScRgbConverter::Params& p, const uint16_t* rgba0,
+                                         const uint16_t* rgba1, uint32_t width, void* y0, void* y1,
+                                         void* uv) {
+    using Sample = typename std::conditional<kP010, uint16_t, uint8_t>::type;
+    Sample* dst_y0 = static_cast<Sample*>(y0);
+    Sample* dst_y1 = static_cast<Sample*>(y1);
+    Sample* dst_uv = static_cast<Sample*>(uv);
+    const __m256 y_offset = _mm256_set1_ps(p.y_offset);
+    const __m128 uv_offset = _mm_set1_ps(p.uv_offset);
+    const __m256 max_code = _mm256_set1_ps(p.max_code);
+    const __m128 max_code4 = _mm_set1_ps(p.max_code);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    uint32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256 r0, g0, b0, r1, g1, b1;
+        nonlinear_F16C(p, rgba0 + x * 4, &r0, &g0, &b0);
+        nonlinear_F16C(p, rgba1 + x * 4, &r1, &g1, &b1);
+        store_F16C<kP010>(dst_y0 + x,
+                          codes_F16C(dot_F16C(p.y, r0, g0, b0, y_offset), max_code, order));
+        store_F16C<kP010>(dst_y1 + x,
+                          codes_F16C(dot_F16C(p.y, r1, g1, b1, y_offset), max_code, order));
+        const __m256 sr = _mm256_add_ps(r0, r1);
+        const __m256 sg = _mm256_add_ps(g0, g1);
+        const __m256 sb = _mm256_add_ps(b0, b1);
+        const __m128 r = _mm_add_ps(_mm256_castps256_ps128(sr), _mm256_extractf128_ps(sr, 1));
+        const __m128 g = _mm_add_ps(_mm256_castps256_ps128(sg), _mm256_extractf128_ps(sg, 1));
+        const __m128 b = _mm_add_ps(_mm256_castps256_ps128(sb), _mm256_extractf128_ps(sb, 1));
+        __m128 u = _mm_fmadd_ps(_mm_set1_ps(p.u[0]), r, uv_offset);
+        u = _mm_fmadd_ps(_mm_set1_ps(p.u[1]), g, u);
+        u = _mm_fmadd_ps(_mm_set1_ps(p.u[2]), b, u);
+        __m128 v = _mm_fmadd_ps(_mm_set1_ps(p.v[0]), r, uv_offset);
+        v = _mm_fmadd_ps(_mm_set1_ps(p.v[1]), g, v);
+        v = _mm_fmadd_ps(_mm_set1_ps(p.v[2]), b, v);
+        const __m128i ui = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(u, _mm_setzero_ps()), max_code4));
+        const __m128i vi = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), max_code4));
+        const __m128i codes =
+            _mm_packus_epi32(_mm_unpacklo_epi32(ui, vi), _mm_unpackhi_epi32(ui, vi));
+        store_F16C<kP010>(dst_uv + x, codes);
+    }
+    return x;
+}
+#endif // AMF_ARCH_X86
+
+// Y'CbCr from non linear R'G'B', scaled to output codes. Chroma is computed from the sum of a 2x2
+// block.
+static void setYuvCoefficients(ScRgbConverter::Params* p, double kr, double kb, bool full,
+                               int bits) {
+    const double scale = 1 << (bits - 8);
+    const double kg = 1.0 - kr - kb;
+    const double y_range = (full ? 255.0 : 219.0) * scale;
+    const double uv_range = (full ? 255.0 : 224.0) * scale / 4.0;
+    const double y[3] = {kr, kg, kb};
+    const double u[3] = {-kr / (2.0 * (1.0 - kb)), -kg / (2.0 * (1.0 - kb)), 0.5};
+    const double v[3] = {0.5, -kg / (2.0 * (1.0 - kr)), -kb / (2.0 * (1.0 - kr))};
+    for (int i = 0; i < 3; i++) {
+        p->y[i] = static_cast<float>(y[i] * y_range);
+        p->u[i] = static_cast<float>(u[i] * uv_range);
+        p->v[i] = static_cast<float>(v[i] * uv_range);
+    }
+    p->y_offset = static_cast<float>((full ? 0.0 : 16.0) * scale + 0.5);
+    p->uv_offset = static_cast<float>(128.0 * scale + 0.5);
+    p->max_code = static_cast<float>((1 << bits) - 1);
+}
+
+ScRgbConverter::ScRgbConverter(Output output, SimdLevel level, const ColorSpace& color)
+    : output_(output) {
+    if (output_ == Output::P010) {
+        // BT.709 -> BT.2020 primaries, ITU-R BT.2087
+        static constexpr float kBt709To2020[9] = {0.6274f, 0.3293f, 0.0433f, 0.0691f, 0.9195f,
+                                                  0.0114f, 0.0164f, 0.0880f, 0.8956f};
+        memcpy(params_.matrix, kBt709To2020, sizeof(params_.matrix));
+        params_.lut = kPqTable.data();
+        setYuvCoefficients(&params_, 0.2627, 0.0593, false, 10);
+    }
+    else {
+        params_.lut = kSdrTable.data();
+        static constexpr double kKr[] = {0.299, 0.2126, 0.2627};
+        static constexpr double kKb[] = {0.114, 0.0722, 0.0593};
+        const auto matrix = static_cast<size_t>(color.matrix);
+        setYuvCoefficients(&params_, kKr[matrix], kKb[matrix], color.range == ColorRange::FULL, 8);
+        setSdrWhite(kDefaultSdrWhite);
+    }
+    row_c_ = output_ == Output::P010 ? row_C<true> : row_C<false>;
+    row_ = row_c_;
+    level_ = resolveSimdLevel(level);
+    switch (level_) {
+#if defined(AMF_ARCH_X86)
+    case SimdLevel::AVX2:
+    case SimdLevel::AVX512:
+        if (cpuFeatures().f16c) {
+            level_ = SimdLevel::AVX2;
+            row_ = output_ == Output::P010 ? row_F16C<true> : row_F16C<false>;
+            break;
+        }
+        level_ = SimdLevel::SCALAR;
+        break;
+#endif
+    default:
+        level_ = SimdLevel::SCALAR;
+        break;
+    }
+}
+
+void ScRgbConverter::setSdrWhite(float sdr_white) {
+    if (output_ != Output::NV12 || !(sdr_white > 0.0f)) {
+        return;
+    }
+    memset(params_.matrix, 0, sizeof(params_.matrix));
+    params_.matrix[0] = params_.matrix[4] = params_.matrix[8] = 1.0f / sdr_white;
+}
+
+void ScRgbConverter::convert(const uint8_t* rgba, uint32_t rgba_pitch, uint32_t width,
+                             uint32_t height, uint8_t* y, uint32_t y_pitch, uint8_t* uv,
+                             uint32_t uv_pitch) const {
+    const uint32_t sample_size = output_ == Output::P010 ? 2 : 1;
+    const uint32_t uv_rows = (height + 1) / 2;
+    // Every pixel goes through 3 table lookups, worth splitting much earlier than a plain copy
+    constexpr uint32_t kMinRowsPerBand = 32;
+    parallelForRows(uv_rows, kMinRowsPerBand, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t uv_row = begin; uv_row < end; uv_row++) {
+            const uint32_t row = uv_row * 2;
+            const bool last = row + 1 >= height;
+            const uint8_t* row0 = rgba + static_cast<size_t>(row) * rgba_pitch;
+            auto src0 = reinterpret_cast<const uint16_t*>(row0);
+            auto src1 = last ? src0 : reinterpret_cast<const uint16_t*>(row0 + rgba_pitch);
+            uint8_t* y0 = y + static_cast<size_t>(row) * y_pitch;
+            // The last row of an odd height is written twice with the same values
+            uint8_t* y1 = last ? y0 : y0 + y_pitch;
+            uint8_t* dst_uv = uv + static_cast<size_t>(uv_row) * uv_pitch;
+            const uint32_t done = row_(params_, src0, src1, width, y0, y1, dst_uv);
+            if (done < width) {
+                const size_t offset = static_cast<size_t>(done) * sample_size;
+                row_c_(params_, src0 + done * 4, src1 + done * 4, width - done, y0 + offset,
+                       y1 + offset, dst_uv + offset);
+            }
+        }
+    });
+}
+
+} // namespace amf
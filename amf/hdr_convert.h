@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+#include "color_space.h"
+#include "cpu_features.h"
+
+namespace amf {
+
+// R16G16B16A16_FLOAT scRGB (linear, BT.709 primaries, 1.0 = 80 nits) -> 4:2:0 on the cpu.
+// P010 is HDR10: BT.2020 primaries, PQ, BT.2020 non constant luminance, limited range.
+// NV12 is SDR with the matrix and range of the ColorSpace, like BgraToNv12Converter. The primaries
+// stay BT.709 and chroma is always a 2x2 average. Everything above SDR white is rolled off into the
+// top of the range before the sRGB curve instead of being clipped.
+// Both transfer curves are tables built at compile time, indexed by the float bits.
+class ScRgbConverter {
+public:
+    enum class Output : uint8_t {
+        NV12 = 0,
+        // 10 bits in the high bits of each 16-bit sample
+        P010 = 1,
+    };
+
+    struct Params {
+        // Applied to linear scRGB before the transfer curve
+        float matrix[9];
+        const float* lut;
+        // Non linear RGB -> Y, Cb, Cr already scaled to output codes, chroma to a 2x2 sum
+        float y[3];
+        float u[3];
+        float v[3];
+        // With +0.5 so that truncation rounds
+        float y_offset;
+        float uv_offset;
+        float max_code;
+    };
+
+    using RowFunc = uint32_t (*)(const Params& params, const uint16_t* rgba0, const uint16_t* rgba1,
+                                 uint32_t width, void* y0, void* y1, void* uv);
+
+    // P010 ignores the color space
+    explicit ScRgbConverter(Output output, SimdLevel level = SimdLevel::AUTO,
+                            const ColorSpace& color = {});
+
+    Output output() const { return output_; }
+    SimdLevel level() const { return level_; }
+
+    // scRGB value that is SDR white, the "SDR content brightness" of Windows HDR (1.0 = 80 nits).
+    // NV12 only, P010 keeps absolute luminance.
+    void setSdrWhite(float sdr_white);
+
+    // Odd width|height are allowed. Pitches are in bytes, for P010 y|uv point to 16-bit samples.
+    void convert(const uint8_t* rgba, uint32_t rgba_pitch, uint32_t width, uint32_t height,
+                 uint8_t* y, uint32_t y_pitch, uint8_t* uv, uint32_t uv_pitch) const;
+
+private:
+    const Output output_;
+    SimdLevel level_ = SimdLevel::SCALAR;
+    Params params_;
+    // The simd kernels return how many pixels they handled, the scalar one finishes the row
+    RowFunc row_ = nullptr;
+    RowFunc row_c_ = nullptr;
+};
+
+} // namespace amf
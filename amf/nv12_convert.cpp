@@ -1,6 +1,9 @@
 
 #include "nv12_convert.h"
 
+#include <algorithm>
+#include <cstring>
+
 #if !defined(SAFE_RELEASE)
 #define SAFE_RELEASE(X)                                                                            \
     if (X) {                                                                                       \
@@ -60,44 +63,61 @@ void D3D11VideoProcessorConvert::Cleanup() {
 HRESULT D3D11VideoProcessorConvert::ConvertAndCrop(ID3D11Texture2D* pRGB, ID3D11Texture2D* pYUV,
                                                    int offset_x, int offset_y, int cropped_width,
                                                    int cropped_height) {
-    HRESULT hr = S_OK;
-    if (!pRGB) {
-        return -1;
+    if (!pRGB || !pYUV) {
+        return E_INVALIDARG;
     }
-    Microsoft::WRL::ComPtr<ID3D11Device> input_texture_device;
-    pRGB->GetDevice(input_texture_device.GetAddressOf());
-
-    if (!corp_temp_texture_) {
-        CD3D11_TEXTURE2D_DESC input_desc = {};
-        pRGB->GetDesc(&input_desc);
-        input_desc.Width = cropped_width;
-        input_desc.Height = cropped_height;
-
-        hr = input_texture_device->CreateTexture2D(&input_desc, nullptr,
-                                                   corp_temp_texture_.GetAddressOf());
-        if (FAILED(hr)) {
+    D3D11_TEXTURE2D_DESC inDesc = {0};
+    pRGB->GetDesc(&inDesc);
+    /// Keep the crop inside the input, a window moving off screen only loses its outer part
+    RECT rect;
+    rect.left = std::max(offset_x, 0);
+    rect.top = std::max(offset_y, 0);
+    rect.right = std::min(offset_x + cropped_width, static_cast<int>(inDesc.Width));
+    rect.bottom = std::min(offset_y + cropped_height, static_cast<int>(inDesc.Height));
+    if (rect.right <= rect.left || rect.bottom <= rect.top) {
+        return E_INVALIDARG;
+    }
+    return ConvertRect(pRGB, pYUV, &rect, true);
+}
 
-            return hr;
+/// Perform Colorspace conversion
+void D3D11VideoProcessorConvert::SetOutputColorSpace(UINT ycbcr_matrix, bool full_range) {
+    output_matrix_ = ycbcr_matrix;
+    output_full_range_ = full_range;
+    if (!m_pVP) {
+        return;
+    }
+    // The DXGI color spaces also carry the siting, only the left one exists for BT.601|709 and
+    // that is what the encoder signals. The legacy one leaves it to the driver.
+    ID3D11VideoContext1* context1 = nullptr;
+    if (SUCCEEDED(m_pVidCtx->QueryInterface(__uuidof(ID3D11VideoContext1), (void**)&context1))) {
+        DXGI_COLOR_SPACE_TYPE type;
+        if (output_matrix_ == 0) {
+            type = output_full_range_ ? DXGI_COLOR_SPACE_YCBCR_FULL_G22_LEFT_P601
+                                      : DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P601;
         }
+        else {
+            type = output_full_range_ ? DXGI_COLOR_SPACE_YCBCR_FULL_G22_LEFT_P709
+                                      : DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P709;
+        }
+        context1->VideoProcessorSetOutputColorSpace1(m_pVP, type);
+        context1->Release();
+        return;
     }
-    Microsoft::WRL::ComPtr<ID3D11DeviceContext> input_texture_device_ctx;
-    input_texture_device->GetImmediateContext(&input_texture_device_ctx);
-
-    D3D11_BOX source_region;
-    source_region.left = offset_x;
-    source_region.right = offset_x + cropped_width;
-    source_region.top = offset_y;
-    source_region.bottom = offset_y + cropped_height;
-    source_region.front = 0;
-    source_region.back = 1;
-    input_texture_device_ctx->CopySubresourceRegion(corp_temp_texture_.Get(), 0, 0, 0, 0, pRGB, 0,
-                                                    &source_region);
-    return Convert(corp_temp_texture_.Get(), pYUV);
+    D3D11_VIDEO_PROCESSOR_COLOR_SPACE space = {0};
+    space.YCbCr_Matrix = output_matrix_;
+    space.Nominal_Range = output_full_range_ ? D3D11_VIDEO_PROCESSOR_NOMINAL_RANGE_0_255
+                                             : D3D11_VIDEO_PROCESSOR_NOMINAL_RANGE_16_235;
+    m_pVidCtx->VideoProcessorSetOutputColorSpace(m_pVP, &space);
 }
 
-/// Perform Colorspace conversion
 HRESULT D3D11VideoProcessorConvert::Convert(ID3D11Texture2D* pRGB, ID3D11Texture2D* pYUV,
                                             bool store_texture) {
+    return ConvertRect(pRGB, pYUV, nullptr, store_texture);
+}
+
+HRESULT D3D11VideoProcessorConvert::ConvertRect(ID3D11Texture2D* pRGB, ID3D11Texture2D* pYUV,
+                                                const RECT* source_rect, bool store_texture) {
     HRESULT hr = S_OK;
 
     D3D11_TEXTURE2D_DESC inDesc = {0};
@@ -133,9 +153,19 @@ HRESULT D3D11VideoProcessorConvert::Convert(ID3D11Texture2D* pRGB, ID3D11Texture
         hr = m_pVid->CreateVideoProcessor(m_pVPEnum, 0, &m_pVP);
         if (FAILED(hr)) {
         }
-        D3D11_VIDEO_PROCESSOR_COLOR_SPACE space = {0};
-        space.YCbCr_Matrix = 1;
-        m_pVidCtx->VideoProcessorSetOutputColorSpace(m_pVP, &space);
+        SetOutputColorSpace(output_matrix_, output_full_range_);
+        source_rect_enabled_ = false;
+    }
+
+    /// The processor state only depends on the texture sizes, a crop is a per-stream rectangle
+    const bool rect_enabled = source_rect != nullptr;
+    if (rect_enabled != source_rect_enabled_ ||
+        (rect_enabled && memcmp(source_rect, &source_rect_, sizeof(RECT)) != 0)) {
+        m_pVidCtx->VideoProcessorSetStreamSourceRect(m_pVP, 0, rect_enabled, source_rect);
+        source_rect_enabled_ = rect_enabled;
+        if (rect_enabled) {
+            source_rect_ = *source_rect;
+        }
     }
 
     // Obtain Video Processor Iutput view from input texture
@@ -11,8 +11,14 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
+
+#include "cpu_convert.h"
+#include "cpu_scaler.h"
+#include "hdr_convert.h"
 
 class D3D11VideoProcessorConvert {
     /// Simple Preprocessor class
@@ -69,6 +75,11 @@ public:
 
     ID3D11DeviceContext* GetConvertD3DContext();
 
+    /// Output YCbCr matrix (0: BT.601, 1: BT.709) and nominal range, BT.709 limited by default.
+    /// Chroma is co-sited left where the video context supports DXGI color spaces
+    void SetOutputColorSpace(UINT ycbcr_matrix, bool full_range);
+
+    /// Convert a sub-rectangle of pRGB, the video processor samples it in place
     HRESULT ConvertAndCrop(ID3D11Texture2D* pRGB, ID3D11Texture2D* pYUV, int offset_x, int offset_y,
                            int cropped_width, int cropped_height);
 
@@ -79,5 +90,73 @@ public:
     ~D3D11VideoProcessorConvert() { Cleanup(); }
 
 private:
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> corp_temp_texture_;
+    HRESULT ConvertRect(ID3D11Texture2D* pRGB, ID3D11Texture2D* pYUV, const RECT* source_rect,
+                        bool store_texture);
+
+private:
+    /// Stream source rectangle currently set on m_pVP, only pushed again when the crop moves
+    RECT source_rect_ = {0, 0, 0, 0};
+    bool source_rect_enabled_ = false;
+
+    UINT output_matrix_ = 1;
+    bool output_full_range_ = false;
+};
+
+namespace amf {
+
+class NV12Convertor {
+public:
+    enum class Backend : uint8_t {
+        VIDEO_PROCESSOR = 0,
+        // Map the input texture and convert with BgraToNv12Converter, no video device required.
+        // Also takes R16G16B16A16_FLOAT (ScRgbConverter) into NV12 or P010.
+        // An input or crop of another size is scaled to the output with CpuScaler, as the video
+        // processor stretches it. P010 is not scaled, it is converted 1:1 from the top left and
+        // the edge pixels fill the rest.
+        CPU = 1,
+    };
+
+    ~NV12Convertor();
+
+    // `color` is what the converted frames are encoded as, it has to match the encoder settings.
+    // BT.2020 needs Backend::CPU, the video processor fails to initialize with it.
+    bool init(Microsoft::WRL::ComPtr<ID3D11Device> d3d11_device, uint32_t width, uint32_t height,
+              Backend backend = Backend::VIDEO_PROCESSOR, const ColorSpace& color = {});
+
+    bool convert(Microsoft::WRL::ComPtr<ID3D11Texture2D> input,
+                 Microsoft::WRL::ComPtr<ID3D11Texture2D>& output);
+
+    // Converts only `crop` of the input, read in place by either backend
+    bool convert(Microsoft::WRL::ComPtr<ID3D11Texture2D> input,
+                 Microsoft::WRL::ComPtr<ID3D11Texture2D>& output, const RECT& crop);
+
+    Backend backend() const { return backend_; }
+    const ColorSpace& colorSpace() const { return color_; }
+
+private:
+    void uninit();
+
+    bool convertOnCpu(Microsoft::WRL::ComPtr<ID3D11Texture2D> input,
+                      Microsoft::WRL::ComPtr<ID3D11Texture2D>& output, const RECT* crop);
+
+    bool prepareStagingTextures(const D3D11_TEXTURE2D_DESC& input_desc,
+                                const D3D11_TEXTURE2D_DESC& output_desc);
+
+private:
+    Backend backend_ = Backend::VIDEO_PROCESSOR;
+    ColorSpace color_;
+    std::unique_ptr<D3D11VideoProcessorConvert> convert_;
+
+    Microsoft::WRL::ComPtr<ID3D11Device> d3d11_dev_;
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext> d3d11_ctx_;
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> input_staging_;
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> nv12_staging_;
+    std::unique_ptr<BgraToNv12Converter> cpu_convert_;
+    // Created on the first fp16 frame, for the output format of that frame
+    std::unique_ptr<ScRgbConverter> hdr_convert_;
+    // NV12 of the input or crop at its own size, when it has to be scaled to the output
+    std::unique_ptr<CpuScaler> scaler_;
+    std::vector<uint8_t> scale_buffer_;
 };
+
+} // namespace amf
@@ -0,0 +1,120 @@
+#include "p2_quantile.h"
+
+#include <algorithm>
+
+namespace amf {
+
+P2Quantile::P2Quantile(double p)
+    : p_(std::min(std::max(p, 0.0), 1.0)) {
+    desired_[0] = 0.0;
+    desired_[1] = 2.0 * p_;
+    desired_[2] = 4.0 * p_;
+    desired_[3] = 2.0 + 2.0 * p_;
+    desired_[4] = 4.0;
+    increments_[0] = 0.0;
+    increments_[1] = p_ / 2.0;
+    increments_[2] = p_;
+    increments_[3] = (1.0 + p_) / 2.0;
+    increments_[4] = 1.0;
+    for (int i = 0; i < 5; i++) {
+        positions_[i] = i;
+    }
+}
+
+void P2Quantile::add(double value) {
+    if (count_ < 5) {
+        heights_[count_++] = value;
+        if (count_ == 5) {
+            std::sort(heights_, heights_ + 5);
+        }
+        return;
+    }
+    count_++;
+    int k = 0;
+    if (value < heights_[0]) {
+        heights_[0] = value;
+        k = 0;
+    }
+    else if (value >= heights_[4]) {
+        heights_[4] = value;
+        k = 3;
+    }
+    else {
+        k = 0;
+        while (k < 3 && value >= heights_[k + 1]) {
+            k++;
+        }
+    }
+    for (int i = k + 1; i < 5; i++) {
+        positions_[i] += 1.0;
+    }
+    for (int i = 0; i < 5; i++) {
+        desired_[i] += increments_[i];
+    }
+    for (int i = 1; i < 4; i++) {
+        const double d = desired_[i] - positions_[i];
+        if ((d >= 1.0 && positions_[i + 1] - positions_[i] > 1.0) ||
+            (d <= -1.0 && positions_[i - 1] - positions_[i] < -1.0)) {
+            const int step = d > 0.0 ? 1 : -1;
+            const double height = parabolic(i, step);
+            if (heights_[i - 1] < height && height < heights_[i + 1]) {
+                heights_[i] = height;
+            }
+            else {
+                heights_[i] = linear(i, step);
+            }
+            positions_[i] += step;
+        }
+    }
+}
+
+double P2Quantile::value() const {
+    if (count_ == 0) {
+        return 0.0;
+    }
+    if (count_ <= 5) {
+        // The sample at floor(p * n) in sorted order, the upper median for p = 0.5
+        double sorted[5];
+        std::copy(heights_, heights_ + count_, sorted);
+        std::sort(sorted, sorted + count_);
+        const size_t index = std::min(static_cast<size_t>(p_ * count_), count_ - 1);
+        return sorted[index];
+    }
+    return heights_[2];
+}
+
+double P2Quantile::parabolic(int i, double d) const {
+    const double n0 = positions_[i - 1];
+    const double n1 = positions_[i];
+    const double n2 = positions_[i + 1];
+    return heights_[i] + d / (n2 - n0) *
+                             ((n1 - n0 + d) * (heights_[i + 1] - heights_[i]) / (n2 - n1) +
+                              (n2 - n1 - d) * (heights_[i] - heights_[i - 1]) / (n1 - n0));
+}
+
+double P2Quantile::linear(int i, int d) const {
+    return heights_[i] + d * (heights_[i + d] - heights_[i]) / (positions_[i + d] - positions_[i]);
+}
+
+QuantileSketch::QuantileSketch()
+    : p50_(0.5)
+    , p90_(0.9)
+    , p99_(0.99) {}
+
+void QuantileSketch::add(double value) {
+    if (count_ == 0) {
+        min_ = value;
+        max_ = value;
+    }
+    else {
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+    count_++;
+    sum_ += value;
+    p50_.add(value);
+    p90_.add(value);
+    p99_.add(value);
+}
+
+} // namespace amf
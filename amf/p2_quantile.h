@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace amf {
+
+// Streaming estimate of one quantile with the P-square algorithm of Jain and Chlamtac.
+// Five markers follow the minimum, the quantile, the maximum and the two points half way, their
+// heights are adjusted with a piecewise parabolic prediction as samples arrive. Memory and time per
+// sample are constant. Up to five samples the result is exact.
+class P2Quantile {
+public:
+    // 0 < p < 1
+    explicit P2Quantile(double p);
+
+    void add(double value);
+
+    size_t count() const { return count_; }
+    // 0 without samples
+    double value() const;
+
+private:
+    double parabolic(int i, double d) const;
+    double linear(int i, int d) const;
+
+private:
+    double p_ = 0.5;
+    size_t count_ = 0;
+    // Marker heights, positions and desired positions
+    double heights_[5] = {0};
+    double positions_[5] = {0};
+    double desired_[5] = {0};
+    double increments_[5] = {0};
+};
+
+// p50, p90 and p99 of a stream, with its count, mean, min and max, in constant memory
+class QuantileSketch {
+public:
+    QuantileSketch();
+
+    void add(double value);
+
+    size_t count() const { return count_; }
+    double mean() const { return count_ > 0 ? sum_ / count_ : 0.0; }
+    double min() const { return count_ > 0 ? min_ : 0.0; }
+    double max() const { return count_ > 0 ? max_ : 0.0; }
+    double p50() const { return p50_.value(); }
+    double p90() const { return p90_.value(); }
+    double p99() const { return p99_.value(); }
+
+private:
+    size_t count_ = 0;
+    double sum_ = 0.0;
+    double min_ = 0.0;
+    double max_ = 0.0;
+    P2Quantile p50_;
+    P2Quantile p90_;
+    P2Quantile p99_;
+};
+
+} // namespace amf
@@ -0,0 +1,160 @@
+#include "plane_copy.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "cpu_features.h"
+#include "thread_pool.h"
+
+#if defined(AMF_ARCH_X86)
+#include <immintrin.h>
+#endif
+
+namespace amf {
+
+// Below this a plane stays in cache anyway and streaming stores only cost the fence
+static constexpr size_t kStreamingThreshold = 1024 * 1024;
+// 3840 x 2160 luma, one thread saturates the bus for anything smaller
+static constexpr size_t kParallelThreshold = 3840 * 2160;
+static constexpr uint32_t kMinRowsPerBand = 64;
+
+#if defined(AMF_ARCH_X86)
+static void copyRowStreaming(uint8_t* dst, const uint8_t* src, size_t size) {
+    // movntdq needs an aligned destination, the source can stay unaligned
+    size_t head = (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15;
+    head = std::min(head, size);
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+    for (; size >= 64; size -= 64, src += 64, dst += 64) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + 0);
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + 1);
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + 2);
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + 3);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst) + 0, a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst) + 1, b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst) + 2, c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst) + 3, d);
+    }
+    for (; size >= 16; size -= 16, src += 16, dst += 16) {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst),
+                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+    }
+    memcpy(dst, src, size);
+}
+
+static void streamingFence() {
+    _mm_sfence();
+}
+#else
+static void copyRowStreaming(uint8_t* dst, const uint8_t* src, size_t size) {
+    memcpy(dst, src, size);
+}
+
+static void streamingFence() {}
+#endif
+
+static void copyRows(const uint8_t* src, uint32_t src_pitch, uint8_t* dst, uint32_t dst_pitch,
+                     uint32_t width_bytes, uint32_t rows, bool streaming) {
+    if (src_pitch == width_bytes && dst_pitch == width_bytes && !streaming) {
+        memcpy(dst, src, static_cast<size_t>(width_bytes) * rows);
+        return;
+    }
+    for (uint32_t i = 0; i < rows; i++) {
+        const uint8_t* s = src + static_cast<size_t>(i) * src_pitch;
+        uint8_t* d = dst + static_cast<size_t>(i) * dst_pitch;
+        if (streaming) {
+            copyRowStreaming(d, s, width_bytes);
+        }
+        else {
+            memcpy(d, s, width_bytes);
+        }
+    }
+    if (streaming) {
+        streamingFence();
+    }
+}
+
+void copyPlane(const uint8_t* src, uint32_t src_pitch, uint8_t* dst, uint32_t dst_pitch,
+               uint32_t width_bytes, uint32_t rows, CopyMode mode) {
+    const size_t bytes = static_cast<size_t>(width_bytes) * rows;
+    const bool streaming = mode == CopyMode::STREAMING ||
+                           (mode == CopyMode::AUTO && bytes >= kStreamingThreshold);
+    if (mode == CopyMode::TEMPORAL || bytes < kParallelThreshold) {
+        copyRows(src, src_pitch, dst, dst_pitch, width_bytes, rows, streaming);
+        return;
+    }
+    parallelForRows(rows, kMinRowsPerBand, [&](uint32_t begin, uint32_t end) {
+        copyRows(src + static_cast<size_t>(begin) * src_pitch, src_pitch,
+                 dst + static_cast<size_t>(begin) * dst_pitch, dst_pitch, width_bytes, end - begin,
+                 streaming);
+    });
+}
+
+void copyNv12(const uint8_t* src_y, uint32_t src_y_pitch, const uint8_t* src_uv,
+              uint32_t src_uv_pitch, uint8_t* dst_y, uint32_t dst_y_pitch, uint8_t* dst_uv,
+              uint32_t dst_uv_pitch, uint32_t width, uint32_t height, CopyMode mode) {
+    // Odd sizes still carry a full chroma sample for the last column|row
+    const uint32_t uv_width = (width + 1) / 2 * 2;
+    const uint32_t uv_rows = (height + 1) / 2;
+    const size_t bytes = static_cast<size_t>(width) * height;
+    const bool streaming = mode == CopyMode::STREAMING ||
+                           (mode == CopyMode::AUTO && bytes >= kStreamingThreshold);
+    if (mode == CopyMode::TEMPORAL || bytes < kParallelThreshold) {
+        copyRows(src_y, src_y_pitch, dst_y, dst_y_pitch, width, height, streaming);
+        copyRows(src_uv, src_uv_pitch, dst_uv, dst_uv_pitch, uv_width, uv_rows, streaming);
+        return;
+    }
+    // Bands are cut on chroma rows so that each one owns its 2 luma rows per chroma row
+    parallelForRows(uv_rows, kMinRowsPerBand / 2, [&](uint32_t begin, uint32_t end) {
+        const uint32_t y_begin = begin * 2;
+        const uint32_t y_end = std::min(end * 2, height);
+        copyRows(src_y + static_cast<size_t>(y_begin) * src_y_pitch, src_y_pitch,
+                 dst_y + static_cast<size_t>(y_begin) * dst_y_pitch, dst_y_pitch, width,
+                 y_end - y_begin, streaming);
+        copyRows(src_uv + static_cast<size_t>(begin) * src_uv_pitch, src_uv_pitch,
+                 dst_uv + static_cast<size_t>(begin) * dst_uv_pitch, dst_uv_pitch, uv_width,
+                 end - begin, streaming);
+    });
+}
+
+void padNv12(uint8_t* y, uint32_t y_pitch, uint8_t* uv, uint32_t uv_pitch, uint32_t width,
+             uint32_t height, uint32_t padded_width, uint32_t padded_height,
+             uint32_t sample_bytes) {
+    if (width == 0 || height == 0) {
+        return;
+    }
+    // Chroma of an odd size already covers the last column|row
+    const uint32_t uv_pairs = (width + 1) / 2;
+    const uint32_t uv_rows = (height + 1) / 2;
+    const uint32_t padded_pairs = std::max((padded_width + 1) / 2, uv_pairs);
+    const uint32_t padded_uv_rows = (padded_height + 1) / 2;
+    const size_t y_sample = sample_bytes;
+    const size_t uv_sample = sample_bytes * 2;
+    if (padded_width > width) {
+        for (uint32_t i = 0; i < height; i++) {
+            uint8_t* row = y + static_cast<size_t>(i) * y_pitch;
+            for (uint32_t x = width; x < padded_width; x++) {
+                memcpy(row + x * y_sample, row + (width - 1) * y_sample, y_sample);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < uv_rows; i++) {
+        uint8_t* row = uv + static_cast<size_t>(i) * uv_pitch;
+        for (uint32_t pair = uv_pairs; pair < padded_pairs; pair++) {
+            memcpy(row + pair * uv_sample, row + (uv_pairs - 1) * uv_sample, uv_sample);
+        }
+    }
+    const uint8_t* last_y = y + static_cast<size_t>(height - 1) * y_pitch;
+    for (uint32_t i = height; i < padded_height; i++) {
+        memcpy(y + static_cast<size_t>(i) * y_pitch, last_y,
+               std::max(width, padded_width) * y_sample);
+    }
+    const uint8_t* last_uv = uv + static_cast<size_t>(uv_rows - 1) * uv_pitch;
+    for (uint32_t i = uv_rows; i < padded_uv_rows; i++) {
+        memcpy(uv + static_cast<size_t>(i) * uv_pitch, last_uv, padded_pairs * uv_sample);
+    }
+}
+
+} // namespace amf
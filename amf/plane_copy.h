@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+namespace amf {
+
+enum class CopyMode : uint8_t {
+    // Streaming stores for big planes, row bands on several threads from 4K on
+    AUTO = 0,
+    // memcpy per row on the calling thread, same as the old copy loops
+    TEMPORAL = 1,
+    // Non-temporal stores, for destinations the cpu will not read again (mapped textures)
+    STREAMING = 2,
+};
+
+// Copy `rows` rows of `width_bytes` bytes between two pitched buffers
+void copyPlane(const uint8_t* src, uint32_t src_pitch, uint8_t* dst, uint32_t dst_pitch,
+               uint32_t width_bytes, uint32_t rows, CopyMode mode = CopyMode::AUTO);
+
+// Copy a NV12 frame, Y and UV planes may have different pitches on both sides
+void copyNv12(const uint8_t* src_y, uint32_t src_y_pitch, const uint8_t* src_uv,
+              uint32_t src_uv_pitch, uint8_t* dst_y, uint32_t dst_y_pitch, uint8_t* dst_uv,
+              uint32_t dst_uv_pitch, uint32_t width, uint32_t height,
+              CopyMode mode = CopyMode::AUTO);
+
+// Fills a NV12 frame of `width` x `height` out to `padded_width` x `padded_height` by repeating
+// its last column and row, so that a surface larger than the picture holds no stale pixels.
+// `sample_bytes` is 2 for P010.
+void padNv12(uint8_t* y, uint32_t y_pitch, uint8_t* uv, uint32_t uv_pitch, uint32_t width,
+             uint32_t height, uint32_t padded_width, uint32_t padded_height,
+             uint32_t sample_bytes = 1);
+
+} // namespace amf
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace amf {
+
+// Timestamped samples in time order, in a ring that only grows while its oldest sample is still
+// within `retention_us`. Once it holds the retention at the sample rate, pushing a sample reuses
+// the slot of the oldest one and never allocates. Times and values are separate arrays, looking up
+// a time range only touches the times.
+template <typename T> class SampleRing {
+public:
+    explicit SampleRing(int64_t retention_us, size_t initial_capacity = 64)
+        : retention_us_(retention_us) {
+        size_t capacity = 1;
+        while (capacity < initial_capacity) {
+            capacity <<= 1;
+        }
+        times_.resize(capacity);
+        values_.resize(capacity);
+    }
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+    size_t capacity() const { return times_.size(); }
+
+    // Times only move forward, a sample that is not newer than the newest one is dropped
+    bool push(int64_t at_time, const T& value) {
+        if (size_ > 0 && at_time <= timeAt(size_ - 1)) {
+            return false;
+        }
+        if (size_ == times_.size()) {
+            if (at_time - timeAt(0) >= retention_us_) {
+                head_ = (head_ + 1) & mask();
+                size_--;
+            }
+            else {
+                grow();
+            }
+        }
+        const size_t slot = (head_ + size_) & mask();
+        times_[slot] = at_time;
+        values_[slot] = value;
+        size_++;
+        return true;
+    }
+
+    // Index of the oldest sample at or after `at_time`, size() when there is none
+    size_t lowerBound(int64_t at_time) const {
+        return search(at_time, [](int64_t time, int64_t bound) { return time < bound; });
+    }
+
+    // Index of the oldest sample after `at_time`, size() when there is none
+    size_t upperBound(int64_t at_time) const {
+        return search(at_time, [](int64_t time, int64_t bound) { return time <= bound; });
+    }
+
+    // 0 is the oldest sample
+    int64_t timeAt(size_t index) const { return times_[(head_ + index) & mask()]; }
+    const T& at(size_t index) const { return values_[(head_ + index) & mask()]; }
+
+private:
+    size_t mask() const { return times_.size() - 1; }
+
+    template <typename Before> size_t search(int64_t at_time, Before before) const {
+        size_t first = 0;
+        size_t count = size_;
+        while (count > 0) {
+            const size_t step = count / 2;
+            if (before(timeAt(first + step), at_time)) {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else {
+                count = step;
+            }
+        }
+        return first;
+    }
+
+    // Doubles the capacity, the samples are moved to the front in time order
+    void grow() {
+        std::vector<int64_t> times(times_.size() * 2);
+        std::vector<T> values(values_.size() * 2);
+        for (size_t i = 0; i < size_; i++) {
+            times[i] = timeAt(i);
+            values[i] = at(i);
+        }
+        times_.swap(times);
+        values_.swap(values);
+        head_ = 0;
+    }
+
+private:
+    int64_t retention_us_ = 0;
+    std::vector<int64_t> times_;
+    std::vector<T> values_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+};
+
+} // namespace amf
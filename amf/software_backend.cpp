@@ -0,0 +1,818 @@
+#include "software_backend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "amf_helper.h"
+#include "plane_copy.h"
+#include "yuv_convert.h"
+
+#define LOG_DEBUG(...) amf::log(0, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_INFO(...) amf::log(1, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_WARN(...) amf::log(2, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_ERROR(...) amf::log(3, __FILE__, __LINE__, __VA_ARGS__)
+
+namespace amf {
+
+using Clock = std::chrono::steady_clock;
+
+// Reference counting and a property map, shared by every object below
+template <typename Interface> class SoftwareObject : public Interface {
+public:
+    using Interface::GetProperty;
+    using Interface::SetProperty;
+
+    virtual ~SoftwareObject() = default;
+
+    amf_long AMF_STD_CALL Acquire() override { return ++refs_; }
+
+    amf_long AMF_STD_CALL Release() override {
+        amf_long refs = --refs_;
+        if (refs == 0) {
+            delete this;
+        }
+        return refs;
+    }
+
+    AMF_RESULT AMF_STD_CALL SetProperty(const wchar_t* name, AMFVariantStruct value) override {
+        if (!name) {
+            return AMF_INVALID_POINTER;
+        }
+        std::vector<AMFPropertyStorageObserver*> observers;
+        {
+            std::lock_guard<std::mutex> lock(props_mtx_);
+            props_[name] = AMFVariant(value);
+            observers = prop_observers_;
+        }
+        for (auto* observer : observers) {
+            observer->OnPropertyChanged(name);
+        }
+        return AMF_OK;
+    }
+
+    AMF_RESULT AMF_STD_CALL GetProperty(const wchar_t* name,
+                                        AMFVariantStruct* value) const override {
+        if (!name || !value) {
+            return AMF_INVALID_POINTER;
+        }
+        std::lock_guard<std::mutex> lock(props_mtx_);
+        auto it = props_.find(name);
+        if (it == props_.end()) {
+            return AMF_NOT_FOUND;
+        }
+        AMFVariantInit(value);
+        return AMFVariantCopy(value, const_cast<AMFVariant*>(&it->second));
+    }
+
+    amf_bool AMF_STD_CALL HasProperty(const wchar_t* name) const override {
+        std::lock_guard<std::mutex> lock(props_mtx_);
+        return name && props_.count(name) > 0;
+    }
+
+    amf_size AMF_STD_CALL GetPropertyCount() const override {
+        std::lock_guard<std::mutex> lock(props_mtx_);
+        return props_.size();
+    }
+
+    AMF_RESULT AMF_STD_CALL GetPropertyAt(amf_size index, wchar_t* name, amf_size name_size,
+                                          AMFVariantStruct* value) const override {
+        if (!name || !value || name_size == 0) {
+            return AMF_INVALID_POINTER;
+        }
+        std::lock_guard<std::mutex> lock(props_mtx_);
+        if (index >= props_.size()) {
+            return AMF_INVALID_ARG;
+        }
+        auto it = std::next(props_.begin(), index);
+        const size_t length = std::min<size_t>(it->first.size(), name_size - 1);
+        std::copy_n(it->first.c_str(), length, name);
+        name[length] = 0;
+        AMFVariantInit(value);
+        return AMFVariantCopy(value, const_cast<AMFVariant*>(&it->second));
+    }
+
+    AMF_RESULT AMF_STD_CALL Clear() override {
+        std::lock_guard<std::mutex> lock(props_mtx_);
+        props_.clear();
+        return AMF_OK;
+    }
+
+    AMF_RESULT AMF_STD_CALL AddTo(AMFPropertyStorage* dest, amf_bool overwrite,
+                                  amf_bool /*deep*/) const override {
+        if (!dest) {
+            return AMF_INVALID_POINTER;
+        }
+        std::map<std::wstring, AMFVariant> props;
+        {
+            std::lock_guard<std::mutex> lock(props_mtx_);
+            props = props_;
+        }
+        for (auto& prop : props) {
+            if (!overwrite && dest->HasProperty(prop.first.c_str())) {
+                continue;
+            }
+            auto res = dest->SetProperty(prop.first.c_str(), prop.second);
+            if (res != AMF_OK) {
+                return res;
+            }
+        }
+        return AMF_OK;
+    }
+
+    AMF_RESULT AMF_STD_CALL CopyTo(AMFPropertyStorage* dest, amf_bool deep) const override {
+        if (!dest) {
+            return AMF_INVALID_POINTER;
+        }
+        dest->Clear();
+        return AddTo(dest, true, deep);
+    }
+
+    void AMF_STD_CALL AddObserver(AMFPropertyStorageObserver* observer) override {
+        std::lock_guard<std::mutex> lock(props_mtx_);
+        prop_observers_.push_back(observer);
+    }
+
+    void AMF_STD_CALL RemoveObserver(AMFPropertyStorageObserver* observer) override {
+        std::lock_guard<std::mutex> lock(props_mtx_);
+        prop_observers_.erase(
+            std::remove(prop_observers_.begin(), prop_observers_.end(), observer),
+            prop_observers_.end());
+    }
+
+    template <typename T> T property(const wchar_t* name, T fallback) const {
+        T value = fallback;
+        if (!name || this->GetProperty(name, &value) != AMF_OK) {
+            return fallback;
+        }
+        return value;
+    }
+
+protected:
+    // AMFInterface and AMFPropertyStorage are answered for every object
+    AMF_RESULT queryInterface(const AMFGuid& id, void** out,
+                              std::initializer_list<AMFGuid> extra) {
+        if (!out) {
+            return AMF_INVALID_POINTER;
+        }
+        bool found = id == AMFInterface::IID() || id == AMFPropertyStorage::IID();
+        for (auto& guid : extra) {
+            found = found || id == guid;
+        }
+        if (!found) {
+            *out = nullptr;
+            return AMF_NO_INTERFACE;
+        }
+        *out = static_cast<Interface*>(this);
+        this->Acquire();
+        return AMF_OK;
+    }
+
+private:
+    std::atomic<amf_long> refs_{0};
+    mutable std::mutex props_mtx_;
+    std::map<std::wstring, AMFVariant> props_;
+    std::vector<AMFPropertyStorageObserver*> prop_observers_;
+};
+
+// Plane of a SoftwareSurface, lives and dies with its surface
+class SoftwarePlane : public AMFPlane {
+public:
+    SoftwarePlane(AMFSurface* surface, AMF_PLANE_TYPE type, uint8_t* data, int32_t pixel_size,
+                  int32_t width, int32_t height, int32_t pitch)
+        : surface_(surface)
+        , type_(type)
+        , data_(data)
+        , pixel_size_(pixel_size)
+        , width_(width)
+        , height_(height)
+        , pitch_(pitch) {}
+
+    amf_long AMF_STD_CALL Acquire() override { return surface_->Acquire(); }
+    amf_long AMF_STD_CALL Release() override { return surface_->Release(); }
+    AMF_RESULT AMF_STD_CALL QueryInterface(const AMFGuid& id, void** out) override {
+        if (!out) {
+            return AMF_INVALID_POINTER;
+        }
+        if (id != AMFInterface::IID() && id != AMFPlane::IID()) {
+            *out = nullptr;
+            return AMF_NO_INTERFACE;
+        }
+        *out = static_cast<AMFPlane*>(this);
+        Acquire();
+        return AMF_OK;
+    }
+
+    AMF_PLANE_TYPE AMF_STD_CALL GetType() override { return type_; }
+    void* AMF_STD_CALL GetNative() override {
+        return data_ + static_cast<size_t>(offset_y_) * pitch_ + offset_x_ * pixel_size_;
+    }
+    amf_int32 AMF_STD_CALL GetPixelSizeInBytes() override { return pixel_size_; }
+    amf_int32 AMF_STD_CALL GetOffsetX() override { return offset_x_; }
+    amf_int32 AMF_STD_CALL GetOffsetY() override { return offset_y_; }
+    amf_int32 AMF_STD_CALL GetWidth() override { return width_; }
+    amf_int32 AMF_STD_CALL GetHeight() override { return height_; }
+    amf_int32 AMF_STD_CALL GetHPitch() override { return pitch_; }
+    amf_int32 AMF_STD_CALL GetVPitch() override { return height_; }
+    bool AMF_STD_CALL IsTiled() override { return false; }
+
+    void crop(int32_t x, int32_t y, int32_t width, int32_t height) {
+        offset_x_ = x;
+        offset_y_ = y;
+        width_ = width;
+        height_ = height;
+    }
+
+private:
+    AMFSurface* surface_;
+    AMF_PLANE_TYPE type_;
+    uint8_t* data_;
+    int32_t pixel_size_;
+    int32_t width_;
+    int32_t height_;
+    int32_t pitch_;
+    int32_t offset_x_ = 0;
+    int32_t offset_y_ = 0;
+};
+
+struct SoftwareBackend::SurfacePool {
+    std::mutex mtx;
+    std::vector<std::vector<uint8_t>> free_buffers;
+    uint32_t in_use = 0;
+    uint32_t max_surfaces = 0;
+};
+
+// NV12 in host memory, returns its buffer to the pool once the last reference is gone
+class SoftwareSurface : public SoftwareObject<AMFSurface> {
+public:
+    SoftwareSurface(std::shared_ptr<SoftwareBackend::SurfacePool> pool, std::vector<uint8_t> buffer,
+                    int32_t width, int32_t height, int32_t pitch)
+        : pool_(std::move(pool))
+        , buffer_(std::move(buffer))
+        , y_(this, AMF_PLANE_Y, buffer_.data(), 1, width, height, pitch)
+        , uv_(this, AMF_PLANE_UV, buffer_.data() + static_cast<size_t>(pitch) * height, 2,
+              (width + 1) / 2, (height + 1) / 2, pitch) {}
+
+    ~SoftwareSurface() override {
+        for (auto* observer : observers_) {
+            observer->OnSurfaceDataRelease(this);
+        }
+        std::lock_guard<std::mutex> lock(pool_->mtx);
+        pool_->free_buffers.push_back(std::move(buffer_));
+        pool_->in_use--;
+    }
+
+    AMF_RESULT AMF_STD_CALL QueryInterface(const AMFGuid& id, void** out) override {
+        return queryInterface(id, out, {AMFData::IID(), AMFSurface::IID()});
+    }
+
+    // AMFData
+    AMF_MEMORY_TYPE AMF_STD_CALL GetMemoryType() override { return AMF_MEMORY_HOST; }
+    AMF_RESULT AMF_STD_CALL Duplicate(AMF_MEMORY_TYPE, AMFData**) override {
+        return AMF_NOT_SUPPORTED;
+    }
+    AMF_RESULT AMF_STD_CALL Convert(AMF_MEMORY_TYPE type) override {
+        return type == AMF_MEMORY_HOST ? AMF_OK : AMF_NOT_SUPPORTED;
+    }
+    AMF_RESULT AMF_STD_CALL Interop(AMF_MEMORY_TYPE type) override { return Convert(type); }
+    AMF_DATA_TYPE AMF_STD_CALL GetDataType() override { return AMF_DATA_SURFACE; }
+    amf_bool AMF_STD_CALL IsReusable() override { return true; }
+    void AMF_STD_CALL SetPts(amf_pts pts) override { pts_ = pts; }
+    amf_pts AMF_STD_CALL GetPts() override { return pts_; }
+    void AMF_STD_CALL SetDuration(amf_pts duration) override { duration_ = duration; }
+    amf_pts AMF_STD_CALL GetDuration() override { return duration_; }
+
+    // AMFSurface
+    AMF_SURFACE_FORMAT AMF_STD_CALL GetFormat() override { return AMF_SURFACE_NV12; }
+    amf_size AMF_STD_CALL GetPlanesCount() override { return 2; }
+    AMFPlane* AMF_STD_CALL GetPlaneAt(amf_size index) override {
+        return index == 0 ? &y_ : index == 1 ? &uv_ : nullptr;
+    }
+    AMFPlane* AMF_STD_CALL GetPlane(AMF_PLANE_TYPE type) override {
+        return type == AMF_PLANE_Y ? &y_ : type == AMF_PLANE_UV ? &uv_ : nullptr;
+    }
+    AMF_FRAME_TYPE AMF_STD_CALL GetFrameType() override { return frame_type_; }
+    void AMF_STD_CALL SetFrameType(AMF_FRAME_TYPE type) override { frame_type_ = type; }
+    AMF_RESULT AMF_STD_CALL SetCrop(amf_int32 x, amf_int32 y, amf_int32 width,
+                                    amf_int32 height) override {
+        // NV12 chroma is subsampled, the crop has to stay on even pixels
+        if (x < 0 || y < 0 || width <= 0 || height <= 0 || (x | y) & 1) {
+            return AMF_INVALID_ARG;
+        }
+        y_.crop(x, y, width, height);
+        uv_.crop(x / 2, y / 2, (width + 1) / 2, (height + 1) / 2);
+        return AMF_OK;
+    }
+    AMF_RESULT AMF_STD_CALL CopySurfaceRegion(AMFSurface*, amf_int32, amf_int32, amf_int32,
+                                              amf_int32, amf_int32, amf_int32) override {
+        return AMF_NOT_SUPPORTED;
+    }
+
+    using SoftwareObject<AMFSurface>::AddObserver;
+    using SoftwareObject<AMFSurface>::RemoveObserver;
+    void AMF_STD_CALL AddObserver(AMFSurfaceObserver* observer) override {
+        observers_.push_back(observer);
+    }
+    void AMF_STD_CALL RemoveObserver(AMFSurfaceObserver* observer) override {
+        observers_.erase(std::remove(observers_.begin(), observers_.end(), observer),
+                         observers_.end());
+    }
+
+private:
+    std::shared_ptr<SoftwareBackend::SurfacePool> pool_;
+    std::vector<uint8_t> buffer_;
+    SoftwarePlane y_;
+    SoftwarePlane uv_;
+    amf_pts pts_ = 0;
+    amf_pts duration_ = 0;
+    AMF_FRAME_TYPE frame_type_ = AMF_FRAME_PROGRESSIVE;
+    std::vector<AMFSurfaceObserver*> observers_;
+};
+
+class SoftwareBuffer : public SoftwareObject<AMFBuffer> {
+public:
+    explicit SoftwareBuffer(size_t size)
+        : data_(size) {}
+
+    ~SoftwareBuffer() override {
+        for (auto* observer : observers_) {
+            observer->OnBufferDataRelease(this);
+        }
+    }
+
+    AMF_RESULT AMF_STD_CALL QueryInterface(const AMFGuid& id, void** out) override {
+        return queryInterface(id, out, {AMFData::IID(), AMFBuffer::IID()});
+    }
+
+    // AMFData
+    AMF_MEMORY_TYPE AMF_STD_CALL GetMemoryType() override { return AMF_MEMORY_HOST; }
+    AMF_RESULT AMF_STD_CALL Duplicate(AMF_MEMORY_TYPE, AMFData**) override {
+        return AMF_NOT_SUPPORTED;
+    }
+    AMF_RESULT AMF_STD_CALL Convert(AMF_MEMORY_TYPE type) override {
+        return type == AMF_MEMORY_HOST ? AMF_OK : AMF_NOT_SUPPORTED;
+    }
+    AMF_RESULT AMF_STD_CALL Interop(AMF_MEMORY_TYPE type) override { return Convert(type); }
+    AMF_DATA_TYPE AMF_STD_CALL GetDataType() override { return AMF_DATA_BUFFER; }
+    amf_bool AMF_STD_CALL IsReusable() override { return true; }
+    void AMF_STD_CALL SetPts(amf_pts pts) override { pts_ = pts; }
+    amf_pts AMF_STD_CALL GetPts() override { return pts_; }
+    void AMF_STD_CALL SetDuration(amf_pts duration) override { duration_ = duration; }
+    amf_pts AMF_STD_CALL GetDuration() override { return duration_; }
+
+    // AMFBuffer
+    AMF_RESULT AMF_STD_CALL SetSize(amf_size size) override {
+        data_.resize(size);
+        return AMF_OK;
+    }
+    amf_size AMF_STD_CALL GetSize() override { return data_.size(); }
+    void* AMF_STD_CALL GetNative() override { return data_.data(); }
+
+    using SoftwareObject<AMFBuffer>::AddObserver;
+    using SoftwareObject<AMFBuffer>::RemoveObserver;
+    void AMF_STD_CALL AddObserver(AMFBufferObserver* observer) override {
+        observers_.push_back(observer);
+    }
+    void AMF_STD_CALL RemoveObserver(AMFBufferObserver* observer) override {
+        observers_.erase(std::remove(observers_.begin(), observers_.end(), observer),
+                         observers_.end());
+    }
+
+private:
+    std::vector<uint8_t> data_;
+    amf_pts pts_ = 0;
+    amf_pts duration_ = 0;
+    std::vector<AMFBufferObserver*> observers_;
+};
+
+// Property names the software encoder reads, per codec
+struct SoftwareCodec {
+    amf_codec_type type;
+    const wchar_t* target_bitrate;
+    const wchar_t* framerate;
+    const wchar_t* min_qp;
+    const wchar_t* max_qp;
+    const wchar_t* key_min_qp;
+    const wchar_t* key_max_qp;
+    const wchar_t* vbv_buffer_size;
+    const wchar_t* idr_period;
+    const wchar_t* query_timeout;
+    const wchar_t* force_picture_type;
+    int64_t picture_type_idr;
+    const wchar_t* statistics_feedback;
+    const wchar_t* average_qp;
+    int64_t output_idr;
+    int64_t output_p;
+};
+
+static const SoftwareCodec kSoftwareAvc = {
+    amf_codec_type::AVC,
+    AMF_VIDEO_ENCODER_TARGET_BITRATE,
+    AMF_VIDEO_ENCODER_FRAMERATE,
+    AMF_VIDEO_ENCODER_MIN_QP,
+    AMF_VIDEO_ENCODER_MAX_QP,
+    AMF_VIDEO_ENCODER_MIN_QP,
+    AMF_VIDEO_ENCODER_MAX_QP,
+    AMF_VIDEO_ENCODER_VBV_BUFFER_SIZE,
+    AMF_VIDEO_ENCODER_IDR_PERIOD,
+    AMF_VIDEO_ENCODER_QUERY_TIMEOUT,
+    AMF_VIDEO_ENCODER_FORCE_PICTURE_TYPE,
+    AMF_VIDEO_ENCODER_PICTURE_TYPE_IDR,
+    AMF_VIDEO_ENCODER_STATISTICS_FEEDBACK,
+    AMF_VIDEO_ENCODER_STATISTIC_AVERAGE_QP,
+    AMF_VIDEO_ENCODER_OUTPUT_DATA_TYPE_IDR,
+    AMF_VIDEO_ENCODER_OUTPUT_DATA_TYPE_P,
+};
+
+static const SoftwareCodec kSoftwareHevc = {
+    amf_codec_type::HEVC,
+    AMF_VIDEO_ENCODER_HEVC_TARGET_BITRATE,
+    AMF_VIDEO_ENCODER_HEVC_FRAMERATE,
+    AMF_VIDEO_ENCODER_HEVC_MIN_QP_P,
+    AMF_VIDEO_ENCODER_HEVC_MAX_QP_P,
+    AMF_VIDEO_ENCODER_HEVC_MIN_QP_I,
+    AMF_VIDEO_ENCODER_HEVC_MAX_QP_I,
+    AMF_VIDEO_ENCODER_HEVC_VBV_BUFFER_SIZE,
+    AMF_VIDEO_ENCODER_HEVC_GOP_SIZE,
+    AMF_VIDEO_ENCODER_HEVC_QUERY_TIMEOUT,
+    AMF_VIDEO_ENCODER_HEVC_FORCE_PICTURE_TYPE,
+    AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_IDR,
+    AMF_VIDEO_ENCODER_HEVC_STATISTICS_FEEDBACK,
+    AMF_VIDEO_ENCODER_HEVC_STATISTIC_AVERAGE_QP,
+    AMF_VIDEO_ENCODER_HEVC_OUTPUT_DATA_TYPE_IDR,
+    AMF_VIDEO_ENCODER_HEVC_OUTPUT_DATA_TYPE_P,
+};
+
+// Queue of `queue_depth` frames encoded one at a time, each `latency_us` long.
+// Sizes, frame types and QP are decided at submit time from the current properties, by the
+// EncoderModel when the options ask for it.
+class SoftwareEncoder : public SoftwareObject<AMFComponent> {
+    struct Job {
+        Clock::time_point ready;
+        amf_pts pts = 0;
+        bool key = false;
+        bool feedback = false;
+        size_t size = 0;
+        uint32_t qp = 0;
+    };
+
+public:
+    SoftwareEncoder(const SoftwareCodec& codec, const SoftwareBackend::Options& options,
+                    std::shared_ptr<SoftwareBackend::Stats> stats)
+        : codec_(codec)
+        , options_(options)
+        , stats_(std::move(stats))
+        , model_(options.model, options.seed) {}
+
+    AMF_RESULT AMF_STD_CALL QueryInterface(const AMFGuid& id, void** out) override {
+        return queryInterface(id, out, {AMFPropertyStorageEx::IID(), AMFComponent::IID()});
+    }
+
+    // AMFPropertyStorageEx, there is no property description
+    amf_size AMF_STD_CALL GetPropertiesInfoCount() const override { return 0; }
+    AMF_RESULT AMF_STD_CALL GetPropertyInfo(amf_size, const AMFPropertyInfo**) const override {
+        return AMF_NOT_SUPPORTED;
+    }
+    AMF_RESULT AMF_STD_CALL GetPropertyInfo(const wchar_t*,
+                                            const AMFPropertyInfo**) const override {
+        return AMF_NOT_SUPPORTED;
+    }
+    AMF_RESULT AMF_STD_CALL ValidateProperty(const wchar_t*, AMFVariantStruct,
+                                             AMFVariantStruct*) const override {
+        return AMF_NOT_SUPPORTED;
+    }
+
+    // AMFComponent
+    AMF_RESULT AMF_STD_CALL Init(AMF_SURFACE_FORMAT format, amf_int32 width,
+                                 amf_int32 height) override {
+        if (format != AMF_SURFACE_NV12) {
+            return AMF_INVALID_FORMAT;
+        }
+        if (width <= 0 || height <= 0) {
+            return AMF_INVALID_ARG;
+        }
+        std::lock_guard<std::mutex> lock(mtx_);
+        width_ = width;
+        height_ = height;
+        initialized_ = true;
+        draining_ = false;
+        frames_since_key_ = -1;
+        model_.reset();
+        return AMF_OK;
+    }
+
+    AMF_RESULT AMF_STD_CALL ReInit(amf_int32 width, amf_int32 height) override {
+        if (!options_.reinit) {
+            return AMF_NOT_SUPPORTED;
+        }
+        if (width <= 0 || height <= 0) {
+            return AMF_INVALID_ARG;
+        }
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!initialized_) {
+            return AMF_NOT_INITIALIZED;
+        }
+        width_ = width;
+        height_ = height;
+        jobs_.clear();
+        draining_ = false;
+        frames_since_key_ = -1;
+        model_.reset();
+        return AMF_OK;
+    }
+
+    AMF_RESULT AMF_STD_CALL Terminate() override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        initialized_ = false;
+        jobs_.clear();
+        cv_.notify_all();
+        return AMF_OK;
+    }
+
+    AMF_RESULT AMF_STD_CALL Drain() override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        draining_ = true;
+        cv_.notify_all();
+        return AMF_OK;
+    }
+
+    AMF_RESULT AMF_STD_CALL Flush() override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        jobs_.clear();
+        draining_ = false;
+        return AMF_OK;
+    }
+
+    AMF_RESULT AMF_STD_CALL SubmitInput(AMFData* data) override {
+        if (!data) {
+            return AMF_INVALID_POINTER;
+        }
+        Job job;
+        job.pts = data->GetPts();
+        int64_t picture_type = 0;
+        job.key = data->GetProperty(codec_.force_picture_type, &picture_type) == AMF_OK &&
+                  picture_type == codec_.picture_type_idr;
+        bool feedback = false;
+        job.feedback =
+            data->GetProperty(codec_.statistics_feedback, &feedback) == AMF_OK && feedback;
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!initialized_) {
+            return AMF_NOT_INITIALIZED;
+        }
+        if (draining_) {
+            return AMF_EOF;
+        }
+        if (jobs_.size() >= options_.queue_depth) {
+            stats_->input_full++;
+            return AMF_INPUT_FULL;
+        }
+        const int64_t idr_period = property<int64_t>(codec_.idr_period, 0);
+        frames_since_key_++;
+        if (frames_since_key_ == 0 || (idr_period > 0 && frames_since_key_ >= idr_period)) {
+            job.key = true;
+        }
+        if (job.key) {
+            frames_since_key_ = 0;
+        }
+        if (options_.rate_model) {
+            modelFrame(data, &job);
+        }
+        else {
+            job.size = packetSize(job.key);
+            job.qp =
+                (property<int64_t>(codec_.min_qp, 18) + property<int64_t>(codec_.max_qp, 51)) / 2;
+        }
+        const auto now = Clock::now();
+        busy_until_ = std::max(now, busy_until_) + std::chrono::microseconds(options_.latency_us);
+        job.ready = busy_until_;
+        jobs_.push_back(job);
+        stats_->submitted++;
+        cv_.notify_all();
+        return AMF_OK;
+    }
+
+    AMF_RESULT AMF_STD_CALL QueryOutput(AMFData** out) override {
+        if (!out) {
+            return AMF_INVALID_POINTER;
+        }
+        *out = nullptr;
+        const auto timeout = std::chrono::milliseconds(property<int64_t>(codec_.query_timeout, 0));
+        const auto deadline = Clock::now() + timeout;
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            while (true) {
+                if (!initialized_) {
+                    return AMF_NOT_INITIALIZED;
+                }
+                const auto now = Clock::now();
+                if (!jobs_.empty() && jobs_.front().ready <= now) {
+                    break;
+                }
+                if (jobs_.empty() && draining_) {
+                    return AMF_EOF;
+                }
+                if (now >= deadline) {
+                    return AMF_REPEAT;
+                }
+                cv_.wait_until(lock, jobs_.empty() ? deadline
+                                                   : std::min(deadline, jobs_.front().ready));
+            }
+            job = jobs_.front();
+            jobs_.pop_front();
+        }
+        stats_->encoded++;
+        *out = makePacket(job);
+        (*out)->Acquire();
+        return AMF_OK;
+    }
+
+    AMFContext* AMF_STD_CALL GetContext() override { return nullptr; }
+    AMF_RESULT AMF_STD_CALL SetOutputDataAllocatorCB(AMFDataAllocatorCB*) override {
+        return AMF_NOT_SUPPORTED;
+    }
+    AMF_RESULT AMF_STD_CALL GetCaps(AMFCaps**) override { return AMF_NOT_SUPPORTED; }
+    AMF_RESULT AMF_STD_CALL Optimize(AMFComponentOptimizationCallback*) override {
+        return AMF_NOT_SUPPORTED;
+    }
+
+private:
+    size_t packetSize(bool key) const {
+        size_t size = options_.packet_size;
+        if (size == 0) {
+            const int64_t bitrate = property<int64_t>(codec_.target_bitrate, 0);
+            const AMFRate rate = property<AMFRate>(codec_.framerate, AMFConstructRate(30, 1));
+            const double fps = rate.den > 0 && rate.num > 0 ? rate.num * 1.0 / rate.den : 30.0;
+            size = static_cast<size_t>(bitrate / 8 / fps);
+        }
+        if (key) {
+            size = static_cast<size_t>(size * options_.key_frame_scale);
+        }
+        // Start code and NAL header at least
+        return std::max<size_t>(size, 8);
+    }
+
+    // With mtx_ held
+    void modelFrame(AMFData* data, Job* job) {
+        AMFSurfacePtr surface(data);
+        AMFPlane* plane = surface ? surface->GetPlane(AMF_PLANE_Y) : nullptr;
+        if (plane) {
+            model_.analyze(static_cast<const uint8_t*>(plane->GetNative()), plane->GetHPitch(),
+                           plane->GetWidth(), plane->GetHeight());
+        }
+        EncoderModel::Settings settings;
+        settings.bitrate = property<int64_t>(codec_.target_bitrate, 0);
+        const AMFRate rate = property<AMFRate>(codec_.framerate, AMFConstructRate(30, 1));
+        settings.fps = rate.den > 0 && rate.num > 0 ? rate.num * 1.0 / rate.den : 30.0;
+        settings.vbv_size = property<int64_t>(codec_.vbv_buffer_size, 0);
+        settings.min_qp = property<int64_t>(job->key ? codec_.key_min_qp : codec_.min_qp, 0);
+        settings.max_qp = property<int64_t>(job->key ? codec_.key_max_qp : codec_.max_qp, 51);
+        auto frame = model_.encode(job->key, settings);
+        if (frame.overflow) {
+            stats_->vbv_overflows++;
+        }
+        job->size = std::max<size_t>(frame.size, 8);
+        job->qp = frame.qp;
+    }
+
+    SoftwareBuffer* makePacket(const Job& job) const {
+        auto* packet = new SoftwareBuffer(job.size);
+        auto* data = static_cast<uint8_t*>(packet->GetNative());
+        data[2] = 0;
+        data[3] = 1;
+        if (codec_.type == amf_codec_type::AVC) {
+            // nal_ref_idc 3, IDR slice or non-IDR slice
+            data[4] = job.key ? 0x65 : 0x41;
+        }
+        else {
+            // IDR_W_RADL or TRAIL_R, layer 0, tid 1
+            data[4] = job.key ? (19 << 1) : (1 << 1);
+            data[5] = 1;
+        }
+        packet->SetPts(job.pts);
+        packet->SetProperty(get_amf_output_type(codec_.type),
+                            job.key ? codec_.output_idr : codec_.output_p);
+        if (job.feedback) {
+            packet->SetProperty(codec_.average_qp, static_cast<int64_t>(job.qp));
+        }
+        return packet;
+    }
+
+private:
+    const SoftwareCodec& codec_;
+    const SoftwareBackend::Options options_;
+    std::shared_ptr<SoftwareBackend::Stats> stats_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Job> jobs_;
+    Clock::time_point busy_until_;
+    bool initialized_ = false;
+    bool draining_ = false;
+    int32_t width_ = 0;
+    int32_t height_ = 0;
+    int64_t frames_since_key_ = -1;
+    EncoderModel model_;
+};
+
+SoftwareBackend::SoftwareBackend()
+    : SoftwareBackend(Options()) {}
+
+SoftwareBackend::SoftwareBackend(const Options& options)
+    : options_(options)
+    , pool_(std::make_shared<SurfacePool>())
+    , stats_(std::make_shared<Stats>()) {
+    options_.queue_depth = std::max(options_.queue_depth, 1u);
+    pool_->max_surfaces = std::max(options_.max_surfaces, 1u);
+}
+
+SoftwareBackend::~SoftwareBackend() {
+    uninit();
+}
+
+bool SoftwareBackend::init(uint64_t /*luid*/) {
+    LOG_INFO("Software encoder backend, queue depth:%u latency:%u us", options_.queue_depth,
+             options_.latency_us);
+    return true;
+}
+
+void SoftwareBackend::uninit() {
+    std::lock_guard<std::mutex> lock(pool_->mtx);
+    pool_->free_buffers.clear();
+}
+
+AMF_RESULT SoftwareBackend::createEncoder(const wchar_t* codec, AMFComponent** encoder) {
+    if (!codec || !encoder) {
+        return AMF_INVALID_POINTER;
+    }
+    const SoftwareCodec* type = nullptr;
+    if (std::wstring(codec) == AMFVideoEncoderVCE_AVC) {
+        type = &kSoftwareAvc;
+    }
+    else if (std::wstring(codec) == AMFVideoEncoder_HEVC) {
+        type = &kSoftwareHevc;
+    }
+    else {
+        return AMF_CODEC_NOT_SUPPORTED;
+    }
+    *encoder = new SoftwareEncoder(*type, options_, stats_);
+    (*encoder)->Acquire();
+    return AMF_OK;
+}
+
+AMFSurfacePtr SoftwareBackend::upload(const VideoFrameView& frame) {
+    const uint32_t width = frame.width;
+    const uint32_t height = frame.height;
+    // Same row alignment as the gpu textures
+    const uint32_t pitch = (width + 255) & ~255u;
+    const size_t size = static_cast<size_t>(pitch) * (height + (height + 1) / 2);
+    std::vector<uint8_t> buffer;
+    {
+        std::lock_guard<std::mutex> lock(pool_->mtx);
+        if (pool_->in_use >= pool_->max_surfaces) {
+            LOG_WARN("All surfaces in busy, drop frame");
+            return nullptr;
+        }
+        pool_->in_use++;
+        // After a resize the buffers of the old size are reused as long as they are big enough
+        auto& buffers = pool_->free_buffers;
+        auto fit = std::find_if(buffers.rbegin(), buffers.rend(),
+                                [size](const std::vector<uint8_t>& item) {
+                                    return item.capacity() >= size;
+                                });
+        if (fit != buffers.rend()) {
+            buffer = std::move(*fit);
+            buffers.erase(std::next(fit).base());
+        }
+        else if (!buffers.empty()) {
+            // Too small, grown below
+            buffer = std::move(buffers.back());
+            buffers.pop_back();
+        }
+    }
+    if (buffer.capacity() < size) {
+        stats_->surfaces_allocated++;
+    }
+    buffer.resize(size);
+    uint8_t* dst_y = buffer.data();
+    uint8_t* dst_uv = dst_y + static_cast<size_t>(pitch) * height;
+    if (frame.format == VideoFormat::I420) {
+        copyI420ToNv12(frame.data[0], frame.pitch[0], frame.data[1], frame.pitch[1],
+                       frame.data[2], frame.pitch[2], dst_y, pitch, dst_uv, pitch, width, height);
+    }
+    else {
+        copyNv12(frame.data[0], frame.pitch[0], frame.data[1], frame.pitch[1], dst_y, pitch,
+                 dst_uv, pitch, width, height);
+    }
+    return AMFSurfacePtr(static_cast<AMFSurface*>(
+        new SoftwareSurface(pool_, std::move(buffer), width, height, pitch)));
+}
+
+} // namespace amf
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "encoder_backend.h"
+#include "encoder_model.h"
+
+namespace amf {
+
+// Stand-in for the AMF runtime in plain memory, no device or driver required.
+// The surfaces, packets and encoder implement the AMF interfaces from amf/core, so AmfEncoder and
+// its pipelines run unchanged on any machine. Packets carry no real bitstream, only a start code,
+// the NAL header of their frame type and padding up to the size the encoder would produce.
+class SoftwareBackend : public EncoderBackend {
+public:
+    struct Options {
+        // Frames SubmitInput takes before it answers AMF_INPUT_FULL
+        uint32_t queue_depth = 3;
+        // Encode time of one frame, frames are encoded one after the other
+        uint32_t latency_us = 4000;
+        // Bytes of a P frame, 0 follows TARGET_BITRATE / FRAMERATE of the encoder
+        uint32_t packet_size = 0;
+        // Key frames are this much larger than P frames
+        float key_frame_scale = 4.0f;
+        // Sizes and QP come from a CBR rate control over EncoderModel instead, driven by the
+        // bitrate, frame rate, VBV size and QP range set on the encoder
+        bool rate_model = false;
+        EncoderModel::Params model;
+        uint32_t seed = 1;
+        // ReInit answers AMF_NOT_SUPPORTED otherwise, like an encoder that needs a new component
+        bool reinit = true;
+        // upload() returns nullptr while every surface is held by the encoder
+        uint32_t max_surfaces = 8;
+    };
+
+    struct Stats {
+        std::atomic<uint64_t> submitted{0};
+        std::atomic<uint64_t> encoded{0};
+        std::atomic<uint64_t> input_full{0};
+        std::atomic<uint64_t> surfaces_allocated{0};
+        // Frames that did not fit in the VBV buffer, rate model only
+        std::atomic<uint64_t> vbv_overflows{0};
+    };
+
+    SoftwareBackend();
+    explicit SoftwareBackend(const Options& options);
+    ~SoftwareBackend() override;
+
+    const char* name() const override { return "software"; }
+
+    bool init(uint64_t luid) override;
+    void uninit() override;
+    uint64_t luid() const override { return 0; }
+
+    // AVC and HEVC
+    AMF_RESULT createEncoder(const wchar_t* codec, AMFComponent** encoder) override;
+
+    AMFSurfacePtr upload(const VideoFrameView& frame) override;
+
+    const Stats& stats() const { return *stats_; }
+
+    // Buffers of the surfaces, defined in software_backend.cpp
+    struct SurfacePool;
+
+private:
+    Options options_;
+    // Shared with the surfaces and encoders handed out, they may outlive the backend
+    std::shared_ptr<SurfacePool> pool_;
+    std::shared_ptr<Stats> stats_;
+};
+
+} // namespace amf
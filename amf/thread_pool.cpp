@@ -0,0 +1,111 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace amf {
+
+// The pool whose task this thread is running, a nested job of the same pool runs inline
+static thread_local const ThreadPool* running_pool = nullptr;
+
+ThreadPool* ThreadPool::instance() {
+    // Row bands stop scaling long before the core count does on big machines
+    static ThreadPool pool(std::min<uint32_t>(std::max(std::thread::hardware_concurrency(), 1u), 8u) -
+                           1);
+    return &pool;
+}
+
+ThreadPool::ThreadPool(uint32_t workers) {
+    workers_.reserve(workers);
+    for (uint32_t i = 0; i < workers; i++) {
+        workers_.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    job_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::drain(uint32_t generation, TaskFn fn, void* ctx, uint32_t count) {
+    const ThreadPool* outer = running_pool;
+    running_pool = this;
+    uint64_t next = next_.load(std::memory_order_relaxed);
+    while (static_cast<uint32_t>(next >> 32) == generation &&
+           static_cast<uint32_t>(next) < count) {
+        if (!next_.compare_exchange_weak(next, next + 1, std::memory_order_relaxed)) {
+            continue;
+        }
+        fn(ctx, static_cast<uint32_t>(next));
+        if (finished_.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+            std::lock_guard<std::mutex> lock(mtx_);
+            done_cv_.notify_one();
+        }
+        next = next_.load(std::memory_order_relaxed);
+    }
+    running_pool = outer;
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seen = 0;
+    while (true) {
+        TaskFn fn = nullptr;
+        void* ctx = nullptr;
+        uint32_t count = 0;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            job_cv_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+            fn = fn_;
+            ctx = ctx_;
+            count = count_;
+            active_++;
+        }
+        drain(static_cast<uint32_t>(seen), fn, ctx, count);
+        std::lock_guard<std::mutex> lock(mtx_);
+        // run() must not set up the next job while a worker may still read this one
+        if (--active_ == 0) {
+            done_cv_.notify_one();
+        }
+    }
+}
+
+void ThreadPool::run(uint32_t count, TaskFn fn, void* ctx) {
+    if (count == 0) {
+        return;
+    }
+    if (workers_.empty() || count == 1 || running_pool == this) {
+        for (uint32_t i = 0; i < count; i++) {
+            fn(ctx, i);
+        }
+        return;
+    }
+    std::lock_guard<std::mutex> run_lock(run_mtx_);
+    uint32_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        fn_ = fn;
+        ctx_ = ctx;
+        count_ = count;
+        generation_++;
+        generation = static_cast<uint32_t>(generation_);
+        next_.store(static_cast<uint64_t>(generation) << 32, std::memory_order_relaxed);
+        finished_.store(0, std::memory_order_relaxed);
+    }
+    job_cv_.notify_all();
+    drain(generation, fn, ctx, count);
+    std::unique_lock<std::mutex> lock(mtx_);
+    done_cv_.wait(lock, [&]() {
+        return finished_.load(std::memory_order_acquire) == count && active_ == 0;
+    });
+}
+
+} // namespace amf
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace amf {
+
+// Fixed set of workers used to split a frame into row bands.
+// parallelFor() blocks until every index has run, the calling thread takes part in the work.
+// Tasks are passed as (function pointer, context) so that no job ever allocates.
+// A parallelFor() from inside a task runs inline on the thread of that task.
+class ThreadPool {
+public:
+    static ThreadPool* instance();
+
+    explicit ThreadPool(uint32_t workers);
+    ~ThreadPool();
+
+    // Number of threads that can run a job concurrently, including the caller
+    uint32_t concurrency() const { return static_cast<uint32_t>(workers_.size()) + 1; }
+
+    template <typename Fn> void parallelFor(uint32_t count, Fn&& fn) {
+        auto invoke = [](void* ctx, uint32_t index) { (*static_cast<Fn*>(ctx))(index); };
+        run(count, invoke, &fn);
+    }
+
+private:
+    using TaskFn = void (*)(void* ctx, uint32_t index);
+
+    void run(uint32_t count, TaskFn fn, void* ctx);
+    void workerLoop();
+    // Runs the indices of job `generation` that nobody claimed yet
+    void drain(uint32_t generation, TaskFn fn, void* ctx, uint32_t count);
+
+private:
+    std::vector<std::thread> workers_;
+    // Only one job at a time, concurrent callers queue up here
+    std::mutex run_mtx_;
+
+    std::mutex mtx_;
+    std::condition_variable job_cv_;
+    std::condition_variable done_cv_;
+    uint64_t generation_ = 0;
+    uint32_t active_ = 0;
+    bool stop_ = false;
+
+    // Written under mtx_, workers copy them when they pick up a generation
+    TaskFn fn_ = nullptr;
+    void* ctx_ = nullptr;
+    uint32_t count_ = 0;
+    // Generation in the high half, next index in the low half, a worker late for one job can
+    // never claim an index of the next
+    std::atomic<uint64_t> next_{0};
+    std::atomic<uint32_t> finished_{0};
+};
+
+// Splits [0, rows) into bands of at least min_rows rows and runs fn(begin, end) for each.
+// Small jobs run inline on the caller.
+template <typename Fn> void parallelForRows(uint32_t rows, uint32_t min_rows, Fn&& fn) {
+    auto pool = ThreadPool::instance();
+    uint32_t bands = min_rows > 0 ? rows / min_rows : rows;
+    bands = std::min<uint32_t>(bands, pool->concurrency());
+    if (bands <= 1) {
+        fn(0u, rows);
+        return;
+    }
+    pool->parallelFor(bands, [&](uint32_t band) {
+        const uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(rows) * band / bands);
+        const uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(rows) * (band + 1) / bands);
+        fn(begin, end);
+    });
+}
+
+} // namespace amf
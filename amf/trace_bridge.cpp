@@ -0,0 +1,128 @@
+#include "trace_bridge.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cwchar>
+
+#include "amf_helper.h"
+
+namespace amf {
+
+#define LOG_DEBUG(...) amf::log(0, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_INFO(...) amf::log(1, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_WARN(...) amf::log(2, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_ERROR(...) amf::log(3, __FILE__, __LINE__, __VA_ARGS__)
+
+static constexpr const wchar_t* kTraceWriterId = L"AmfTestLog";
+
+static int64_t cur_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Writers get no level, the runtime puts its name in front of the message text
+static int logLevel(const wchar_t* message) {
+    if (std::wcsstr(message, L" Error:")) {
+        return 3;
+    }
+    if (std::wcsstr(message, L" Warning:")) {
+        return 2;
+    }
+    if (std::wcsstr(message, L" Debug:") || std::wcsstr(message, L" Trace:")) {
+        return 0;
+    }
+    return 1;
+}
+
+TraceBridge::TraceBridge()
+    : TraceBridge(Options()) {}
+
+TraceBridge::TraceBridge(const Options& options)
+    : options_(options) {}
+
+void TraceBridge::attach(AMFTrace* trace) {
+    trace_ = trace;
+    trace_->SetGlobalLevel(options_.level);
+    trace_->EnableWriter(AMF_TRACE_WRITER_CONSOLE, false);
+    trace_->EnableWriter(AMF_TRACE_WRITER_DEBUG_OUTPUT, false);
+    trace_->EnableWriter(AMF_TRACE_WRITER_FILE, false);
+    trace_->RegisterWriter(kTraceWriterId, this, true);
+    trace_->SetWriterLevel(kTraceWriterId, options_.level);
+    for (auto& scope_level : options_.scope_levels) {
+        previous_scope_levels_[scope_level.first] =
+            trace_->GetWriterLevelForScope(kTraceWriterId, scope_level.first.c_str());
+        trace_->SetWriterLevelForScope(kTraceWriterId, scope_level.first.c_str(),
+                                       scope_level.second);
+    }
+    LOG_INFO("AMF trace goes to the log at level %d, %zu scopes set", options_.level,
+             options_.scope_levels.size());
+}
+
+void TraceBridge::setClock(Clock clock) {
+    clock_ = std::move(clock);
+}
+
+void TraceBridge::detach() {
+    if (trace_) {
+        for (auto& scope_level : previous_scope_levels_) {
+            trace_->SetWriterLevelForScope(kTraceWriterId, scope_level.first.c_str(),
+                                           scope_level.second);
+        }
+        previous_scope_levels_.clear();
+        trace_->UnregisterWriter(kTraceWriterId);
+        trace_ = nullptr;
+    }
+}
+
+bool TraceBridge::admit(std::wstring_view scope, uint64_t* suppressed) {
+    const int64_t now = clock_ ? clock_() : cur_time();
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto iter = buckets_.find(scope);
+    if (iter == buckets_.end()) {
+        Bucket bucket;
+        bucket.tokens = options_.burst;
+        bucket.last_time = now;
+        iter = buckets_.emplace(std::wstring(scope), bucket).first;
+    }
+    Bucket& bucket = iter->second;
+    const double refill = (now - bucket.last_time) * options_.lines_per_second / 1e6;
+    bucket.tokens = std::min<double>(options_.burst, bucket.tokens + refill);
+    bucket.last_time = now;
+    if (bucket.tokens < 1.0) {
+        bucket.suppressed++;
+        return false;
+    }
+    bucket.tokens -= 1.0;
+    *suppressed = bucket.suppressed;
+    bucket.suppressed = 0;
+    return true;
+}
+
+void AMF_CDECL_CALL TraceBridge::Write(const wchar_t* scope, const wchar_t* message) {
+    if (!message) {
+        return;
+    }
+    scope = scope ? scope : L"";
+    uint64_t suppressed = 0;
+    if (!admit(scope, &suppressed)) {
+        return;
+    }
+    if (suppressed > 0) {
+        LOG_WARN("[%ls] %llu trace lines suppressed", scope,
+                 static_cast<unsigned long long>(suppressed));
+    }
+    // Lines of the runtime carry their scope and end with a line break, the log adds its own
+    size_t length = std::wcslen(message);
+    while (length > 0 && (message[length - 1] == L'\n' || message[length - 1] == L'\r')) {
+        length--;
+    }
+    amf::log(logLevel(message), __FILE__, __LINE__, "%.*ls", static_cast<int>(length),
+             message);
+}
+
+void AMF_CDECL_CALL TraceBridge::Flush() {
+    log_flush();
+}
+
+} // namespace amf
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "core/Trace.h"
+
+namespace amf {
+
+// Routes the trace of the AMF runtime into amf::log instead of its own file and debug output
+// writers, which write synchronously on the thread that traces, often the encode thread.
+// The runtime filters by level before it calls the writer, globally and per scope. Each scope is
+// further limited to `lines_per_second` so that a runtime stuck in a loop does not flood the log.
+class TraceBridge : public AMFTraceWriter {
+public:
+    // Microseconds, steady clock by default
+    using Clock = std::function<int64_t()>;
+
+    struct Options {
+        // AMF_TRACE_* of the writer, warnings and errors in release builds
+#ifdef NDEBUG
+        int32_t level = AMF_TRACE_WARNING;
+#else
+        int32_t level = AMF_TRACE_TRACE;
+#endif
+        // Levels of single scopes, they override `level`. The encoder cores trace every
+        // frame and every property set, they only bring their warnings in debug builds too.
+        std::map<std::wstring, int32_t> scope_levels = {
+            {L"AMFEncoderCoreH264", AMF_TRACE_WARNING},
+            {L"AMFEncoderCoreHevc", AMF_TRACE_WARNING},
+            {L"AMFEncoderCoreAV1", AMF_TRACE_WARNING},
+        };
+        uint32_t lines_per_second = 100;
+        uint32_t burst = 200;
+    };
+
+    TraceBridge();
+    explicit TraceBridge(const Options& options);
+
+    // Replaces the console, debug output and file writers of `trace` with this one
+    void attach(AMFTrace* trace);
+    // Time base of the rate limit, before the first line is written
+    void setClock(Clock clock);
+    // Before the runtime is unloaded, the scope levels are set back
+    void detach();
+
+    void AMF_CDECL_CALL Write(const wchar_t* scope, const wchar_t* message) override;
+    void AMF_CDECL_CALL Flush() override;
+
+private:
+    struct Bucket {
+        double tokens = 0.0;
+        int64_t last_time = 0;
+        uint64_t suppressed = 0;
+    };
+
+    // False when the scope is over its rate, `suppressed` is what was dropped before this line
+    bool admit(std::wstring_view scope, uint64_t* suppressed);
+
+private:
+    const Options options_;
+    Clock clock_;
+    AMFTrace* trace_ = nullptr;
+    // Levels of Options::scope_levels before attach
+    std::map<std::wstring, int32_t> previous_scope_levels_;
+
+    std::mutex mtx_;
+    std::map<std::wstring, Bucket, std::less<>> buckets_;
+};
+
+} // namespace amf
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace amf {
+
+enum class VideoFormat : uint8_t {
+    UNKNOWN = 0,
+    NV12 = 1,
+    I420 = 2,
+};
+
+// Non-owning description of a frame in cpu memory.
+// The planes may come from anywhere (mapped textures, pools, mmapped files), the consumer
+// calls `release(opaque)` exactly once as soon as it no longer reads them.
+struct VideoFrameView {
+    using ReleaseCallback = void (*)(void* opaque);
+
+    VideoFormat format = VideoFormat::UNKNOWN;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // NV12: [0] Y, [1] interleaved UV
+    // I420: [0] Y, [1] U, [2] V
+    const uint8_t* data[3] = {nullptr, nullptr, nullptr};
+    uint32_t pitch[3] = {0, 0, 0};
+
+    ReleaseCallback release = nullptr;
+    void* opaque = nullptr;
+
+    static VideoFrameView nv12(const uint8_t* y, uint32_t y_pitch, const uint8_t* uv,
+                               uint32_t uv_pitch, uint32_t width, uint32_t height) {
+        VideoFrameView view;
+        view.format = VideoFormat::NV12;
+        view.width = width;
+        view.height = height;
+        view.data[0] = y;
+        view.pitch[0] = y_pitch;
+        view.data[1] = uv;
+        view.pitch[1] = uv_pitch;
+        return view;
+    }
+
+    // Tightly packed NV12, UV follows Y
+    static VideoFrameView nv12(const uint8_t* data, uint32_t width, uint32_t height) {
+        return nv12(data, width, data + static_cast<size_t>(width) * height, width, width, height);
+    }
+
+    static VideoFrameView i420(const uint8_t* y, uint32_t y_pitch, const uint8_t* u,
+                               uint32_t u_pitch, const uint8_t* v, uint32_t v_pitch,
+                               uint32_t width, uint32_t height) {
+        VideoFrameView view;
+        view.format = VideoFormat::I420;
+        view.width = width;
+        view.height = height;
+        view.data[0] = y;
+        view.pitch[0] = y_pitch;
+        view.data[1] = u;
+        view.pitch[1] = u_pitch;
+        view.data[2] = v;
+        view.pitch[2] = v_pitch;
+        return view;
+    }
+
+    bool valid() const {
+        if (width == 0 || height == 0) {
+            return false;
+        }
+        switch (format) {
+        case VideoFormat::NV12:
+            return data[0] && data[1] && pitch[0] >= width && pitch[1] >= (width + 1) / 2 * 2;
+        case VideoFormat::I420:
+            return data[0] && data[1] && data[2] && pitch[0] >= width &&
+                   pitch[1] >= (width + 1) / 2 && pitch[2] >= (width + 1) / 2;
+        default:
+            return false;
+        }
+    }
+};
+
+// Calls the release callback of a view once, either explicitly or when leaving the scope
+class ScopedFrameRelease {
+public:
+    explicit ScopedFrameRelease(const VideoFrameView& frame)
+        : release_(frame.release)
+        , opaque_(frame.opaque) {}
+    ~ScopedFrameRelease() { release(); }
+
+    ScopedFrameRelease(const ScopedFrameRelease&) = delete;
+    ScopedFrameRelease& operator=(const ScopedFrameRelease&) = delete;
+
+    void release() {
+        if (release_) {
+            auto release = release_;
+            release_ = nullptr;
+            release(opaque_);
+        }
+    }
+
+private:
+    VideoFrameView::ReleaseCallback release_ = nullptr;
+    void* opaque_ = nullptr;
+};
+
+} // namespace amf
@@ -0,0 +1,218 @@
+#include "yuv_convert.h"
+
+#include "thread_pool.h"
+
+#if defined(AMF_ARCH_X86)
+#include <immintrin.h>
+#elif defined(AMF_ARCH_ARM64)
+#include <arm_neon.h>
+#endif
+
+namespace amf {
+
+// Same as plane_copy.cpp, chroma of anything below 4K is done on the calling thread
+static constexpr size_t kParallelThreshold = 3840 * 2160;
+static constexpr uint32_t kMinRowsPerBand = 32;
+
+using InterleaveFunc = uint32_t (*)(const uint8_t* u, const uint8_t* v, uint8_t* uv,
+                                    uint32_t width);
+using DeinterleaveFunc = uint32_t (*)(const uint8_t* uv, uint8_t* u, uint8_t* v, uint32_t width);
+
+static uint32_t interleave_C(const uint8_t* u, const uint8_t* v, uint8_t* uv, uint32_t width) {
+    for (uint32_t i = 0; i < width; i++) {
+        uv[i * 2] = u[i];
+        uv[i * 2 + 1] = v[i];
+    }
+    return width;
+}
+
+static uint32_t deinterleave_C(const uint8_t* uv, uint8_t* u, uint8_t* v, uint32_t width) {
+    for (uint32_t i = 0; i < width; i++) {
+        u[i] = uv[i * 2];
+        v[i] = uv[i * 2 + 1];
+    }
+    return width;
+}
+
+#if defined(AMF_ARCH_X86)
+AMF_TARGET_SSE41 static uint32_t interleave_SSE41(const uint8_t* u, const uint8_t* v,
+                                                  uint8_t* uv, uint32_t width) {
+    uint32_t i = 0;
+    for (; i + 16 <= width; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + i * 2), _mm_unpacklo_epi8(a, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + i * 2 + 16), _mm_unpackhi_epi8(a, b));
+    }
+    return i;
+}
+
+AMF_TARGET_SSE41 static uint32_t deinterleave_SSE41(const uint8_t* uv, uint8_t* u, uint8_t* v,
+                                                    uint32_t width) {
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    uint32_t i = 0;
+    for (; i + 16 <= width; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + i * 2));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + i * 2 + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(u + i),
+                         _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(v + i),
+                         _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+    return i;
+}
+
+AMF_TARGET_AVX2 static uint32_t interleave_AVX2(const uint8_t* u, const uint8_t* v, uint8_t* uv,
+                                                uint32_t width) {
+    uint32_t i = 0;
+    for (; i + 32 <= width; i += 32) {
+        // unpack works inside 128-bit lanes, pre-swap the middle quarters to keep the order
+        __m256i a = _mm256_permute4x64_epi64(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(u + i)), 0xd8);
+        __m256i b = _mm256_permute4x64_epi64(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i)), 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + i * 2), _mm256_unpacklo_epi8(a, b));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + i * 2 + 32),
+                            _mm256_unpackhi_epi8(a, b));
+    }
+    return i;
+}
+
+AMF_TARGET_AVX2 static uint32_t deinterleave_AVX2(const uint8_t* uv, uint8_t* u, uint8_t* v,
+                                                  uint32_t width) {
+    const __m256i mask = _mm256_set1_epi16(0x00ff);
+    uint32_t i = 0;
+    for (; i + 32 <= width; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(uv + i * 2));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(uv + i * 2 + 32));
+        __m256i even = _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+        __m256i odd = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(u + i),
+                            _mm256_permute4x64_epi64(even, 0xd8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(v + i),
+                            _mm256_permute4x64_epi64(odd, 0xd8));
+    }
+    return i;
+}
+#endif // AMF_ARCH_X86
+
+#if defined(AMF_ARCH_ARM64)
+static uint32_t interleave_NEON(const uint8_t* u, const uint8_t* v, uint8_t* uv, uint32_t width) {
+    uint32_t i = 0;
+    for (; i + 16 <= width; i += 16) {
+        uint8x16x2_t px;
+        px.val[0] = vld1q_u8(u + i);
+        px.val[1] = vld1q_u8(v + i);
+        vst2q_u8(uv + i * 2, px);
+    }
+    return i;
+}
+
+static uint32_t deinterleave_NEON(const uint8_t* uv, uint8_t* u, uint8_t* v, uint32_t width) {
+    uint32_t i = 0;
+    for (; i + 16 <= width; i += 16) {
+        uint8x16x2_t px = vld2q_u8(uv + i * 2);
+        vst1q_u8(u + i, px.val[0]);
+        vst1q_u8(v + i, px.val[1]);
+    }
+    return i;
+}
+#endif // AMF_ARCH_ARM64
+
+struct UVKernels {
+    InterleaveFunc interleave = interleave_C;
+    DeinterleaveFunc deinterleave = deinterleave_C;
+};
+
+static UVKernels selectKernels(SimdLevel level) {
+    UVKernels kernels;
+    switch (resolveSimdLevel(level)) {
+#if defined(AMF_ARCH_X86)
+    case SimdLevel::SSE41:
+        kernels.interleave = interleave_SSE41;
+        kernels.deinterleave = deinterleave_SSE41;
+        break;
+    // Pure shuffles are bound by memory long before 512-bit registers would help
+    case SimdLevel::AVX2:
+    case SimdLevel::AVX512:
+        kernels.interleave = interleave_AVX2;
+        kernels.deinterleave = deinterleave_AVX2;
+        break;
+#endif
+#if defined(AMF_ARCH_ARM64)
+    case SimdLevel::NEON:
+        kernels.interleave = interleave_NEON;
+        kernels.deinterleave = deinterleave_NEON;
+        break;
+#endif
+    default:
+        break;
+    }
+    return kernels;
+}
+
+static UVKernels kernels(SimdLevel level) {
+    static const UVKernels best = selectKernels(SimdLevel::AUTO);
+    return level == SimdLevel::AUTO ? best : selectKernels(level);
+}
+
+void interleaveUVRow(const uint8_t* u, const uint8_t* v, uint8_t* uv, uint32_t width,
+                     SimdLevel level) {
+    const uint32_t done = kernels(level).interleave(u, v, uv, width);
+    interleave_C(u + done, v + done, uv + done * 2, width - done);
+}
+
+void deinterleaveUVRow(const uint8_t* uv, uint8_t* u, uint8_t* v, uint32_t width,
+                       SimdLevel level) {
+    const uint32_t done = kernels(level).deinterleave(uv, u, v, width);
+    deinterleave_C(uv + done * 2, u + done, v + done, width - done);
+}
+
+template <typename Fn>
+static void forChromaRows(uint32_t width, uint32_t height, uint32_t uv_rows, Fn&& fn) {
+    if (static_cast<size_t>(width) * height < kParallelThreshold) {
+        fn(0u, uv_rows);
+        return;
+    }
+    parallelForRows(uv_rows, kMinRowsPerBand, fn);
+}
+
+void copyI420ToNv12(const uint8_t* src_y, uint32_t src_y_pitch, const uint8_t* src_u,
+                    uint32_t src_u_pitch, const uint8_t* src_v, uint32_t src_v_pitch,
+                    uint8_t* dst_y, uint32_t dst_y_pitch, uint8_t* dst_uv, uint32_t dst_uv_pitch,
+                    uint32_t width, uint32_t height, CopyMode mode) {
+    const uint32_t uv_width = (width + 1) / 2;
+    const uint32_t uv_rows = (height + 1) / 2;
+    copyPlane(src_y, src_y_pitch, dst_y, dst_y_pitch, width, height, mode);
+    const auto k = kernels(SimdLevel::AUTO);
+    forChromaRows(width, height, uv_rows, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t row = begin; row < end; row++) {
+            const uint8_t* u = src_u + static_cast<size_t>(row) * src_u_pitch;
+            const uint8_t* v = src_v + static_cast<size_t>(row) * src_v_pitch;
+            uint8_t* uv = dst_uv + static_cast<size_t>(row) * dst_uv_pitch;
+            const uint32_t done = k.interleave(u, v, uv, uv_width);
+            interleave_C(u + done, v + done, uv + done * 2, uv_width - done);
+        }
+    });
+}
+
+void copyNv12ToI420(const uint8_t* src_y, uint32_t src_y_pitch, const uint8_t* src_uv,
+                    uint32_t src_uv_pitch, uint8_t* dst_y, uint32_t dst_y_pitch, uint8_t* dst_u,
+                    uint32_t dst_u_pitch, uint8_t* dst_v, uint32_t dst_v_pitch, uint32_t width,
+                    uint32_t height, CopyMode mode) {
+    const uint32_t uv_width = (width + 1) / 2;
+    const uint32_t uv_rows = (height + 1) / 2;
+    copyPlane(src_y, src_y_pitch, dst_y, dst_y_pitch, width, height, mode);
+    const auto k = kernels(SimdLevel::AUTO);
+    forChromaRows(width, height, uv_rows, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t row = begin; row < end; row++) {
+            const uint8_t* uv = src_uv + static_cast<size_t>(row) * src_uv_pitch;
+            uint8_t* u = dst_u + static_cast<size_t>(row) * dst_u_pitch;
+            uint8_t* v = dst_v + static_cast<size_t>(row) * dst_v_pitch;
+            const uint32_t done = k.deinterleave(uv, u, v, uv_width);
+            deinterleave_C(uv + done * 2, u + done, v + done, uv_width - done);
+        }
+    });
+}
+
+} // namespace amf
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+#include "cpu_features.h"
+#include "plane_copy.h"
+
+namespace amf {
+
+// Planar <-> semi-planar chroma rows, `width` counts chroma samples
+void interleaveUVRow(const uint8_t* u, const uint8_t* v, uint8_t* uv, uint32_t width,
+                     SimdLevel level = SimdLevel::AUTO);
+void deinterleaveUVRow(const uint8_t* uv, uint8_t* u, uint8_t* v, uint32_t width,
+                       SimdLevel level = SimdLevel::AUTO);
+
+// I420 -> NV12, the Y plane goes through copyPlane() with `mode`, UV is interleaved on the way
+void copyI420ToNv12(const uint8_t* src_y, uint32_t src_y_pitch, const uint8_t* src_u,
+                    uint32_t src_u_pitch, const uint8_t* src_v, uint32_t src_v_pitch,
+                    uint8_t* dst_y, uint32_t dst_y_pitch, uint8_t* dst_uv, uint32_t dst_uv_pitch,
+                    uint32_t width, uint32_t height, CopyMode mode = CopyMode::AUTO);
+
+// NV12 -> I420
+void copyNv12ToI420(const uint8_t* src_y, uint32_t src_y_pitch, const uint8_t* src_uv,
+                    uint32_t src_uv_pitch, uint8_t* dst_y, uint32_t dst_y_pitch, uint8_t* dst_u,
+                    uint32_t dst_u_pitch, uint8_t* dst_v, uint32_t dst_v_pitch, uint32_t width,
+                    uint32_t height, CopyMode mode = CopyMode::AUTO);
+
+} // namespace amf